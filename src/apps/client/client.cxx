@@ -49,10 +49,13 @@ Client::Client(QWidget *parent)
     m_lnePort(new QLineEdit),
     m_lneUser(new QLineEdit),
     m_lnePassword(new QLineEdit),
+    m_chkCompress(new QCheckBox(tr("Compress binary transfers"))),
     m_btnLogin(new QPushButton(tr("Login"))),
     m_tcpSocket(new QTcpSocket(this)),
     m_algSignalMapper(new QSignalMapper),
-    m_workspace(new Workspace)
+    m_workspace(new Workspace),
+    m_server_has_model(false),
+    m_jobTimer(new QTimer(this))
 {
     m_workspace->loadModel("/Users/seppke/Desktop/Lenna_face.xgz");
     
@@ -65,6 +68,15 @@ Client::Client(QWidget *parent)
     
     QMenu* mnuAlgs = menuBar()->addMenu("Algorithms");
     
+    QMenu* mnuJobs = menuBar()->addMenu("Jobs");
+    QAction* cancelAct = new QAction("Cancel all jobs", this);
+    mnuJobs->addAction(cancelAct);
+    connect(cancelAct, SIGNAL(triggered()), this, SLOT(cancelJobs()));
+    
+    //Poll the status of the jobs at the server every second
+    m_jobTimer->setInterval(1000);
+    connect(m_jobTimer, SIGNAL(timeout()), this, SLOT(pollJobs()));
+    
     
     
     
@@ -185,8 +197,9 @@ Client::Client(QWidget *parent)
     mainLayout->addWidget(m_lneUser, 2, 1);
     mainLayout->addWidget(passwordLabel, 3, 0);
     mainLayout->addWidget(m_lnePassword, 3, 1);
-    mainLayout->addWidget(m_lblStatus, 4, 0, 1, 2);
-    mainLayout->addWidget(buttonBox, 5, 0, 1, 2);
+    mainLayout->addWidget(m_chkCompress, 4, 0, 1, 2);
+    mainLayout->addWidget(m_lblStatus, 5, 0, 1, 2);
+    mainLayout->addWidget(buttonBox, 6, 0, 1, 2);
     
     setWindowTitle(QGuiApplication::applicationDisplayName());
     m_lnePort->setFocus();
@@ -197,46 +210,62 @@ Client::Client(QWidget *parent)
 
 void Client::sendModel(Model* model)
 {
-    QByteArray model_data;
-    QBuffer out_buf(&model_data);
+    //Identify the model by its content. Thus, the server can tell, if it
+    //already holds the model (e.g. from a previous session).
+    QString hash = Impex::contentHash(model);
+    model->setID(hash);
     
-    //Always use compressed transfer
-    QIOCompressor* compressor = new QIOCompressor(&out_buf);
-    compressor->setStreamFormat(QIOCompressor::GzipFormat);
-
-    if (!compressor->open(QIODevice::WriteOnly))
-    {
-        qWarning("Did not open compressor (gz) on tcpSocket");
-        throw "Error";
-    }
-    
-    QXmlStreamWriter xmlWriter(compressor);
-    model->setID(QString::number(reinterpret_cast<long long>(model)));
-    model->serialize(xmlWriter);
-    compressor->close();
+    QString request0 = QString("Have:%1\n").arg(hash);
     
-    QString request1 = QString("Model:%1\n").arg(model_data.size());
-    
-    qDebug() << "--> " << request1;
-    m_tcpSocket->write(request1.toLatin1());
+    qDebug() << "--> " << request0;
+    m_server_has_model = false;
+    m_tcpSocket->write(request0.toLatin1());
     m_tcpSocket->flush();
     m_tcpSocket->waitForBytesWritten();
+    m_tcpSocket->waitForReadyRead();
     
-    while( m_tcpSocket->bytesToWrite() != 0)
+    if(m_server_has_model)
     {
-        QCoreApplication::processEvents();
+        qDebug("    Model is already held by the server - skipping upload.");
+        return;
     }
     
-    qDebug() << "--> \"Compressed Model Data\"";
-    m_tcpSocket->write(model_data);
-    m_tcpSocket->flush();
-    m_tcpSocket->waitForBytesWritten();
-    
-    while( m_tcpSocket->bytesToWrite() != 0)
+    //Models with raw blocks are sent as binary frames
+    if(model->rawBlockCount() != 0)
     {
-        QCoreApplication::processEvents();
+        QString request1 = QString("RawModel:%1\n").arg(RawModelWriter::version);
+        
+        qDebug() << "--> " << request1;
+        m_tcpSocket->write(request1.toLatin1());
+        
+        qDebug() << "--> \"Binary Model Frame\"";
+        if(!RawModelWriter::write(model, m_tcpSocket, m_chkCompress->isChecked()))
+        {
+            qWarning("Did not write binary model frame on tcpSocket");
+            throw "Error";
+        }
+        m_tcpSocket->flush();
+        
+        while( m_tcpSocket->bytesToWrite() != 0)
+        {
+            if(!m_tcpSocket->waitForBytesWritten())
+            {
+                break;
+            }
+        }
+        
+        m_tcpSocket->waitForReadyRead();
+        return;
     }
     
+    QString request1("ModelStream:0\n");
+    
+    qDebug() << "--> " << request1;
+    m_tcpSocket->write(request1.toLatin1());
+    
+    qDebug() << "--> \"Chunked Model Data\"";
+    writeChunked(model);
+    
     m_tcpSocket->waitForReadyRead();
 }
 
@@ -247,6 +276,8 @@ void Client::registerAtServer()
     if(m_btnLogin->text() == "Logout")
     {
         m_tcpSocket->abort();
+        m_jobTimer->stop();
+        m_jobs.clear();
         m_btnLogin->setText("Login");
         m_lblStatus->setText("Successfully logged out!");
     }
@@ -271,43 +302,45 @@ void Client::registerAtServer()
 
 void Client::sendAlgorithm(Algorithm* alg)
 {
-    QByteArray alg_data;
-    QBuffer out_buf(&alg_data);
+    QString request1("AlgorithmStream:0\r\n");
+    
+    qDebug() << "--> " << request1;
+    m_tcpSocket->write(request1.toLatin1());
+    
+    qDebug() << "--> \"Chunked Algorithm Data\"";
+    writeChunked(alg);
+}
+
+void Client::writeChunked(Serializable* object)
+{
+    //Serialize, compress and send the object at the same time.
+    //The writer blocks if too many bytes are pending on the socket.
+    QChunkedWriter writer(m_tcpSocket);
+    writer.open(QIODevice::WriteOnly);
     
     //Always use compressed transfer
-    QIOCompressor* compressor = new QIOCompressor(&out_buf);
-    compressor->setStreamFormat(QIOCompressor::GzipFormat);
+    QIOCompressor compressor(&writer);
+    compressor.setStreamFormat(QIOCompressor::GzipFormat);
 
-    if (!compressor->open(QIODevice::WriteOnly))
+    if (!compressor.open(QIODevice::WriteOnly))
     {
         qWarning("Did not open compressor (gz) on tcpSocket");
         throw "Error";
     }
     
-    QXmlStreamWriter xmlWriter(compressor);
-    alg->serialize(xmlWriter);
-    compressor->close();
-    
-    QString request1 = QString("Algorithm:%1\r\n").arg(alg_data.size());
-    
-    qDebug() << "--> " << request1;
-    m_tcpSocket->write(request1.toLatin1());
-    m_tcpSocket->flush();
-    m_tcpSocket->waitForBytesWritten();
-    
-    while( m_tcpSocket->bytesToWrite() != 0)
-    {
-        QCoreApplication::processEvents();
-    }
+    QXmlStreamWriter xmlWriter(&compressor);
+    object->serialize(xmlWriter);
+    compressor.close();
+    writer.close();
     
-    qDebug() << "--> \"Compressed Algorithm Data\"";
-    m_tcpSocket->write(alg_data);
     m_tcpSocket->flush();
-    m_tcpSocket->waitForBytesWritten();
     
     while( m_tcpSocket->bytesToWrite() != 0)
     {
-        QCoreApplication::processEvents();
+        if(!m_tcpSocket->waitForBytesWritten())
+        {
+            break;
+        }
     }
 }
 
@@ -373,6 +406,92 @@ void Client::readModel(int bytesToRead)
     }
 }
 
+void Client::readModelStream()
+{
+    try
+    {
+        qDebug() << "<-- \"Chunked Model data\".";
+        
+        //Decompress and deserialize the model while the chunks are arriving
+        QChunkedReader reader(m_tcpSocket);
+        reader.open(QIODevice::ReadOnly);
+        
+        //Always use compressed transfer
+        QIOCompressor compressor(&reader);
+        compressor.setStreamFormat(QIOCompressor::GzipFormat);
+
+        if (!compressor.open(QIODevice::ReadOnly))
+        {
+            qWarning("Did not open compressor (gz) on tcpSocket");
+            throw "Error";
+        }
+        
+        QXmlStreamReader xmlReader(&compressor);
+        Model* new_model = m_workspace->loadModel(xmlReader);
+        
+        if(!reader.skipToEnd())
+        {
+            qWarning("Did not receive the complete chunked stream");
+            throw "Error";
+        }
+        
+        if(new_model == NULL)
+        {
+            qWarning("Did not load a model over the tcpSocket");
+            throw "Error";
+        }
+        
+        qDebug("    Model loaded and added sucessfully!");
+        qDebug() << "Now: " << m_workspace->models.size() << " models available!";
+        
+        m_lblStatus->setText(QString("Models: %1, latest model: %2, type:%3, ID:%4, descripton:%5").arg(m_workspace->models.size()).arg(new_model->name()).arg(new_model->typeName()).arg(new_model->id()).arg(new_model->description()));
+    }
+    catch(...)
+    {
+        qDebug("Error occured!");
+    }
+}
+
+void Client::readRawModel(int version)
+{
+    try
+    {
+        if(version != RawModelWriter::version)
+        {
+            qWarning() << "Unsupported version of binary model frames:" << version;
+            throw "Error";
+        }
+        
+        RawModelReader reader(m_workspace);
+        
+        //Read directly from the socket into the model's storage
+        while(reader.read(m_tcpSocket) && !reader.isFinished())
+        {
+            if(!m_tcpSocket->waitForReadyRead())
+            {
+                break;
+            }
+        }
+        
+        Model* new_model = reader.takeModel();
+        
+        if(new_model == NULL)
+        {
+            qWarning("Did not load a binary model frame over the tcpSocket");
+            throw "Error";
+        }
+        
+        qDebug("    Model loaded and added sucessfully!");
+        qDebug() << "Now: " << m_workspace->models.size() << " models available!";
+        
+        m_lblStatus->setText(QString("Models: %1, latest model: %2, type:%3, ID:%4, descripton:%5").arg(m_workspace->models.size()).arg(new_model->name()).arg(new_model->typeName()).arg(new_model->id()).arg(new_model->description()));
+    }
+    catch(...)
+    {
+        qDebug("Error occured!");
+    }
+}
+
 /**
  * Manages the reading of newly arrived data on the socket
  */
@@ -397,6 +516,66 @@ void Client::readHandler()
             int bytesToRead = data_split[1].toInt();
             readModel(bytesToRead);
         }
+        if(message_type == "ModelStream")
+        {
+            readModelStream();
+        }
+        if(message_type == "RawModel")
+        {
+            readRawModel(data_split[1].toInt());
+        }
+        if(message_type == "Job")
+        {
+            m_jobs.append(data_split[1].toULongLong());
+            m_jobTimer->start();
+            m_lblStatus->setText(QString("Job %1 has been queued!").arg(data_split[1]));
+        }
+        if(message_type == "Jobs")
+        {
+            //Jobs of previous sessions, which may still be running
+            for(const QString& id : data_split[1].split(",", QString::SkipEmptyParts))
+            {
+                if(!m_jobs.contains(id.toULongLong()))
+                {
+                    m_jobs.append(id.toULongLong());
+                }
+            }
+            if(!m_jobs.isEmpty())
+            {
+                m_jobTimer->start();
+            }
+        }
+        if(message_type == "Status")
+        {
+            QStringList status = data_split[1].split(",");
+            
+            if(status.size() == 3)
+            {
+                quint64 job_id = status[0].toULongLong();
+                
+                m_lblStatus->setText(QString("Job %1: %2 (%3%)").arg(status[0]).arg(status[1]).arg(status[2]));
+                
+                if(status[1] != "Queued" && status[1] != "Running")
+                {
+                    //Retrieve the results, this also removes the job at the server
+                    m_jobs.removeAll(job_id);
+                    
+                    QString request1 = QString("Results:%1\n").arg(job_id);
+                    
+                    qDebug() << "--> " << request1;
+                    m_tcpSocket->write(request1.toLatin1());
+                    m_tcpSocket->flush();
+                }
+            }
+            if(m_jobs.isEmpty())
+            {
+                m_jobTimer->stop();
+            }
+        }
+        if(message_type == "Have")
+        {
+            m_server_has_model = (data_split[1] == "1");
+        }
         if(message_type == "Error")
         {
             int bytesToRead = data_split[1].toInt();
@@ -411,8 +590,18 @@ void Client::readHandler()
         {
             m_lblStatus->setText(QString("Successfully logged in!"));
             m_btnLogin->setText("Logout");
+            
+            //Ask for the jobs of previous sessions
+            m_tcpSocket->write(QString("Jobs:0\n").toLatin1());
+            m_tcpSocket->flush();
         }
     }
+    
+    //Several messages (e.g. the results of a job) may have arrived at once
+    if(m_tcpSocket->canReadLine())
+    {
+        readHandler();
+    }
 }
 
 void Client::displayError(QAbstractSocket::SocketError socketError)
@@ -497,4 +686,32 @@ void Client::runAlgorithm(int index)
         alg->results().clear();
     }
 }
+void Client::pollJobs()
+{
+    for(quint64 job_id : m_jobs)
+    {
+        QString request1 = QString("Status:%1\n").arg(job_id);
+        
+        qDebug() << "--> " << request1;
+        m_tcpSocket->write(request1.toLatin1());
+        m_tcpSocket->flush();
+        
+        //Wait for the answer before asking for the next job
+        m_tcpSocket->waitForReadyRead();
+    }
+}
+
+void Client::cancelJobs()
+{
+    for(quint64 job_id : m_jobs)
+    {
+        QString request1 = QString("Cancel:%1\n").arg(job_id);
+        
+        qDebug() << "--> " << request1;
+        m_tcpSocket->write(request1.toLatin1());
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForReadyRead();
+    }
+}
+
 } //namespace graipe
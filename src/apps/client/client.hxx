@@ -39,14 +39,17 @@
 #include <QMainWindow>
 #include <QTcpSocket>
 #include <QSignalMapper>
+#include <QList>
 
 #include "core/core.h"
 
+class QCheckBox;
 class QComboBox;
 class QLabel;
 class QLineEdit;
 class QPushButton;
 class QTcpSocket;
+class QTimer;
 class QNetworkSession;
 
 namespace graipe {
@@ -109,6 +112,17 @@ private slots:
      * \param index The index of the algorithm at the algorithm_factory.
      */
     void runAlgorithm(int index);
+    
+    /**
+     * This slot is called periodically to poll the status of all jobs of
+     * this client, which are queued or running at the server.
+     */
+    void pollJobs();
+    
+    /**
+     * Cancels all jobs of this client, which are queued or running at the server.
+     */
+    void cancelJobs();
 
 private:
     /**
@@ -120,6 +134,29 @@ private:
      */
     inline void readModel(int bytesToRead);
     
+    /**
+     * Inline function to read a received Model, which will be send over TCP
+     * as a binary frame (see RawModelWriter).
+     *
+     * \param version The version of the binary frame format.
+     */
+    inline void readRawModel(int version);
+    
+    /**
+     * Inline function to read a received Model, which will be send over TCP
+     * as a chunked stream (see QChunkedWriter). The model is decompressed
+     * and deserialized while the chunks arrive.
+     */
+    inline void readModelStream();
+    
+    /**
+     * Inline function to write a serializable object (a model or an algorithm)
+     * compressed and as a chunked stream to the server.
+     *
+     * \param object The object to be sent.
+     */
+    inline void writeChunked(Serializable* object);
+    
     /**
      * @{
      *
@@ -131,6 +168,8 @@ private:
     QLineEdit *m_lneUser;
     QLineEdit *m_lnePassword;
     
+    QCheckBox *m_chkCompress;
+    
     QLabel *m_lblStatus;
     QPushButton *m_btnLogin;
     /** 
@@ -148,6 +187,15 @@ private:
     
     /** The workspace of the client **/
     Workspace* m_workspace;
+    
+    /** Did the server answer, that it already holds the last model? **/
+    bool m_server_has_model;
+    
+    /** The ids of the jobs, which are queued or running at the server **/
+    QList<quint64> m_jobs;
+    
+    /** The timer for polling the status of the jobs **/
+    QTimer* m_jobTimer;
 };
 
 } //namespace graipe
@@ -284,7 +284,7 @@ void MainWindow::reset()
 
 void MainWindow::loadModel()
 {	
-	QFileDialog dialog(this, "Load models", m_default_dir, "GRAIPE models (*.xgz *.xml)");
+	QFileDialog dialog(this, "Load models", m_default_dir, "GRAIPE models (*.xgz *.xml *.xraw)");
 	dialog.setFileMode(QFileDialog::ExistingFiles);
 	dialog.setViewMode(QFileDialog::Detail);
 	
@@ -718,7 +718,7 @@ void MainWindow::saveCurrentModel()
 		QString suggested_filename = model->name().replace(" ", "_");
 		QString filename = QFileDialog::getSaveFileName(this, tr("Save Model to file"),
                            suggested_filename,
-                            tr("Packed GRAIPE-models (*.xgz);;Unpacked GRAIPE-models (*.xml)"));
+                            tr("Packed GRAIPE-models (*.xgz);;Unpacked GRAIPE-models (*.xml);;Raw GRAIPE-models (*.xraw)"));
 		
 		if(!filename.isEmpty())
 		{	
@@ -0,0 +1,529 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "jobscheduler.hxx"
+
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QtDebug>
+
+#include <QDateTime>
+
+#include <algorithm>
+
+namespace graipe {
+
+/** The time to live of finished jobs, which have not been retrieved, in ms **/
+static const qint64 finished_job_ttl = 60*60*1000;
+
+/**
+ * Runnable to run a job inside the thread pool of the scheduler.
+ */
+class JobRunnable
+:   public QRunnable
+{
+public:
+    /**
+     * Constructor.
+     *
+     * \param scheduler The scheduler.
+     * \param job       The job to be run.
+     */
+    JobRunnable(JobScheduler* scheduler, JobScheduler::Job* job)
+    :   m_scheduler(scheduler),
+        m_job(job)
+    {
+    }
+    
+    /**
+     * Runs the job.
+     */
+    void run() override
+    {
+        m_scheduler->runJob(m_job);
+    }
+    
+private:
+    /** The scheduler **/
+    JobScheduler* m_scheduler;
+    /** The job **/
+    JobScheduler::Job* m_job;
+};
+
+
+
+
+JobScheduler::JobScheduler(Workspace* wsp, int max_threads, QObject* parent)
+:   QObject(parent),
+    m_workspace(wsp),
+    m_running(0),
+    m_max_running(std::max(max_threads, 1)),
+    m_next_id(1)
+{
+    m_pool.setMaxThreadCount(m_max_running);
+    
+    connect(&m_expire_timer, SIGNAL(timeout()), this, SLOT(expireJobs()));
+    m_expire_timer.start(60*1000);
+}
+
+JobScheduler::~JobScheduler()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        //Do not start any further jobs
+        for(Job* job : m_jobs)
+        {
+            if(job->info.state == Queued)
+            {
+                delete job->algorithm;
+                job->algorithm = NULL;
+                job->info.state = Canceled;
+            }
+        }
+        m_queues.clear();
+        m_round_robin.clear();
+    }
+    
+    m_pool.waitForDone();
+    
+    qDeleteAll(m_jobs);
+    
+    for(const Session& session : m_sessions)
+    {
+        delete session.workspace;
+    }
+}
+
+Workspace* JobScheduler::acquireSession(const QString& user)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if(!m_sessions.contains(user))
+    {
+        Session session;
+        session.workspace = new Workspace(*m_workspace);
+        session.connections = 0;
+        m_sessions[user] = session;
+    }
+    
+    m_sessions[user].connections++;
+    return m_sessions[user].workspace;
+}
+
+void JobScheduler::releaseSession(const QString& user)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if(m_sessions.contains(user))
+    {
+        m_sessions[user].connections--;
+        cleanupSession(user);
+    }
+}
+
+quint64 JobScheduler::submit(const QString& user, Algorithm* alg)
+{
+    //The models, which are needed by the algorithm
+    std::vector<Model*> inputs;
+    
+    for(auto item : *alg->parameters())
+    {
+        for(Model* model : item.second->needsModels())
+        {
+            inputs.push_back(model);
+        }
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    //Reject algorithms, which need models of expired jobs
+    if(m_sessions.contains(user))
+    {
+        Workspace* wsp = m_sessions[user].workspace;
+        QMutexLocker models_locker(&wsp->models_mutex);
+        
+        for(Model* model : inputs)
+        {
+            if(std::find(wsp->models.begin(), wsp->models.end(), model) == wsp->models.end())
+            {
+                qWarning() << "JobScheduler: Rejected a job of user" << user << "since it needs a deleted model";
+                delete alg;
+                return 0;
+            }
+        }
+    }
+    
+    Job* job = new Job;
+    job->info.id = m_next_id++;
+    job->info.user = user;
+    job->info.state = Queued;
+    job->info.progress = 0;
+    job->algorithm = alg;
+    job->inputs = inputs;
+    job->cancel_requested = false;
+    job->finished_at = 0;
+    
+    m_jobs[job->info.id] = job;
+    
+    if(!m_queues.contains(user))
+    {
+        m_round_robin.append(user);
+    }
+    m_queues[user].enqueue(job);
+    
+    qDebug() << "JobScheduler: Queued job" << job->info.id << "of user" << user;
+    
+    dispatch();
+    
+    return job->info.id;
+}
+
+bool JobScheduler::jobInfo(const QString& user, quint64 id, JobInfo& info) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    Job* job = m_jobs.value(id, NULL);
+    
+    if(job == NULL || job->info.user != user)
+    {
+        return false;
+    }
+    
+    info = job->info;
+    return true;
+}
+
+QVector<quint64> JobScheduler::jobs(const QString& user) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QVector<quint64> result;
+    
+    for(Job* job : m_jobs)
+    {
+        if(job->info.user == user)
+        {
+            result.push_back(job->info.id);
+        }
+    }
+    return result;
+}
+
+bool JobScheduler::cancel(const QString& user, quint64 id)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    Job* job = m_jobs.value(id, NULL);
+    
+    if(job == NULL || job->info.user != user)
+    {
+        return false;
+    }
+    
+    switch(job->info.state)
+    {
+        case Queued:
+            m_queues[user].removeOne(job);
+            if(m_queues[user].isEmpty())
+            {
+                m_queues.remove(user);
+                m_round_robin.removeOne(user);
+            }
+            delete job->algorithm;
+            job->algorithm = NULL;
+            job->info.state = Canceled;
+            job->finished_at = QDateTime::currentMSecsSinceEpoch();
+            return true;
+            
+        case Running:
+            job->cancel_requested = true;
+            job->algorithm->cancel();
+            return true;
+            
+        case Canceled:
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+bool JobScheduler::takeResults(const QString& user, quint64 id, std::vector<Model*>& results)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    Job* job = m_jobs.value(id, NULL);
+    
+    if(job == NULL || job->info.user != user || job->info.state == Queued || job->info.state == Running)
+    {
+        return false;
+    }
+    
+    results = job->results;
+    
+    m_jobs.remove(id);
+    delete job;
+    
+    return true;
+}
+
+QString JobScheduler::stateName(JobState state)
+{
+    switch(state)
+    {
+        case Queued:
+            return "Queued";
+        case Running:
+            return "Running";
+        case Finished:
+            return "Finished";
+        case Failed:
+            return "Failed";
+        case Canceled:
+        default:
+            return "Canceled";
+    }
+}
+
+void JobScheduler::dispatch()
+{
+    while(m_running < m_max_running && !m_round_robin.isEmpty())
+    {
+        //Serve the users one after another
+        QString user = m_round_robin.takeFirst();
+        
+        Job* job = m_queues[user].dequeue();
+        
+        if(m_queues[user].isEmpty())
+        {
+            m_queues.remove(user);
+        }
+        else
+        {
+            m_round_robin.append(user);
+        }
+        
+        job->info.state = Running;
+        m_running++;
+        
+        qDebug() << "JobScheduler: Starting job" << job->info.id << "of user" << user;
+        
+        m_pool.start(new JobRunnable(this, job));
+    }
+}
+
+void JobScheduler::runJob(Job* job)
+{
+    Algorithm* alg = job->algorithm;
+    bool failed = false;
+    
+    //The algorithm reports by means of signals, which are handled in this thread
+    //Receivers must not throw: A canceled algorithm leaves its run() by itself
+    connect(alg, &Algorithm::statusMessage, [&](float p, QString message){
+                QMutexLocker locker(&m_mutex);
+                job->info.progress = p;
+                job->info.message = message;
+            });
+    connect(alg, &Algorithm::errorMessage, [&](QString message){
+                QMutexLocker locker(&m_mutex);
+                job->info.message = message;
+                failed = true;
+            });
+    
+    try
+    {
+        alg->run();
+    }
+    catch(...)
+    {
+        failed = true;
+    }
+    
+    std::vector<Model*> results = alg->results();
+    
+    {
+        //cancel() must not access the algorithm any more
+        QMutexLocker locker(&m_mutex);
+        job->algorithm = NULL;
+    }
+    delete alg;
+    
+    QMutexLocker locker(&m_mutex);
+    
+    job->finished_at = QDateTime::currentMSecsSinceEpoch();
+    
+    if(job->cancel_requested)
+    {
+        //The results are not needed anymore
+        qDeleteAll(results);
+        job->info.state = Canceled;
+    }
+    else if(failed)
+    {
+        qDeleteAll(results);
+        job->info.state = Failed;
+    }
+    else
+    {
+        job->results = results;
+        job->info.progress = 100;
+        job->info.state = Finished;
+    }
+    
+    qDebug() << "JobScheduler: Job" << job->info.id << "of user" << job->info.user << stateName(job->info.state);
+    
+    m_running--;
+    dispatch();
+}
+
+void JobScheduler::cleanupSession(const QString& user)
+{
+    if(!m_sessions.contains(user) || m_sessions[user].connections > 0)
+    {
+        return;
+    }
+    
+    for(Job* job : m_jobs)
+    {
+        if(job->info.user == user)
+        {
+            return;
+        }
+    }
+    
+    delete m_sessions[user].workspace;
+    m_sessions.remove(user);
+}
+
+bool JobScheduler::isReferenced(const QString& user, Model* model) const
+{
+    for(Job* job : m_jobs)
+    {
+        if(     job->info.user == user
+            &&  (   std::find(job->inputs.begin(), job->inputs.end(), model) != job->inputs.end()
+                 || std::find(job->results.begin(), job->results.end(), model) != job->results.end()))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::expireJobs()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList users;
+    
+    //The results of the expired jobs, which are not needed by other jobs
+    std::vector<std::pair<QString, Model*> > expired_models;
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        for(QMap<quint64, Job*>::iterator iter = m_jobs.begin(); iter != m_jobs.end(); )
+        {
+            Job* job = iter.value();
+            
+            if(     job->info.state != Queued && job->info.state != Running
+                &&  now - job->finished_at > finished_job_ttl)
+            {
+                qDebug() << "JobScheduler: Job" << job->info.id << "of user" << job->info.user << "expired";
+                
+                users.append(job->info.user);
+                
+                for(Model* model : job->results)
+                {
+                    expired_models.push_back(std::make_pair(job->info.user, model));
+                }
+                delete job;
+                iter = m_jobs.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        
+        users.removeDuplicates();
+        
+        //Only the job's references are dropped for models, which are still needed
+        expired_models.erase(std::remove_if(expired_models.begin(), expired_models.end(),
+                                            [&](const std::pair<QString, Model*>& item)
+                                            {
+                                                return isReferenced(item.first, item.second);
+                                            }),
+                             expired_models.end());
+        
+        //Models, which are not in the workspace any more, cannot be found by new jobs
+        for(const std::pair<QString, Model*>& item : expired_models)
+        {
+            Workspace* wsp = item.second->workspace();
+            QMutexLocker models_locker(&wsp->models_mutex);
+            wsp->models.erase(std::remove(wsp->models.begin(), wsp->models.end(), item.second), wsp->models.end());
+        }
+        
+        //Keep the sessions alive, until their models have been deleted
+        for(const QString& user : users)
+        {
+            if(m_sessions.contains(user))
+            {
+                m_sessions[user].connections++;
+            }
+        }
+    }
+    
+    //Wait for other connections, which currently read the models
+    //This must not block the scheduler, since running jobs report their status
+    for(const std::pair<QString, Model*>& item : expired_models)
+    {
+        unsigned int unlock_code = item.second->lockForWrite();
+        item.second->unlock(unlock_code);
+        delete item.second;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    for(const QString& user : users)
+    {
+        if(m_sessions.contains(user))
+        {
+            m_sessions[user].connections--;
+            cleanupSession(user);
+        }
+    }
+}
+
+} //namespace graipe
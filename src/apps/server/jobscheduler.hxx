@@ -0,0 +1,306 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_SERVER_JOBSCHEDULER_HXX
+#define GRAIPE_SERVER_JOBSCHEDULER_HXX
+
+#include "core/algorithm.hxx"
+#include "core/workspace.hxx"
+
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <vector>
+
+namespace graipe {
+
+/**
+ * The job scheduler of the server. Algorithms, which are submitted by the
+ * users, are queued as jobs and run by a bounded pool of threads. Each user
+ * has an own queue and the queues are served in a round-robin manner. Thus,
+ * a user, who submits many jobs, cannot starve the other users.
+ *
+ * Each user works on a session workspace, which is shared by all connections
+ * of the user and outlives them as long as there are jobs of the user left.
+ * Thus, the results of jobs may be retrieved after reconnecting. Jobs, whose
+ * results have not been retrieved within an hour after they finished, expire.
+ * Their results are then removed from the session workspace, unless they are
+ * needed by other jobs of the user.
+ *
+ * All methods are thread-safe.
+ */
+class JobScheduler
+:   public QObject
+{
+    Q_OBJECT
+    
+public:
+    /**
+     * The states of a job.
+     */
+    enum JobState { Queued, Running, Finished, Failed, Canceled };
+    
+    /**
+     * Brief struct for the status of a job.
+     */
+    struct JobInfo
+    {
+        /** the unique id of the job **/
+        quint64 id;
+        /** the user, who submitted the job **/
+        QString user;
+        /** the state of the job **/
+        JobState state;
+        /** the progress of the job in percent **/
+        float progress;
+        /** the last status or error message of the job **/
+        QString message;
+    };
+    
+    /**
+     * Creates a new job scheduler.
+     *
+     * \param wsp         The workspace of the server, which provides the factories.
+     * \param max_threads The maximal count of concurrently running jobs.
+     * \param parent      Pointer to the parent object, defaults to NULL.
+     */
+    JobScheduler(Workspace* wsp, int max_threads = QThread::idealThreadCount(), QObject* parent = NULL);
+    
+    /**
+     * Destructor: Cancels all queued jobs and waits for the running jobs.
+     */
+    ~JobScheduler();
+    
+    /**
+     * Returns the session workspace of a user and registers a new connection
+     * for it. The workspace is created on first use.
+     *
+     * \param user The user.
+     * \return The session workspace of the user.
+     */
+    Workspace* acquireSession(const QString& user);
+    
+    /**
+     * Unregisters a connection of a user. If the user has neither connections
+     * nor jobs left, the session workspace will be deleted.
+     *
+     * \param user The user.
+     */
+    void releaseSession(const QString& user);
+    
+    /**
+     * Queues an algorithm as a new job. The scheduler takes the ownership of
+     * the algorithm, which needs to be created using the session workspace
+     * of the user. If the algorithm needs models, which have been removed from
+     * the session workspace in the meantime (see expireJobs()), the algorithm
+     * is deleted instead.
+     *
+     * \param user The user, who submits the job.
+     * \param alg  The algorithm to be run.
+     * \return The unique id of the new job or 0, if the algorithm was rejected.
+     */
+    quint64 submit(const QString& user, Algorithm* alg);
+    
+    /**
+     * Get the status of a job.
+     *
+     * \param user The user, who submitted the job.
+     * \param id   The id of the job.
+     * \param info The status of the job will be written here.
+     * \return True, if the user has a job with this id.
+     */
+    bool jobInfo(const QString& user, quint64 id, JobInfo& info) const;
+    
+    /**
+     * Get all jobs of a user, which have not been retrieved yet.
+     *
+     * \param user The user.
+     * \return The ids of the user's jobs.
+     */
+    QVector<quint64> jobs(const QString& user) const;
+    
+    /**
+     * Cancels a job. Queued jobs are removed from the queue. For running jobs,
+     * the cancellation is requested from the algorithm (see Algorithm::cancel()).
+     * The algorithm leaves its run() at its next check of the cancellation and
+     * its results will be discarded.
+     *
+     * \param user The user, who submitted the job.
+     * \param id   The id of the job.
+     * \return True, if the job is (or will be) canceled.
+     */
+    bool cancel(const QString& user, quint64 id);
+    
+    /**
+     * Retrieves the results of a job and removes the job from the scheduler.
+     * This is only possible for jobs, which are not queued or running any more.
+     * The results remain in the user's session workspace.
+     *
+     * \param user    The user, who submitted the job.
+     * \param id      The id of the job.
+     * \param results The results of the job will be written here.
+     * \return True, if the job has been removed.
+     */
+    bool takeResults(const QString& user, quint64 id, std::vector<Model*>& results);
+    
+    /**
+     * Converts a job state into a string for the protocol.
+     *
+     * \param state The job state.
+     * \return The name of the state.
+     */
+    static QString stateName(JobState state);
+    
+private:
+    /**
+     * A scheduled job.
+     */
+    struct Job
+    {
+        /** the status of the job **/
+        JobInfo info;
+        /** the algorithm of the job, NULL after running it **/
+        Algorithm* algorithm;
+        /** the models, which are needed by the algorithm **/
+        std::vector<Model*> inputs;
+        /** the results of the job **/
+        std::vector<Model*> results;
+        /** has the job been canceled while running? **/
+        bool cancel_requested;
+        /** the time, when the job has been finished (ms since epoch) **/
+        qint64 finished_at;
+    };
+    
+    /**
+     * A session of a user.
+     */
+    struct Session
+    {
+        /** the workspace of the session **/
+        Workspace* workspace;
+        /** the count of connections of the user **/
+        int connections;
+    };
+    
+    /**
+     * Starts queued jobs as long as there are free threads.
+     * Needs to be called with the mutex locked.
+     */
+    void dispatch();
+    
+    /**
+     * Runs a job. This is called from the pool's threads.
+     *
+     * \param job The job to be run.
+     */
+    void runJob(Job* job);
+    
+    /**
+     * Deletes the session of a user, if there are neither connections nor
+     * jobs of the user left. Needs to be called with the mutex locked.
+     *
+     * \param user The user.
+     */
+    void cleanupSession(const QString& user);
+    
+    /**
+     * Checks if a model is needed by any job of a user, either as an input
+     * of the algorithm or as a result. Needs to be called with the mutex locked.
+     *
+     * \param user  The user.
+     * \param model The model.
+     * \return True, if any job of the user references the model.
+     */
+    bool isReferenced(const QString& user, Model* model) const;
+    
+private slots:
+    /**
+     * Deletes all jobs, which have not been retrieved within the time to live
+     * after they finished. Their results are removed from the session workspace
+     * and deleted, if no other job of the user references them. Since other
+     * connections may still access the results, each one is locked for writing
+     * before it is deleted. Afterwards, the sessions of users without connections
+     * and jobs are deleted.
+     */
+    void expireJobs();
+    
+private:
+    //The runnable needs to call runJob()
+    friend class JobRunnable;
+    
+    /** The workspace of the server **/
+    Workspace* m_workspace;
+    
+    /** The pool of worker threads **/
+    QThreadPool m_pool;
+    
+    /** The timer for the expiration of finished jobs **/
+    QTimer m_expire_timer;
+    
+    /** The mutex to protect all members below **/
+    mutable QMutex m_mutex;
+    
+    /** The sessions of all users **/
+    QMap<QString, Session> m_sessions;
+    
+    /** All jobs, which have not been retrieved yet **/
+    QMap<quint64, Job*> m_jobs;
+    
+    /** The queues of each user **/
+    QMap<QString, QQueue<Job*> > m_queues;
+    
+    /** The users with queued jobs in the order they will be served **/
+    QStringList m_round_robin;
+    
+    /** The count of currently running jobs **/
+    int m_running;
+    
+    /** The maximal count of concurrently running jobs **/
+    int m_max_running;
+    
+    /** The id for the next job **/
+    quint64 m_next_id;
+};
+
+} //namespace graipe
+
+#endif //GRAIPE_SERVER_JOBSCHEDULER_HXX
@@ -0,0 +1,154 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "modelcache.hxx"
+#include "core/core.h"
+
+#include <QBuffer>
+#include <QMutexLocker>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+namespace graipe {
+
+ModelCache::ModelCache(qint64 max_bytes)
+:   m_bytes(0),
+    m_max_bytes(max_bytes)
+{
+}
+
+bool ModelCache::contains(const QString& hash) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.contains(hash);
+}
+
+bool ModelCache::insert(const QString& hash, Model* model)
+{
+    Entry entry;
+    entry.raw = (model->rawBlockCount() != 0);
+    
+    QBuffer buffer(&entry.data);
+    buffer.open(QIODevice::WriteOnly);
+    
+    if(entry.raw)
+    {
+        if(!RawModelWriter::write(model, &buffer, true))
+        {
+            return false;
+        }
+        buffer.close();
+    }
+    else
+    {
+        QXmlStreamWriter xmlWriter(&buffer);
+        model->serialize(xmlWriter);
+        buffer.close();
+        
+        entry.data = qCompress(entry.data);
+    }
+    
+    qint64 bytes = entry.data.size();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    if(bytes > m_max_bytes || m_entries.contains(hash))
+    {
+        return false;
+    }
+    
+    //Evict the least recently used models until the new one fits
+    while(m_bytes + bytes > m_max_bytes && !m_lru.isEmpty())
+    {
+        m_bytes -= m_entries.take(m_lru.takeFirst()).data.size();
+    }
+    
+    m_entries.insert(hash, entry);
+    m_lru.append(hash);
+    m_bytes += bytes;
+    
+    return true;
+}
+
+Model* ModelCache::load(const QString& hash, Workspace* wsp)
+{
+    Entry entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        QHash<QString, Entry>::const_iterator iter = m_entries.constFind(hash);
+        
+        if(iter == m_entries.constEnd())
+        {
+            return NULL;
+        }
+        //Implicitly shared: The data stays valid, even if evicted meanwhile.
+        entry = iter.value();
+        
+        //Mark as recently used
+        m_lru.removeOne(hash);
+        m_lru.append(hash);
+    }
+    
+    if(entry.raw)
+    {
+        QBuffer buffer(&entry.data);
+        buffer.open(QIODevice::ReadOnly);
+        
+        //All data is available: The reader finishes within one call
+        RawModelReader reader(wsp);
+        reader.read(&buffer);
+        return reader.takeModel();
+    }
+    else
+    {
+        QByteArray xml_data = qUncompress(entry.data);
+        QXmlStreamReader xmlReader(xml_data);
+        return wsp->loadModel(xmlReader);
+    }
+}
+
+qint64 ModelCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+qint64 ModelCache::maxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_max_bytes;
+}
+
+} //namespace graipe
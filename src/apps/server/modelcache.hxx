@@ -0,0 +1,141 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_SERVER_MODELCACHE_HXX
+#define GRAIPE_SERVER_MODELCACHE_HXX
+
+#include "core/model.hxx"
+
+#include <QByteArray>
+#include <QHash>
+#include <QLinkedList>
+#include <QMutex>
+#include <QString>
+
+namespace graipe {
+
+/**
+ * A content-addressed store of models, which is shared by all WorkerThreads of
+ * the server. Each model is kept in its compressed serialized form (a binary
+ * model frame with zlib compressed blocks for models with raw blocks, otherwise
+ * the compressed XML serialization) and is identified by its content hash
+ * (see Impex::contentHash()). Thus, clients may ask for models by their hash
+ * and skip the upload, if the server already holds them.
+ *
+ * The cache evicts the least recently used models, if the memory budget in
+ * bytes is exceeded. All methods are thread-safe.
+ */
+class ModelCache
+{
+public:
+    /**
+     * Creates an empty model cache.
+     *
+     * \param max_bytes The memory budget of the cache in bytes.
+     */
+    ModelCache(qint64 max_bytes = qint64(1)<<30);
+    
+    /**
+     * Checks if the cache holds a model with the given hash. This does not
+     * change the order of eviction.
+     *
+     * \param hash The content hash of the model.
+     * \return True, if the model is held by the cache.
+     */
+    bool contains(const QString& hash) const;
+    
+    /**
+     * Stores a model in the cache using its content hash. The model's ID
+     * should be the content hash, too. Models, which exceed the complete
+     * memory budget, will not be stored.
+     *
+     * \param hash  The content hash of the model.
+     * \param model The model.
+     * \return True, if the model is stored in the cache.
+     */
+    bool insert(const QString& hash, Model* model);
+    
+    /**
+     * Deserializes a model of the cache into a workspace. Marks the model as
+     * recently used.
+     *
+     * \param hash The content hash of the model.
+     * \param wsp  The workspace, where the model will be added to.
+     * \return The new model or NULL, if the model is not held by the cache.
+     */
+    Model* load(const QString& hash, Workspace* wsp);
+    
+    /**
+     * The memory currently used by the cache.
+     *
+     * \return The size of all serialized models of the cache in bytes.
+     */
+    qint64 size() const;
+    
+    /**
+     * The memory budget of the cache.
+     *
+     * \return The maximal size of all serialized models of the cache in bytes.
+     */
+    qint64 maxSize() const;
+    
+private:
+    /**
+     * The serialized form of a cached model
+     */
+    struct Entry
+    {
+        /** The serialized data **/
+        QByteArray data;
+        /** Is the data a binary model frame (or XML)? **/
+        bool raw;
+    };
+    
+    /** The entries of the cache **/
+    QHash<QString, Entry> m_entries;
+    
+    /** The hashes of the entries, least recently used first **/
+    QLinkedList<QString> m_lru;
+    
+    /** The size of all entries and the memory budget in bytes **/
+    qint64 m_bytes, m_max_bytes;
+    
+    /** The mutex to protect the cache **/
+    mutable QMutex m_mutex;
+};
+
+} //namespace graipe
+
+#endif //GRAIPE_SERVER_MODELCACHE_HXX
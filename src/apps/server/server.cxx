@@ -46,7 +46,8 @@ namespace graipe {
 
 Server::Server(Workspace* wsp, QObject *parent)
     : QTcpServer(parent),
-    m_workspace(wsp)
+    m_workspace(wsp),
+    m_scheduler(wsp)
 {
     qDebug()    << "Server knows factories: models " << m_workspace->modelFactory().size()
                 << ", ViewControllers: " << m_workspace->viewControllerFactory().size()
@@ -98,7 +99,7 @@ void Server::incomingConnection(qintptr socketDescriptor)
 {
     qDebug() << "New incoming connection for socket:" << socketDescriptor;
     
-    WorkerThread *thread = new WorkerThread(socketDescriptor, m_registered_users, m_workspace, this);
+    WorkerThread *thread = new WorkerThread(socketDescriptor, m_registered_users, &m_model_cache, &m_scheduler, this);
     connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
     connect(thread, SIGNAL(connectionUserAuth(qintptr, QString)), this, SLOT(connectionUserAuth(qintptr, QString)));
     connect(thread, SIGNAL(connectionTerminated(qintptr)), this, SLOT(connectionTerminated(qintptr)));
@@ -39,6 +39,8 @@
 #include <QStringList>
 #include <QTcpServer>
 #include "core/workspace.hxx"
+#include "jobscheduler.hxx"
+#include "modelcache.hxx"
 
 namespace graipe {
 
@@ -121,6 +123,12 @@ private:
     
     /** All active connections **/
     QVector<ConnectionInfo> m_connections;
+    
+    /** The content-addressed model cache shared by all connections **/
+    ModelCache m_model_cache;
+    
+    /** The job scheduler shared by all connections **/
+    JobScheduler m_scheduler;
 };
 
 } //namespace graipe
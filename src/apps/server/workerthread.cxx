@@ -43,18 +43,24 @@
 
 namespace graipe {
 
-WorkerThread::WorkerThread(qintptr socketDescriptor, QVector<QString> registered_users, Workspace* wsp, QObject *parent)
+/** The maximal size of a chunked algorithm description, which is buffered before running it **/
+static const int max_algorithm_stream_size = 1 << 26;
+/** The size of the chunks, in which a chunked algorithm description is read **/
+static const int algorithm_stream_chunk_size = 1 << 16;
+
+WorkerThread::WorkerThread(qintptr socketDescriptor, QVector<QString> registered_users, ModelCache* model_cache, JobScheduler* scheduler, QObject *parent)
 :   QThread(parent),
     m_socketDescriptor(socketDescriptor),
     m_tcpSocket(NULL),
     m_registered_users(registered_users),
     m_state(-1),
     m_expected_bytes(0),
-    m_workspace(new Workspace(*wsp))
+    m_workspace(NULL),
+    m_raw_reader(NULL),
+    m_compress(false),
+    m_model_cache(model_cache),
+    m_scheduler(scheduler)
 {
-    qDebug()    << "Server knows factories: models " << m_workspace->modelFactory().size()
-                << ", ViewControllers: " << m_workspace->viewControllerFactory().size()
-                << ", algorithms: " << m_workspace->algorithmFactory().size();
 }
 
 void WorkerThread::run()
@@ -67,6 +73,9 @@ void WorkerThread::run()
         return;
     }
     
+    //Bound the socket's buffer. If it is full, TCP flow control throttles the client
+    m_tcpSocket->setReadBufferSize(1<<22);
+    
     connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(readyRead()), Qt::DirectConnection);
     connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(disconnected()));
 
@@ -96,6 +105,11 @@ void WorkerThread::readyRead()
                 m_state = 0;
                 qDebug() << m_socketDescriptor <<  "--- logged in unsing:" << account;
                 
+                //Continue the user's session (or start a new one)
+                m_user = split_data[1];
+                m_workspace = m_scheduler->acquireSession(m_user);
+                m_raw_reader = new RawModelReader(m_workspace);
+                
                 //Tell the server
                 emit connectionUserAuth(m_socketDescriptor, split_data[1]);
                 
@@ -127,6 +141,138 @@ void WorkerThread::readyRead()
                     readyRead();
                 }
             }
+            else if(split_data[0] == "Have")
+            {
+                //Does the session's workspace already hold the model?
+                bool available = false;
+                {
+                    QMutexLocker locker(&m_workspace->models_mutex);
+                    
+                    for(Model* model : m_workspace->models)
+                    {
+                        if(model->id() == split_data[1])
+                        {
+                            available = true;
+                            break;
+                        }
+                    }
+                }
+                
+                //Otherwise: Does the shared cache hold the model?
+                if(!available && m_model_cache->load(split_data[1], m_workspace) != NULL)
+                {
+                    qDebug() << m_socketDescriptor << "--- Model loaded from cache:" << split_data[1];
+                    available = true;
+                }
+                
+                if(available)
+                {
+                    m_tcpSocket->write(QString("Have:1").toLatin1());
+                }
+                else
+                {
+                    m_tcpSocket->write(QString("Have:0").toLatin1());
+                }
+                m_tcpSocket->flush();
+                m_tcpSocket->waitForBytesWritten();
+            }
+            else if(split_data[0] == "Status")
+            {
+                JobScheduler::JobInfo info;
+                
+                if(m_scheduler->jobInfo(m_user, split_data[1].toULongLong(), info))
+                {
+                    m_tcpSocket->write(QString("Status:%1,%2,%3").arg(info.id).arg(JobScheduler::stateName(info.state)).arg(info.progress).toLatin1());
+                }
+                else
+                {
+                    m_tcpSocket->write(QString("Error:0").toLatin1());
+                }
+                m_tcpSocket->flush();
+                m_tcpSocket->waitForBytesWritten();
+            }
+            else if(split_data[0] == "Jobs")
+            {
+                QStringList ids;
+                
+                for(quint64 id : m_scheduler->jobs(m_user))
+                {
+                    ids.append(QString::number(id));
+                }
+                m_tcpSocket->write(QString("Jobs:%1").arg(ids.join(",")).toLatin1());
+                m_tcpSocket->flush();
+                m_tcpSocket->waitForBytesWritten();
+            }
+            else if(split_data[0] == "Cancel")
+            {
+                if(m_scheduler->cancel(m_user, split_data[1].toULongLong()))
+                {
+                    m_tcpSocket->write(QString("Success:0").toLatin1());
+                }
+                else
+                {
+                    m_tcpSocket->write(QString("Error:0").toLatin1());
+                }
+                m_tcpSocket->flush();
+                m_tcpSocket->waitForBytesWritten();
+            }
+            else if(split_data[0] == "Results")
+            {
+                std::vector<Model*> results;
+                
+                if(m_scheduler->takeResults(m_user, split_data[1].toULongLong(), results))
+                {
+                    try
+                    {
+                        for(Model* model : results)
+                        {
+                            sendModel(model);
+                        }
+                    }
+                    catch(...)
+                    {
+                        qWarning() << m_socketDescriptor << "--- Did not send all results of job" << split_data[1];
+                    }
+                }
+                else
+                {
+                    m_tcpSocket->write(QString("Error:0").toLatin1());
+                    m_tcpSocket->flush();
+                    m_tcpSocket->waitForBytesWritten();
+                }
+            }
+            else if(split_data[0] == "ModelStream")
+            {
+                m_state = 4;
+                readModelStream();
+                m_state = 0;
+            }
+            else if(split_data[0] == "AlgorithmStream")
+            {
+                m_state = 4;
+                readAlgorithmStream();
+                m_state = 0;
+            }
+            else if(split_data[0] == "RawModel")
+            {
+                if(split_data[1].toInt() != RawModelWriter::version)
+                {
+                    qWarning() << m_socketDescriptor << "--- Unsupported version of binary model frames:" << split_data[1];
+                    m_tcpSocket->write(QString("Error:0").toLatin1());
+                    m_tcpSocket->flush();
+                    m_tcpSocket->waitForBytesWritten();
+                }
+                else
+                {
+                    m_state = 3;
+                    m_raw_reader->reset();
+                    //Maybe some bytes already arrived?
+                    if(m_tcpSocket->bytesAvailable())
+                    {
+                        readyRead();
+                    }
+                }
+            }
             else if(split_data[0] == "Algorithm")
             {
                 m_state = 2;
@@ -149,7 +295,8 @@ void WorkerThread::readyRead()
         
         if(m_buffer.size() == m_expected_bytes)
         {
-            readModel();
+            QBuffer in_buf(&m_buffer);
+            readModel(&in_buf);
             m_state = 0;
             m_expected_bytes = 0;
             m_buffer.clear();
@@ -168,7 +315,8 @@ void WorkerThread::readyRead()
         
         if(m_buffer.size() == m_expected_bytes)
         {
-            readAndRunAlgorithm();
+            QBuffer in_buf(&m_buffer);
+            readAndRunAlgorithm(&in_buf);
             m_state = 0;
             m_expected_bytes = 0;
             m_buffer.clear();
@@ -178,6 +326,11 @@ void WorkerThread::readyRead()
             qDebug()  << m_socketDescriptor << "--- Still waiting for more Algorithm bytes";
         }
     }
+    else if(m_state == 3)
+    {
+        readRawModel();
+    }
+    //State 4: A chunked stream is being read synchronously - nothing to do here.
 }
 
 void WorkerThread::disconnected()
@@ -187,34 +340,34 @@ void WorkerThread::disconnected()
     //Tell the server
     emit connectionTerminated(m_socketDescriptor);
 
-    delete m_workspace;
+    delete m_raw_reader;
+    
+    //The session is kept by the scheduler as long as there are jobs left
+    if(m_workspace != NULL)
+    {
+        m_scheduler->releaseSession(m_user);
+    }
     m_tcpSocket->deleteLater();
     exit(0);
 }
 
-void WorkerThread::readModel()
+void WorkerThread::readModel(QIODevice* in_device)
 {
     try
     {
-        QByteArray in_model_data = m_buffer;
-        
-        QBuffer in_buf(&in_model_data);
-        
         //Always use compressed transfer
-        QIOCompressor* in_compressor = new QIOCompressor(&in_buf);
-        in_compressor->setStreamFormat(QIOCompressor::GzipFormat);
+        QIOCompressor in_compressor(in_device);
+        in_compressor.setStreamFormat(QIOCompressor::GzipFormat);
 
-        if (!in_compressor->open(QIODevice::ReadOnly))
+        if (!in_compressor.open(QIODevice::ReadOnly))
         {
             qWarning()  << m_socketDescriptor << "--- Did not open compressor (gz) on tcpSocket";
             throw "Error";
         }
         
-        QXmlStreamReader xmlReader(in_compressor);
+        QXmlStreamReader xmlReader(&in_compressor);
         
-        m_workspace->global_algorithm_mutex.lock();
         Model* new_model = m_workspace->loadModel(xmlReader);
-        m_workspace->global_algorithm_mutex.unlock();
         
         if(new_model == NULL)
         {
@@ -223,6 +376,8 @@ void WorkerThread::readModel()
             
         }
         
+        cacheModel(new_model);
+        
         qDebug() << m_socketDescriptor << "--- Model loaded and added sucessfully!";
         qDebug() << m_socketDescriptor << "--- Now: " << m_workspace->models.size() << " models available!";
         
@@ -241,26 +396,180 @@ void WorkerThread::readModel()
     }
 }
 
-void WorkerThread::readAndRunAlgorithm()
+void WorkerThread::cacheModel(Model* model)
 {
-    try
+    //Only models, which are identified by their content, may be shared
+    QString hash = Impex::contentHash(model);
+    
+    if(model->id() == hash && !m_model_cache->contains(hash))
+    {
+        m_model_cache->insert(hash, model);
+        qDebug() << m_socketDescriptor << "--- Model added to cache:" << hash
+                 << "(" << m_model_cache->size() << "of" << m_model_cache->maxSize() << "bytes used)";
+    }
+}
+
+void WorkerThread::readModelStream()
+{
+    qDebug()  << m_socketDescriptor << "--> \"Chunked Model data\".";
+    
+    //Decompress and deserialize the model while the chunks are arriving
+    QChunkedReader reader(m_tcpSocket);
+    reader.open(QIODevice::ReadOnly);
+    
+    readModel(&reader);
+    
+    if(!reader.skipToEnd())
     {
-        QByteArray in_alg_data = m_buffer;
+        qWarning() << m_socketDescriptor << "--- Did not receive the complete chunked stream";
+        m_tcpSocket->abort();
+    }
+}
+
+void WorkerThread::readAlgorithmStream()
+{
+    qDebug()  << m_socketDescriptor << "--> \"Chunked Algorithm data\".";
+    
+    QChunkedReader reader(m_tcpSocket);
+    reader.open(QIODevice::ReadOnly);
+    
+    //The algorithm's description is small, so it may be completely read before running it.
+    //Larger descriptions are not buffered, but skipped and rejected afterwards.
+    QByteArray alg_data;
+    QByteArray chunk(algorithm_stream_chunk_size, 0);
+    
+    while(!reader.atEnd() && alg_data.size() <= max_algorithm_stream_size)
+    {
+        qint64 bytes = reader.read(chunk.data(), chunk.size());
+        
+        if(bytes <= 0)
+        {
+            break;
+        }
+        alg_data.append(chunk.constData(), bytes);
+    }
+    
+    if(!reader.skipToEnd())
+    {
+        qWarning() << m_socketDescriptor << "--- Did not receive the complete chunked stream";
+        m_tcpSocket->abort();
+        return;
+    }
+    
+    if(alg_data.size() > max_algorithm_stream_size)
+    {
+        qWarning() << m_socketDescriptor << "--- The chunked algorithm exceeds the maximal size of" << max_algorithm_stream_size << "bytes";
+        m_tcpSocket->write(QString("Error:0").toLatin1());
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForBytesWritten();
+        return;
+    }
+    
+    QBuffer in_buf(&alg_data);
+    readAndRunAlgorithm(&in_buf);
+}
+
+void WorkerThread::readRawModel()
+{
+    //Read directly from the socket into the model's storage
+    if(!m_raw_reader->read(m_tcpSocket))
+    {
+        qWarning() << m_socketDescriptor << "--- Did not load a binary model frame over the tcpSocket";
+        m_state = 0;
+        
+        m_tcpSocket->write(QString("Error:0").toLatin1());
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForBytesWritten();
+    }
+    else if(m_raw_reader->isFinished())
+    {
+        m_state = 0;
+        
+        //The model is now owned by the workspace
+        Model* new_model = m_raw_reader->takeModel();
+        m_compress = m_raw_reader->isCompressed();
+        
+        cacheModel(new_model);
+        
+        qDebug() << m_socketDescriptor << "--- Model loaded and added sucessfully!";
+        qDebug() << m_socketDescriptor << "--- Now: " << m_workspace->models.size() << " models available!";
+        
+        m_tcpSocket->write(QString("Success:0").toLatin1());
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForBytesWritten();
+    }
+    else
+    {
+        qDebug()  << m_socketDescriptor << "--- Still waiting for more Model bytes";
+    }
+}
+
+void WorkerThread::sendModel(Model* model)
+{
+    if(model->rawBlockCount() != 0)
+    {
+        QString request = QString("RawModel:%1\n").arg(RawModelWriter::version);
+        
+        qDebug()  << m_socketDescriptor << "<-- " << request;
+        m_tcpSocket->write(request.toLatin1());
         
+        qDebug()  << m_socketDescriptor << "<-- \"Binary model frame\".";
+        if(!RawModelWriter::write(model, m_tcpSocket, m_compress))
+        {
+            qWarning()  << m_socketDescriptor << "--- Did not write binary model frame on tcpSocket";
+            throw "Error";
+        }
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForBytesWritten();
+        return;
+    }
+    
+    QString request = QString("ModelStream:0\n");
+    
+    qDebug()  << m_socketDescriptor << "<-- " << request;
+    m_tcpSocket->write(request.toLatin1());
+    
+    qDebug()  << m_socketDescriptor << "<-- \"Chunked Model data\".";
+    //Serialize, compress and send the model at the same time
+    QChunkedWriter writer(m_tcpSocket);
+    writer.open(QIODevice::WriteOnly);
+    
+    //Always use compressed transfer
+    QIOCompressor out_compressor(&writer);
+    out_compressor.setStreamFormat(QIOCompressor::GzipFormat);
+    
+    if (!out_compressor.open(QIODevice::WriteOnly))
+    {
+        qWarning()  << m_socketDescriptor << "--- Did not open compressor (gz) on tcpSocket";
+        throw "Error";
+    }
+    
+    QXmlStreamWriter xmlWriter(&out_compressor);
+    model->serialize(xmlWriter);
+    out_compressor.close();
+    writer.close();
+    
+    m_tcpSocket->flush();
+    m_tcpSocket->waitForBytesWritten();
+}
+
+void WorkerThread::readAndRunAlgorithm(QIODevice* in_device)
+{
+    try
+    {
         qDebug()  << m_socketDescriptor << "--> \"Algorithm data\".";
-        QBuffer in_buf(&in_alg_data);
         
         //Always use compressed transfer
-        QIOCompressor* in_compressor = new QIOCompressor(&in_buf);
-        in_compressor->setStreamFormat(QIOCompressor::GzipFormat);
+        QIOCompressor in_compressor(in_device);
+        in_compressor.setStreamFormat(QIOCompressor::GzipFormat);
 
-        if (!in_compressor->open(QIODevice::ReadOnly))
+        if (!in_compressor.open(QIODevice::ReadOnly))
         {
             qWarning() << m_socketDescriptor << "--- Did not open compressor (gz) on tcpSocket";
             throw "Error";
         }
         
-        QXmlStreamReader xmlReader(in_compressor);
+        QXmlStreamReader xmlReader(&in_compressor);
         Algorithm* new_alg = m_workspace->loadAlgorithm(xmlReader);
         
         if(new_alg == NULL)
@@ -271,42 +580,19 @@ void WorkerThread::readAndRunAlgorithm()
         }
         
         qDebug() << m_socketDescriptor << "--- Algorithm loaded sucessfully!";
-        new_alg->run();
-        qDebug() << m_socketDescriptor << "--- Algorithm ran sucessfully!";
         
-        for(Model* model : new_alg->results())
+        //Run the algorithm as a job in the background
+        quint64 job_id = m_scheduler->submit(m_user, new_alg);
+        
+        if(job_id == 0)
         {
-            QByteArray out_model_data;
-            QBuffer out_buf(&out_model_data);
-            
-            //Always use compressed transfer
-            QIOCompressor* out_compressor = new QIOCompressor(&out_buf);
-            out_compressor->setStreamFormat(QIOCompressor::GzipFormat);
-
-            if (!out_compressor->open(QIODevice::WriteOnly))
-            {
-                qWarning()  << m_socketDescriptor << "--- Did not open compressor (gz) on tcpSocket";
-                throw "Error";
-            }
-            
-            QXmlStreamWriter xmlWriter(out_compressor);
-            model->serialize(xmlWriter);
-            out_compressor->close();
-            
-            QString request = QString("Model:%1\n").arg(out_model_data.size());
-
-            qDebug()  << m_socketDescriptor << "<-- " << request;
-            //First: Write the type (Image) and the number of bytes (of the image) to the socket"
-            m_tcpSocket->write(request.toLatin1());
-            m_tcpSocket->flush();
-            m_tcpSocket->waitForBytesWritten();
-            
-            qDebug()  << m_socketDescriptor << "<-- \"Model data\".";
-            //Then submit the data of the model:
-            m_tcpSocket->write(out_model_data);
-            m_tcpSocket->flush();
-            m_tcpSocket->waitForBytesWritten();
+            qWarning() << m_socketDescriptor << "--- The algorithm needs a model, which has expired";
+            throw "Error";
         }
+        
+        m_tcpSocket->write(QString("Job:%1").arg(job_id).toLatin1());
+        m_tcpSocket->flush();
+        m_tcpSocket->waitForBytesWritten();
     }
     catch(...)
     {
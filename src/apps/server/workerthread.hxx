@@ -37,10 +37,14 @@
 #define GRAIPE_SERVER_WORKERTHREAD_HXX
 
 #include "core/model.hxx"
+#include "core/rawtransfer.hxx"
+#include "jobscheduler.hxx"
+#include "modelcache.hxx"
 
 #include <QThread>
 #include <QTcpSocket>
 #include <QByteArray>
+#include <QIODevice>
 #include <QVector>
 
 namespace graipe {
@@ -60,10 +64,12 @@ class WorkerThread
          *
          * \param socketDescriptor The unique socketDescriptor of the client
          * \param registered_users A list of all registered users
-         * \param wsp              The workspace of this client
+         * \param model_cache      The model cache, which is shared by all threads
+         * \param scheduler        The job scheduler, which provides the users' sessions
+         *                         and runs the algorithms
          * \param parent           A pointer to the parent. Here: the server.
          */
-        WorkerThread(qintptr socketDescriptor, QVector<QString> registered_users, Workspace* wsp, QObject *parent);
+        WorkerThread(qintptr socketDescriptor, QVector<QString> registered_users, ModelCache* model_cache, JobScheduler* scheduler, QObject *parent);
     
         /**
          * Running phase of the thread
@@ -83,13 +89,52 @@ class WorkerThread
    
     protected:
         /** 
-         * Function to read a model.
+         * Function to read a model from a device, which provides the compressed
+         * XML serialization of the model.
+         *
+         * \param in_device The device to read the compressed model from.
+         */
+        void readModel(QIODevice* in_device);
+    
+        /**
+         * Adds a newly received model to the shared model cache, if the model
+         * is identified by its content hash (see Impex::contentHash()).
+         *
+         * \param model The received model.
+         */
+        void cacheModel(Model* model);
+    
+        /**
+         * Function to read a model, which is transferred as a chunked stream.
+         * The model is decompressed and deserialized while the chunks arrive.
+         */
+        void readModelStream();
+    
+        /**
+         * Function to read and run an algorithm, which is transferred as a
+         * chunked stream. Algorithms, whose description exceeds 64 MB, are
+         * rejected with an error reply.
+         */
+        void readAlgorithmStream();
+    
+        /**
+         * Function to read a model, which is transferred as a binary frame.
+         */
+        void readRawModel();
+    
+        /**
+         * Function to send a model to the client. Models with raw blocks are sent
+         * as binary frames, all others as compressed XML.
+         *
+         * \param model The model to be sent.
          */
-        void readModel();
+        void sendModel(Model* model);
         /**
-         * Funciton to read and run an algorithm.
+         * Funciton to read an algorithm and submit it as a job to the scheduler.
+         *
+         * \param in_device The device to read the compressed algorithm from.
          */
-        void readAndRunAlgorithm();
+        void readAndRunAlgorithm(QIODevice* in_device);
 
     signals:
         /**
@@ -120,7 +165,10 @@ class WorkerThread
          * \verbatim
            -1 : no logged in, \n
             0 : logged in,\n
-            1 : busy (waiting for data to be received)
+            1 : busy (waiting for model data to be received)\n
+            2 : busy (waiting for algorithm data to be received)\n
+            3 : busy (waiting for a binary model frame to be received)\n
+            4 : busy (reading a chunked stream)
            \endverbatim
          */
         int m_state;
@@ -131,8 +179,23 @@ class WorkerThread
         /** Buffer for data exchange **/
         QByteArray m_buffer;
     
-        /** The workspace of this thread **/
+        /** The user, who is logged in **/
+        QString m_user;
+    
+        /** The workspace of this thread (the session workspace of the user) **/
         Workspace * m_workspace;
+    
+        /** The reader for binary model frames **/
+        RawModelReader * m_raw_reader;
+    
+        /** Use compression for binary model frames (as requested by the client) **/
+        bool m_compress;
+    
+        /** The model cache, which is shared by all threads **/
+        ModelCache * m_model_cache;
+    
+        /** The job scheduler, which is shared by all threads **/
+        JobScheduler * m_scheduler;
 };
 
 } //namespace graipe
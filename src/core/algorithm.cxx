@@ -35,6 +35,16 @@
 
 #include "core/algorithm.hxx"
 
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
 namespace graipe {
 
 /**
@@ -46,7 +56,8 @@ namespace graipe {
  */
 
 Algorithm::Algorithm(Workspace* wsp)
-:   m_parameters(new ParameterGroup),
+:   m_canceled(0),
+    m_parameters(new ParameterGroup),
     m_workspace(wsp)
 {
 }
@@ -141,18 +152,33 @@ void Algorithm::run()
 
 void Algorithm::lockModels()
 {
+    //Collect all models: Write access wins, if a model is used more than once.
+    //The map sorts the models, which yields the global order of locking.
+    std::map<Model*, bool> models;
+    
     for(auto item : *m_parameters)
 	{
-        item.second->lock();
+        for(Model* model : item.second->needsModels())
+        {
+            models[model] = models[model] || item.second->isOutput();
+        }
+    }
+    
+    for(auto item : models)
+    {
+        unsigned int unlock_code = item.second ? item.first->lockForWrite() : item.first->lockForRead();
+        m_model_locks.push_back(std::make_pair(item.first, unlock_code));
     }
 }
 
 void Algorithm::unlockModels()
 {
-    for(auto item : *m_parameters)
+    //Unlock in reverse order
+    for(auto iter = m_model_locks.rbegin(); iter != m_model_locks.rend(); ++iter)
     {
-        item.second->unlock();
+        iter->first->unlock(iter->second);
     }
+    m_model_locks.clear();
 }
 
 void Algorithm::status_update(float percent)
@@ -165,9 +191,124 @@ void Algorithm::status_update(float percent)
 	emit statusMessage(std::min(p_overall, 99.9f), QString("processing"));	
 }
 
+/**
+ * Runnable to process a single band for Algorithm::parallelBands().
+ */
+class BandRunnable
+:   public QRunnable
+{
+public:
+    /**
+     * Constructor.
+     *
+     * \param band_function The function, which processes a single band.
+     * \param band          The index of the band.
+     * \param finished      Semaphore, which is released after processing.
+     * \param error         The first exception, which occured.
+     * \param error_mutex   Mutex to protect the first exception.
+     */
+    BandRunnable(const std::function<void(unsigned int)>& band_function, unsigned int band,
+                 QSemaphore& finished, std::exception_ptr& error, QMutex& error_mutex)
+    :   m_band_function(band_function),
+        m_band(band),
+        m_finished(finished),
+        m_error(error),
+        m_error_mutex(error_mutex)
+    {
+    }
+    
+    /**
+     * Processes the band.
+     */
+    void run() override
+    {
+        try
+        {
+            m_band_function(m_band);
+        }
+        catch(...)
+        {
+            QMutexLocker locker(&m_error_mutex);
+            if(!m_error)
+            {
+                m_error = std::current_exception();
+            }
+        }
+        m_finished.release();
+    }
+
+private:
+    /** The function, which processes a single band **/
+    const std::function<void(unsigned int)>& m_band_function;
+    /** The index of the band **/
+    unsigned int m_band;
+    /** Semaphore, which is released after processing **/
+    QSemaphore& m_finished;
+    /** The first exception, which occured **/
+    std::exception_ptr& m_error;
+    /** Mutex to protect the first exception **/
+    QMutex& m_error_mutex;
+};
+
+void Algorithm::parallelBands(unsigned int band_count, const std::function<void(unsigned int)>& band_function)
+{
+    QSemaphore finished;
+    std::exception_ptr error;
+    QMutex error_mutex;
+    
+    //Use an own pool: The calling thread may be a pooled thread itself
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, std::min(int(band_count), QThread::idealThreadCount())));
+    
+    //Skip the remaining bands, if the algorithm is canceled
+    std::function<void(unsigned int)> cancelable_band_function = [&](unsigned int band)
+        {
+            if(!isCanceled())
+            {
+                band_function(band);
+            }
+        };
+    
+    for(unsigned int band=0; band!=band_count; ++band)
+    {
+        pool.start(new BandRunnable(cancelable_band_function, band, finished, error, error_mutex));
+    }
+    
+    //Report the progress from the calling thread
+    m_phase_count = band_count;
+    
+    for(m_phase=0; m_phase < m_phase_count; )
+    {
+        finished.acquire();
+        m_phase++;
+        status_update(0.0);
+    }
+    
+    pool.waitForDone();
+    
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+    if(isCanceled())
+    {
+        throw std::runtime_error("The algorithm has been canceled.");
+    }
+}
+
 std::vector<Model *>  Algorithm::results()
 {
 	return m_results;
 }
 
+void Algorithm::cancel()
+{
+    m_canceled.storeRelease(1);
+}
+
+bool Algorithm::isCanceled() const
+{
+    return m_canceled.loadAcquire() != 0;
+}
+
 }//end of namespace graipe
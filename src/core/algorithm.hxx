@@ -40,6 +40,11 @@
 #include "core/model.hxx"
 #include "core/parameters.hxx"
 
+#include <QAtomicInt>
+
+#include <functional>
+#include <map>
+#include <utility>
 #include <vector>
 
 namespace graipe {
@@ -69,7 +74,10 @@ namespace graipe {
  * To further keep consistency among the involved models, which are 
  * needed by the algorithm to run, it has a lockModels() method
  * method and a unlockModels() method to make sure the models 
- * cannot be (re-)edited during the running of an algorithm.
+ * cannot be (re-)edited during the running of an algorithm. The models
+ * of input parameters are locked for reading, thus many algorithms may
+ * use the same models concurrently. The models of output parameters
+ * (see Parameter::isOutput()) are locked exclusively for writing.
  *
  * During each run, the algorithm uses signals to report about the
  * current progress, errors and finshed state.
@@ -145,7 +153,14 @@ class GRAIPE_CORE_EXPORT Algorithm
          * Model types) need to be locked, to prevent instable states during
          * the processes.
          *
-         * This method locks each parameter.
+         * This method locks the models of each parameter: The models of
+         * output parameters for writing, all others for reading (see
+         * Model::lockForRead() and Model::lockForWrite()). Algorithms, which
+         * modify the models of a parameter in place, have to mark it by means
+         * of Parameter::setOutput(). The locks are acquired in a fixed (global)
+         * order to prevent deadlocks among concurrently running algorithms.
+         * Both, lockModels() and unlockModels(), need to be called from the
+         * thread, which runs the algorithm.
          */
         void lockModels();
     
@@ -154,7 +169,7 @@ class GRAIPE_CORE_EXPORT Algorithm
          * Model types) need to be locked, to prevent instable states during
          * the processes.
          *
-         * This method unlocks each parameter.
+         * This method unlocks the models of each parameter.
          */
      	void unlockModels();
 
@@ -183,6 +198,21 @@ class GRAIPE_CORE_EXPORT Algorithm
          * \return The results of the algorithm (if finished).
          */
 		virtual std::vector<Model*> results();
+    
+        /**
+         * Requests the cancellation of a running algorithm. This may be called
+         * from any thread. Since the algorithm cannot be interrupted at any
+         * point, it is polled by the algorithms themselves, e.g. by means of
+         * parallelBands() or isCanceled(), which then leave their run() early.
+         */
+        void cancel();
+    
+        /**
+         * Checks if the cancellation of the algorithm has been requested.
+         *
+         * \return True, if cancel() has been called.
+         */
+        bool isCanceled() const;
 	
     
     public slots:
@@ -210,6 +240,27 @@ class GRAIPE_CORE_EXPORT Algorithm
 		void finished();
 
 	protected:
+        /**
+         * Runs a function for each band (or any other independent unit of work)
+         * in parallel. This is meant for algorithms, which process the bands of
+         * an image independently of each other. Each band counts as one phase of
+         * the algorithm: Whenever a band has been processed, the progress is
+         * reported using status_update() from the calling thread.
+         * This call blocks, until all bands have been processed. If the function
+         * throws an exception for any band, the first exception is rethrown
+         * afterwards. If the algorithm is canceled, the remaining bands are
+         * skipped and a std::runtime_error is thrown afterwards.
+         *
+         * \param band_count    The number of bands.
+         * \param band_function The function, which processes a single band. It
+         *                      gets the index of the band as argument and must
+         *                      be safe to be called concurrently for different bands.
+         */
+        void parallelBands(unsigned int band_count, const std::function<void(unsigned int)>& band_function);
+    
+        /** Has the cancellation of the algorithm been requested? **/
+        QAtomicInt m_canceled;
+    
         /** The current phase of the algorithm **/
 		unsigned int m_phase;
         /** The total number phases of the algorithm **/
@@ -219,6 +270,10 @@ class GRAIPE_CORE_EXPORT Algorithm
 		ParameterGroup * m_parameters;
 		/** The results **/
         std::vector<Model*> m_results;
+    
+        /** The models locked by lockModels() and their unlock codes **/
+        std::vector<std::pair<Model*, unsigned int> > m_model_locks;
+    
         /** The Workspace **/
         Workspace* m_workspace;
 };
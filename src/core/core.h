@@ -57,7 +57,9 @@
 #include "core/parameters.hxx"
 #include "core/parameterselection.hxx"
 #include "core/qt_ext.hxx"
+#include "core/rawtransfer.hxx"
 #include "core/serializable.hxx"
+#include "core/spatialindex.hxx"
 #include "core/updatechecker.hxx"
 #include "core/viewcontroller.hxx"
 #include "core/workspace.hxx"
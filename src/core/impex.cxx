@@ -37,11 +37,18 @@
 #include "core/workspace.hxx"
 
 #include <QFile>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QCryptographicHash>
 #include "core/qt_ext/qiocompressor.hxx"
 #include "core/factories.hxx"
 
 #include "core/parameters/longstringparameter.hxx"
 
+#include <algorithm>
+#include <cstring>
+
 namespace graipe {
 
 /**
@@ -51,6 +58,54 @@ namespace graipe {
  *     @brief Implementation file for the import and export of data
  * @}
  */
+
+/** The magic bytes at the beginning of each raw container **/
+static const char raw_magic[8] = {'G','R','A','I','P','E','R','B'};
+/** The current version of the raw container format **/
+static const quint32 raw_version = 1;
+/** The alignment of the raw data blocks inside the container **/
+static const qint64 raw_alignment = 4096;
+
+/**
+ * Aligns an offset to the next multiple of raw_alignment.
+ *
+ * \param offset The offset.
+ * \return The aligned offset.
+ */
+static qint64 rawAlign(qint64 offset)
+{
+    return ((offset + raw_alignment - 1) / raw_alignment) * raw_alignment;
+}
+
+/**
+ * Reads one block of a raw container straight into the given memory.
+ *
+ * \param file  The raw container file.
+ * \param block The location of the block inside the file.
+ * \param data  The memory, where the block will be read to.
+ * \return True, if the block has been read completely.
+ */
+static bool readRawBlock(QFile & file, const Impex::RawBlock & block, char* data)
+{
+    if(data == NULL || !file.seek(block.offset))
+    {
+        return false;
+    }
+    
+    qint64 bytes_read = 0;
+    
+    while(bytes_read < block.size)
+    {
+        qint64 res = file.read(data + bytes_read, block.size - bytes_read);
+        
+        if(res <= 0)
+        {
+            return false;
+        }
+        bytes_read += res;
+    }
+    return true;
+}
  
 QIODevice* Impex::openFile(const QString & filename, QIODevice::OpenModeFlag openMode)
 {
@@ -84,6 +139,13 @@ QIODevice* Impex::openFile(const QString & filename, QIODevice::OpenModeFlag ope
 
 bool Impex::save(Serializable * object, const QString & filename, bool compress)
 {
+    Model* model = dynamic_cast<Model*>(object);
+    
+    if(model != NULL && isRawFile(filename))
+    {
+        return saveRaw(model, filename);
+    }
+    
 	QIODevice* device = Impex::openFile(filename, QIODevice::WriteOnly);
     
 	if (device != NULL)
@@ -96,5 +158,317 @@ bool Impex::save(Serializable * object, const QString & filename, bool compress)
 	return false;
 }
 
+bool Impex::isRawFile(const QString & filename)
+{
+    return filename.endsWith(".xraw", Qt::CaseInsensitive);
+}
+
+QByteArray Impex::rawHeader(Model * model, bool with_id)
+{
+    QByteArray xml_header;
+    QBuffer xml_buffer(&xml_header);
+    xml_buffer.open(QIODevice::WriteOnly);
+    
+    QXmlStreamWriter xmlWriter(&xml_buffer);
+    xmlWriter.setAutoFormatting(true);
+    xmlWriter.setAutoFormattingIndent(4);
+    
+    xmlWriter.writeStartDocument();
+        xmlWriter.writeStartElement(model->typeName());
+        if(with_id)
+        {
+            xmlWriter.writeAttribute("ID", model->id());
+        }
+            xmlWriter.writeStartElement("Header");
+                model->serialize_header(xmlWriter);
+            xmlWriter.writeEndElement();
+            xmlWriter.writeStartElement("Content");
+            if(model->rawBlockCount() != 0)
+            {
+                xmlWriter.writeAttribute("Encoding", "Raw");
+            }
+            else
+            {
+                model->serialize_content(xmlWriter);
+            }
+            xmlWriter.writeEndElement();
+        xmlWriter.writeEndElement();
+    xmlWriter.writeEndDocument();
+    xml_buffer.close();
+    
+    return xml_header;
+}
+
+QString Impex::contentHash(Model * model)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    
+    hash.addData(rawHeader(model, false));
+    
+    const Model* const_model = model;
+    for(unsigned int i=0; i!=model->rawBlockCount(); ++i)
+    {
+        const char* data = const_model->rawBlockData(i);
+        qint64 size = model->rawBlockSize(i);
+        
+        //Blocks without storage hash like blocks of zeros
+        if(data == NULL)
+        {
+            QByteArray zeros(std::min(size, qint64(1<<20)), 0);
+            for(qint64 offset=0; offset < size; offset+=zeros.size())
+            {
+                hash.addData(zeros.constData(), std::min(size-offset, qint64(zeros.size())));
+            }
+        }
+        else
+        {
+            for(qint64 offset=0; offset < size; offset+=(1<<30))
+            {
+                hash.addData(data + offset, std::min(size-offset, qint64(1<<30)));
+            }
+        }
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool Impex::saveRaw(Model * model, const QString & filename)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    qCritical("Impex::saveRaw: Raw containers may only be written on little-endian hosts!");
+    return false;
+#endif
+    
+    unsigned int block_count = model->rawBlockCount();
+    
+    //1. Serialize the XML header of the model
+    QByteArray xml_header = rawHeader(model);
+    
+    if(xml_header.size() > raw_max_header_size)
+    {
+        qCritical("Impex::saveRaw: The XML header exceeds the maximal size of a raw header!");
+        return false;
+    }
+    
+    //2. Compute the (aligned) block table
+    QVector<RawBlock> blocks(block_count);
+    qint64 offset = rawAlign(sizeof(raw_magic) + 2*sizeof(quint32) + sizeof(quint64)
+                             + block_count*2*sizeof(quint64) + xml_header.size());
+    
+    for(unsigned int i=0; i!=block_count; ++i)
+    {
+        blocks[i].offset = offset;
+        blocks[i].size   = model->rawBlockSize(i);
+        offset = rawAlign(offset + blocks[i].size);
+    }
+    
+    //Use a QSaveFile to replace existing files atomically. This keeps the old file
+    //intact for all models, which have currently mapped its blocks.
+    QSaveFile file(filename);
+    
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    
+    //3. Write the preamble, the block table and the XML header
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    
+    out.writeRawData(raw_magic, sizeof(raw_magic));
+    out << raw_version << quint32(block_count) << quint64(xml_header.size());
+    
+    for(const RawBlock& block : blocks)
+    {
+        out << quint64(block.offset) << quint64(block.size);
+    }
+    out.writeRawData(xml_header.constData(), xml_header.size());
+    
+    if(out.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+    
+    //4. Write the blocks directly from the model's storage
+    for(unsigned int i=0; i!=block_count; ++i)
+    {
+        const char* data = static_cast<const Model*>(model)->rawBlockData(i);
+        
+        if(     data == NULL
+            ||  !file.seek(blocks[i].offset)
+            ||  file.write(data, blocks[i].size) != blocks[i].size)
+        {
+            qCritical() << "Impex::saveRaw: Writing of block" << i << "failed!";
+            file.cancelWriting();
+            return false;
+        }
+    }
+    
+    return file.commit();
+}
+
+bool Impex::openRaw(QFile & file, QByteArray & xml_header, QVector<RawBlock> & blocks)
+{
+    //The blocks are large, so avoid any buffering inside Qt:
+    if(!file.isOpen() && !file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        return false;
+    }
+    
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    
+    char magic[sizeof(raw_magic)];
+    
+    if(     in.readRawData(magic, sizeof(raw_magic)) != sizeof(raw_magic)
+        ||  memcmp(magic, raw_magic, sizeof(raw_magic)) != 0)
+    {
+        qWarning("Impex::openRaw: File is not a raw container!");
+        return false;
+    }
+    
+    quint32 version, block_count;
+    quint64 header_size;
+    
+    in >> version >> block_count >> header_size;
+    
+    if(version != raw_version)
+    {
+        qWarning() << "Impex::openRaw: Unsupported version of raw container:" << version;
+        return false;
+    }
+    
+    //The counts and sizes are not trusted: Check them against the file before allocating
+    quint64 file_size = file.size();
+    quint64 preamble_size = sizeof(raw_magic) + 2*sizeof(quint32) + sizeof(quint64);
+    
+    if(     in.status() != QDataStream::Ok
+        ||  quint64(block_count) > (file_size - preamble_size)/(2*sizeof(quint64))
+        ||  header_size > quint64(raw_max_header_size)
+        ||  header_size > file_size - preamble_size - quint64(block_count)*2*sizeof(quint64))
+    {
+        qWarning("Impex::openRaw: Block table or XML header of raw container exceed the file!");
+        return false;
+    }
+    
+    blocks.resize(block_count);
+    
+    for(RawBlock& block : blocks)
+    {
+        quint64 offset, size;
+        in >> offset >> size;
+        
+        if(offset > file_size || size > file_size - offset)
+        {
+            qWarning("Impex::openRaw: Block of raw container exceeds the file!");
+            return false;
+        }
+        block.offset = offset;
+        block.size = size;
+    }
+    
+    xml_header.resize(header_size);
+    
+    if(in.readRawData(xml_header.data(), int(header_size)) != int(header_size))
+    {
+        qWarning("Impex::openRaw: XML header of raw container is incomplete!");
+        return false;
+    }
+    
+    return in.status() == QDataStream::Ok;
+}
+
+bool Impex::readRawBlocks(QFile & file, const QVector<RawBlock> & blocks, Model * model)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    qCritical("Impex::readRawBlocks: Raw containers may only be read on little-endian hosts!");
+    return false;
+#endif
+    
+    if((unsigned int)blocks.size() != model->rawBlockCount())
+    {
+        qWarning("Impex::readRawBlocks: Block count does not match the model!");
+        return false;
+    }
+    
+    for(unsigned int i=0; i!=model->rawBlockCount(); ++i)
+    {
+        if(model->rawBlockSize(i) != blocks[i].size)
+        {
+            qWarning() << "Impex::readRawBlocks: Block" << i << "does not match the model's storage!";
+            return false;
+        }
+        
+        //Read the block straight into the model's storage:
+        if(!readRawBlock(file, blocks[i], model->rawBlockData(i)))
+        {
+            qWarning() << "Impex::readRawBlocks: Block" << i << "could not be read!";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Impex::mapRawBlocks(QFile * file, const QVector<RawBlock> & blocks, Model * model)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    qCritical("Impex::mapRawBlocks: Raw containers may only be read on little-endian hosts!");
+    delete file;
+    return false;
+#endif
+    
+    bool mapped = false;
+    
+    if((unsigned int)blocks.size() != model->rawBlockCount())
+    {
+        qWarning("Impex::mapRawBlocks: Block count does not match the model!");
+        delete file;
+        return false;
+    }
+    
+    for(unsigned int i=0; i!=model->rawBlockCount(); ++i)
+    {
+        if(model->rawBlockSize(i) != blocks[i].size)
+        {
+            qWarning() << "Impex::mapRawBlocks: Block" << i << "does not match the model's storage!";
+            delete file;
+            return false;
+        }
+        
+        //Private mapping: Writes of the model will not change the file
+        uchar* memory = file->map(blocks[i].offset, blocks[i].size, QFileDevice::MapPrivateOption);
+        
+        if(memory != NULL && model->mapRawBlock(i, (char*)memory))
+        {
+            mapped = true;
+        }
+        else
+        {
+            if(memory != NULL)
+            {
+                file->unmap(memory);
+            }
+            
+            //Fallback: Read the block into the model's own storage
+            if(!readRawBlock(*file, blocks[i], model->rawBlockData(i)))
+            {
+                qWarning() << "Impex::mapRawBlocks: Block" << i << "could neither be mapped nor read!";
+                delete file;
+                return false;
+            }
+        }
+    }
+    
+    if(mapped)
+    {
+        //The file needs to live (and stay open) as long as the model:
+        file->setParent(model);
+    }
+    else
+    {
+        delete file;
+    }
+    return true;
+}
+
 }//end of namespace graipe
 
@@ -46,6 +46,8 @@
 #include <map>
 
 #include <QString>
+#include <QFile>
+#include <QVector>
 #include <QXmlStreamWriter>
 
 namespace graipe {
@@ -77,10 +79,40 @@ namespace graipe {
  *
  * Since the headers are usually organized in a dictionary style, 
  * some helper methods are defined here, too.
+ *
+ * Besides the XML format, Models may be stored in a binary raw container
+ * (file extension ".xraw"). It consists of:
+ *
+ *     1. A preamble (little-endian): 8 byte magic "GRAIPERB", the version
+ *        (quint32), the number of blocks (quint32) and the size of the
+ *        XML header (quint64).
+ *     2. A block table: offset and size (both quint64) of each block.
+ *     3. The XML serialization of the Model, where the Content is replaced
+ *        by an empty element with the attribute Encoding="Raw".
+ *     4. The raw (little-endian) data blocks given by Model::rawBlockData(),
+ *        each aligned to page boundaries (4096 bytes).
+ *
+ * This avoids any encoding and allows to read the blocks directly into
+ * the Model's storage or to memory-map them (see mapRawBlocks()).
  */
 class GRAIPE_CORE_EXPORT Impex
 { 
 	public:
+        /**
+         * Location of one data block inside a raw container file.
+         */
+        struct RawBlock
+        {
+            /** The (absolute) offset of the block inside the file **/
+            qint64 offset;
+            /** The size of the block in bytes **/
+            qint64 size;
+        };
+    
+        /** The maximal size of the XML header of raw containers and raw frames **/
+        static const qint64 raw_max_header_size = 1 << 26;
+    
+
         /**
          * Basic open procedure for compressed and uncompressed files.
          *
@@ -92,6 +124,8 @@ class GRAIPE_CORE_EXPORT Impex
             
         /**
          * Standard exporter for everything, which implements the Serializable interface.
+         * If the object is a Model and the filename ends with ".xraw", the binary
+         * raw container format will be used (see saveRaw()).
          *
          * \param object   The object, which shall be serialized.
          * \param filename The filename, where the object shall be stored.
@@ -99,6 +133,87 @@ class GRAIPE_CORE_EXPORT Impex
          * \return True, if the storage of the object was successful.
          */
 		static bool save(Serializable * object, const QString & filename, bool compress=true);
+    
+        /**
+         * Checks, if a filename refers to the binary raw container format.
+         *
+         * \param filename The filename.
+         * \return True, if the filename ends with ".xraw".
+         */
+        static bool isRawFile(const QString & filename);
+    
+        /**
+         * Exporter of a Model to the binary raw container format.
+         * If the Model does not provide raw blocks, the content is stored inside
+         * the XML header as usual.
+         *
+         * \param model    The model, which shall be stored.
+         * \param filename The filename, where the model shall be stored.
+         * \return True, if the storage of the model was successful.
+         */
+        static bool saveRaw(Model * model, const QString & filename);
+    
+        /**
+         * Serializes the XML header of a Model for the raw formats. The Content of
+         * the Model is replaced by an empty element with the attribute Encoding="Raw",
+         * if the Model provides raw blocks.
+         *
+         * \param model   The model.
+         * \param with_id If false, the ID of the model will not be serialized.
+         * \return The XML serialization of the model without the raw blocks.
+         */
+        static QByteArray rawHeader(Model * model, bool with_id=true);
+    
+        /**
+         * Computes a hash (SHA-1) of the content of a Model. The hash covers the
+         * XML header and all raw blocks of the Model, but not its ID. Thus, two
+         * Models share the same hash, if they will be deserialized to the same data.
+         *
+         * \param model The model.
+         * \return The hex-encoded hash of the model's content.
+         */
+        static QString contentHash(Model * model);
+    
+        /**
+         * Opens a raw container file (if not already opened) and reads the preamble,
+         * the block table and the XML header. Afterwards, the XML header may be
+         * used to create and deserialize the model. Containers, whose header exceeds
+         * raw_max_header_size or whose block table or blocks exceed the file, are
+         * rejected.
+         *
+         * \param file       The raw container file.
+         * \param xml_header The XML header, which will be read.
+         * \param blocks     The block table, which will be read.
+         * \return True, if the container was opened and the header could be read.
+         */
+        static bool openRaw(QFile & file, QByteArray & xml_header, QVector<RawBlock> & blocks);
+    
+        /**
+         * Reads all the blocks of a raw container file directly into the storage
+         * of an (already deserialized) Model.
+         *
+         * \param file   The raw container file opened by openRaw().
+         * \param blocks The block table as given by openRaw().
+         * \param model  The model, whose blocks will be filled.
+         * \return True, if all blocks could be read.
+         */
+        static bool readRawBlocks(QFile & file, const QVector<RawBlock> & blocks, Model * model);
+    
+        /**
+         * Maps all the blocks of a raw container file into memory and passes them to
+         * an (already deserialized) Model by means of Model::mapRawBlock(). Blocks, which
+         * cannot be mapped or are not accepted by the model, will be read instead.
+         *
+         * Since the mapping needs the file to stay open, this function takes the 
+         * ownership of the file: If at least one block was mapped, the file will be
+         * deleted together with the model, else it will be deleted immediately.
+         *
+         * \param file   The raw container file opened by openRaw().
+         * \param blocks The block table as given by openRaw().
+         * \param model  The model, whose blocks will be mapped.
+         * \return True, if all blocks could be mapped or read.
+         */
+        static bool mapRawBlocks(QFile * file, const QVector<RawBlock> & blocks, Model * model);
 };
 
 /**
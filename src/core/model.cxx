@@ -64,7 +64,9 @@ Model::Model(Workspace* wsp)
     m_global_ul(new PointFParameter("Global upper-left (deg.):", QPointF(-180,-90), QPointF(180,90), QPointF(0,0), NULL)),
     m_global_lr(new PointFParameter("Global lower-right (deg.):", QPointF(-180,-90),QPointF(180,90), QPointF(0,0), NULL)),
     m_parameters(new ParameterGroup("Model Properties", ParameterGroup::storage_type(), QFormLayout::WrapAllRows)),
-    m_workspace(wsp)
+    m_workspace(wsp),
+    m_writer(NULL),
+    m_rwlock(QReadWriteLock::Recursive)
 {
     m_name->setValue(QString("New ") + typeName());
     m_description->setValue(QString("This new ") + typeName() + " has been created on " + QDateTime::currentDateTime().toString());
@@ -81,6 +83,7 @@ Model::Model(Workspace* wsp)
     connect(m_parameters, SIGNAL(valueChanged()), this, SLOT(updateModel()));
     
     //Add to global Models list
+    QMutexLocker locker(&workspace()->models_mutex);
     workspace()->models.push_back(this);
 }
 
@@ -93,7 +96,9 @@ Model::Model(const Model& model)
     m_lr(new PointParameter("Local lower-right:", QPoint(0,0),QPoint(100000,100000), QPoint(model.right(), model.bottom()), NULL)),
     m_global_ul(new PointFParameter("Global upper-left (deg.):", QPointF(-180,-90), QPointF(180,90), QPointF(model.globalLeft(), model.globalTop()), NULL)),
     m_global_lr(new PointFParameter("Global lower-right (deg.):", QPointF(-180,-90),QPointF(180,90), QPointF(model.globalRight(), model.globalBottom()), NULL)),
-    m_parameters(new ParameterGroup("Model Properties",ParameterGroup::storage_type(), QFormLayout::WrapAllRows))
+    m_parameters(new ParameterGroup("Model Properties",ParameterGroup::storage_type(), QFormLayout::WrapAllRows)),
+    m_writer(NULL),
+    m_rwlock(QReadWriteLock::Recursive)
 {
     m_parameters->addParameter("name", m_name);
     m_parameters->addParameter("descr", m_description);
@@ -107,6 +112,7 @@ Model::Model(const Model& model)
     connect(m_parameters, SIGNAL(valueChanged()), this, SLOT(updateModel()));
     
     //Add to global Models list
+    QMutexLocker locker(&workspace()->models_mutex);
     workspace()->models.push_back(this);
 }
 
@@ -116,6 +122,7 @@ Model::~Model()
     delete m_parameters;
     
     //Remove from global models list
+    QMutexLocker locker(&workspace()->models_mutex);
     workspace()->models.erase(std::remove(workspace()->models.begin(), workspace()->models.end(), this), workspace()->models.end());
 }
 
@@ -462,20 +469,84 @@ bool Model::deserialize_content(QXmlStreamReader& xmlReader)
     return true;
 }
 
+unsigned int Model::rawBlockCount() const
+{
+    return 0;
+}
+
+qint64 Model::rawBlockSize(unsigned int block_id) const
+{
+    return 0;
+}
+
+const char* Model::rawBlockData(unsigned int block_id) const
+{
+    return NULL;
+}
+
+char* Model::rawBlockData(unsigned int block_id)
+{
+    return NULL;
+}
+
+bool Model::mapRawBlock(unsigned int block_id, char* memory)
+{
+    return false;
+}
+
 bool Model::locked() const
 {
-    return (m_locks.size() > 0);
+    QMutexLocker locker(&m_lock_mutex);
+    
+    return     (m_locks.size() > 0) || (m_read_locks.size() > 0)
+            || (m_write_locks.size() > 0 && m_writer != QThread::currentThread());
 }
 
 unsigned int Model::lockedBy() const
 {
-    return m_locks.size();
+    QMutexLocker locker(&m_lock_mutex);
+    
+    return m_locks.size() + m_read_locks.size() + m_write_locks.size();
 }
 
 unsigned int Model::lock()
 {
     unsigned int unlock_code = rand();
-    m_locks.push_back(unlock_code);
+    {
+        QMutexLocker locker(&m_lock_mutex);
+        m_locks.push_back(unlock_code);
+    }
+    
+	emit modelChanged();
+    
+    return unlock_code;
+}
+
+unsigned int Model::lockForRead()
+{
+    m_rwlock.lockForRead();
+    
+    unsigned int unlock_code = rand();
+    {
+        QMutexLocker locker(&m_lock_mutex);
+        m_read_locks.push_back(unlock_code);
+    }
+    
+	emit modelChanged();
+    
+    return unlock_code;
+}
+
+unsigned int Model::lockForWrite()
+{
+    m_rwlock.lockForWrite();
+    
+    unsigned int unlock_code = rand();
+    {
+        QMutexLocker locker(&m_lock_mutex);
+        m_write_locks.push_back(unlock_code);
+        m_writer = QThread::currentThread();
+    }
     
 	emit modelChanged();
     
@@ -483,13 +554,44 @@ unsigned int Model::lock()
 }
 
 void Model::unlock(unsigned int unlock_code)
-{    
-    QVector<unsigned int>::iterator iter = std::find(m_locks.begin(), m_locks.end(), unlock_code);
-    if(iter != m_locks.end())
+{
     {
-        m_locks.erase(iter);
-        emit modelChanged();
+        QMutexLocker locker(&m_lock_mutex);
+        
+        QVector<unsigned int>::iterator iter = std::find(m_locks.begin(), m_locks.end(), unlock_code);
+        if(iter != m_locks.end())
+        {
+            //Non-blocking lock: Nothing to release
+            m_locks.erase(iter);
+            locker.unlock();
+            
+            emit modelChanged();
+            return;
+        }
+        
+        iter = std::find(m_read_locks.begin(), m_read_locks.end(), unlock_code);
+        if(iter != m_read_locks.end())
+        {
+            m_read_locks.erase(iter);
+        }
+        else
+        {
+            iter = std::find(m_write_locks.begin(), m_write_locks.end(), unlock_code);
+            if(iter == m_write_locks.end())
+            {
+                return;
+            }
+            m_write_locks.erase(iter);
+            
+            if(m_write_locks.empty())
+            {
+                m_writer = NULL;
+            }
+        }
     }
+    
+    m_rwlock.unlock();
+    emit modelChanged();
 }
 
 ParameterGroup* Model::parameters()
@@ -41,6 +41,9 @@
 
 #include <QString>
 #include <QVector>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThread>
 #include <QTransform>
 #include <QObject>
 #include <QtDebug>
@@ -80,9 +83,10 @@ class Workspace;
  * Since the model provides signals and slots, it inherits from 
  * QObject as well as from Serializable for import/export reasons.
  *
- * A model also holds it lock-status w.r.t. to read-only locks, e.g.
- * to ensure no editing while an algorithm runs on this model. The 
- * locking is implemented by means of a ticketing system. For each
+ * A model also holds it lock-status w.r.t. to read and write locks, e.g.
+ * to ensure no editing while an algorithm runs on this model. Many readers
+ * may lock a model at the same time, while a writer gets exclusive access.
+ * The locking is implemented by means of a ticketing system. For each
  * lock-request, the locker gets a random id, which he needs to pass for
  * a successful unlocking to the model.
  */
@@ -408,12 +412,66 @@ class GRAIPE_CORE_EXPORT Model
          * \return True, if the Model's content could be restored,
          */
         virtual bool deserialize_content(QXmlStreamReader& xmlReader);
+
+        /**
+         * Models, which hold large contiguous blocks of data (like image bands), may
+         * expose these blocks for the binary raw container format (see Impex::saveRaw).
+         * Then, the blocks will be written and read without any XML encoding.
+         * Has to be specialized, here always 0.
+         *
+         * \return The number of raw data blocks of this model.
+         */
+        virtual unsigned int rawBlockCount() const;
+
+        /**
+         * Size of a raw data block in bytes.
+         * Has to be specialized, here always 0.
+         *
+         * \param block_id The id of the block.
+         * \return The size of the block in bytes.
+         */
+        virtual qint64 rawBlockSize(unsigned int block_id) const;
+
+        /**
+         * Constant/reading access to the memory of a raw data block.
+         * Has to be specialized, here always NULL.
+         *
+         * \param block_id The id of the block.
+         * \return The pointer to the first byte of the block.
+         */
+        virtual const char* rawBlockData(unsigned int block_id) const;
+
+        /**
+         * Writing access to the memory of a raw data block. This is called after the
+         * deserialization of the model (header and content) to fill the block's storage
+         * with the data of the container file.
+         * Has to be specialized, here always NULL.
+         *
+         * \param block_id The id of the block.
+         * \return The pointer to the first byte of the block.
+         */
+        virtual char* rawBlockData(unsigned int block_id);
     
+        /**
+         * Instead of reading a raw data block into its own storage, a model may use
+         * memory-mapped blocks of a raw container directly. Then, only the touched pages
+         * of the block will be loaded from disk. Writes to the memory are private to the
+         * model (copy-on-write) and do not change the file.
+         * Has to be specialized, here always false (no mapping support).
+         *
+         * \param block_id The id of the block.
+         * \param memory The mapped memory of the block (of size rawBlockSize(block_id)).
+         * \return True, if the model uses the mapped memory as storage for the block.
+         */
+        virtual bool mapRawBlock(unsigned int block_id, char* memory);
+
         /**
          * Models may be locked (to read only access), while algorithms are using them e.g.
-         * This function can be used to query, if the Model is locked or not.
+         * This function can be used to query, if the Model is locked or not. A model,
+         * which is locked for writing, is only reported as locked to other threads
+         * than the writing one.
          *
-         * \return True, if the model has been locked by somebody
+         * \return True, if the model may not be edited by the caller.
          */
         bool locked() const;
         /**
@@ -428,13 +486,36 @@ class GRAIPE_CORE_EXPORT Model
          * Put a lock request on the model. Since the locking is a secured operation,
          * each lock-requester will get a personal (random) unlock code by its request.
          * He has to take for this code, because otherwise, unlocking is impossible.
+         * This call never blocks. It only marks the model as locked() to prevent
+         * editing, but does not exclude writers (see lockForRead()).
          *
          * \return The code needed for unlocking afterwards
          */
         unsigned int lock();
     
+        /**
+         * Put a read lock request on the model. Like lock(), but many readers may
+         * hold a lock at the same time while writers are excluded. Thus, this call
+         * blocks, while the model is locked for writing by another thread.
+         * The lock has to be removed by the same thread, which requested it.
+         *
+         * \return The code needed for unlocking afterwards
+         */
+        unsigned int lockForRead();
+    
+        /**
+         * Put a write lock request on the model. The writer gets exclusive access, thus
+         * this call blocks until all other read or write locks have been released.
+         * Do not request a write lock while holding a read lock on the same model.
+         * The lock has to be removed by the same thread, which requested it.
+         *
+         * \return The code needed for unlocking afterwards
+         */
+        unsigned int lockForWrite();
+    
         /** 
-         * Remove the locking of the model using your unlock code.
+         * Remove any locking of the model using your unlock code. Read and write
+         * locks have to be removed by the thread, which requested them.
          *
          * \param unlock_code the code, which unlocks the lock.
          */
@@ -479,8 +560,23 @@ class GRAIPE_CORE_EXPORT Model
         Workspace * m_workspace;
 
     private:
-        /** keeping track of the locks **/
+        /** keeping track of the (non-blocking) locks **/
         QVector<unsigned int> m_locks;
+    
+        /** keeping track of the read locks **/
+        QVector<unsigned int> m_read_locks;
+    
+        /** keeping track of the write locks **/
+        QVector<unsigned int> m_write_locks;
+    
+        /** the thread, which holds the write locks **/
+        QThread* m_writer;
+    
+        /** the read/write lock itself **/
+        QReadWriteLock m_rwlock;
+    
+        /** protects the tracking of the locks **/
+        mutable QMutex m_lock_mutex;
 };
 
 
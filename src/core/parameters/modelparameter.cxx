@@ -57,6 +57,8 @@ ModelParameter::ModelParameter(const QString &name, QString type_filter, Paramet
     if(wsp!= NULL && wsp->models.size())
 	{
 		m_allowed_values.clear();
+        
+        QMutexLocker locker(&wsp->models_mutex);
 		
 		for(Model * model: wsp->models)
 		{
@@ -52,12 +52,11 @@ namespace graipe {
 MultiModelParameter::MultiModelParameter(const QString& name, QString type_filter, Parameter* parent, bool invert_parent, Workspace* wsp)
 :	Parameter(name, parent, invert_parent),
     m_delegate(NULL),
-    m_allowed_values(wsp->models),
 	m_type_filter(type_filter)
 {
-    if(wsp != NULL && wsp->models.size())
+    if(wsp != NULL)
 	{
-		m_allowed_values.clear();
+        QMutexLocker locker(&wsp->models_mutex);
 		
 		for(Model* model: wsp->models)
 		{
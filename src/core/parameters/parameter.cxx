@@ -51,14 +51,16 @@ namespace graipe {
 Parameter::Parameter()
 :	m_name(""),
     m_parent(NULL),
-    m_invert_parent(false)
+    m_invert_parent(false),
+    m_output(false)
 {
 }
 
 Parameter::Parameter(const QString&  name, Parameter* parent, bool invert_parent)
 :	m_name(name), 
     m_parent(parent),
-    m_invert_parent(invert_parent)
+    m_invert_parent(invert_parent),
+    m_output(false)
 {
 }
 
@@ -87,6 +89,16 @@ bool Parameter::invertParent() const
     return m_invert_parent;
 }
 
+bool Parameter::isOutput() const
+{
+    return m_output;
+}
+
+void Parameter::setOutput(bool output)
+{
+    m_output = output;
+}
+
 QString Parameter::toString() const
 {
 	return "";
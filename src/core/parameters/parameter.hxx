@@ -133,6 +133,23 @@ class GRAIPE_CORE_EXPORT Parameter
          */
         virtual bool invertParent() const;
     
+        /**
+         * Does this parameter refer to models, which will be modified by an algorithm?
+         * Then, Algorithm::lockModels() locks these models for writing instead of
+         * reading.
+         *
+         * \return True, if the parameter's models are outputs of an algorithm.
+         */
+        bool isOutput() const;
+    
+        /**
+         * Marks this parameter as referring to models, which will be modified by an
+         * algorithm. By default, all parameters are inputs.
+         *
+         * \param output True, if the parameter's models are outputs of an algorithm.
+         */
+        void setOutput(bool output);
+    
         /**
          * The value converted to a QString. Needs to be specified for inheriting classes.
          * This is the default method for the value serialization performed by
@@ -257,6 +274,9 @@ class GRAIPE_CORE_EXPORT Parameter
     
         /** Should the enabled/disabled by parent rule be inverted? **/
         bool m_invert_parent;
+    
+        /** Are the models of the parameter modified by an algorithm? **/
+        bool m_output;
 };
 
 /**
@@ -45,6 +45,7 @@
  * already great Qt library
  */
 
+#include "core/qt_ext/qchunkeddevice.hxx"
 #include "core/qt_ext/qgraphicsresizableitem.hxx"
 #include "core/qt_ext/qiocompressor.hxx"
 #include "core/qt_ext/qlegend.hxx"
@@ -0,0 +1,306 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "qchunkeddevice.hxx"
+
+#include <QtDebug>
+
+#include <algorithm>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *     @file
+ *     @brief Implementation file for the chunked transfer devices
+ * @}
+ */
+
+/**
+ * Helper to write a chunk size in little-endian byte order.
+ *
+ * \param size The size of the chunk.
+ * \return The encoded size.
+ */
+static QByteArray encodeChunkSize(quint32 size)
+{
+    QByteArray result(4, 0);
+    for(int i=0; i!=4; ++i)
+    {
+        result[i] = char((size >> (8*i)) & 0xFF);
+    }
+    return result;
+}
+
+/**
+ * Helper to read a chunk size in little-endian byte order.
+ *
+ * \param data The encoded size (4 bytes).
+ * \return The decoded size.
+ */
+static quint32 decodeChunkSize(const QByteArray& data)
+{
+    quint32 result = 0;
+    for(int i=0; i!=4; ++i)
+    {
+        result |= quint32((unsigned char)data[i]) << (8*i);
+    }
+    return result;
+}
+
+
+
+
+QChunkedWriter::QChunkedWriter(QIODevice* device, qint64 chunk_size, qint64 max_pending)
+:   m_device(device),
+    m_chunk_size(std::max(chunk_size, qint64(1))),
+    m_max_pending(std::max(max_pending, chunk_size))
+{
+}
+
+QChunkedWriter::~QChunkedWriter()
+{
+    if(isOpen())
+    {
+        close();
+    }
+}
+
+bool QChunkedWriter::isSequential() const
+{
+    return true;
+}
+
+bool QChunkedWriter::open(OpenMode mode)
+{
+    if(mode != QIODevice::WriteOnly || m_device == NULL || !m_device->isWritable())
+    {
+        return false;
+    }
+    
+    m_chunk.clear();
+    m_chunk.reserve(m_chunk_size);
+    
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void QChunkedWriter::close()
+{
+    if(!isOpen())
+    {
+        return;
+    }
+    
+    writeChunk();
+    
+    //The empty chunk marks the end of the stream
+    m_device->write(encodeChunkSize(0));
+    
+    QIODevice::close();
+}
+
+qint64 QChunkedWriter::maxPending() const
+{
+    return m_max_pending;
+}
+
+qint64 QChunkedWriter::readData(char* /*data*/, qint64 /*maxSize*/)
+{
+    return -1;
+}
+
+qint64 QChunkedWriter::writeData(const char* data, qint64 maxSize)
+{
+    qint64 written = 0;
+    
+    while(written < maxSize)
+    {
+        qint64 bytes = std::min(maxSize - written, m_chunk_size - m_chunk.size());
+        m_chunk.append(data + written, bytes);
+        written += bytes;
+        
+        if(m_chunk.size() == m_chunk_size && !writeChunk())
+        {
+            return -1;
+        }
+    }
+    return written;
+}
+
+bool QChunkedWriter::writeChunk()
+{
+    if(m_chunk.isEmpty())
+    {
+        return true;
+    }
+    
+    if(    m_device->write(encodeChunkSize(m_chunk.size())) != 4
+        || m_device->write(m_chunk) != m_chunk.size())
+    {
+        qWarning("QChunkedWriter: Could not write chunk to device");
+        return false;
+    }
+    m_chunk.clear();
+    
+    //Backpressure: Do not let the pending bytes grow unbounded
+    while(m_device->bytesToWrite() > m_max_pending)
+    {
+        if(!m_device->waitForBytesWritten(30000))
+        {
+            qWarning("QChunkedWriter: Timeout while waiting for the device");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+
+QChunkedReader::QChunkedReader(QIODevice* device, int msecs)
+:   m_device(device),
+    m_msecs(msecs),
+    m_remaining(0),
+    m_finished(false),
+    m_failed(false)
+{
+}
+
+bool QChunkedReader::isSequential() const
+{
+    return true;
+}
+
+bool QChunkedReader::open(OpenMode mode)
+{
+    if(mode != QIODevice::ReadOnly || m_device == NULL || !m_device->isReadable())
+    {
+        return false;
+    }
+    
+    m_remaining = 0;
+    m_finished = false;
+    m_failed = false;
+    
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+bool QChunkedReader::atEnd() const
+{
+    return m_finished || m_failed;
+}
+
+bool QChunkedReader::hasFailed() const
+{
+    return m_failed;
+}
+
+bool QChunkedReader::skipToEnd()
+{
+    char buffer[4096];
+    
+    while(readData(buffer, sizeof(buffer)) > 0)
+    {
+    }
+    return m_finished;
+}
+
+qint64 QChunkedReader::readData(char* data, qint64 maxSize)
+{
+    if(m_failed)
+    {
+        return -1;
+    }
+    if(m_finished)
+    {
+        return 0;
+    }
+    
+    //Start of the next chunk?
+    if(m_remaining == 0)
+    {
+        if(!waitFor(4))
+        {
+            m_failed = true;
+            return -1;
+        }
+        
+        m_remaining = decodeChunkSize(m_device->read(4));
+        
+        if(m_remaining == 0)
+        {
+            m_finished = true;
+            return 0;
+        }
+    }
+    
+    if(!waitFor(1))
+    {
+        m_failed = true;
+        return -1;
+    }
+    
+    qint64 bytes = m_device->read(data, std::min(std::min(maxSize, m_remaining), m_device->bytesAvailable()));
+    
+    if(bytes < 0)
+    {
+        m_failed = true;
+        return -1;
+    }
+    
+    m_remaining -= bytes;
+    return bytes;
+}
+
+qint64 QChunkedReader::writeData(const char* /*data*/, qint64 /*maxSize*/)
+{
+    return -1;
+}
+
+bool QChunkedReader::waitFor(qint64 bytes)
+{
+    while(m_device->bytesAvailable() < bytes)
+    {
+        if(!m_device->waitForReadyRead(m_msecs))
+        {
+            qWarning("QChunkedReader: Timeout while waiting for the device");
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace graipe
@@ -0,0 +1,262 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_CORE_QCHUNKEDDEVICE_HXX
+#define GRAIPE_CORE_QCHUNKEDDEVICE_HXX
+
+#include "core/config.hxx"
+
+#include <QByteArray>
+#include <QIODevice>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *
+ * @file
+ * @brief Header file for the chunked transfer devices QChunkedWriter and QChunkedReader
+ */
+
+/**
+ * This device splits everything written to it into chunks and writes these
+ * chunks onto another (sequential) device, like a QTcpSocket. Each chunk is
+ * preceded by its size (quint32, little-endian). Closing the device writes
+ * an empty chunk, which marks the end of the stream.
+ *
+ * Since the receiver does not need to know the total size of the stream in
+ * advance, the data may be generated (e.g. serialized and compressed) while
+ * it is being sent. The amount of pending bytes on the target device is
+ * bounded: If more than maxPending() bytes are waiting to be written, the
+ * writer blocks until the device has written them.
+ */
+class GRAIPE_CORE_EXPORT QChunkedWriter
+:   public QIODevice
+{
+    public:
+        /**
+         * Constructor of the chunked writer.
+         *
+         * \param device     The device, where the chunks will be written to.
+         * \param chunk_size The maximal size of each chunk in bytes.
+         * \param max_pending The maximal count of bytes, which may be pending
+         *                    on the target device before writing blocks.
+         */
+        QChunkedWriter(QIODevice* device, qint64 chunk_size=1<<18, qint64 max_pending=1<<22);
+    
+        /**
+         * Destructor of the chunked writer. Closes the device if necessary.
+         */
+        ~QChunkedWriter();
+    
+        /**
+         * A chunked writer is always a sequential device.
+         *
+         * \return Always true.
+         */
+        bool isSequential() const;
+    
+        /**
+         * Opens the writer. Only QIODevice::WriteOnly is supported.
+         *
+         * \param mode The open mode.
+         * \return True, if the writer could be opened.
+         */
+        bool open(OpenMode mode);
+    
+        /**
+         * Writes the remaining data and the terminating empty chunk and closes
+         * the device.
+         */
+        void close();
+    
+        /**
+         * The maximal count of bytes, which may be pending on the target device
+         * before writing blocks.
+         *
+         * \return The maximal count of pending bytes.
+         */
+        qint64 maxPending() const;
+    
+    protected:
+        /**
+         * Reading is not supported by the chunked writer.
+         *
+         * \return Always -1.
+         */
+        qint64 readData(char* data, qint64 maxSize);
+    
+        /**
+         * Writes data to the chunked writer.
+         *
+         * \param data    Pointer to the data, which shall be written.
+         * \param maxSize The size of the data.
+         * \return The count of bytes written or -1 on errors.
+         */
+        qint64 writeData(const char* data, qint64 maxSize);
+    
+    private:
+        /**
+         * Writes the current chunk (if any) to the target device.
+         *
+         * \return True, if the chunk could be written.
+         */
+        bool writeChunk();
+    
+        /** The target device **/
+        QIODevice* m_device;
+        /** The current (not yet written) chunk **/
+        QByteArray m_chunk;
+        /** The maximal size of each chunk **/
+        qint64 m_chunk_size;
+        /** The maximal count of pending bytes on the target device **/
+        qint64 m_max_pending;
+};
+
+
+
+
+/**
+ * This device reads a stream of chunks, which has been written by a QChunkedWriter,
+ * from another (sequential) device, like a QTcpSocket. It presents the content
+ * of the chunks as one continuous stream and reaches its end at the terminating
+ * empty chunk. Bytes following the terminating chunk are left untouched on the
+ * source device.
+ *
+ * Reading blocks until data is available on the source device (or the timeout
+ * has passed). Thus, readers, which are not able to handle incomplete data,
+ * like the QIOCompressor or the QXmlStreamReader, can process the stream while
+ * it is still arriving. No data is buffered by this device itself.
+ */
+class GRAIPE_CORE_EXPORT QChunkedReader
+:   public QIODevice
+{
+    public:
+        /**
+         * Constructor of the chunked reader.
+         *
+         * \param device  The device, where the chunks will be read from.
+         * \param msecs   The timeout for waiting for new data in milliseconds.
+         */
+        QChunkedReader(QIODevice* device, int msecs=30000);
+    
+        /**
+         * A chunked reader is always a sequential device.
+         *
+         * \return Always true.
+         */
+        bool isSequential() const;
+    
+        /**
+         * Opens the reader. Only QIODevice::ReadOnly is supported.
+         *
+         * \param mode The open mode.
+         * \return True, if the reader could be opened.
+         */
+        bool open(OpenMode mode);
+    
+        /**
+         * Returns true if the terminating chunk has been read.
+         *
+         * \return True, if the end of the chunked stream has been reached.
+         */
+        bool atEnd() const;
+    
+        /**
+         * Returns true if reading failed, e.g. due to a timeout.
+         *
+         * \return True, if the stream could not be read completely.
+         */
+        bool hasFailed() const;
+    
+        /**
+         * Reads the remaining chunks until the end of the stream is reached.
+         * Use this after the processing of the stream (e.g. decompression)
+         * has finished or failed to leave the source device at a well-defined
+         * position.
+         *
+         * \return True, if the end of the stream has been reached.
+         */
+        bool skipToEnd();
+    
+    protected:
+        /**
+         * Reads data from the chunked stream. Blocks until at least one byte
+         * could be read, the end of the stream has been reached or the
+         * reading failed.
+         *
+         * \param data    Pointer to the memory, where the data shall be stored.
+         * \param maxSize The maximal count of bytes to be read.
+         * \return The count of bytes read, 0 at the end or -1 on errors.
+         */
+        qint64 readData(char* data, qint64 maxSize);
+    
+        /**
+         * Writing is not supported by the chunked reader.
+         *
+         * \return Always -1.
+         */
+        qint64 writeData(const char* data, qint64 maxSize);
+    
+    private:
+        /**
+         * Waits until at least the given number of bytes are available on the
+         * source device.
+         *
+         * \param bytes The count of bytes needed.
+         * \return True, if the bytes are available.
+         */
+        bool waitFor(qint64 bytes);
+    
+        /** The source device **/
+        QIODevice* m_device;
+        /** The timeout for waiting for new data **/
+        int m_msecs;
+        /** The remaining bytes of the current chunk **/
+        qint64 m_remaining;
+        /** Has the terminating chunk been read? **/
+        bool m_finished;
+        /** Has the reading failed? **/
+        bool m_failed;
+};
+
+/**
+ * @}
+ */
+
+} //namespace graipe
+
+#endif //GRAIPE_CORE_QCHUNKEDDEVICE_HXX
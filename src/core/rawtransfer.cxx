@@ -0,0 +1,412 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "core/rawtransfer.hxx"
+#include "core/impex.hxx"
+
+#include <QDataStream>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "zlib.h"
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *     @file
+ *     @brief Implementation file for the binary transfer of Models over sequential devices
+ * @}
+ */
+
+/** The magic bytes at the beginning of each frame **/
+static const char frame_magic[4] = {'G','R','P','F'};
+/** The size of the preamble of each frame **/
+static const qint64 frame_preamble_size = 4 + 2*sizeof(quint16) + 2*sizeof(quint32);
+/** The size of the header of each block **/
+static const qint64 frame_block_header_size = 2*sizeof(quint64);
+/** The size of the chunks, which are written at once **/
+static const qint64 frame_chunk_size = 1 << 22;
+/** The maximal transmitted size of a compressed block, which is buffered by the reader **/
+static const qint64 frame_max_compressed_block_size = 1 << 30;
+
+/**
+ * Writes data in chunks onto a device. For buffered devices (like sockets), we
+ * wait until the pending data is written to keep the device's buffer small.
+ *
+ * \param device The device.
+ * \param data   The data to be written.
+ * \param size   The size of the data in bytes.
+ * \return True, if all data has been written.
+ */
+static bool writeChunked(QIODevice * device, const char * data, qint64 size)
+{
+    qint64 pos = 0;
+    
+    while(pos < size)
+    {
+        qint64 res = device->write(data + pos, std::min(frame_chunk_size, size - pos));
+        
+        if(res < 0)
+        {
+            return false;
+        }
+        pos += res;
+        
+        while(device->bytesToWrite() > frame_chunk_size)
+        {
+            if(!device->waitForBytesWritten(-1))
+            {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool RawModelWriter::write(Model * model, QIODevice * device, bool compress)
+{
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    qCritical("RawModelWriter::write: Raw frames may only be written on little-endian hosts!");
+    return false;
+#endif
+    
+    QByteArray xml_header = Impex::rawHeader(model);
+    
+    if(xml_header.size() > Impex::raw_max_header_size)
+    {
+        qCritical("RawModelWriter::write: The XML header exceeds the maximal size of a frame header!");
+        return false;
+    }
+    
+    //Compressed blocks are buffered completely by the reader. Send the frame
+    //uncompressed if any block may exceed the reader's limit.
+    for(unsigned int i=0; compress && i!=model->rawBlockCount(); ++i)
+    {
+        if((qint64)compressBound(model->rawBlockSize(i)) > frame_max_compressed_block_size)
+        {
+            compress = false;
+        }
+    }
+    
+    //1. Write the preamble and the XML header
+    QByteArray preamble;
+    QDataStream out(&preamble, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    
+    out.writeRawData(frame_magic, sizeof(frame_magic));
+    out << version << quint16(compress ? Compressed : 0)
+        << quint32(model->rawBlockCount()) << quint32(xml_header.size());
+    
+    if(     device->write(preamble) != preamble.size()
+        ||  device->write(xml_header) != xml_header.size())
+    {
+        return false;
+    }
+    
+    //2. Write each block, directly from the model's storage if not compressed
+    for(unsigned int i=0; i!=model->rawBlockCount(); ++i)
+    {
+        const char* data = static_cast<const Model*>(model)->rawBlockData(i);
+        qint64 size = model->rawBlockSize(i);
+        
+        if(data == NULL)
+        {
+            return false;
+        }
+        
+        QByteArray compressed_data;
+        
+        if(compress)
+        {
+            uLongf compressed_size = compressBound(size);
+            compressed_data.resize(compressed_size);
+            
+            if(compress2((Bytef*)compressed_data.data(), &compressed_size, (const Bytef*)data, size, Z_BEST_SPEED) != Z_OK)
+            {
+                qCritical() << "RawModelWriter::write: Compression of block" << i << "failed!";
+                return false;
+            }
+            compressed_data.resize(compressed_size);
+        }
+        
+        QByteArray block_header;
+        QDataStream block_out(&block_header, QIODevice::WriteOnly);
+        block_out.setByteOrder(QDataStream::LittleEndian);
+        block_out << quint64(size) << quint64(compress ? compressed_data.size() : size);
+        
+        if(device->write(block_header) != block_header.size())
+        {
+            return false;
+        }
+        
+        bool res = compress ? writeChunked(device, compressed_data.constData(), compressed_data.size())
+                            : writeChunked(device, data, size);
+        if(!res)
+        {
+            qCritical() << "RawModelWriter::write: Writing of block" << i << "failed!";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+
+RawModelReader::RawModelReader(Workspace * wsp)
+:   m_workspace(wsp),
+    m_model(NULL)
+{
+    reset();
+}
+
+RawModelReader::~RawModelReader()
+{
+    delete m_model;
+}
+
+void RawModelReader::reset()
+{
+    delete m_model;
+    m_model = NULL;
+    
+    m_state = ReadPreamble;
+    m_flags = 0;
+    m_block_count = 0;
+    m_header_size = 0;
+    m_block = 0;
+    m_raw_size = 0;
+    m_wire_size = 0;
+    m_block_pos = 0;
+    m_block_data = NULL;
+    m_buffer.clear();
+}
+
+bool RawModelReader::read(QIODevice * device)
+{
+    try
+    {
+        while(m_state != Finished && m_state != Failed)
+        {
+            switch(m_state)
+            {
+                case ReadPreamble:
+                {
+                    if(!fillBuffer(device, frame_preamble_size))
+                    {
+                        return true;
+                    }
+                    
+                    QDataStream in(m_buffer);
+                    in.setByteOrder(QDataStream::LittleEndian);
+                    
+                    char magic[sizeof(frame_magic)];
+                    quint16 frame_version;
+                    
+                    in.readRawData(magic, sizeof(frame_magic));
+                    in >> frame_version >> m_flags >> m_block_count >> m_header_size;
+                    
+                    if(memcmp(magic, frame_magic, sizeof(frame_magic)) != 0)
+                    {
+                        throw std::runtime_error("Frame does not start with the magic bytes.");
+                    }
+                    if(frame_version != RawModelWriter::version)
+                    {
+                        throw std::runtime_error("Frame has an unsupported version.");
+                    }
+                    if(m_header_size > Impex::raw_max_header_size)
+                    {
+                        throw std::runtime_error("Frame header exceeds the maximal size.");
+                    }
+                    
+                    m_buffer.clear();
+                    m_state = ReadHeader;
+                    break;
+                }
+                case ReadHeader:
+                {
+                    if(!fillBuffer(device, m_header_size))
+                    {
+                        return true;
+                    }
+                    
+                    QXmlStreamReader xmlReader(m_buffer);
+                    m_model = m_workspace->loadModel(xmlReader);
+                    
+                    if(m_model == NULL)
+                    {
+                        throw std::runtime_error("Model could not be created from the header.");
+                    }
+                    if(m_model->rawBlockCount() != m_block_count)
+                    {
+                        throw std::runtime_error("Block count does not match the model.");
+                    }
+                    
+                    m_buffer.clear();
+                    m_block = 0;
+                    m_state = (m_block_count == 0) ? Finished : ReadBlockHeader;
+                    break;
+                }
+                case ReadBlockHeader:
+                {
+                    if(!fillBuffer(device, frame_block_header_size))
+                    {
+                        return true;
+                    }
+                    
+                    QDataStream in(m_buffer);
+                    in.setByteOrder(QDataStream::LittleEndian);
+                    
+                    quint64 raw_size, wire_size;
+                    in >> raw_size >> wire_size;
+                    
+                    m_raw_size = raw_size;
+                    m_wire_size = wire_size;
+                    m_block_data = m_model->rawBlockData(m_block);
+                    
+                    if(m_block_data == NULL || m_raw_size != m_model->rawBlockSize(m_block))
+                    {
+                        throw std::runtime_error("Block does not match the model's storage.");
+                    }
+                    if(!isCompressed() && m_wire_size != m_raw_size)
+                    {
+                        throw std::runtime_error("Size of uncompressed block is inconsistent.");
+                    }
+                    if(     isCompressed()
+                        &&  (m_wire_size < 0 || m_wire_size > frame_max_compressed_block_size || m_wire_size > (qint64)compressBound(m_raw_size)))
+                    {
+                        throw std::runtime_error("Size of compressed block exceeds the maximal size.");
+                    }
+                    
+                    m_buffer.clear();
+                    m_block_pos = 0;
+                    m_state = ReadBlock;
+                    break;
+                }
+                case ReadBlock:
+                {
+                    if(isCompressed())
+                    {
+                        if(!fillBuffer(device, m_wire_size))
+                        {
+                            return true;
+                        }
+                        
+                        //Decompress directly into the model's storage
+                        uLongf raw_size = m_raw_size;
+                        
+                        if(     uncompress((Bytef*)m_block_data, &raw_size, (const Bytef*)m_buffer.constData(), m_buffer.size()) != Z_OK
+                            ||  (qint64)raw_size != m_raw_size)
+                        {
+                            throw std::runtime_error("Decompression of block failed.");
+                        }
+                        m_buffer.clear();
+                    }
+                    else
+                    {
+                        //Read directly into the model's storage
+                        qint64 res = device->read(m_block_data + m_block_pos, m_raw_size - m_block_pos);
+                        
+                        if(res < 0)
+                        {
+                            throw std::runtime_error("Reading of block failed.");
+                        }
+                        m_block_pos += res;
+                        
+                        if(m_block_pos < m_raw_size)
+                        {
+                            return true;
+                        }
+                    }
+                    
+                    m_block++;
+                    m_state = (m_block == m_block_count) ? Finished : ReadBlockHeader;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+    catch(std::runtime_error & e)
+    {
+        qCritical() << "RawModelReader::read failed! Error: " << e.what();
+        
+        delete m_model;
+        m_model = NULL;
+        m_state = Failed;
+    }
+    return m_state != Failed;
+}
+
+bool RawModelReader::isFinished() const
+{
+    return m_state == Finished;
+}
+
+bool RawModelReader::isCompressed() const
+{
+    return m_flags & RawModelWriter::Compressed;
+}
+
+Model* RawModelReader::takeModel()
+{
+    if(m_state != Finished)
+    {
+        return NULL;
+    }
+    
+    Model* model = m_model;
+    m_model = NULL;
+    return model;
+}
+
+bool RawModelReader::fillBuffer(QIODevice * device, qint64 bytes)
+{
+    qint64 missing = bytes - m_buffer.size();
+    
+    if(missing > 0)
+    {
+        m_buffer.append(device->read(missing));
+    }
+    return m_buffer.size() == bytes;
+}
+
+} //end of namespace graipe
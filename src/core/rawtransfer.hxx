@@ -0,0 +1,217 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_CORE_RAWTRANSFER_HXX
+#define GRAIPE_CORE_RAWTRANSFER_HXX
+
+#include "core/config.hxx"
+#include "core/model.hxx"
+#include "core/workspace.hxx"
+
+#include <QByteArray>
+#include <QIODevice>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *
+ * @file
+ * @brief Header file for the binary transfer of Models over sequential devices
+ */
+
+/**
+ * This class writes a Model as a binary frame onto a (sequential) device, like
+ * a QTcpSocket. Like the raw container format of the Impex class, the frame
+ * transfers the raw data blocks of a model (see Model::rawBlockData()) without
+ * any XML encoding. The frame is organized as follows (little-endian):
+ *
+ *     1. A preamble: 4 byte magic "GRPF", the version (quint16), the flags (quint16),
+ *        the number of blocks (quint32) and the size of the XML header (quint32).
+ *     2. The XML serialization of the Model, where the Content is replaced
+ *        by an empty element with the attribute Encoding="Raw".
+ *     3. For each block: its raw size and its transmitted size (both quint64)
+ *        followed by the transmitted data of the block.
+ *
+ * If the flag RawModelWriter::Compressed is set, each block is compressed
+ * separately using zlib. Otherwise, the blocks are written directly from the
+ * model's storage.
+ */
+class GRAIPE_CORE_EXPORT RawModelWriter
+{
+    public:
+        /** The current version of the binary frame format **/
+        static const quint16 version = 1;
+    
+        /** The flags of a frame **/
+        enum Flags
+        {
+            /** Blocks are zlib compressed **/
+            Compressed = 0x01
+        };
+    
+        /**
+         * Writes a Model as a binary frame onto a device.
+         *
+         * \param model    The model, which shall be written.
+         * \param device   The device, where the frame shall be written on.
+         * \param compress If true, each block will be compressed before writing.
+         * \return True, if the frame was written completely.
+         */
+        static bool write(Model * model, QIODevice * device, bool compress=false);
+};
+
+/**
+ * This class reads a Model from a binary frame (see RawModelWriter) on a
+ * (sequential) device, like a QTcpSocket. Since the data may arrive in parts,
+ * the reader can be called whenever new data is available and reads as 
+ * much as possible. The model will be created as soon as its XML header has
+ * arrived, afterwards all (uncompressed) blocks will be read directly into
+ * the model's storage.
+ * Only the XML header and compressed blocks are buffered. Frames announcing
+ * a header of more than 64 MB or a compressed block of more than 1 GB (or
+ * more than zlib's bound for the block's raw size) are rejected before
+ * anything is buffered. The writer sends such blocks uncompressed.
+ */
+class GRAIPE_CORE_EXPORT RawModelReader
+{
+    public:
+        /**
+         * Creates a new reader for binary frames.
+         *
+         * \param wsp The workspace, which is used to create the Model.
+         */
+        RawModelReader(Workspace * wsp);
+    
+        /**
+         * Destructor of the reader. Deletes the (partially) read Model, if 
+         * it has not been taken by means of takeModel().
+         */
+        ~RawModelReader();
+    
+        /**
+         * Resets the reader to read the next frame.
+         */
+        void reset();
+    
+        /**
+         * Reads all currently available data of the frame from the device.
+         *
+         * \param device The device, where the frame is read from.
+         * \return False, if an error occured while reading the frame, else true.
+         */
+        bool read(QIODevice * device);
+    
+        /**
+         * Checks if the frame has been read completely.
+         *
+         * \return True, if the frame and the Model have been read completely.
+         */
+        bool isFinished() const;
+    
+        /**
+         * Checks if the blocks of the current frame are compressed.
+         *
+         * \return True, if the frame uses compressed blocks.
+         */
+        bool isCompressed() const;
+    
+        /**
+         * Returns the read Model and passes its ownership to the caller.
+         *
+         * \return The Model, if the frame has been read completely, else NULL.
+         */
+        Model* takeModel();
+    
+    private:
+        /**
+         * Reads from the device into the buffer, until it holds the given amount of bytes.
+         *
+         * \param device The device, where we read from.
+         * \param bytes The number of bytes the buffer shall hold.
+         * \return True, if the buffer holds the given number of bytes.
+         */
+        bool fillBuffer(QIODevice * device, qint64 bytes);
+    
+        /** The states of the reader **/
+        enum State
+        {
+            ReadPreamble,
+            ReadHeader,
+            ReadBlockHeader,
+            ReadBlock,
+            Finished,
+            Failed
+        };
+    
+        /** The workspace **/
+        Workspace * m_workspace;
+    
+        /** The current state **/
+        State m_state;
+    
+        /** The flags of the current frame **/
+        quint16 m_flags;
+    
+        /** The number of blocks and the size of the header of the current frame **/
+        quint32 m_block_count, m_header_size;
+    
+        /** The id of the current block **/
+        unsigned int m_block;
+    
+        /** The raw and transmitted sizes of the current block **/
+        qint64 m_raw_size, m_wire_size;
+    
+        /** The number of bytes read of the current (uncompressed) block **/
+        qint64 m_block_pos;
+    
+        /** The storage of the current block **/
+        char * m_block_data;
+    
+        /** Buffer for the preamble, the header and compressed blocks **/
+        QByteArray m_buffer;
+    
+        /** The Model, which is currently read **/
+        Model * m_model;
+};
+
+/**
+ * @}
+ */
+
+} //end of namespace graipe
+
+#endif //GRAIPE_CORE_RAWTRANSFER_HXX
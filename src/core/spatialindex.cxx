@@ -0,0 +1,470 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "core/spatialindex.hxx"
+
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *     @file
+ *     @brief Implementation file for the SpatialIndex2D class
+ * @}
+ */
+
+/**
+ * Comparison of point indices along one dimension, used to split the KD-tree.
+ */
+class SpatialIndex2DLess
+{
+    public:
+        SpatialIndex2DLess(const std::vector<QPointFX>& points, int dim)
+        : m_points(points),
+          m_dim(dim)
+        {
+        }
+    
+        bool operator()(unsigned int i, unsigned int j) const
+        {
+            return (m_dim == 0) ? (m_points[i].x() < m_points[j].x()) : (m_points[i].y() < m_points[j].y());
+        }
+    
+    private:
+        const std::vector<QPointFX>& m_points;
+        int m_dim;
+};
+
+SpatialIndex2D::SpatialIndex2D(IndexType type, float cell_size)
+: m_type(type),
+  m_cell_size(cell_size),
+  m_used_cell_size(0),
+  m_grid_x(0), m_grid_y(0),
+  m_grid_width(0), m_grid_height(0)
+{
+}
+
+void SpatialIndex2D::clear()
+{
+    m_points.clear();
+    buildIndex();
+}
+
+unsigned int SpatialIndex2D::size() const
+{
+    return (unsigned int)m_points.size();
+}
+
+SpatialIndex2D::IndexType SpatialIndex2D::type() const
+{
+    return m_type;
+}
+
+const SpatialIndex2D::PointType& SpatialIndex2D::point(unsigned int index) const
+{
+    return m_points[index];
+}
+
+void SpatialIndex2D::radiusSearch(const PointType& p, float radius, std::vector<unsigned int>& result) const
+{
+    boxSearch(PointType(p.x()-radius, p.y()-radius), PointType(p.x()+radius, p.y()+radius), result);
+    
+    double radius2 = double(radius)*radius;
+    
+    unsigned int n=0;
+    for(unsigned int i=0; i<result.size(); ++i)
+    {
+        const PointType& q = m_points[result[i]];
+        double dx = q.x()-p.x(), dy = q.y()-p.y();
+        
+        if(dx*dx + dy*dy <= radius2)
+        {
+            result[n++] = result[i];
+        }
+    }
+    result.resize(n);
+}
+
+std::vector<unsigned int> SpatialIndex2D::radiusSearch(const PointType& p, float radius) const
+{
+    std::vector<unsigned int> result;
+    radiusSearch(p, radius, result);
+    return result;
+}
+
+void SpatialIndex2D::boxSearch(const PointType& min_p, const PointType& max_p, std::vector<unsigned int>& result) const
+{
+    result.clear();
+    
+    if(m_points.empty())
+        return;
+    
+    if(m_type == KDTree)
+    {
+        boxSearchKDTree(0, size(), min_p, max_p, result);
+    }
+    else
+    {
+        int x0 = std::max(0, int(std::floor((min_p.x() - m_grid_x)/m_used_cell_size))),
+            y0 = std::max(0, int(std::floor((min_p.y() - m_grid_y)/m_used_cell_size))),
+            x1 = std::min(m_grid_width-1,  int(std::floor((max_p.x() - m_grid_x)/m_used_cell_size))),
+            y1 = std::min(m_grid_height-1, int(std::floor((max_p.y() - m_grid_y)/m_used_cell_size)));
+        
+        for(int y=y0; y<=y1; ++y)
+        {
+            for(int x=x0; x<=x1; ++x)
+            {
+                int cell = y*m_grid_width + x;
+                
+                for(unsigned int c=m_cell_start[cell]; c<m_cell_start[cell+1]; ++c)
+                {
+                    const PointType& q = m_points[m_cell_items[c]];
+                    
+                    if(    q.x() >= min_p.x() && q.x() <= max_p.x()
+                        && q.y() >= min_p.y() && q.y() <= max_p.y())
+                    {
+                        result.push_back(m_cell_items[c]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<unsigned int> SpatialIndex2D::nearestNeighbors(const PointType& p, unsigned int k) const
+{
+    std::vector<Candidate> heap;
+    
+    if(k != 0 && !m_points.empty())
+    {
+        heap.reserve(std::min(k, size()));
+        
+        if(m_type == KDTree)
+        {
+            nearestNeighborsKDTree(0, size(), p, k, heap);
+        }
+        else
+        {
+            nearestNeighborsGrid(p, k, heap);
+        }
+    }
+    
+    std::sort_heap(heap.begin(), heap.end());
+    
+    std::vector<unsigned int> result(heap.size());
+    for(unsigned int i=0; i<heap.size(); ++i)
+    {
+        result[i] = heap[i].second;
+    }
+    return result;
+}
+
+int SpatialIndex2D::nearestNeighbor(const PointType& p) const
+{
+    std::vector<unsigned int> result = nearestNeighbors(p, 1);
+    
+    return result.empty() ? -1 : int(result.front());
+}
+
+void SpatialIndex2D::buildIndex()
+{
+    m_cell_start.clear();
+    m_cell_items.clear();
+    m_order.clear();
+    m_split_dim.clear();
+    m_grid_width = m_grid_height = 0;
+    
+    if(m_points.empty())
+        return;
+    
+    if(m_type == KDTree)
+    {
+        m_order.resize(m_points.size());
+        m_split_dim.resize(m_points.size());
+        
+        for(unsigned int i=0; i<m_order.size(); ++i)
+        {
+            m_order[i] = i;
+        }
+        buildKDTree(0, size());
+    }
+    else
+    {
+        buildGrid();
+    }
+}
+
+void SpatialIndex2D::buildGrid()
+{
+    double min_x = m_points[0].x(), max_x = min_x,
+           min_y = m_points[0].y(), max_y = min_y;
+    
+    for(const PointType& p : m_points)
+    {
+        min_x = std::min(min_x, p.x()); max_x = std::max(max_x, p.x());
+        min_y = std::min(min_y, p.y()); max_y = std::max(max_y, p.y());
+    }
+    
+    double w = max_x - min_x,
+           h = max_y - min_y;
+    
+    m_used_cell_size = m_cell_size;
+    
+    if(m_used_cell_size <= 0)
+    {
+        //Aim at about two points per cell
+        if(w*h > 0)
+        {
+            m_used_cell_size = std::sqrt(2.0*w*h/m_points.size());
+        }
+        else
+        {
+            m_used_cell_size = std::max(w, h)/std::sqrt(double(m_points.size()));
+        }
+        
+        if(m_used_cell_size <= 0)
+        {
+            m_used_cell_size = 1;
+        }
+    }
+    
+    //Never allow the grid to become much larger than the point set
+    double max_cells = 4.0*m_points.size() + 16;
+    while( (w/m_used_cell_size+1)*(h/m_used_cell_size+1) > max_cells)
+    {
+        m_used_cell_size *= 2;
+    }
+    
+    m_grid_x = min_x;
+    m_grid_y = min_y;
+    m_grid_width  = int(w/m_used_cell_size) + 1;
+    m_grid_height = int(h/m_used_cell_size) + 1;
+    
+    //Counting sort of the points into their cells
+    std::vector<unsigned int> cells(m_points.size());
+    m_cell_start.assign(m_grid_width*m_grid_height+1, 0);
+    
+    for(unsigned int i=0; i<m_points.size(); ++i)
+    {
+        int x = std::min(m_grid_width-1,  int((m_points[i].x() - m_grid_x)/m_used_cell_size)),
+            y = std::min(m_grid_height-1, int((m_points[i].y() - m_grid_y)/m_used_cell_size));
+        
+        cells[i] = y*m_grid_width + x;
+        ++m_cell_start[cells[i]+1];
+    }
+    
+    for(unsigned int c=1; c<m_cell_start.size(); ++c)
+    {
+        m_cell_start[c] += m_cell_start[c-1];
+    }
+    
+    std::vector<unsigned int> fill(m_cell_start.begin(), m_cell_start.end()-1);
+    m_cell_items.resize(m_points.size());
+    
+    for(unsigned int i=0; i<m_points.size(); ++i)
+    {
+        m_cell_items[fill[cells[i]]++] = i;
+    }
+}
+
+void SpatialIndex2D::buildKDTree(unsigned int first, unsigned int last)
+{
+    if(last - first < 2)
+    {
+        if(last > first)
+        {
+            m_split_dim[first] = 0;
+        }
+        return;
+    }
+    
+    //Split along the dimension of the larger extent
+    double min_x = m_points[m_order[first]].x(), max_x = min_x,
+           min_y = m_points[m_order[first]].y(), max_y = min_y;
+    
+    for(unsigned int i=first+1; i<last; ++i)
+    {
+        const PointType& p = m_points[m_order[i]];
+        min_x = std::min(min_x, p.x()); max_x = std::max(max_x, p.x());
+        min_y = std::min(min_y, p.y()); max_y = std::max(max_y, p.y());
+    }
+    
+    int dim = (max_x - min_x >= max_y - min_y) ? 0 : 1;
+    unsigned int mid = first + (last - first)/2;
+    
+    std::nth_element(m_order.begin()+first, m_order.begin()+mid, m_order.begin()+last, SpatialIndex2DLess(m_points, dim));
+    m_split_dim[mid] = dim;
+    
+    buildKDTree(first, mid);
+    buildKDTree(mid+1, last);
+}
+
+void SpatialIndex2D::boxSearchKDTree(unsigned int first, unsigned int last,
+                                     const PointType& min_p, const PointType& max_p,
+                                     std::vector<unsigned int>& result) const
+{
+    while(first < last)
+    {
+        unsigned int mid = first + (last - first)/2;
+        const PointType& q = m_points[m_order[mid]];
+        
+        if(    q.x() >= min_p.x() && q.x() <= max_p.x()
+            && q.y() >= min_p.y() && q.y() <= max_p.y())
+        {
+            result.push_back(m_order[mid]);
+        }
+        
+        double split = m_split_dim[mid] ? q.y() : q.x(),
+               lower = m_split_dim[mid] ? min_p.y() : min_p.x(),
+               upper = m_split_dim[mid] ? max_p.y() : max_p.x();
+        
+        bool left  = lower <= split,
+             right = upper >= split;
+        
+        if(left && right)
+        {
+            boxSearchKDTree(first, mid, min_p, max_p, result);
+            first = mid+1;
+        }
+        else if(left)
+        {
+            last = mid;
+        }
+        else
+        {
+            first = mid+1;
+        }
+    }
+}
+
+void SpatialIndex2D::offerCandidate(const PointType& p, unsigned int index, unsigned int k, std::vector<Candidate>& heap) const
+{
+    const PointType& q = m_points[index];
+    double dx = q.x()-p.x(), dy = q.y()-p.y();
+    Candidate c(dx*dx + dy*dy, index);
+    
+    if(heap.size() < k)
+    {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end());
+    }
+    else if(c < heap.front())
+    {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+
+void SpatialIndex2D::nearestNeighborsKDTree(unsigned int first, unsigned int last,
+                                            const PointType& p, unsigned int k,
+                                            std::vector<Candidate>& heap) const
+{
+    if(first >= last)
+        return;
+    
+    unsigned int mid = first + (last - first)/2;
+    const PointType& q = m_points[m_order[mid]];
+    
+    offerCandidate(p, m_order[mid], k, heap);
+    
+    double diff = m_split_dim[mid] ? (p.y() - q.y()) : (p.x() - q.x());
+    
+    //Visit the side of the query point first
+    if(diff < 0)
+    {
+        nearestNeighborsKDTree(first, mid, p, k, heap);
+        if(heap.size() < k || diff*diff <= heap.front().first)
+        {
+            nearestNeighborsKDTree(mid+1, last, p, k, heap);
+        }
+    }
+    else
+    {
+        nearestNeighborsKDTree(mid+1, last, p, k, heap);
+        if(heap.size() < k || diff*diff <= heap.front().first)
+        {
+            nearestNeighborsKDTree(first, mid, p, k, heap);
+        }
+    }
+}
+
+void SpatialIndex2D::nearestNeighborsGrid(const PointType& p, unsigned int k, std::vector<Candidate>& heap) const
+{
+    int cx = int(std::floor((p.x() - m_grid_x)/m_used_cell_size)),
+        cy = int(std::floor((p.y() - m_grid_y)/m_used_cell_size));
+    
+    //Number of rings needed to cover the whole grid from the query cell
+    int max_ring = std::max(std::max(std::abs(cx), std::abs(cx - m_grid_width + 1)),
+                            std::max(std::abs(cy), std::abs(cy - m_grid_height + 1)));
+    
+    for(int r=0; r<=max_ring; ++r)
+    {
+        //All points outside of ring r are at least (r*cell_size) away
+        if(heap.size() == k)
+        {
+            double bound = (r-1)*m_used_cell_size;
+            if(r > 0 && bound*bound > heap.front().first)
+                break;
+        }
+        
+        int y0 = std::max(0, cy-r), y1 = std::min(m_grid_height-1, cy+r);
+        
+        for(int y=y0; y<=y1; ++y)
+        {
+            //Inner rows of the ring only need their two border cells
+            int step = (y == cy-r || y == cy+r) ? 1 : 2*r;
+            
+            for(int x=cx-r; x<=cx+r; x+=std::max(step,1))
+            {
+                if(x < 0 || x >= m_grid_width)
+                    continue;
+                
+                int cell = y*m_grid_width + x;
+                
+                for(unsigned int c=m_cell_start[cell]; c<m_cell_start[cell+1]; ++c)
+                {
+                    offerCandidate(p, m_cell_items[c], k, heap);
+                }
+            }
+        }
+    }
+}
+
+} //namespace graipe
@@ -0,0 +1,262 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_CORE_SPATIALINDEX_HXX
+#define GRAIPE_CORE_SPATIALINDEX_HXX
+
+#include "core/config.hxx"
+#include "core/qt_ext/qpointfx.hxx"
+
+#include <vector>
+#include <utility>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_core
+ * @{
+ *
+ * @file
+ * @brief Header file for the SpatialIndex2D class
+ */
+
+/**
+ * A static spatial index over a set of 2D points. It answers radius, box and
+ * k-nearest-neighbour queries without scanning all points. Two layouts are
+ * available: A uniform grid, which is best for evenly spread points and radius
+ * queries of about the cell size, and a balanced KD-tree, which adapts to
+ * clustered point sets. The index keeps a copy of the point positions and
+ * reports the indices of the points in the order they were given at build time.
+ *
+ * All queries are const and may be called concurrently from different threads.
+ */
+class GRAIPE_CORE_EXPORT SpatialIndex2D
+{
+    public:
+        /**
+         * The used point type
+         */
+        typedef QPointFX PointType;
+    
+        /**
+         * The available layouts of the index.
+         */
+        enum IndexType { UniformGrid=0, KDTree=1 };
+    
+        /**
+         * Default constructor. Creates an empty index.
+         *
+         * \param type The layout of the index.
+         * \param cell_size The edge length of the grid cells. If zero, a cell size
+         *        is chosen, which holds about two points per cell. Ignored for KD-trees.
+         */
+        SpatialIndex2D(IndexType type=KDTree, float cell_size=0);
+    
+        /**
+         * Constructor, which directly builds the index from a range of points.
+         *
+         * \param begin Iterator to the first point.
+         * \param end Iterator after the last point.
+         * \param type The layout of the index.
+         * \param cell_size The edge length of the grid cells (0 = automatic).
+         */
+        template <class ITERATOR>
+        SpatialIndex2D(ITERATOR begin, ITERATOR end, IndexType type=KDTree, float cell_size=0)
+        : m_type(type),
+          m_cell_size(cell_size)
+        {
+            build(begin, end);
+        }
+    
+        /**
+         * (Re-)builds the index from a range of points.
+         *
+         * \param begin Iterator to the first point.
+         * \param end Iterator after the last point.
+         */
+        template <class ITERATOR>
+        void build(ITERATOR begin, ITERATOR end)
+        {
+            m_points.assign(begin, end);
+            buildIndex();
+        }
+    
+        /**
+         * Removes all points from the index.
+         */
+        void clear();
+    
+        /**
+         * Returns the number of indexed points.
+         *
+         * \return The number of indexed points.
+         */
+        unsigned int size() const;
+    
+        /**
+         * Returns the layout of this index.
+         *
+         * \return The layout of this index.
+         */
+        IndexType type() const;
+    
+        /**
+         * Getter for the position of an indexed point.
+         *
+         * \param index The index of the point.
+         * \return The position of that point.
+         */
+        const PointType& point(unsigned int index) const;
+    
+        /**
+         * Finds all points, whose distance to a given position is less or equal
+         * than a given radius. The result is not sorted.
+         *
+         * \param p The query position.
+         * \param radius The search radius.
+         * \param result The indices of the found points. Will be cleared first.
+         */
+        void radiusSearch(const PointType& p, float radius, std::vector<unsigned int>& result) const;
+    
+        /**
+         * Convenience variant of the radius search, which returns the indices.
+         *
+         * \param p The query position.
+         * \param radius The search radius.
+         * \return The (unsorted) indices of all points inside the radius.
+         */
+        std::vector<unsigned int> radiusSearch(const PointType& p, float radius) const;
+    
+        /**
+         * Finds all points inside an axis aligned box (including its borders).
+         * The result is not sorted.
+         *
+         * \param min_p The upper left corner of the box.
+         * \param max_p The lower right corner of the box.
+         * \param result The indices of the found points. Will be cleared first.
+         */
+        void boxSearch(const PointType& min_p, const PointType& max_p, std::vector<unsigned int>& result) const;
+    
+        /**
+         * Finds the k nearest points of a given position.
+         *
+         * \param p The query position.
+         * \param k The number of requested neighbours.
+         * \return The indices of the min(k, size()) nearest points, sorted by ascending distance.
+         */
+        std::vector<unsigned int> nearestNeighbors(const PointType& p, unsigned int k) const;
+    
+        /**
+         * Finds the nearest point of a given position.
+         *
+         * \param p The query position.
+         * \return The index of the nearest point or -1, if the index is empty.
+         */
+        int nearestNeighbor(const PointType& p) const;
+    
+    private:
+        /** Candidate type for kNN queries: (squared distance, index) **/
+        typedef std::pair<double, unsigned int> Candidate;
+    
+        /**
+         * Builds the grid or tree for the current points.
+         */
+        void buildIndex();
+    
+        /**
+         * Builds the grid cells for the current points.
+         */
+        void buildGrid();
+    
+        /**
+         * Recursively builds the KD-tree for the range [first, last) of m_order.
+         *
+         * \param first The first position of the range.
+         * \param last The position after the last element of the range.
+         */
+        void buildKDTree(unsigned int first, unsigned int last);
+    
+        /**
+         * Recursive box search in the KD-tree.
+         */
+        void boxSearchKDTree(unsigned int first, unsigned int last,
+                             const PointType& min_p, const PointType& max_p,
+                             std::vector<unsigned int>& result) const;
+    
+        /**
+         * Recursive kNN search in the KD-tree.
+         */
+        void nearestNeighborsKDTree(unsigned int first, unsigned int last,
+                                    const PointType& p, unsigned int k,
+                                    std::vector<Candidate>& heap) const;
+    
+        /**
+         * kNN search in the grid by means of growing rings of cells.
+         */
+        void nearestNeighborsGrid(const PointType& p, unsigned int k, std::vector<Candidate>& heap) const;
+    
+        /**
+         * Offers a point to the candidate heap of a kNN search.
+         */
+        void offerCandidate(const PointType& p, unsigned int index, unsigned int k, std::vector<Candidate>& heap) const;
+    
+        /** The layout of the index **/
+        IndexType m_type;
+        /** The requested and the used cell size of the grid **/
+        float m_cell_size, m_used_cell_size;
+        /** The indexed points **/
+        std::vector<PointType> m_points;
+    
+        /** The grid's origin and its size in cells **/
+        double m_grid_x, m_grid_y;
+        int m_grid_width, m_grid_height;
+        /** Start of each cell in m_cell_items (size: cells+1) **/
+        std::vector<unsigned int> m_cell_start;
+        /** The point indices sorted by cell **/
+        std::vector<unsigned int> m_cell_items;
+    
+        /** The point indices in KD-tree order (median of each range is its node) **/
+        std::vector<unsigned int> m_order;
+        /** The split dimension of each KD-tree node (0 = x, 1 = y) **/
+        std::vector<unsigned char> m_split_dim;
+};
+
+/**
+ * @}
+ */
+
+} //namespace graipe
+
+#endif //GRAIPE_CORE_SPATIALINDEX_HXX
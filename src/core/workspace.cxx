@@ -75,6 +75,10 @@ Workspace::Workspace(const Workspace& wsp, bool reload_factories)
 Workspace::~Workspace()
 {
     clear();
+    
+    QMutexLocker locker(&caches_mutex);
+    qDeleteAll(caches);
+    caches.clear();
 }
 
 bool Workspace::deserialize(QXmlStreamReader& xmlReader)
@@ -311,6 +315,8 @@ void Workspace::clear()
     }
     viewControllers.clear();
     
+    QMutexLocker locker(&models_mutex);
+    
     for(Model* m : models)
     {
         m->deleteLater();
@@ -318,8 +324,52 @@ void Workspace::clear()
     models.clear();
 }
 
-Model* Workspace::loadModel(const QString & filename)
+Model* Workspace::loadModel(const QString & filename, bool map_raw)
 {
+    if(Impex::isRawFile(filename))
+    {
+        QFile* file = new QFile(filename);
+        QByteArray xml_header;
+        QVector<Impex::RawBlock> blocks;
+        
+        if(!Impex::openRaw(*file, xml_header, blocks))
+        {
+            qWarning("Workspace::loadModel: Could not read the header of the raw container!");
+            delete file;
+            return NULL;
+        }
+        
+        QXmlStreamReader xmlReader(xml_header);
+        Model* model = loadModel(xmlReader);
+        
+        if(model == NULL)
+        {
+            delete file;
+            return NULL;
+        }
+        
+        bool res;
+        
+        if(map_raw)
+        {
+            //Takes the ownership of the file:
+            res = Impex::mapRawBlocks(file, blocks, model);
+        }
+        else
+        {
+            res = Impex::readRawBlocks(*file, blocks, model);
+            delete file;
+        }
+        
+        if(!res)
+        {
+            qWarning("Workspace::loadModel: Could not read the blocks of the raw container!");
+            delete model;
+            return NULL;
+        }
+        return model;
+    }
+    
    QIODevice* device = Impex::openFile(filename, QIODevice::ReadOnly);
    Model* model = NULL;
 
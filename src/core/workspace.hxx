@@ -43,8 +43,10 @@
 
 #include <QDir>
 #include <QCoreApplication>
+#include <QHash>
 #include <QLibrary>
 #include <QMutex>
+#include <QObject>
 
 #include <vector>
 
@@ -173,12 +175,15 @@ class GRAIPE_CORE_EXPORT Workspace
     
         /**
          * Import procedure for available Models from a filename.
+         * Files ending with ".xraw" will be read as binary raw containers.
          *
          * \param filename The filename of the stored Model.
+         * \param map_raw If true, the blocks of raw containers will be memory-mapped
+         *                instead of being read into memory. Defaults to true.
          * \return A valid pointer to a new Model, if the loading of the Model was successful.
          *         else: a null pointer.
          */
-        Model* loadModel(const QString & filename);
+        Model* loadModel(const QString & filename, bool map_raw=true);
     
     
         /**
@@ -250,20 +255,42 @@ class GRAIPE_CORE_EXPORT Workspace
         }
 
         /**
-         * Public global algorithm mutex.
+         * Public global algorithm mutex. Only needed for algorithms, which are not
+         * thread-safe. The models are protected by their own read/write locks
+         * (see Algorithm::lockModels()).
          */
         QMutex global_algorithm_mutex;
     
         /**
          * A public container holding all loaded Models.
+         * Lock the models_mutex when accessing it.
          */
         std::vector<Model*> models;
     
+        /**
+         * Mutex to protect the models container. Models may be created by
+         * concurrently running algorithms (e.g. by the job scheduler of the server).
+         */
+        QMutex models_mutex;
+    
         /**
          * A public container holding all loaded ViewControllers.
          */
         std::vector<ViewController*> viewControllers;
     
+        /**
+         * Caches of the modules, which belong to this workspace, e.g. for 
+         * intermediate results, which may be reused by subsequent algorithms.
+         * They are identified by a unique name and deleted with the workspace.
+         * Lock the caches_mutex when accessing it.
+         */
+        QHash<QString, QObject*> caches;
+    
+        /**
+         * Mutex to protect the caches container.
+         */
+        QMutex caches_mutex;
+    
     
         /**
          * Returns the currently active Model. Change it using 
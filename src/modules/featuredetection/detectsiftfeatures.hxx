@@ -76,6 +76,8 @@ namespace graipe {
  * \param double_image_size   If true, the lowest octave will start are 2*width, 2*height of the image.
  * \param normalize_image     If true, the image will be normalized to 0..1 for the further computations.
  * \param wsp                 The worskpace of the SIFT detection.
+ * \param threads             The number of threads used for the detection (0 = all cores).
+ *                            The result does not depend on it. Defaults to 1.
  * \return A list of all detected SIFT features.
  */
 
@@ -83,11 +85,11 @@ template <class T>
 SIFTFeatureList2D* detectFeaturesUsingSIFT(const vigra::MultiArrayView<2,T>& src,
                                           float sigma, unsigned int octaves, unsigned int levels,
 									      float contrast_threshold, float curvature_threshold, bool double_image_size, bool normalize_image,
-                                          Workspace * wsp)
+                                          Workspace * wsp, int threads=1)
 {
 	SIFTFeatureList2D * result = new SIFTFeatureList2D(wsp);
     
-    std::vector<SIFTFeature> std_result = computeSIFTDescriptors(src, sigma, octaves, levels, contrast_threshold, curvature_threshold, double_image_size, normalize_image);
+    std::vector<SIFTFeature> std_result = computeSIFTDescriptors(src, sigma, octaves, levels, contrast_threshold, curvature_threshold, double_image_size, normalize_image, threads);
         
     for(const SIFTFeature& sift : std_result)
     {
@@ -40,6 +40,8 @@
 
 #include "vigra/convolution.hxx"
 
+#include <algorithm>
+
 namespace graipe {
 
 /**
@@ -500,7 +502,9 @@ class CannyFeatureLengthFilter
             EdgelFeatureList2D* new_featurelist = new EdgelFeatureList2D(features->workspace());
             
             std::vector<bool> marked(features->size(), false);
-            std::vector<unsigned int> trace, boundary;
+            std::vector<unsigned int> trace, boundary, candidates;
+            
+            const SpatialIndex2D& index = features->spatialIndex();
             
             for (unsigned int i=0; i<features->size(); ++i)
             {
@@ -526,14 +530,18 @@ class CannyFeatureLengthFilter
                             min_x = pos_b.x() - search_radius;	max_x = pos_b.x() + search_radius;
                             min_y = pos_b.y()- search_radius;	max_y = pos_b.y() + search_radius;
                             
+                            index.boxSearch(EdgelFeatureList2D::PointType(min_x, min_y),
+                                            EdgelFeatureList2D::PointType(max_x, max_y),
+                                            candidates);
+                            
+                            //Keep the order of the traces independent of the index
+                            std::sort(candidates.begin(), candidates.end());
                             
-                            for (unsigned int j=0; j<features->size(); ++j)
+                            for (unsigned int c=0; c<candidates.size(); ++c)
                             {
-                                const EdgelFeatureList2D::PointType& pos_j = features->position(j);
+                                unsigned int j = candidates[c];
                                 
-                                if( !marked[j]
-                                   && pos_j.x() >= min_x && pos_j.x() <= max_x
-                                   && pos_j.y() >= min_y && pos_j.y() <= max_y)
+                                if( !marked[j])
                                 {
                                     marked[j] = true;
                                     trace.push_back(j);
@@ -594,6 +602,7 @@ class SIFTFeatureDetector
             m_parameters->addParameter("curvature", new FloatParameter("curvature threshold", 0, 100, 10));
             m_parameters->addParameter("double",    new BoolParameter("double image resolution orientation", true));
             m_parameters->addParameter("norm",      new BoolParameter("normalize image to 0..1", true));
+            m_parameters->addParameter("threads",   new IntParameter("Threads (0 = all cores)", 0, 256, 0));
         }
 	
         /** 
@@ -636,6 +645,7 @@ class SIFTFeatureDetector
                     BoolParameter	*	param_double_size  = static_cast<BoolParameter*>( (*m_parameters)["double"]),
                                     *	param_normalize = static_cast<BoolParameter*>( (*m_parameters)["norm"]);
                     
+                    IntParameter	*	param_threads = static_cast<IntParameter*>( (*m_parameters)["threads"]);
                     
                     vigra::MultiArrayView<2,float>	imageband = param_imageBand->value();
                     
@@ -645,7 +655,7 @@ class SIFTFeatureDetector
                                                                                    param_sigma->value(), param_octaves->value(), param_levels->value(),
                                                                                    param_contrast_threshold->value(), param_curvature_threshold->value(),
                                                                                    param_double_size->value(), param_normalize->value(),
-                                                                                   m_workspace);
+                                                                                   m_workspace, param_threads->value());
                     
                     new_feature_list->setName(QString("SIFT Features of ") + param_imageBand->toString());
                     QString descr("The following parameters were used to determine the SIFT Features:\n");
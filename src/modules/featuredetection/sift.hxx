@@ -5,10 +5,15 @@
 #include <list>
 #include <string>
 #include <algorithm>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 #include <vigra/impex.hxx>
 #include <vigra/multi_array.hxx>
 #include <vigra/convolution.hxx>
+#include <vigra/recursiveconvolution.hxx>
 #include <vigra/multi_math.hxx>
 #include <vigra/linear_algebra.hxx>
 #include <vigra/splineimageview.hxx>
@@ -226,18 +231,492 @@ std::vector<float> computeOrientationHistogram(const vigra::MultiArray<2,T> & im
     return histogram;
 }
 
+/**
+ * Determines the number of threads for the parallel parts of the SIFT computation.
+ *
+ * \param threads The requested number of threads. If <= 0, all cores will be used.
+ * \return The number of threads to be used, at least one.
+ */
+inline unsigned int siftThreadCount(int threads)
+{
+    if(threads <= 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max(threads, 1);
+}
+
+/**
+ * Determines the number of blocks, into which siftParallelFor splits a range.
+ * Use this to size the thread-local buffers, which are filled per block.
+ *
+ * \param count The size of the index range.
+ * \param threads The requested number of threads (0 = all cores).
+ * \return The number of blocks, which is four times the thread count at most.
+ */
+inline unsigned int siftBlockCount(unsigned int count, int threads)
+{
+    return std::min(count, 4*siftThreadCount(threads));
+}
+
+/**
+ * Runs a function for the index range [0, count) in parallel. The range is
+ * split into siftBlockCount(count, threads) contiguous blocks, which are
+ * processed in ascending order by each thread. Thus, results, which are
+ * collected per block and merged in block order afterwards, do not depend
+ * on the number of threads. The first exception thrown by the function will
+ * be rethrown after all threads have finished.
+ *
+ * \param count The size of the index range.
+ * \param threads The number of threads (0 = all cores).
+ * \param block_function The function, which will be called with the block's
+ *        index and its index range [first, last).
+ */
+inline void siftParallelFor(unsigned int count, int threads,
+                            const std::function<void(unsigned int block, unsigned int first, unsigned int last)> & block_function)
+{
+    unsigned int blocks = siftBlockCount(count, threads);
+    unsigned int thread_count = std::min(siftThreadCount(threads), blocks);
+    
+    auto first = [&](unsigned int block) { return (unsigned int)((unsigned long long)count*block/blocks); };
+    
+    if(thread_count <= 1)
+    {
+        for(unsigned int block=0; block<blocks; ++block)
+        {
+            block_function(block, first(block), first(block+1));
+        }
+        return;
+    }
+    
+    std::atomic<unsigned int> next_block(0);
+    std::vector<std::exception_ptr> errors(thread_count);
+    std::vector<std::thread> workers;
+    
+    for(unsigned int t=0; t<thread_count; ++t)
+    {
+        workers.push_back(std::thread([&, t]()
+            {
+                try
+                {
+                    for(unsigned int block=next_block++; block<blocks; block=next_block++)
+                    {
+                        block_function(block, first(block), first(block+1));
+                    }
+                }
+                catch(...)
+                {
+                    errors[t] = std::current_exception();
+                    next_block = blocks;
+                }
+            }));
+    }
+    
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    
+    for(const std::exception_ptr& error : errors)
+    {
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * Gaussian smoothing of an image using a number of threads. This uses the
+ * same separable kernel and reflective border treatment as
+ * vigra::gaussianSmoothing, but performs the x-pass on row strips and the
+ * y-pass on column strips of the image. Since each row (column) is convolved
+ * independently, the result is the same as for the sequential smoothing.
+ * Source and destination may be the same image.
+ *
+ * \param src The source image.
+ * \param dest The destination image, which needs to have the source's shape.
+ * \param sigma The standard deviation of the Gaussian.
+ * \param threads The number of threads (0 = all cores).
+ */
+template <class T>
+void siftGaussianSmoothing(const vigra::MultiArrayView<2,T> & src, vigra::MultiArrayView<2,float> dest,
+                           double sigma, int threads)
+{
+    vigra_precondition(src.shape() == dest.shape(), "siftGaussianSmoothing(): shape mismatch between input and output.");
+    
+    vigra::Kernel1D<double> gauss;
+    gauss.initGaussian(sigma);
+    gauss.setBorderTreatment(vigra::BORDER_TREATMENT_REFLECT);
+    
+    int w = src.width(),
+        h = src.height();
+    
+    vigra::MultiArray<2,float> tmp(src.shape());
+    
+    siftParallelFor(h, threads,
+                    [&](unsigned int, unsigned int first, unsigned int last)
+                    {
+                        vigra::separableConvolveX(srcImageRange(src.subarray(vigra::Shape2(0,first), vigra::Shape2(w,last))),
+                                                  destImage(tmp.subarray(vigra::Shape2(0,first), vigra::Shape2(w,last))),
+                                                  kernel1d(gauss));
+                    });
+    
+    siftParallelFor(w, threads,
+                    [&](unsigned int, unsigned int first, unsigned int last)
+                    {
+                        vigra::separableConvolveY(srcImageRange(tmp.subarray(vigra::Shape2(first,0), vigra::Shape2(last,h))),
+                                                  destImage(dest.subarray(vigra::Shape2(first,0), vigra::Shape2(last,h))),
+                                                  kernel1d(gauss));
+                    });
+}
+
+/**
+ * Gradient cache of one scale space level. It holds the coefficients of the
+ * level's quadratic interpolating spline as well as the magnitude and the
+ * orientation of the spline's gradient at the pixels around the features of
+ * that level. It is computed once per level and then shared by the orientation
+ * assignment and the descriptors of all features on that level. Gradients at
+ * sub-pixel positions (or at pixels outside the features' patches) are evaluated
+ * from the stored coefficients, so it needs no prefiltering per feature and
+ * all const methods may be used from several threads at once, which is not
+ * the case for a vigra::SplineImageView.
+ */
+template <class T>
+class SIFTGradientCache
+{
+    public:
+        /**
+         * Default constructor: Creates an empty cache.
+         */
+        SIFTGradientCache()
+        : m_width(0),
+          m_height(0)
+        {
+        }
+    
+        /**
+         * Computes the spline coefficients of an image and the gradients at all
+         * pixels of the quadratic patches around the given features' positions.
+         *
+         * \param img The image of the scale space level.
+         * \param first_feature The first feature of the level.
+         * \param last_feature Behind the last feature of the level.
+         * \param radius The radius of the patches, where the gradients are needed.
+         * \param threads The number of threads (0 = all cores).
+         */
+        template <class FEATURE_ITERATOR>
+        void build(const vigra::MultiArrayView<2,T> & img,
+                   FEATURE_ITERATOR first_feature, FEATURE_ITERATOR last_feature,
+                   int radius, int threads)
+        {
+            m_width  = img.width();
+            m_height = img.height();
+            
+            m_coefficients.reshape(img.shape());
+            m_magnitude.reshape(img.shape());
+            m_orientation.reshape(img.shape());
+            m_cached.reshape(img.shape(), 0);
+            
+            //The quadratic B-spline prefilter is separable and has a single pole
+            double pole = vigra::BSpline<2, double>().prefilterCoefficients()[0];
+            
+            siftParallelFor(m_height, threads,
+                            [&](unsigned int, unsigned int first, unsigned int last)
+                            {
+                                vigra::recursiveFilterX(srcImageRange(img.subarray(vigra::Shape2(0,first), vigra::Shape2(m_width,last))),
+                                                        destImage(m_coefficients.subarray(vigra::Shape2(0,first), vigra::Shape2(m_width,last))),
+                                                        pole, vigra::BORDER_TREATMENT_REFLECT);
+                            });
+            
+            siftParallelFor(m_width, threads,
+                            [&](unsigned int, unsigned int first, unsigned int last)
+                            {
+                                vigra::MultiArrayView<2, float> columns = m_coefficients.subarray(vigra::Shape2(first,0), vigra::Shape2(last,m_height));
+                                vigra::recursiveFilterY(srcImageRange(columns), destImage(columns),
+                                                        pole, vigra::BORDER_TREATMENT_REFLECT);
+                            });
+            
+            //Mark the patches around the features
+            for (FEATURE_ITERATOR feature = first_feature; feature != last_feature; ++feature)
+            {
+                int x = std::floor(feature->position[0]+0.5),
+                    y = std::floor(feature->position[1]+0.5);
+                
+                for (int img_y = std::max(0, y-radius); img_y <= std::min(m_height-1, y+radius); ++img_y)
+                {
+                    for (int img_x = std::max(0, x-radius); img_x <= std::min(m_width-1, x+radius); ++img_x)
+                    {
+                        m_cached(img_x, img_y) = 1;
+                    }
+                }
+            }
+            
+            siftParallelFor(m_height, threads,
+                            [&](unsigned int, unsigned int first, unsigned int last)
+                            {
+                                for (unsigned int y=first; y<last; ++y)
+                                {
+                                    for (int x=0; x<m_width; ++x)
+                                    {
+                                        if(m_cached(x,y))
+                                        {
+                                            float dx, dy;
+                                            splineGradient(x, y, dx, dy);
+                                            
+                                            m_magnitude(x,y)   = sqrt(dx*dx+dy*dy);
+                                            m_orientation(x,y) = atan2(dy,dx);
+                                        }
+                                    }
+                                }
+                            });
+        }
+    
+        /**
+         * The width of the cached image.
+         *
+         * \return The width of the cached image.
+         */
+        int width() const
+        {
+            return m_width;
+        }
+    
+        /**
+         * The height of the cached image.
+         *
+         * \return The height of the cached image.
+         */
+        int height() const
+        {
+            return m_height;
+        }
+    
+        /**
+         * The gradient magnitude at a pixel. The pixel needs to be inside one of
+         * the patches given at build().
+         *
+         * \param x The x-coordinate of the pixel.
+         * \param y The y-coordinate of the pixel.
+         * \return The gradient magnitude at (x,y).
+         */
+        float magnitude(int x, int y) const
+        {
+            return m_magnitude(x,y);
+        }
+    
+        /**
+         * The gradient orientation at a pixel. The pixel needs to be inside one of
+         * the patches given at build().
+         *
+         * \param x The x-coordinate of the pixel.
+         * \param y The y-coordinate of the pixel.
+         * \return The gradient orientation at (x,y) in radians (-pi..pi).
+         */
+        float orientation(int x, int y) const
+        {
+            return m_orientation(x,y);
+        }
+    
+        /**
+         * The gradient at an arbitrary position. If the position is (almost)
+         * a cached pixel, the cached values are returned. Otherwise the gradient
+         * will be interpolated by means of the spline.
+         *
+         * \param x The x-coordinate.
+         * \param y The y-coordinate.
+         * \param magnitude The gradient magnitude at (x,y).
+         * \param orientation The gradient orientation at (x,y) in radians (-pi..pi).
+         */
+        void gradient(double x, double y, float & magnitude, float & orientation) const
+        {
+            int ix = std::floor(x+0.5),
+                iy = std::floor(y+0.5);
+            
+            if(    std::abs(x-ix) < 1.0e-3 && std::abs(y-iy) < 1.0e-3
+                && ix >= 0 && ix < m_width && iy >= 0 && iy < m_height
+                && m_cached(ix,iy))
+            {
+                magnitude   = m_magnitude(ix,iy);
+                orientation = m_orientation(ix,iy);
+            }
+            else
+            {
+                float dx, dy;
+                splineGradient(x, y, dx, dy);
+                
+                magnitude   = sqrt(dx*dx+dy*dy);
+                orientation = atan2(dy,dx);
+            }
+        }
+    
+    protected:
+        /**
+         * Reflects an index at the borders, like vigra::BORDER_TREATMENT_REFLECT.
+         *
+         * \param i The index.
+         * \param size The size of the dimension.
+         * \return The reflected index.
+         */
+        static int reflect(int i, int size)
+        {
+            if(i < 0)
+                return -i;
+            if(i >= size)
+                return 2*(size-1)-i;
+            return i;
+        }
+    
+        /**
+         * Evaluates the first derivatives of the quadratic spline.
+         *
+         * \param x The x-coordinate.
+         * \param y The y-coordinate.
+         * \param dx The derivative in x-direction at (x,y).
+         * \param dy The derivative in y-direction at (x,y).
+         */
+        void splineGradient(double x, double y, float & dx, float & dy) const
+        {
+            int ix = std::floor(x+0.5),
+                iy = std::floor(y+0.5);
+            
+            double u = x - ix,
+                   v = y - iy;
+            
+            //B-spline weights and their derivatives for the nodes ix-1, ix, ix+1 (iy-1, iy, iy+1)
+            double wx[3]  = { 0.5*(0.5-u)*(0.5-u), 0.75-u*u, 0.5*(0.5+u)*(0.5+u) },
+                   wy[3]  = { 0.5*(0.5-v)*(0.5-v), 0.75-v*v, 0.5*(0.5+v)*(0.5+v) },
+                   dwx[3] = { u-0.5, -2.0*u, u+0.5 },
+                   dwy[3] = { v-0.5, -2.0*v, v+0.5 };
+            
+            double sum_dx = 0, sum_dy = 0;
+            
+            for (int j=0; j<3; ++j)
+            {
+                int cy = reflect(iy+j-1, m_height);
+                
+                double row = 0, row_dx = 0;
+                
+                for (int i=0; i<3; ++i)
+                {
+                    float c = m_coefficients(reflect(ix+i-1, m_width), cy);
+                    
+                    row    += wx[i]*c;
+                    row_dx += dwx[i]*c;
+                }
+                
+                sum_dx += wy[j]*row_dx;
+                sum_dy += dwy[j]*row;
+            }
+            
+            dx = sum_dx;
+            dy = sum_dy;
+        }
+    
+        /** size of the cached image **/
+        int m_width, m_height;
+        /** spline coefficients of the image **/
+        vigra::MultiArray<2, float> m_coefficients;
+        /** gradient magnitudes and orientations at the pixels **/
+        vigra::MultiArray<2, float> m_magnitude, m_orientation;
+        /** non-zero for all pixels, where the gradients have been computed **/
+        vigra::MultiArray<2, vigra::UInt8> m_cached;
+};
+
+/**
+ * Inline function to fill the orientation histograms for a given DoG
+ * extermum position from a gradient cache. Same as above, but no gradients
+ * need to be computed.
+ *
+ * \param cache Constant reference to the gradient cache of the feature's level.
+ * \param feature Const reference to the sift feature.
+ * \param radius The radius used for the collection of gradients
+ * \param histogram_bins The sampling bins for 0..360 degrees.
+ * \return A filled vector with all gaussian distance weighted gradient directions.
+ */
+template <class T>
+std::vector<float> computeOrientationHistogram(const SIFTGradientCache<T> & cache,
+                                               const SIFTFeature & feature,
+                                               int radius=8, unsigned int histogram_bins=36)
+{
+    float x = feature.position[0];
+    float y = feature.position[1];
+ 
+    vigra::Gaussian<double> gauss((feature.scale-2)*1.5);
+    
+    std::vector<float> histogram(histogram_bins);
+    
+    for (int j = -radius; j<= radius; ++j)
+    {
+        int img_y = std::floor((y+j) +0.5);
+        if( img_y < 1 || img_y > cache.height()-2 )
+            continue;
+        
+        for (int i = -radius; i<= radius; ++i)
+        {
+            int img_x = std::floor((x+i)+0.5);
+            if( img_x < 1 || img_x > cache.width()-2 )
+                continue;
+            
+            float   angle = fmod(2*M_PI + cache.orientation(img_x, img_y), 2*M_PI),
+                    weight = cache.magnitude(img_x, img_y)*gauss(sqrt(i*i+j*j));
+            
+            unsigned int hist_bin = angle/(2.0*M_PI)*histogram_bins;
+            histogram[std::min(hist_bin, histogram_bins-1)]+=weight;
+        }
+    }
+    
+    return histogram;
+}
+
+/**
+ * Samples the gradient of a spline image view at a sub-pixel position.
+ *
+ * \param siv Constant reference to the spline image view.
+ * \param x The x-coordinate.
+ * \param y The y-coordinate.
+ * \param magnitude The gradient magnitude at (x,y).
+ * \param orientation The gradient orientation at (x,y) in radians (-pi..pi).
+ */
+template <class SIV>
+inline void sampleSIFTGradient(const SIV & siv, float x, float y, float & magnitude, float & orientation)
+{
+    float   dx = siv.dx(x,y),
+            dy = siv.dy(x,y);
+    
+    magnitude   = sqrt(dx*dx+dy*dy);
+    orientation = atan2(dy,dx);
+}
+
+/**
+ * Samples the gradient of a gradient cache at a sub-pixel position.
+ * Cached values are used for positions at the pixels.
+ *
+ * \param cache Constant reference to the gradient cache.
+ * \param x The x-coordinate.
+ * \param y The y-coordinate.
+ * \param magnitude The gradient magnitude at (x,y).
+ * \param orientation The gradient orientation at (x,y) in radians (-pi..pi).
+ */
+template <class T>
+inline void sampleSIFTGradient(const SIFTGradientCache<T> & cache, float x, float y, float & magnitude, float & orientation)
+{
+    cache.gradient(x, y, magnitude, orientation);
+}
+
 /**
  * Inline function to fill the final discriptor histograms for a given feature.
  *
- * \param siv Constant reference to the image.
+ * \param siv Constant reference to the image, e.g. a vigra::SplineImageView or a
+ *            SIFTGradientCache. The gradients are sampled using sampleSIFTGradient.
  * \param feature Const reference to the sift feature. Position and orientation will used.
  * \param blocks The block count (defaults to 4x4=16).
  * \param block_size The size of each block (defaults to 4x4=16)
  * \param histogram_bins The sampling bins for 0..360 degrees.
  * \return A filled flat vector with all gaussian distance weighted gradient directions.
  */
-template <class T, int ORDER>
-inline std::vector<float>  computeSIFTHistograms(const vigra::SplineImageView<ORDER, T> & siv,
+template <class SIV>
+inline std::vector<float>  computeSIFTHistograms(const SIV & siv,
                                                  const SIFTFeature & feature,
                                                  unsigned int blocks=16, unsigned int block_size=16, unsigned int histogram_bins=8)
 {
@@ -272,10 +751,11 @@ inline std::vector<float>  computeSIFTHistograms(const vigra::SplineImageView<OR
             if( siv_x <= 0 || siv_x >= siv.width() - 1 )
                 continue;
             
-            float   dx = siv.dx(siv_x,siv_y),
-                    dy = siv.dy(siv_x,siv_y),
-                    gradient_orientation = atan2(dy,dx)+M_PI,
-                    gradient_weight = sqrt(dx*dx+dy*dy)*gauss(sqrt(i*i+j*j));
+            float sample_magnitude, sample_orientation;
+            sampleSIFTGradient(siv, siv_x, siv_y, sample_magnitude, sample_orientation);
+            
+            float   gradient_orientation = sample_orientation+M_PI,
+                    gradient_weight = sample_magnitude*gauss(sqrt(i*i+j*j));
             
             unsigned int hist = blocks_per_row*int(hist_col) + int(hist_row),
                          hist_bin = gradient_orientation/(2.0*M_PI)*histogram_bins,
@@ -288,6 +768,54 @@ inline std::vector<float>  computeSIFTHistograms(const vigra::SplineImageView<OR
     return histograms;
 }
 
+/**
+ * Determines the orientation of a feature from its orientation histogram.
+ * The maximum bin will be refined by means of a parabola through it and
+ * its neighbors.
+ *
+ * \param hist The orientation histogram with 36 bins (10 degrees each).
+ * \return The orientation in radians.
+ */
+inline float computeSIFTOrientation(const std::vector<float> & hist)
+{
+    int x2 = 0;
+    double y2 = hist[0];
+    
+    for(unsigned int bin=1; bin<hist.size(); ++bin)
+    {
+        if(hist[bin] > y2)
+        {
+            x2 = bin;
+            y2 = hist[bin];
+        }
+    }
+    
+    if(y2!=0)
+    {
+        //Interpolate angle using parabola:
+        //Collecting values
+        int x1 = x2-1;
+        int x3 = x2+1;
+        double y1 = hist[(36+x1)%36];
+        double y3 = hist[(36+x3)%36];
+        
+        //Estimate parabola
+        double denom = (x1 - x2) * (x1 - x3) * (x2 - x3);
+        double A     = (x3 * (y2 - y1) + x2 * (y1 - y3) + x1 * (y3 - y2)) / denom;
+        double B     = (x3*x3 * (y1 - y2) + x2*x2 * (y3 - y1) + x1*x1 * (y2 - y3)) / denom;
+        //double C     = (x2 * x3 * (x2 - x3) * y1 + x3 * x1 * (x3 - x1) * y2 + x1 * x2 * (x1 - x2) * y3) / denom;
+        
+        double xv = -B / (2*A);
+        //double yv = C - B*B / (4*A);
+        
+        return xv*10.0/180.0*M_PI;
+    }
+    else
+    {
+        return x2*10.0/180.0*M_PI;
+    }
+}
+
 /**
  * The main SIFT method. Computes the feature descriptors.
  *
@@ -299,6 +827,9 @@ inline std::vector<float>  computeSIFTHistograms(const vigra::SplineImageView<OR
  * \param curvature_threshold The keypoint's edge threshold. Defaults to 10.0 (radius of corner)
  * \param double_image_size It true, it doubles the image size for 0th scale
  * \param normalize_image It true, the image will be normalized to 0..1 first.
+ * \param threads The number of threads (0 = all cores). The smoothing, the extrema
+ *                search and the descriptor computation of each octave are split
+ *                among them. The result does not depend on it. Defaults to 1.
  * \return The representation of a vector of single SIFT features, which are vectors, too.
  *         Each vector is ordered as follows:
  * \verbatim
@@ -310,7 +841,8 @@ inline std::vector<float>  computeSIFTHistograms(const vigra::SplineImageView<OR
 template <class T>
 std::vector<SIFTFeature> computeSIFTDescriptors(const vigra::MultiArrayView<2,T> & image,
                                                 float sigma = 1.0, unsigned int octaves=0, unsigned int levels=3,
-                                                float contrast_threshold=0.03, float curvature_threshold=10.0, bool double_image_size=true, bool normalize_image=true)
+                                                float contrast_threshold=0.03, float curvature_threshold=10.0, bool double_image_size=true, bool normalize_image=true,
+                                                int threads=1)
 {
     using namespace std;
     using namespace vigra;
@@ -328,7 +860,7 @@ std::vector<SIFTFeature> computeSIFTDescriptors(const vigra::MultiArrayView<2,T>
         work_image.reshape(2*image.shape());
         
         resizeImageLinearInterpolation(image, work_image);
-        gaussianSmoothing(work_image, work_image, sigma);
+        siftGaussianSmoothing(work_image, work_image, sigma, threads);
         o_offset=-1;
     }
     
@@ -392,110 +924,149 @@ std::vector<SIFTFeature> computeSIFTDescriptors(const vigra::MultiArrayView<2,T>
                    total_sigma = last_sigma*k,
                    current_sigma = sqrt(total_sigma*total_sigma - last_sigma*last_sigma);
             
-            
-            gaussianSmoothing(octave[i-1], octave[i], current_sigma);
+            //Each level depends on the previous one, thus parallelize the smoothing itself
+            siftGaussianSmoothing(octave[i-1], octave[i], current_sigma, threads);
 
             //Compute the dog
             dog[i-1].reshape(octave[i].shape());
-            dog[i-1] = octave[i]-octave[i-1];
+            
+            const MultiArray<2, float> & curr = octave[i];
+            const MultiArray<2, float> & prev = octave[i-1];
+            MultiArray<2, float> & diff = dog[i-1];
+            
+            siftParallelFor(diff.height(), threads,
+                            [&](unsigned int, unsigned int first, unsigned int last)
+                            {
+                                for (unsigned int y=first; y<last; ++y)
+                                {
+                                    for (unsigned int x=0; x<diff.width(); ++x)
+                                    {
+                                        diff(x,y) = curr(x,y) - prev(x,y);
+                                    }
+                                }
+                            });
         }
         
         /**
           * 2. Step: Find features on each DoG level,
-          *          adjust them with subpixel accuray
-          *          filter out most of them,
-          *          create orientation histogram,
-          *          align according to max orientation,
-          *          create descriptors
+          *          adjust them with subpixel accuray and
+          *          filter out most of them.
+          *          The rows of all levels are split into strips. Each strip
+          *          collects its features and counters in its own buffer.
           */
-        for (unsigned int i=3; i<intervals; ++i)
-        {
-            //if we have at least three DoGs, we can search for local extrema
-            for (unsigned int y=1; y<dog[i-2].height()-1; ++y)
-            {
-                for (unsigned int x=1; x<dog[i-2].width()-1; ++x)
-                {
-                    float v = dog[i-2](x,y);
-                    
-                    if ( abs(v) > contrast_threshold)
-                    {
-                        counter_phase1++;
-                        
-                        if(localExtremum(dog, i, x, y))
+        unsigned int rows = (dog[0].height() > 2) ? dog[0].height()-2 : 0;
+        unsigned int rows_total = (intervals-3)*rows;
+        unsigned int blocks = siftBlockCount(rows_total, threads);
+        
+        std::vector<std::vector<SIFTFeature> > block_features(blocks);
+        std::vector<unsigned int> block_phase1(blocks), block_phase2(blocks), block_phase3(blocks);
+        
+        siftParallelFor(rows_total, threads,
+                        [&](unsigned int block, unsigned int first, unsigned int last)
                         {
-                        
-                            //Create a new feature and initialize it.
-                            SIFTFeature new_feature;
-                            new_feature.position[0] = x;
-                            new_feature.position[1] = y;
-                            new_feature.scale = i;
-                            new_feature.contrast = abs(v);
-                        
-                            counter_phase2++;
-                            
-                            if ( adjustLocalExtremum(dog, new_feature, contrast_threshold, curvature_threshold) )
+                            for (unsigned int row=first; row<last; ++row)
                             {
-                                counter_phase3++;
-                                
-                                //switch from DoG to scale space
-								unsigned int best_i = std::floor(new_feature.scale+.5);
-                                std::vector<float> hist = computeOrientationHistogram(octave[best_i], new_feature);
-
-                                int x2 = 0;
-                                double y2 = hist[0];
+                                //if we have at least three DoGs, we can search for local extrema
+                                unsigned int i = 3 + row/rows,
+                                             y = 1 + row%rows;
                                 
-                                for(unsigned int bin=1; bin<hist.size(); ++bin)
+                                for (unsigned int x=1; x<dog[i-2].width()-1; ++x)
                                 {
-                                    if(hist[bin] > y2)
+                                    float v = dog[i-2](x,y);
+                                    
+                                    if ( abs(v) > contrast_threshold)
                                     {
-                                        x2 = bin;
-                                        y2 = hist[bin];
+                                        block_phase1[block]++;
+                                        
+                                        if(localExtremum(dog, i, x, y))
+                                        {
+                                            //Create a new feature and initialize it.
+                                            SIFTFeature new_feature;
+                                            new_feature.position[0] = x;
+                                            new_feature.position[1] = y;
+                                            new_feature.scale = i;
+                                            new_feature.contrast = abs(v);
+                                            
+                                            block_phase2[block]++;
+                                            
+                                            if ( adjustLocalExtremum(dog, new_feature, contrast_threshold, curvature_threshold) )
+                                            {
+                                                block_phase3[block]++;
+                                                block_features[block].push_back(new_feature);
+                                            }
+                                        }
                                     }
                                 }
-                                
-                                if(y2!=0)
+                            }
+                        });
+        
+        //Merge in block order, which is the sequential (level, y, x) order
+        std::vector<SIFTFeature> octave_features;
+        
+        for (unsigned int block=0; block<blocks; ++block)
+        {
+            octave_features.insert(octave_features.end(), block_features[block].begin(), block_features[block].end());
+            
+            counter_phase1 += block_phase1[block];
+            counter_phase2 += block_phase2[block];
+            counter_phase3 += block_phase3[block];
+        }
+        
+        /**
+          * 3. Step: Sort the features by their (rounded) level. The order of the
+          *          features of each level is kept.
+          */
+        //switch from DoG to scale space
+        auto level = [](const SIFTFeature & feature) { return (unsigned int)std::floor(feature.scale+.5); };
+        
+        std::stable_sort(octave_features.begin(), octave_features.end(),
+                         [&level](const SIFTFeature & f1, const SIFTFeature & f2){ return level(f1) < level(f2); });
+        
+        /**
+          * 4. Step: For each level, which contains features, compute the gradient
+          *          cache around them, which is shared by all features of the level
+          *          and freed afterwards. Then, for each feature (in parallel):
+          *          create orientation histogram,
+          *          align according to max orientation,
+          *          create descriptors
+          */
+        double octave_scale = pow(2.0, int(o)+o_offset);
+        const int orientation_radius = 8;
+        
+        for (auto level_begin = octave_features.begin(); level_begin != octave_features.end(); )
+        {
+            unsigned int best_i = level(*level_begin);
+            auto level_end = std::find_if(level_begin, octave_features.end(),
+                                          [&](const SIFTFeature & feature){ return level(feature) != best_i; });
+            
+            SIFTGradientCache<float> gradients;
+            gradients.build(octave[best_i], level_begin, level_end, orientation_radius, threads);
+            
+            siftParallelFor(level_end - level_begin, threads,
+                            [&](unsigned int, unsigned int first, unsigned int last)
+                            {
+                                for (unsigned int f=first; f<last; ++f)
                                 {
-                                    //Interpolate angle using parabola:
-                                    //Collecting values
-                                    int x1 = x2-1;
-                                    int x3 = x2+1;
-                                    double y1 = hist[(36+x1)%36];
-                                    double y3 = hist[(36+x3)%36];
+                                    SIFTFeature & new_feature = level_begin[f];
                                     
-                                    //Estimate parabola
-                                    double denom = (x1 - x2) * (x1 - x3) * (x2 - x3);
-                                    double A     = (x3 * (y2 - y1) + x2 * (y1 - y3) + x1 * (y3 - y2)) / denom;
-                                    double B     = (x3*x3 * (y1 - y2) + x2*x2 * (y3 - y1) + x1*x1 * (y2 - y3)) / denom;
-                                    //double C     = (x2 * x3 * (x2 - x3) * y1 + x3 * x1 * (x3 - x1) * y2 + x1 * x2 * (x1 - x2) * y3) / denom;
-
-                                    double xv = -B / (2*A);
-                                    //double yv = C - B*B / (4*A);
-                        
-                                    //Assign value:
-                                    new_feature.orientation = xv*10.0/180.0*M_PI;
+                                    new_feature.orientation = computeSIFTOrientation(computeOrientationHistogram(gradients, new_feature, orientation_radius));
+                                    new_feature.descriptor = computeSIFTHistograms(gradients, new_feature);
                                 }
-                                else
-                                {
-                                    new_feature.orientation = x2*10.0/180.0*M_PI;
-                                }
-                                
-                                vigra::SplineImageView<2,float> siv(octave[best_i]);
-                                
-                                new_feature.descriptor = computeSIFTHistograms(siv, new_feature);
-
-                                //Rescale from local DoG size to global image size
-                                new_feature.position *= pow(2,o+o_offset);                          //global position
-                                new_feature.scale = pow(2,o+o_offset)*pow(k, new_feature.scale)*sigma;  //global scale
-                                
-                                //Add to results:
-                                result.push_back(new_feature);
-                            }
-                        }
-                    }
-                }
-            }
+                            });
+            
+            level_begin = level_end;
         }
         
+        //Rescale from local DoG size to global image size
+        for (SIFTFeature & new_feature : octave_features)
+        {
+            new_feature.position *= octave_scale;                                    //global position
+            new_feature.scale = octave_scale*pow(k, new_feature.scale)*sigma;        //global scale
+        }
+        
+        //Add to results:
+        result.insert(result.end(), octave_features.begin(), octave_features.end());
+        
         //rescale for next pyramid step and resize old image (3rd from top)
         octave[0].reshape(octave[0].shape()/2);
         resizeImageNoInterpolation(octave[s], octave[0]);
@@ -48,6 +48,7 @@
 
 #include "featurematching/matchpointfeatures.hxx"
 #include "featurematching/matchsiftfeatures.hxx"
+#include "featurematching/siftdescriptorindex.hxx"
 
 /**
  * @}
@@ -156,7 +156,8 @@ class BlockWiseImageMatcher
                                                param_useGME->value(),
                                                mat,
                                                rotation_correlation, translation_correlation,
-                                               used_distance);
+                                               used_distance,
+                                               &m_gme);
                     
                     qint64 processing_time = timer.elapsed();
                     
@@ -205,6 +206,10 @@ class BlockWiseImageMatcher
                 unlockModels();
             }
         }
+    
+    protected:
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
     
 /**
@@ -353,7 +358,8 @@ class FeatureToFeatureMatcher
                                                   param_nCandidates->value(), param_useGME->value(),
                                                   mat,
                                                   rotation_correlation, translation_correlation,
-                                                  used_distance);
+                                                  used_distance,
+                                                  &m_gme);
                     
                     qint64 processing_time = timer.elapsed();
                     
@@ -403,6 +409,10 @@ class FeatureToFeatureMatcher
                 unlockModels();
             }
         }
+    
+    protected:
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
 
 
@@ -550,7 +560,8 @@ class FeatureToImageMatcher
                                                param_nCandidates->value(), param_useGME->value(),
                                                mat,
                                                rotation_correlation, translation_correlation,
-                                               used_distance);
+                                               used_distance,
+                                               &m_gme);
                     
                     qint64 processing_time = timer.elapsed();
                     
@@ -600,6 +611,10 @@ class FeatureToImageMatcher
                 unlockModels();
             }
         }
+    
+    protected:
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
 
 /**
@@ -744,7 +759,8 @@ class ShapeContextMatcher
                                                                    param_nCandidates->value(), param_useGME->value(),
                                                                    mat,
                                                                    rotation_correlation, translation_correlation,
-                                                                   used_distance);
+                                                                   used_distance,
+                                                                   &m_gme);
                     
                     qint64 processing_time = timer.elapsed();
                     
@@ -793,6 +809,10 @@ class ShapeContextMatcher
                 unlockModels();
             }
         }
+    
+    protected:
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
 
 /** 
@@ -832,6 +852,10 @@ class SIFTMatcher
             m_parameters->addParameter("max_d", new FloatParameter("Max. geometrical distance of points", 1, 100000,100));
             m_parameters->addParameter("best_n", new IntParameter("Find N best candidates", 1, 50,10));
             m_parameters->addParameter("gme?", new BoolParameter("use global motion estimation"));
+            m_parameters->addParameter("method", new EnumParameter("Matching method", QStringList() << "Exhaustive" << "Randomized KD-forest", 0));
+            m_parameters->addParameter("checks", new IntParameter("Max. checked descriptors per feature (KD-forest)", 1, 1000000, 256));
+            m_parameters->addParameter("trees", new IntParameter("Number of randomized trees (KD-forest)", 1, 32, 4));
+            m_parameters->addParameter("bytes", new BoolParameter("Compare 8-bit quantized descriptors", false));
         }
 		
         /**
@@ -876,6 +900,12 @@ class SIFTMatcher
                 
                     BoolParameter	*	param_useGME = static_cast<BoolParameter*> ( (*m_parameters)["gme?"]);
                     
+                    EnumParameter	*	param_method = static_cast<EnumParameter*> ( (*m_parameters)["method"]);
+                    IntParameter	*	param_checks = static_cast<IntParameter*> ( (*m_parameters)["checks"]),
+                                    *	param_trees  = static_cast<IntParameter*> ( (*m_parameters)["trees"]);
+                    
+                    BoolParameter	*	param_bytes = static_cast<BoolParameter*> ( (*m_parameters)["bytes"]);
+                    
                     
                     vigra::MultiArrayView<2,float> imageband1 = param_imageBand1->value();
                     vigra::MultiArrayView<2,float> imageband2 = param_imageBand2->value();
@@ -907,7 +937,12 @@ class SIFTMatcher
                                                          param_useGME->value(),
                                                          mat,
                                                          rotation_correlation, translation_correlation,
-                                                         used_distance);
+                                                         used_distance,
+                                                         &m_gme,
+                                                         param_method->value(),
+                                                         param_checks->value(),
+                                                         param_trees->value(),
+                                                         param_bytes->value());
                     
                     qint64 processing_time = timer.elapsed();
                     
@@ -958,6 +993,10 @@ class SIFTMatcher
                 unlockModels();
             }
         }
+    
+    protected:
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
 
 /** 
@@ -132,6 +132,8 @@ public:
  * \param rotation_correlation If use_global is true, this keeps rotation correlation coefficient.
  * \param translation_correlation If use_global is true, this keeps translation correlation coefficient.
  * \param used_max_distance If use_global is true, this contains the used search distance after the gme.
+ * \param gme The global motion estimator, which may be reused by subsequent calls.
+ *            If NULL, vigra::estimateGlobalRotationTranslation is used.
  * \return A Sparse weighted multi vectorfield containing all found matches.
  */
 template <class T1, class T2, class MatchingFunctor>
@@ -145,7 +147,8 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToImage(const vigra::MultiArrayVi
                                                        bool use_global,
                                                        vigra::Matrix<double>& mat,
                                                        double & rotation_correlation, double & translation_correlation,
-                                                       unsigned int & used_max_distance)
+                                                       unsigned int & used_max_distance,
+                                                       GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src1.shape() == src2.shape(), "image shapes differ!");
     
@@ -164,11 +167,14 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToImage(const vigra::MultiArrayVi
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1,
-                                          src2,
-                                          mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         //Mat now contains transform for I2->I1
     }
 	
@@ -447,6 +453,8 @@ class CorrelationFunctor
  * \param rotation_correlation If use_global is true, this keeps rotation correlation coefficient.
  * \param translation_correlation If use_global is true, this keeps translation correlation coefficient.
  * \param used_max_distance If use_global is true, this contains the used search distance after the gme.
+ * \param gme The global motion estimator, which may be reused by subsequent calls.
+ *            If NULL, vigra::estimateGlobalRotationTranslation is used.
  * \return A Sparse weighted multi vectorfield containing all found matches.
  */
 template <class T1, class T2, class MatchingFunctor>
@@ -461,7 +469,8 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToFeatures(const vigra::MultiArra
                                                           bool use_global,
                                                           vigra::Matrix<double>& mat,
                                                           double & rotation_correlation, double & translation_correlation,
-                                                          unsigned int & used_max_distance)
+                                                          unsigned int & used_max_distance,
+                                                          GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src1.shape() == src2.shape(), "image shapes differ!");
     
@@ -480,11 +489,14 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToFeatures(const vigra::MultiArra
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1,
-                                          src2,
-                                          mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         //Mat now contains transform for I2->I1
     }
 	
@@ -595,6 +607,9 @@ std::vector<vigra::MultiArray<2, unsigned int> > createShapeContexts(PointFeatur
 	int radius_bins = int(log(max_radius))+1;
 	
 	vector<vigra::MultiArray<2, unsigned int> > shape_contexts;
+    vector<unsigned int> neighbors;
+    
+    const SpatialIndex2D& index = features.spatialIndex();
 
 	for(unsigned int i=0 ; i < features.size(); ++i)
     {
@@ -604,9 +619,14 @@ std::vector<vigra::MultiArray<2, unsigned int> > createShapeContexts(PointFeatur
 		
 		//create new shape context image for ith feature
 		vigra::MultiArray<2, unsigned int> shape_context(angle_bins,radius_bins);
+        
+        //Rounding moves both points by up to sqrt(0.5) each, so widen the search
+        index.radiusSearch(features.position(i), max_radius + 1.5, neighbors);
 				 
-		for(unsigned int j=0 ; j < features.size(); ++j)
+		for(unsigned int n=0 ; n < neighbors.size(); ++n)
         {
+            unsigned int j = neighbors[n];
+            
             //Destination image point coordinates
             int s2_x = vigra::round(features.position(j).x()),
                 s2_y = vigra::round(features.position(j).y());
@@ -677,6 +697,8 @@ double shapecontext_cc(const vigra::MultiArray<2, T1> & src1, const vigra::Multi
  * \param rotation_correlation If use_global is true, this keeps rotation correlation coefficient.
  * \param translation_correlation If use_global is true, this keeps translation correlation coefficient.
  * \param used_max_distance If use_global is true, this contains the used search distance after the gme.
+ * \param gme The global motion estimator, which may be reused by subsequent calls.
+ *            If NULL, vigra::estimateGlobalRotationTranslation is used.
  * \return A Sparse weighted multi vectorfield containing all found matches.
  */
 template <class T1, class T2>
@@ -690,7 +712,8 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToFeaturesUsingShapeContext(const
                                                                            bool use_global,
                                                                            vigra::Matrix<double>& mat,
                                                                            double & rotation_correlation, double & translation_correlation,
-                                                                           unsigned int & used_max_distance)
+                                                                           unsigned int & used_max_distance,
+                                                                           GlobalMotionEstimator * gme = NULL)
 {
     using namespace ::std;
     using namespace ::vigra;
@@ -699,11 +722,14 @@ SparseWeightedMultiVectorfield2D* matchFeaturesToFeaturesUsingShapeContext(const
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1,
-                                          src2,
-                                          mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         
         //Mat now contains transform for I2->I1
     }
@@ -40,11 +40,13 @@
 #include <vigra/stdimage.hxx>
 #include <vigra/linear_algebra.hxx>
 #include <vigra/affinegeometry.hxx>
+#include <vigra/affine_registration_fft.hxx>
 
 //GRAIPE components needed
 #include "features2d/features2d.h"
 #include "vectorfields/vectorfields.h"
 #include "registration/registration.h"
+#include "featurematching/siftdescriptorindex.hxx"
 
 namespace graipe {
 
@@ -59,8 +61,12 @@ namespace graipe {
 /** 
  * Feature matching using sift features of the first image and sift features of the second image to search for
  * the N most likely features of the second image.
- * The algorithm is brute force: it finds the closest
- * and second-closest matches, and registers the the correspondence if the distance ratio is above a certain threshold.
+ * For each feature of the first image, all features of the second image within the geometric search distance
+ * are considered, and the N closest ones w.r.t. the descriptor distance are registered as candidates,
+ * if their descriptor distance is below a certain threshold.
+ * The candidates may either be searched exhaustively or approximately by means of a randomized KD-forest
+ * over the descriptors of the second image. The latter visits at most max_checks descriptors per feature.
+ * It is only used, if the geometric search area is expected to hold more features than that.
  * This function returns a (probability-)weighted 2-dimensional multi vectorfield holding the results.
  *
  * \param src1 The first image.
@@ -75,6 +81,13 @@ namespace graipe {
  * \param rotation_correlation If use_global is true, this keeps rotation correlation coefficient.
  * \param translation_correlation If use_global is true, this keeps translation correlation coefficient.
  * \param used_max_distance If use_global is true, this contains the used search distance after the gme.
+ * \param gme The global motion estimator, which may be reused by subsequent calls.
+ *            If NULL, vigra::estimateGlobalRotationTranslation is used.
+ * \param method The matching method, see SIFTMatchingMethod (optional).
+ * \param max_checks The max. number of descriptors visited per feature by the KD-forest (optional).
+ * \param trees The number of randomized trees of the KD-forest (optional).
+ * \param quantize_descriptors If true, the descriptors of both lists are quantized to bytes by a
+ *                             common scale before the exhaustive comparison (optional, lossy).
  * \return A Sparse weighted multi vectorfield containing all found matches.
  */
 template <class T1, class T2>
@@ -88,7 +101,12 @@ SparseWeightedMultiVectorfield2D* matchSIFTFeaturesUsingDistance(const vigra::Mu
                                                                  bool use_global,
                                                                  vigra::Matrix<double> & mat,
                                                                  double & rotation_correlation, double & translation_correlation,
-                                                                 unsigned int & used_max_distance)
+                                                                 unsigned int & used_max_distance,
+                                                                 GlobalMotionEstimator * gme = NULL,
+                                                                 int method = SIFTMatchingExhaustive,
+                                                                 unsigned int max_checks = 256,
+                                                                 unsigned int trees = 4,
+                                                                 bool quantize_descriptors = false)
 {
     using namespace ::std;
     using namespace ::vigra;
@@ -97,11 +115,14 @@ SparseWeightedMultiVectorfield2D* matchSIFTFeaturesUsingDistance(const vigra::Mu
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1,
-                                          src2,
-                                          mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         
         //Mat now contains transform for I2->I1
     }
@@ -111,46 +132,155 @@ SparseWeightedMultiVectorfield2D* matchSIFTFeaturesUsingDistance(const vigra::Mu
     //Create resulting vectorfield
     SparseWeightedMultiVectorfield2D* result_vf = new SparseWeightedMultiVectorfield2D(points1.workspace());
     
+    //Transform the positions of the second features once and index them for the geometric search
+    vector<SIFTFeatureList2D::PointType> targets(points2.size());
+    
+    for(unsigned int j=0; j<points2.size(); j++)
+    {
+        int s2_x = vigra::round(points2.position(j).x()),
+            s2_y = vigra::round(points2.position(j).y());
+        
+        targets[j] = SIFTFeatureList2D::PointType(s2_x*mat(0,0) + s2_y*mat(0,1) + mat(0,2),
+                                                  s2_x*mat(1,0) + s2_y*mat(1,1) + mat(1,2));
+    }
+    
+    SpatialIndex2D target_index(targets.begin(), targets.end());
+    
+    //Expected number of features inside the geometric search area
+    double expected_candidates = points2.size();
+    
+    if(points2.size() != 0)
+    {
+        double min_x = targets[0].x(), max_x = min_x,
+               min_y = targets[0].y(), max_y = min_y;
+        
+        for(const SIFTFeatureList2D::PointType& t : targets)
+        {
+            min_x = min(min_x, t.x()); max_x = max(max_x, t.x());
+            min_y = min(min_y, t.y()); max_y = max(max_y, t.y());
+        }
+        
+        double area = max(1.0, (max_x-min_x)*(max_y-min_y));
+        expected_candidates = min(1.0, M_PI*used_max_distance*used_max_distance/area) * points2.size();
+    }
+    
+    //Compare the descriptors as floats or, on demand, as bytes of a common quantization
+    const SIFTDescriptorMatrix * descr1 = &points1.descriptors(),
+                               * descr2 = &points2.descriptors();
+    SIFTDescriptorMatrix byte_descr1, byte_descr2;
+    
+    bool use_bytes = quantize_descriptors;
+    
+    if(use_bytes)
+    {
+        //The descriptors are not normalized: Map the largest value of both lists to 255
+        const SIFTDescriptorMatrix * lists[2] = {descr1, descr2};
+        float max_value = 0;
+        
+        for(const SIFTDescriptorMatrix * list : lists)
+        {
+            for(unsigned int i=0; i<list->size(); ++i)
+            {
+                for(unsigned int k=0; k<list->length(i); ++k)
+                {
+                    max_value = max(max_value, list->floatRow(i)[k]);
+                }
+            }
+        }
+        
+        float common_scale = (max_value > 0) ? 255.0f/max_value : 1.0f;
+        
+        byte_descr1 = *descr1;
+        byte_descr1.quantize(common_scale);
+        descr1 = &byte_descr1;
+        
+        byte_descr2 = *descr2;
+        byte_descr2.quantize(common_scale);
+        descr2 = &byte_descr2;
+    }
+    
+    const float scale = descr1->quantizationScale();
+    const double max_byte_distance2 = double(max_descr_dist)*scale*max_descr_dist*scale;
+    const unsigned int byte_limit = (unsigned int)min(max_byte_distance2, 4294967295.0);
+    
+    SIFTDescriptorIndex descriptor_index(trees);
+    SIFTDescriptorIndex::SearchContext search_context;
+    
+    bool use_forest =    method == SIFTMatchingKDForest
+                      && expected_candidates > max_checks
+                      && descr1->size() != 0
+                      && descriptor_index.build(points2)
+                      && descr1->dimension() == descriptor_index.dimension();
+    
+    vector<unsigned int> geo_candidates;
+    vector<SIFTDescriptorIndex::Neighbor> neighbors;
+    
     for(unsigned int i=0; i<points1.size(); i++)
     {
-        QVector<float> di = points1.descriptor(i);
         list<WeightedTarget2D>		candidates_list;
         
         double min_distance = max_descr_dist;
         
-        for(unsigned int j=0; j<points2.size(); j++)
+        if(use_forest && descr1->length(i) == descriptor_index.dimension())
         {
-            QVector<float> dm = points2.descriptor(j);
-            
-            double distance = 0;
-            
-            int s2_x = vigra::round(points2.position(j).x()),
-                s2_y = vigra::round(points2.position(j).y());
+            const SIFTFeatureList2D::PointType p1 = points1.position(i);
+            const double max_geo_dist2 = double(used_max_distance)*used_max_distance;
             
-            float	s2t_x = s2_x*mat(0,0) + s2_y*mat(0,1) + mat(0,2),
-                    s2t_y = s2_x*mat(1,0) + s2_y*mat(1,1) + mat(1,2);
+            //The forest holds the (unquantized) float descriptors
+            const float* query = points1.descriptors().floatRow(i);
             
-            if(		(points1.position(i).x()-s2t_x)*(points1.position(i).x()-s2t_x)
-               +	(points1.position(i).y()-s2t_y)*(points1.position(i).y()-s2t_y)
-               >	used_max_distance*used_max_distance)
-                continue;
-            
-            for(unsigned int k=0; k<(unsigned int)di.size() && k<(unsigned int)dm.size(); k++)
-            {
-                distance += (di[k]-dm[k]) * (di[k]-dm[k]);
-            }
-            distance = sqrt(distance);
+            descriptor_index.knnSearch(query, n_candidates, max_checks, max_descr_dist*max_descr_dist,
+                                       [&](unsigned int j)
+                                       {
+                                           return   (p1.x()-targets[j].x())*(p1.x()-targets[j].x())
+                                                  + (p1.y()-targets[j].y())*(p1.y()-targets[j].y()) <= max_geo_dist2;
+                                       },
+                                       search_context, neighbors);
             
-            if(distance < max_descr_dist)     // smallest distance
+            for(const SIFTDescriptorIndex::Neighbor& n : neighbors)
             {
                 WeightedTarget2D target;
-                target.x=s2t_x;
-                target.y=s2t_y;
-                target.weight=distance;
+                target.x=targets[n.second].x();
+                target.y=targets[n.second].y();
+                target.weight=sqrt(n.first);
                 candidates_list.push_back(target);
-                min_distance = std::min(distance,min_distance);
             }
+        }
+        else
+        {
+            target_index.radiusSearch(points1.position(i), used_max_distance, geo_candidates);
+            
+            //Keep the candidate order of the former full scan
+            sort(geo_candidates.begin(), geo_candidates.end());
             
+            for(unsigned int j : geo_candidates)
+            {
+                double distance = 0;
+                
+                float	s2t_x = targets[j].x(),
+                        s2t_y = targets[j].y();
+                
+                unsigned int length = min(descr1->length(i), descr2->length(j));
+                
+                if(use_bytes)
+                {
+                    distance = sqrt(double(siftDescriptorDistance2(descr1->byteRow(i), descr2->byteRow(j), length, byte_limit)))/scale;
+                }
+                else
+                {
+                    distance = sqrt(siftDescriptorDistance2(descr1->floatRow(i), descr2->floatRow(j), length, max_descr_dist*max_descr_dist));
+                }
+                
+                if(distance < max_descr_dist)     // smallest distance
+                {
+                    WeightedTarget2D target;
+                    target.x=s2t_x;
+                    target.y=s2t_y;
+                    target.weight=distance;
+                    candidates_list.push_back(target);
+                    min_distance = std::min(distance,min_distance);
+                }
+            }
         }
         //qDebug() << "min1 = " << min1 << ", min2 = " << min2
         if(candidates_list.size()>0){
@@ -0,0 +1,446 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_FEATUREMATCHING_SIFTDESCRIPTORINDEX_HXX
+#define GRAIPE_FEATUREMATCHING_SIFTDESCRIPTORINDEX_HXX
+
+#include <vector>
+#include <queue>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+//GRAIPE components needed
+#include "features2d/features2d.h"
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_featurematching
+ * @{
+ *
+ * @file
+ * @brief Header file for the approximate nearest neighbour index of SIFT descriptors.
+ */
+
+/**
+ * The available matching methods for SIFT descriptors.
+ */
+enum SIFTMatchingMethod
+{
+    SIFTMatchingExhaustive = 0,
+    SIFTMatchingKDForest = 1
+};
+
+/**
+ * Approximate nearest neighbour index for SIFT descriptors by means of a randomized
+ * KD-forest (Silpa-Anan and Hartley, 2008) over a float copy of the packed descriptors. Each tree splits at the mean of a dimension,
+ * which is randomly chosen from the dimensions of highest variance. A query descends all
+ * trees and then explores the closest unexplored branches of the whole forest until a
+ * given budget of checked descriptors has been spent.
+ */
+class SIFTDescriptorIndex
+{
+    public:
+        /**
+         * Distance and index of a found descriptor. The distance is squared.
+         */
+        typedef std::pair<float, unsigned int> Neighbor;
+    
+        /**
+         * Per-query bookkeeping, which may be reused by subsequent queries of the same
+         * thread to avoid the reallocation of the visited marks.
+         */
+        class SearchContext
+        {
+            public:
+                /**
+                 * Default constructor.
+                 */
+                SearchContext()
+                : m_stamp(0)
+                {
+                }
+            
+            private:
+                friend class SIFTDescriptorIndex;
+            
+                /** The stamp of the last query, which visited each descriptor **/
+                std::vector<unsigned int> m_visited;
+                /** The stamp of the current query **/
+                unsigned int m_stamp;
+        };
+    
+        /**
+         * Default constructor. Creates an empty index.
+         *
+         * \param trees The number of randomized trees.
+         * \param leaf_size The max. number of descriptors in each leaf.
+         * \param seed The seed for the random choice of the split dimensions.
+         */
+        SIFTDescriptorIndex(unsigned int trees=4, unsigned int leaf_size=4, unsigned int seed=1)
+        : m_trees(std::max(1u, trees)),
+          m_leaf_size(std::max(1u, leaf_size)),
+          m_seed(seed),
+          m_dim(0),
+          m_size(0)
+        {
+        }
+    
+        /**
+         * Builds the index for the descriptors of a SIFT feature list.
+         * All descriptors need to have the same dimension.
+         *
+         * \param features The SIFT features.
+         * \return True, if the index could be built.
+         */
+        bool build(const SIFTFeatureList2D& features)
+        {
+            m_nodes.clear();
+            m_roots.clear();
+            m_indices.clear();
+            
+            m_descriptors = features.descriptors();
+            m_descriptors.dequantize();
+            
+            if(!m_descriptors.uniform())
+            {
+                m_descriptors.clear();
+                m_size = m_dim = 0;
+                return false;
+            }
+            
+            m_size = m_descriptors.size();
+            m_dim  = m_descriptors.dimension();
+            
+            if(m_size == 0)
+                return true;
+            
+            std::mt19937 rng(m_seed);
+            m_indices.resize(m_trees);
+            
+            for(unsigned int t=0; t<m_trees; ++t)
+            {
+                m_indices[t].resize(m_size);
+                for(unsigned int i=0; i<m_size; ++i)
+                {
+                    m_indices[t][i] = i;
+                }
+                m_roots.push_back(buildTree(m_indices[t], 0, m_size, rng));
+            }
+            return true;
+        }
+    
+        /**
+         * Returns the number of indexed descriptors.
+         *
+         * \return The number of indexed descriptors.
+         */
+        unsigned int size() const
+        {
+            return m_size;
+        }
+    
+        /**
+         * Returns the dimension of the indexed descriptors.
+         *
+         * \return The dimension of the indexed descriptors.
+         */
+        unsigned int dimension() const
+        {
+            return m_dim;
+        }
+    
+        /**
+         * Approximate k nearest neighbour search.
+         *
+         * \param query The query descriptor (of the index' dimension).
+         * \param k The max. number of neighbours to find.
+         * \param max_checks The max. number of descriptors to visit.
+         * \param max_distance2 Only descriptors with a squared distance below this value are reported.
+         * \param filter Unary predicate on the descriptor index. Only accepted descriptors are reported.
+         * \param context The (reusable) bookkeeping for this query.
+         * \param result The found neighbours sorted by ascending distance. Will be cleared first.
+         */
+        template <class FILTER>
+        void knnSearch(const float* query, unsigned int k, unsigned int max_checks, float max_distance2,
+                       const FILTER& filter, SearchContext& context,
+                       std::vector<Neighbor>& result) const
+        {
+            result.clear();
+            
+            if(m_size == 0 || k == 0)
+                return;
+            
+            if(context.m_visited.size() != m_size || ++context.m_stamp == 0)
+            {
+                context.m_visited.assign(m_size, 0);
+                context.m_stamp = 1;
+            }
+            
+            std::priority_queue<Branch, std::vector<Branch>, std::greater<Branch> > branches;
+            unsigned int checks = 0;
+            
+            for(unsigned int t=0; t<m_trees; ++t)
+            {
+                descend(m_roots[t], 0, query, k, max_distance2, filter, context, branches, checks, result);
+            }
+            
+            while(!branches.empty() && checks < max_checks)
+            {
+                Branch b = branches.top();
+                branches.pop();
+                
+                if(b.first >= worstDistance(k, max_distance2, result))
+                    break;
+                
+                descend(b.second, b.first, query, k, max_distance2, filter, context, branches, checks, result);
+            }
+            
+            std::sort_heap(result.begin(), result.end());
+        }
+    
+    private:
+        /**
+         * A node of a tree. Inner nodes split at (dim, value), leaves refer to
+         * the range [begin, end) of the tree's index list.
+         */
+        struct Node
+        {
+            int left, right;
+            unsigned int dim, begin, end, tree;
+            float value;
+        };
+    
+        /** Lower distance bound and node of an unexplored branch **/
+        typedef std::pair<float, int> Branch;
+    
+        /**
+         * Recursively builds a tree for the given range of its index list.
+         *
+         * \return The index of the created node.
+         */
+        int buildTree(std::vector<unsigned int>& indices, unsigned int begin, unsigned int end, std::mt19937& rng)
+        {
+            Node node;
+            node.left = node.right = -1;
+            node.dim = 0;
+            node.value = 0;
+            node.begin = begin;
+            node.end = end;
+            node.tree = (unsigned int)m_roots.size();
+            
+            int node_idx = (int)m_nodes.size();
+            m_nodes.push_back(node);
+            
+            if(end - begin <= m_leaf_size)
+                return node_idx;
+            
+            //Estimate mean and variance from a sample of the range
+            const unsigned int samples = std::min(end - begin, 100u);
+            std::vector<double> mean(m_dim, 0.0), var(m_dim, 0.0);
+            
+            for(unsigned int s=0; s<samples; ++s)
+            {
+                const float* d = descriptor(indices[begin + s*(end-begin)/samples]);
+                for(unsigned int k=0; k<m_dim; ++k)
+                {
+                    mean[k] += d[k];
+                }
+            }
+            for(unsigned int k=0; k<m_dim; ++k)
+            {
+                mean[k] /= samples;
+            }
+            for(unsigned int s=0; s<samples; ++s)
+            {
+                const float* d = descriptor(indices[begin + s*(end-begin)/samples]);
+                for(unsigned int k=0; k<m_dim; ++k)
+                {
+                    var[k] += (d[k]-mean[k])*(d[k]-mean[k]);
+                }
+            }
+            
+            //Randomly choose one of the (up to) five dimensions of highest variance
+            std::vector<unsigned int> dims(m_dim);
+            for(unsigned int k=0; k<m_dim; ++k)
+            {
+                dims[k] = k;
+            }
+            unsigned int top = std::min(m_dim, 5u);
+            std::partial_sort(dims.begin(), dims.begin()+top, dims.end(),
+                              [&var](unsigned int a, unsigned int b){ return var[a] > var[b]; });
+            
+            unsigned int dim = dims[std::uniform_int_distribution<unsigned int>(0, top-1)(rng)];
+            float value = float(mean[dim]);
+            
+            //The value is captured by reference, since the median fallback changes it
+            const SIFTDescriptorMatrix& data = m_descriptors;
+            auto less_than_value = [&data, dim, &value](unsigned int i){ return data.floatRow(i)[dim] < value; };
+            
+            unsigned int mid = (unsigned int)(std::partition(indices.begin()+begin, indices.begin()+end, less_than_value) - indices.begin());
+            
+            //Fall back to the median, if the mean does not separate the range
+            if(mid == begin || mid == end)
+            {
+                mid = begin + (end-begin)/2;
+                std::nth_element(indices.begin()+begin, indices.begin()+mid, indices.begin()+end,
+                                 [&data, dim](unsigned int a, unsigned int b){ return data.floatRow(a)[dim] < data.floatRow(b)[dim]; });
+                value = data.floatRow(indices[mid])[dim];
+                
+                mid = (unsigned int)(std::partition(indices.begin()+begin, indices.begin()+end, less_than_value) - indices.begin());
+                
+                if(mid == begin)
+                {
+                    //The median is the minimum: Put all its occurrences to the left
+                    mid = (unsigned int)(std::partition(indices.begin()+begin, indices.begin()+end,
+                                                        [&data, dim, value](unsigned int i){ return data.floatRow(i)[dim] <= value; }) - indices.begin());
+                    
+                    if(mid == end)
+                    {
+                        //All values are equal in the chosen dimension
+                        return node_idx;
+                    }
+                }
+            }
+            
+            int left  = buildTree(indices, begin, mid, rng);
+            int right = buildTree(indices, mid, end, rng);
+            
+            m_nodes[node_idx].left  = left;
+            m_nodes[node_idx].right = right;
+            m_nodes[node_idx].dim   = dim;
+            m_nodes[node_idx].value = value;
+            
+            return node_idx;
+        }
+    
+        /**
+         * Pointer to the packed descriptor of an index.
+         */
+        const float* descriptor(unsigned int index) const
+        {
+            return m_descriptors.floatRow(index);
+        }
+    
+        /**
+         * The current acceptance bound for new neighbours.
+         */
+        static float worstDistance(unsigned int k, float max_distance2, const std::vector<Neighbor>& result)
+        {
+            return (result.size() < k) ? max_distance2 : std::min(max_distance2, result.front().first);
+        }
+    
+        /**
+         * Descends from a node to its closest leaf, remembers the other branches and
+         * checks all descriptors of the leaf.
+         */
+        template <class FILTER>
+        void descend(int node_idx, float bound, const float* query, unsigned int k, float max_distance2,
+                     const FILTER& filter, SearchContext& context,
+                     std::priority_queue<Branch, std::vector<Branch>, std::greater<Branch> >& branches,
+                     unsigned int& checks, std::vector<Neighbor>& result) const
+        {
+            const Node* node = &m_nodes[node_idx];
+            
+            while(node->left != -1)
+            {
+                float diff = query[node->dim] - node->value;
+                int near_idx = (diff < 0) ? node->left  : node->right,
+                    far_idx  = (diff < 0) ? node->right : node->left;
+                
+                float far_bound = std::max(bound, diff*diff);
+                if(far_bound < worstDistance(k, max_distance2, result))
+                {
+                    branches.push(Branch(far_bound, far_idx));
+                }
+                node = &m_nodes[near_idx];
+            }
+            
+            const std::vector<unsigned int>& indices = m_indices[node->tree];
+            
+            for(unsigned int i=node->begin; i<node->end; ++i)
+            {
+                unsigned int index = indices[i];
+                
+                if(context.m_visited[index] == context.m_stamp)
+                    continue;
+                
+                context.m_visited[index] = context.m_stamp;
+                ++checks;
+                
+                if(!filter(index))
+                    continue;
+                
+                float worst = worstDistance(k, max_distance2, result);
+                float distance = siftDescriptorDistance2(query, descriptor(index), m_dim, worst);
+                
+                if(distance < worst)
+                {
+                    if(result.size() == k)
+                    {
+                        std::pop_heap(result.begin(), result.end());
+                        result.pop_back();
+                    }
+                    result.push_back(Neighbor(distance, index));
+                    std::push_heap(result.begin(), result.end());
+                }
+            }
+        }
+    
+        /** Number of trees and max. leaf size **/
+        unsigned int m_trees, m_leaf_size;
+        /** Seed of the random split selection **/
+        unsigned int m_seed;
+        /** Descriptor dimension and count **/
+        unsigned int m_dim, m_size;
+        /** The packed (float) descriptors **/
+        SIFTDescriptorMatrix m_descriptors;
+        /** The nodes of all trees **/
+        std::vector<Node> m_nodes;
+        /** The root node of each tree **/
+        std::vector<int> m_roots;
+        /** The descriptor order of each tree **/
+        std::vector<std::vector<unsigned int> > m_indices;
+};
+
+/**
+ * @}
+ */
+
+} //end of namespace graipe
+
+#endif //GRAIPE_FEATUREMATCHING_SIFTDESCRIPTORINDEX_HXX
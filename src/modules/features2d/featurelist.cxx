@@ -49,7 +49,8 @@ namespace graipe {
  */
 
 PointFeatureList2D::PointFeatureList2D(Workspace* wsp)
-: Model(wsp)
+: Model(wsp),
+  m_spatial_index_valid(false)
 {
 }
 
@@ -226,6 +227,28 @@ bool PointFeatureList2D::deserialize_content(QXmlStreamReader& xmlReader)
     return true;
 }
 
+const SpatialIndex2D& PointFeatureList2D::spatialIndex() const
+{
+    QMutexLocker locker(&m_spatial_index_mutex);
+    
+    //Items may also be appended by the CSV and XML readers without a model update
+    if(!m_spatial_index_valid || m_spatial_index.size() != (unsigned int)m_points.size())
+    {
+        m_spatial_index.build(m_points.begin(), m_points.end());
+        m_spatial_index_valid = true;
+    }
+    return m_spatial_index;
+}
+
+void PointFeatureList2D::updateModel()
+{
+    {
+        QMutexLocker locker(&m_spatial_index_mutex);
+        m_spatial_index_valid = false;
+    }
+    Model::updateModel();
+}
+
 
 
 
@@ -529,9 +552,14 @@ void SIFTFeatureList2D::setScale(unsigned int index, float new_s)
 	updateModel();
 }
 
-const QVector<float>& SIFTFeatureList2D::descriptor(unsigned int index) const
+QVector<float> SIFTFeatureList2D::descriptor(unsigned int index) const
 {
-	return m_descriptors[index];
+	return m_descriptors.row(index);
+}
+
+const SIFTDescriptorMatrix& SIFTFeatureList2D::descriptors() const
+{
+	return m_descriptors;
 }
 
 void SIFTFeatureList2D::setDescriptor(unsigned int index, const QVector<float> & new_d)
@@ -539,7 +567,7 @@ void SIFTFeatureList2D::setDescriptor(unsigned int index, const QVector<float> &
     if(locked())
         return;
     
-	m_descriptors[index] = new_d;
+	m_descriptors.set(index, new_d);
 	updateModel();
 }
 
@@ -571,7 +599,7 @@ void SIFTFeatureList2D::addFeature(const PointType& p, float weight, float orien
         return;
     
 	m_scales.push_back(scale);
-    m_descriptors.push_back(desc);
+    m_descriptors.append(desc);
     
     EdgelFeatureList2D::addFeature(p, weight, orientation);
 }
@@ -584,7 +612,7 @@ void SIFTFeatureList2D::removeFeature(unsigned int index)
 	if (index <(unsigned int) m_scales.size() )
     {
         m_scales.erase(m_scales.begin()+index);
-        m_descriptors.erase(m_descriptors.begin()+index);
+        m_descriptors.remove(index);
         EdgelFeatureList2D::removeFeature(index);
     }
 }
@@ -597,10 +625,11 @@ QString SIFTFeatureList2D::csvHeader() const
 QString SIFTFeatureList2D::itemToCSV(unsigned int index) const
 {
 	QString result = QString("%1, %2").arg(EdgelFeatureList2D::itemToCSV(index)).arg(m_scales[index]);
+    QVector<float> desc = m_descriptors.row(index);
     
-    for(unsigned int i=0; i< (unsigned int)m_descriptors[index].size(); ++i)
+    for(unsigned int i=0; i< (unsigned int)desc.size(); ++i)
     {
-		result += ", " + QString::number((m_descriptors[index])[i], 'g', 10);
+		result += ", " + QString::number(desc[i], 'g', 10);
 	}
 	return result;
 
@@ -631,7 +660,7 @@ bool SIFTFeatureList2D::itemFromCSV(const QString & serial)
                 }
             }
             
-            m_descriptors.push_back(desc);
+            m_descriptors.append(desc);
             
             EdgelFeatureList2D::itemFromCSV(serial);
 			
@@ -651,14 +680,16 @@ void SIFTFeatureList2D::serialize_item(unsigned int index, QXmlStreamWriter& xml
     
     xmlWriter.writeTextElement("scale", QString::number(m_scales[index], 'g', 10));
     
+    QVector<float> desc = m_descriptors.row(index);
+    
     xmlWriter.writeStartElement("descriptor");
-    xmlWriter.writeAttribute("size", QString::number(m_descriptors[index].size()));
+    xmlWriter.writeAttribute("size", QString::number(desc.size()));
     
-    for(unsigned int i=0; i< (unsigned int)m_descriptors[index].size(); ++i)
+    for(unsigned int i=0; i< (unsigned int)desc.size(); ++i)
     {
 		xmlWriter.writeStartElement("value");
         xmlWriter.writeAttribute("ID", QString::number(i));
-            xmlWriter.writeCharacters(QString::number((m_descriptors[index])[i], 'g', 10));
+            xmlWriter.writeCharacters(QString::number(desc[i], 'g', 10));
         xmlWriter.writeEndElement();
 	}
 }
@@ -701,7 +732,7 @@ bool SIFTFeatureList2D::deserialize_item(QXmlStreamReader& xmlReader)
                         return false;
                     }
                 }
-                m_descriptors.push_back(desc);
+                m_descriptors.append(desc);
             }
             else
             {
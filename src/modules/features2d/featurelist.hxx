@@ -38,10 +38,13 @@
 
 #include "core/model.hxx"
 #include "core/qt_ext/qpointfx.hxx"
+#include "core/spatialindex.hxx"
 
 #include "features2d/config.hxx"
+#include "features2d/siftdescriptors.hxx"
 
 #include <QVector>
+#include <QMutex>
 
 namespace graipe {
 
@@ -187,10 +190,33 @@ class GRAIPE_FEATURES2D_EXPORT PointFeatureList2D
          * \param xmlReader The QXmlStreamReader, where we will read from.
          */
 		bool deserialize_content(QXmlStreamReader& xmlReader);
+    
+        /**
+         * Spatial index over the positions of all features, which may be used for
+         * radius and nearest neighbour queries. The index is built on first use and
+         * invalidated whenever the feature list changes.
+         *
+         * \return A KD-tree over the positions of all features.
+         */
+        const SpatialIndex2D& spatialIndex() const;
+    
+    protected slots:
+        /**
+         * This slot is called, whenever the feature list is changed.
+         * It invalidates the spatial index before informing others.
+         */
+        void updateModel();
 	
 	protected:
 		/** The point list **/
 		QVector<PointType> m_points;
+    
+        /** The lazily built spatial index of the point list **/
+        mutable SpatialIndex2D m_spatial_index;
+        /** Is the spatial index up to date? **/
+        mutable bool m_spatial_index_valid;
+        /** Guards the lazy construction of the spatial index **/
+        mutable QMutex m_spatial_index_mutex;
 };
 
 
@@ -526,11 +552,20 @@ class GRAIPE_FEATURES2D_EXPORT SIFTFeatureList2D
     
         /**
          * Getter for the descriptor of a feature at a certain index.
+         * Since all descriptors are stored in one packed matrix, this returns a copy.
+         * Use descriptors() for the distance computation of many descriptors.
          *
          * \param index The index of the feature inside the list.
          * \return The descriptor of the requested feature.
          */
-		const QVector<float>& descriptor(unsigned int index) const;
+		QVector<float> descriptor(unsigned int index) const;
+    
+        /**
+         * Getter for the packed storage of all descriptors.
+         *
+         * \return The descriptor matrix with one row per feature.
+         */
+		const SIFTDescriptorMatrix& descriptors() const;
     
         /**
          * Setter for the descriptor of a feature at a certain index.
@@ -653,8 +688,8 @@ class GRAIPE_FEATURES2D_EXPORT SIFTFeatureList2D
         /** Storage for each feature's scale **/
         QVector<float> m_scales;
 		
-        /** Storage for each feature's descriptor **/
-        QVector<QVector<float> > m_descriptors;
+        /** Packed storage for each feature's descriptor **/
+        SIFTDescriptorMatrix m_descriptors;
 };
   
 /**
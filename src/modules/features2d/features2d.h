@@ -49,6 +49,7 @@
 #include "features2d/featurelist.hxx"
 #include "features2d/featureliststatistics.hxx"
 #include "features2d/featurelistviewcontroller.hxx"
+#include "features2d/siftdescriptors.hxx"
 
 #include "features2d/polygon.hxx"
 #include "features2d/polygonlist.hxx"
@@ -0,0 +1,508 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "features2d/siftdescriptors.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define GRAIPE_FEATURES2D_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+//Allow the compilation of AVX2 kernels without global compiler flags
+#if defined(GRAIPE_FEATURES2D_X86) && defined(__GNUC__)
+    #define GRAIPE_FEATURES2D_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define GRAIPE_FEATURES2D_TARGET_AVX2
+#endif
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_features2d
+ * @{
+ *     @file
+ *     @brief Implementation file for the packed storage of SIFT descriptors and their distance kernels
+ * @}
+ */
+
+/**
+ * Rounds a descriptor length up to the stride of the float storage.
+ * The byte storage uses the same number of elements, rounded up to 32.
+ */
+static unsigned int siftDescriptorStride(unsigned int dim, int storage)
+{
+    unsigned int multiple = (storage == SIFTDescriptorUInt8) ? 32 : 8;
+    return (dim + multiple - 1)/multiple*multiple;
+}
+
+SIFTDescriptorMatrix::SIFTDescriptorMatrix()
+: m_storage(SIFTDescriptorFloat),
+  m_scale(1),
+  m_size(0),
+  m_dim(0),
+  m_stride(0)
+{
+}
+
+unsigned int SIFTDescriptorMatrix::size() const
+{
+    return m_size;
+}
+
+unsigned int SIFTDescriptorMatrix::dimension() const
+{
+    return m_dim;
+}
+
+unsigned int SIFTDescriptorMatrix::stride() const
+{
+    return m_stride;
+}
+
+unsigned int SIFTDescriptorMatrix::length(unsigned int index) const
+{
+    return m_lengths[index];
+}
+
+bool SIFTDescriptorMatrix::uniform() const
+{
+    for(unsigned int i=0; i<m_size; ++i)
+    {
+        if(m_lengths[i] != m_dim)
+            return false;
+    }
+    return true;
+}
+
+int SIFTDescriptorMatrix::storage() const
+{
+    return m_storage;
+}
+
+float SIFTDescriptorMatrix::quantizationScale() const
+{
+    return m_scale;
+}
+
+void SIFTDescriptorMatrix::clear()
+{
+    m_size = m_dim = m_stride = 0;
+    m_lengths.clear();
+    m_floats.clear();
+    m_bytes.clear();
+}
+
+void SIFTDescriptorMatrix::append(const QVector<float>& descr)
+{
+    if((unsigned int)descr.size() > m_dim)
+    {
+        reshape(descr.size());
+    }
+    
+    ++m_size;
+    m_lengths.push_back(0);
+    
+    if(m_storage == SIFTDescriptorUInt8)
+    {
+        m_bytes.resize(m_size*m_stride, 0);
+    }
+    else
+    {
+        m_floats.resize(m_size*m_stride, 0.0f);
+    }
+    write(m_size-1, descr);
+}
+
+void SIFTDescriptorMatrix::set(unsigned int index, const QVector<float>& descr)
+{
+    if((unsigned int)descr.size() > m_dim)
+    {
+        reshape(descr.size());
+    }
+    write(index, descr);
+}
+
+void SIFTDescriptorMatrix::remove(unsigned int index)
+{
+    if(m_storage == SIFTDescriptorUInt8)
+    {
+        m_bytes.erase(m_bytes.begin() + index*m_stride, m_bytes.begin() + (index+1)*m_stride);
+    }
+    else
+    {
+        m_floats.erase(m_floats.begin() + index*m_stride, m_floats.begin() + (index+1)*m_stride);
+    }
+    m_lengths.erase(m_lengths.begin() + index);
+    --m_size;
+}
+
+QVector<float> SIFTDescriptorMatrix::row(unsigned int index) const
+{
+    QVector<float> descr(m_lengths[index]);
+    
+    if(m_storage == SIFTDescriptorUInt8)
+    {
+        const unsigned char* r = byteRow(index);
+        for(int k=0; k<descr.size(); ++k)
+        {
+            descr[k] = r[k]/m_scale;
+        }
+    }
+    else
+    {
+        std::copy(floatRow(index), floatRow(index) + descr.size(), descr.begin());
+    }
+    return descr;
+}
+
+const float* SIFTDescriptorMatrix::floatRow(unsigned int index) const
+{
+    return (m_storage == SIFTDescriptorFloat) ? &m_floats[index*m_stride] : NULL;
+}
+
+const unsigned char* SIFTDescriptorMatrix::byteRow(unsigned int index) const
+{
+    return (m_storage == SIFTDescriptorUInt8) ? &m_bytes[index*m_stride] : NULL;
+}
+
+void SIFTDescriptorMatrix::quantize(float scale)
+{
+    if(m_storage == SIFTDescriptorUInt8)
+        return;
+    
+    if(scale <= 0)
+    {
+        float max_value = 0;
+        for(float v : m_floats)
+        {
+            max_value = std::max(max_value, v);
+        }
+        scale = (max_value > 0) ? 255.0f/max_value : 1.0f;
+    }
+    
+    unsigned int stride = siftDescriptorStride(m_dim, SIFTDescriptorUInt8);
+    std::vector<unsigned char, SIFTDescriptorAllocator<unsigned char> > bytes(m_size*stride, 0);
+    
+    for(unsigned int i=0; i<m_size; ++i)
+    {
+        for(unsigned int k=0; k<m_lengths[i]; ++k)
+        {
+            bytes[i*stride+k] = (unsigned char)std::min(255.0f, std::max(0.0f, std::floor(m_floats[i*m_stride+k]*scale + 0.5f)));
+        }
+    }
+    
+    m_bytes.swap(bytes);
+    m_floats.clear();
+    m_stride = stride;
+    m_scale = scale;
+    m_storage = SIFTDescriptorUInt8;
+}
+
+void SIFTDescriptorMatrix::dequantize()
+{
+    if(m_storage == SIFTDescriptorFloat)
+        return;
+    
+    unsigned int stride = siftDescriptorStride(m_dim, SIFTDescriptorFloat);
+    std::vector<float, SIFTDescriptorAllocator<float> > floats(m_size*stride, 0.0f);
+    
+    for(unsigned int i=0; i<m_size; ++i)
+    {
+        for(unsigned int k=0; k<m_lengths[i]; ++k)
+        {
+            floats[i*stride+k] = m_bytes[i*m_stride+k]/m_scale;
+        }
+    }
+    
+    m_floats.swap(floats);
+    m_bytes.clear();
+    m_stride = stride;
+    m_scale = 1;
+    m_storage = SIFTDescriptorFloat;
+}
+
+void SIFTDescriptorMatrix::reshape(unsigned int dim)
+{
+    unsigned int stride = siftDescriptorStride(dim, m_storage);
+    
+    if(stride != m_stride)
+    {
+        if(m_storage == SIFTDescriptorUInt8)
+        {
+            std::vector<unsigned char, SIFTDescriptorAllocator<unsigned char> > bytes(m_size*stride, 0);
+            for(unsigned int i=0; i<m_size; ++i)
+            {
+                std::copy(&m_bytes[i*m_stride], &m_bytes[i*m_stride] + m_lengths[i], &bytes[i*stride]);
+            }
+            m_bytes.swap(bytes);
+        }
+        else
+        {
+            std::vector<float, SIFTDescriptorAllocator<float> > floats(m_size*stride, 0.0f);
+            for(unsigned int i=0; i<m_size; ++i)
+            {
+                std::copy(&m_floats[i*m_stride], &m_floats[i*m_stride] + m_lengths[i], &floats[i*stride]);
+            }
+            m_floats.swap(floats);
+        }
+        m_stride = stride;
+    }
+    m_dim = dim;
+}
+
+void SIFTDescriptorMatrix::write(unsigned int index, const QVector<float>& descr)
+{
+    m_lengths[index] = descr.size();
+    
+    if(m_storage == SIFTDescriptorUInt8)
+    {
+        unsigned char* r = &m_bytes[index*m_stride];
+        std::fill(r, r+m_stride, 0);
+        
+        for(int k=0; k<descr.size(); ++k)
+        {
+            r[k] = (unsigned char)std::min(255.0f, std::max(0.0f, std::floor(descr[k]*m_scale + 0.5f)));
+        }
+    }
+    else
+    {
+        float* r = &m_floats[index*m_stride];
+        std::fill(r, r+m_stride, 0.0f);
+        std::copy(descr.begin(), descr.end(), r);
+    }
+}
+
+/**
+ * Checks if the CPU supports AVX2.
+ *
+ * \return True, if the AVX2 kernels may be used.
+ */
+static bool siftDescriptorAVX2Available()
+{
+#if defined(GRAIPE_FEATURES2D_X86)
+    #if defined(__GNUC__)
+        return __builtin_cpu_supports("avx2");
+    #elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        //AVX and OS support for saving the YMM registers
+        if((info[2] & (1<<27)) == 0 || (info[2] & (1<<28)) == 0 || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1<<5)) != 0;
+    #else
+        return false;
+    #endif
+#else
+    return false;
+#endif
+}
+
+/** The result of the CPU check, evaluated once **/
+static const bool sift_descriptor_avx2 = siftDescriptorAVX2Available();
+
+float siftDescriptorDistance2Scalar(const float* d1, const float* d2, unsigned int dim, float limit)
+{
+    float distance = 0;
+    unsigned int k=0;
+    
+    for(; k+32<=dim; k+=32)
+    {
+        for(unsigned int l=k; l<k+32; ++l)
+        {
+            float diff = d1[l]-d2[l];
+            distance += diff*diff;
+        }
+        if(distance > limit)
+            return distance;
+    }
+    for(; k<dim; ++k)
+    {
+        float diff = d1[k]-d2[k];
+        distance += diff*diff;
+    }
+    return distance;
+}
+
+unsigned int siftDescriptorDistance2Scalar(const unsigned char* d1, const unsigned char* d2, unsigned int dim, unsigned int limit)
+{
+    unsigned int distance = 0;
+    unsigned int k=0;
+    
+    for(; k+32<=dim; k+=32)
+    {
+        for(unsigned int l=k; l<k+32; ++l)
+        {
+            int diff = int(d1[l])-int(d2[l]);
+            distance += diff*diff;
+        }
+        if(distance > limit)
+            return distance;
+    }
+    for(; k<dim; ++k)
+    {
+        int diff = int(d1[k])-int(d2[k]);
+        distance += diff*diff;
+    }
+    return distance;
+}
+
+#if defined(GRAIPE_FEATURES2D_X86)
+
+/**
+ * The AVX2 kernel of the squared float distance: 32 elements per termination check.
+ */
+GRAIPE_FEATURES2D_TARGET_AVX2
+static float siftDescriptorDistance2AVX2(const float* d1, const float* d2, unsigned int dim, float limit)
+{
+    __m256 acc = _mm256_setzero_ps();
+    float distance = 0;
+    unsigned int k=0;
+    
+    for(; k+32<=dim; k+=32)
+    {
+        __m256 v0 = _mm256_sub_ps(_mm256_loadu_ps(d1+k),    _mm256_loadu_ps(d2+k)),
+               v1 = _mm256_sub_ps(_mm256_loadu_ps(d1+k+8),  _mm256_loadu_ps(d2+k+8)),
+               v2 = _mm256_sub_ps(_mm256_loadu_ps(d1+k+16), _mm256_loadu_ps(d2+k+16)),
+               v3 = _mm256_sub_ps(_mm256_loadu_ps(d1+k+24), _mm256_loadu_ps(d2+k+24));
+        
+        acc = _mm256_add_ps(acc, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v0,v0), _mm256_mul_ps(v1,v1)),
+                                               _mm256_add_ps(_mm256_mul_ps(v2,v2), _mm256_mul_ps(v3,v3))));
+        
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        distance = _mm_cvtss_f32(s);
+        
+        if(distance > limit)
+            return distance;
+    }
+    for(; k+8<=dim; k+=8)
+    {
+        __m256 v = _mm256_sub_ps(_mm256_loadu_ps(d1+k), _mm256_loadu_ps(d2+k));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(v,v));
+    }
+    
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    distance = _mm_cvtss_f32(s);
+    
+    for(; k<dim; ++k)
+    {
+        float diff = d1[k]-d2[k];
+        distance += diff*diff;
+    }
+    return distance;
+}
+
+/**
+ * The AVX2 kernel of the squared byte distance: 32 elements per termination check.
+ */
+GRAIPE_FEATURES2D_TARGET_AVX2
+static unsigned int siftDescriptorDistance2AVX2(const unsigned char* d1, const unsigned char* d2, unsigned int dim, unsigned int limit)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    unsigned int distance = 0;
+    unsigned int k=0;
+    
+    for(; k+32<=dim; k+=32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d1+k)),
+                b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d2+k));
+        
+        //|a-b| for unsigned bytes, widened to 16 bit and squared + pairwise added to 32 bit
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(a,b), _mm256_subs_epu8(b,a)),
+                lo   = _mm256_unpacklo_epi8(diff, zero),
+                hi   = _mm256_unpackhi_epi8(diff, zero);
+        
+        acc = _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_madd_epi16(lo,lo), _mm256_madd_epi16(hi,hi)));
+        
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+        distance = (unsigned int)_mm_cvtsi128_si32(s);
+        
+        if(distance > limit)
+            return distance;
+    }
+    for(; k<dim; ++k)
+    {
+        int diff = int(d1[k])-int(d2[k]);
+        distance += diff*diff;
+    }
+    return distance;
+}
+
+#endif //GRAIPE_FEATURES2D_X86
+
+float siftDescriptorDistance2(const float* d1, const float* d2, unsigned int dim, float limit)
+{
+#if defined(GRAIPE_FEATURES2D_X86)
+    if(sift_descriptor_avx2)
+    {
+        return siftDescriptorDistance2AVX2(d1, d2, dim, limit);
+    }
+#endif
+    return siftDescriptorDistance2Scalar(d1, d2, dim, limit);
+}
+
+unsigned int siftDescriptorDistance2(const unsigned char* d1, const unsigned char* d2, unsigned int dim, unsigned int limit)
+{
+#if defined(GRAIPE_FEATURES2D_X86)
+    if(sift_descriptor_avx2)
+    {
+        return siftDescriptorDistance2AVX2(d1, d2, dim, limit);
+    }
+#endif
+    return siftDescriptorDistance2Scalar(d1, d2, dim, limit);
+}
+
+float siftDescriptorDistance(const float* d1, const float* d2, unsigned int dim, float limit)
+{
+    return std::sqrt(siftDescriptorDistance2(d1, d2, dim, limit*limit));
+}
+
+} //end of namespace graipe
@@ -0,0 +1,342 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_FEATURES2D_SIFTDESCRIPTORS_HXX
+#define GRAIPE_FEATURES2D_SIFTDESCRIPTORS_HXX
+
+#include "features2d/config.hxx"
+
+#include <QVector>
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_features2d
+ * @{
+ *
+ * @file
+ * @brief Header file for the packed storage of SIFT descriptors and their distance kernels
+ */
+
+/**
+ * Minimal allocator, which aligns all allocations to 32 bytes, the width of
+ * an AVX2 register. It over-allocates and keeps the original pointer right
+ * before the aligned block.
+ */
+template <class T>
+class SIFTDescriptorAllocator
+{
+    public:
+        /** The allocated type **/
+        typedef T value_type;
+    
+        /**
+         * Default constructor.
+         */
+        SIFTDescriptorAllocator()
+        {
+        }
+    
+        /**
+         * Conversion from allocators of other types.
+         */
+        template <class U>
+        SIFTDescriptorAllocator(const SIFTDescriptorAllocator<U>&)
+        {
+        }
+    
+        /**
+         * Allocation of n aligned elements.
+         *
+         * \param n The number of elements.
+         * \return Pointer to the 32-byte aligned memory.
+         */
+        T* allocate(std::size_t n)
+        {
+            void* raw = std::malloc(n*sizeof(T) + 32 + sizeof(void*));
+            if(raw == NULL)
+                throw std::bad_alloc();
+            
+            std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + 31) & ~std::uintptr_t(31);
+            reinterpret_cast<void**>(aligned)[-1] = raw;
+            return reinterpret_cast<T*>(aligned);
+        }
+    
+        /**
+         * Deallocation of memory, which has been allocated before.
+         *
+         * \param p Pointer to the aligned memory.
+         */
+        void deallocate(T* p, std::size_t)
+        {
+            if(p != NULL)
+                std::free(reinterpret_cast<void**>(p)[-1]);
+        }
+};
+
+/** All instances of the allocator are interchangeable **/
+template <class T, class U>
+bool operator==(const SIFTDescriptorAllocator<T>&, const SIFTDescriptorAllocator<U>&) { return true; }
+/** All instances of the allocator are interchangeable **/
+template <class T, class U>
+bool operator!=(const SIFTDescriptorAllocator<T>&, const SIFTDescriptorAllocator<U>&) { return false; }
+
+/**
+ * The element types of the packed SIFT descriptor storage.
+ */
+enum SIFTDescriptorStorage
+{
+    /** Single precision, lossless **/
+    SIFTDescriptorFloat = 0,
+    /** One byte per element, linearly quantized by a common scale **/
+    SIFTDescriptorUInt8 = 1
+};
+
+/**
+ * Packed storage of SIFT descriptors: One row per descriptor, all rows with the
+ * same stride and each row 32-byte aligned. The stride is the longest descriptor's
+ * length rounded up to full AVX2 registers, the remaining elements are zero.
+ *
+ * Optionally, the descriptors may be quantized to bytes, which reduces the memory
+ * (and bandwidth) to a quarter. Quantization is lossy: Each value is stored as
+ * round(value*scale), clamped to 0..255, where the scale is common to all rows.
+ */
+class GRAIPE_FEATURES2D_EXPORT SIFTDescriptorMatrix
+{
+    public:
+        /**
+         * Default constructor. Creates an empty float matrix.
+         */
+        SIFTDescriptorMatrix();
+    
+        /**
+         * Returns the number of descriptors (rows).
+         *
+         * \return The number of descriptors.
+         */
+        unsigned int size() const;
+    
+        /**
+         * Returns the length of the longest descriptor.
+         *
+         * \return The length of the longest descriptor.
+         */
+        unsigned int dimension() const;
+    
+        /**
+         * Returns the number of elements between two rows. This is a multiple of
+         * 8 for float and of 32 for byte storage and may be passed to the kernels.
+         *
+         * \return The row stride in elements.
+         */
+        unsigned int stride() const;
+    
+        /**
+         * Returns the length of one descriptor as it has been given.
+         *
+         * \param index The index of the descriptor.
+         * \return The length of that descriptor.
+         */
+        unsigned int length(unsigned int index) const;
+    
+        /**
+         * Checks, if all descriptors have the same length.
+         *
+         * \return True, if all descriptors have the same length.
+         */
+        bool uniform() const;
+    
+        /**
+         * Returns the element type of the storage.
+         *
+         * \return The storage type, see SIFTDescriptorStorage.
+         */
+        int storage() const;
+    
+        /**
+         * Returns the common quantization scale of the byte storage.
+         *
+         * \return The quantization scale (1 for float storage).
+         */
+        float quantizationScale() const;
+    
+        /**
+         * Removes all descriptors.
+         */
+        void clear();
+    
+        /**
+         * Appends a descriptor as a new row.
+         *
+         * \param descr The descriptor.
+         */
+        void append(const QVector<float>& descr);
+    
+        /**
+         * Replaces a descriptor.
+         *
+         * \param index The index of the descriptor.
+         * \param descr The new descriptor.
+         */
+        void set(unsigned int index, const QVector<float>& descr);
+    
+        /**
+         * Removes a descriptor.
+         *
+         * \param index The index of the descriptor.
+         */
+        void remove(unsigned int index);
+    
+        /**
+         * Returns a (dequantized) copy of a descriptor with its original length.
+         *
+         * \param index The index of the descriptor.
+         * \return The descriptor.
+         */
+        QVector<float> row(unsigned int index) const;
+    
+        /**
+         * Direct access to a row of the float storage.
+         *
+         * \param index The index of the descriptor.
+         * \return Pointer to the 32-byte aligned row or NULL for byte storage.
+         */
+        const float* floatRow(unsigned int index) const;
+    
+        /**
+         * Direct access to a row of the byte storage.
+         *
+         * \param index The index of the descriptor.
+         * \return Pointer to the 32-byte aligned row or NULL for float storage.
+         */
+        const unsigned char* byteRow(unsigned int index) const;
+    
+        /**
+         * Converts the storage to bytes.
+         *
+         * \param scale The quantization scale. If zero, the largest value will be mapped to 255.
+         */
+        void quantize(float scale=0);
+    
+        /**
+         * Converts the storage back to floats.
+         */
+        void dequantize();
+    
+    private:
+        /**
+         * Changes the stride for a new longest descriptor length and moves all rows.
+         *
+         * \param dim The new longest descriptor length.
+         */
+        void reshape(unsigned int dim);
+    
+        /**
+         * Writes a descriptor into an existing row.
+         */
+        void write(unsigned int index, const QVector<float>& descr);
+    
+        /** The storage type **/
+        int m_storage;
+        /** The quantization scale **/
+        float m_scale;
+        /** Number of rows, longest length and stride **/
+        unsigned int m_size, m_dim, m_stride;
+        /** The length of each descriptor **/
+        std::vector<unsigned int> m_lengths;
+        /** The float rows **/
+        std::vector<float, SIFTDescriptorAllocator<float> > m_floats;
+        /** The byte rows **/
+        std::vector<unsigned char, SIFTDescriptorAllocator<unsigned char> > m_bytes;
+};
+
+/**
+ * Squared euclidean distance of two float descriptors. The summation may stop early,
+ * as soon as the partial sum exceeds the given limit (checked every 32 elements).
+ * Uses AVX2, if the CPU supports it. Aligned rows of the SIFTDescriptorMatrix are fastest.
+ *
+ * \param d1 The first descriptor.
+ * \param d2 The second descriptor.
+ * \param dim The number of elements to compare.
+ * \param limit The distance, above which the computation may be stopped.
+ * \return The squared distance or a value > limit.
+ */
+GRAIPE_FEATURES2D_EXPORT float siftDescriptorDistance2(const float* d1, const float* d2, unsigned int dim, float limit);
+
+/**
+ * Squared euclidean distance of two byte descriptors, see above.
+ * Uses AVX2 for all full blocks of 32 elements, if the CPU supports it.
+ *
+ * \param d1 The first descriptor.
+ * \param d2 The second descriptor.
+ * \param dim The number of elements to compare.
+ * \param limit The distance, above which the computation may be stopped.
+ * \return The squared distance (in quantized units) or a value > limit.
+ */
+GRAIPE_FEATURES2D_EXPORT unsigned int siftDescriptorDistance2(const unsigned char* d1, const unsigned char* d2, unsigned int dim, unsigned int limit);
+
+/**
+ * Euclidean distance of two float descriptors.
+ *
+ * \param d1 The first descriptor.
+ * \param d2 The second descriptor.
+ * \param dim The number of elements to compare.
+ * \param limit The distance, above which the computation may be stopped.
+ * \return The distance or a value > limit.
+ */
+GRAIPE_FEATURES2D_EXPORT float siftDescriptorDistance(const float* d1, const float* d2, unsigned int dim, float limit);
+
+/**
+ * The scalar reference kernels of the squared distances.
+ * @{
+ */
+GRAIPE_FEATURES2D_EXPORT float siftDescriptorDistance2Scalar(const float* d1, const float* d2, unsigned int dim, float limit);
+GRAIPE_FEATURES2D_EXPORT unsigned int siftDescriptorDistance2Scalar(const unsigned char* d1, const unsigned char* d2, unsigned int dim, unsigned int limit);
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+} //end of namespace graipe
+
+#endif //GRAIPE_FEATURES2D_SIFTDESCRIPTORS_HXX
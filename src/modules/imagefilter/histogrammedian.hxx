@@ -0,0 +1,333 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_IMAGEFILTER_HISTOGRAMMEDIAN_HXX
+#define GRAIPE_IMAGEFILTER_HISTOGRAMMEDIAN_HXX
+
+#include <vigra/multi_array.hxx>
+#include <vigra/bordertreatment.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_imagefilters
+ * @{
+ *
+ * @file
+ * @brief Header file for the constant-time (histogram-based) median filter
+ */
+
+/**
+ * Inline function to map a coordinate outside of [0, size) back into the
+ * valid range according to a border treatment mode.
+ *
+ * \param i    The coordinate.
+ * \param size The size of the dimension.
+ * \param bt   The border treatment mode.
+ * \return The mapped coordinate or -1, if the outside value shall be zero.
+ */
+inline int histogramMedianBorderIndex(int i, int size, vigra::BorderTreatmentMode bt)
+{
+    if(i >= 0 && i < size)
+    {
+        return i;
+    }
+    
+    switch(bt)
+    {
+        case vigra::BORDER_TREATMENT_ZEROPAD:
+            return -1;
+            
+        case vigra::BORDER_TREATMENT_WRAP:
+            return ((i % size) + size) % size;
+            
+        case vigra::BORDER_TREATMENT_REFLECT:
+            i = (i < 0) ? -i : 2*size - 2 - i;
+            return std::max(0, std::min(size-1, i));
+            
+        default:
+            return std::max(0, std::min(size-1, i));
+    }
+}
+
+/**
+ * The maximal number of bins of the histogram median filter. The costs per pixel
+ * grow linearly with the number of bins, so more bins do not pay off.
+ */
+const unsigned int histogram_median_max_bins = 4096;
+
+/**
+ * The memory budget (in bytes) for the column histograms of the histogram median
+ * filter. Wider images are processed in column strips, which fit into this budget.
+ */
+const std::size_t histogram_median_memory_budget = std::size_t(32) << 20;
+
+/**
+ * Median filter, which uses the constant-time algorithm of Perreault and Hébert:
+ * For each column, a histogram of the window_size rows around the current row
+ * is kept and updated by one row at each step down. The histogram of the window
+ * is then moved along a row by adding the histogram of the entering column and 
+ * subtracting the histogram of the leaving one. Thus, the costs per pixel only
+ * depend on the number of bins, but not on the window size.
+ *
+ * Since each column needs its own histogram, the image is processed in column
+ * strips, such that the column histograms of a strip fit into the memory budget.
+ * Neighbouring strips overlap by window_size-1 (padded) columns.
+ *
+ * The source has to be given as bin indices in [0, bins). The resulting bins
+ * are passed to the writer functor, which is called for each pixel as
+ * writer(x, y, bin). If the border treatment is BORDER_TREATMENT_AVOID, the 
+ * writer is only called for pixels, where the window fits into the image.
+ *
+ * \param src           The source bin indices.
+ * \param bins          The number of bins.
+ * \param window_size   The (quadratic) size of the median window.
+ * \param bt            The border treatment mode.
+ * \param zero_bin      The bin of zero, which is used for BORDER_TREATMENT_ZEROPAD.
+ * \param writer        The functor, which receives the median bins.
+ * \param memory_budget The memory budget for the column histograms in bytes.
+ */
+template <class S, class WRITER>
+void histogramMedian(const vigra::MultiArrayView<2, unsigned short, S> & src,
+                     unsigned int bins, int window_size, vigra::BorderTreatmentMode bt,
+                     unsigned short zero_bin, WRITER writer,
+                     std::size_t memory_budget = histogram_median_memory_budget)
+{
+    const int width  = src.width();
+    const int height = src.height();
+    const int radius = window_size/2;
+    
+    //Padded width of the image
+    const int padded_width = width + window_size - 1;
+    
+    //The median is the element at this (zero-based) rank of the window
+    const unsigned int rank = (window_size*window_size)/2;
+    
+    //Width of the column strips: As many columns as fit into the budget, but at
+    //least window_size, so that the overlap does not dominate the costs
+    const std::size_t budget_columns = memory_budget/(std::size_t(bins)*sizeof(unsigned int));
+    int strip_width = width;
+    
+    if(budget_columns < std::size_t(padded_width))
+    {
+        strip_width = std::min(width, std::max(window_size, int(budget_columns) - (window_size - 1)));
+    }
+    
+    //Column indices of the padded image
+    std::vector<int> columns(padded_width);
+    for(int px=0; px<padded_width; ++px)
+    {
+        columns[px] = histogramMedianBorderIndex(px - radius, width, bt);
+    }
+    
+    std::vector<unsigned int> column_histograms((strip_width + window_size - 1)*std::size_t(bins));
+    std::vector<unsigned int> kernel_histogram(bins);
+    
+    for(int x0=0; x0<width; x0+=strip_width)
+    {
+        const int x1 = std::min(width, x0 + strip_width);
+        
+        //Padded columns of this strip: [x0, x1+window_size-1)
+        const int strip_padded_width = x1 - x0 + window_size - 1;
+        
+        //Returns the bin at a padded position relative to this strip
+        auto binAt = [&](int px, int y) -> unsigned short
+        {
+            int x = columns[x0 + px];
+            y = histogramMedianBorderIndex(y, height, bt);
+            return (x == -1 || y == -1) ? zero_bin : src(x,y);
+        };
+        
+        std::fill(column_histograms.begin(), column_histograms.end(), 0);
+        
+        //Initialize the column histograms with the first window_size-1 rows
+        for(int y=-radius; y<window_size-1-radius; ++y)
+        {
+            for(int px=0; px<strip_padded_width; ++px)
+            {
+                column_histograms[px*bins + binAt(px,y)]++;
+            }
+        }
+        
+        for(int y=0; y<height; ++y)
+        {
+            //Add the lowest row of the window
+            for(int px=0; px<strip_padded_width; ++px)
+            {
+                column_histograms[px*bins + binAt(px, y+window_size-1-radius)]++;
+            }
+            
+            bool avoid_row = (bt == vigra::BORDER_TREATMENT_AVOID) && (y < radius || y+window_size-1-radius >= height);
+            
+            if(!avoid_row)
+            {
+                //Initialize the kernel histogram with the first window_size columns
+                std::fill(kernel_histogram.begin(), kernel_histogram.end(), 0);
+                
+                for(int px=0; px<window_size; ++px)
+                {
+                    const unsigned int* column_histogram = &column_histograms[px*bins];
+                    
+                    for(unsigned int b=0; b<bins; ++b)
+                    {
+                        kernel_histogram[b] += column_histogram[b];
+                    }
+                }
+                
+                for(int x=x0; x<x1; ++x)
+                {
+                    if(x != x0)
+                    {
+                        const unsigned int* entering = &column_histograms[(x-x0+window_size-1)*bins];
+                        const unsigned int* leaving  = &column_histograms[(x-x0-1)*bins];
+                        
+                        for(unsigned int b=0; b<bins; ++b)
+                        {
+                            kernel_histogram[b] += entering[b] - leaving[b];
+                        }
+                    }
+                    
+                    if(bt == vigra::BORDER_TREATMENT_AVOID && (x < radius || x+window_size-1-radius >= width))
+                    {
+                        continue;
+                    }
+                    
+                    unsigned int sum = 0, b = 0;
+                    
+                    for(; b<bins-1; ++b)
+                    {
+                        sum += kernel_histogram[b];
+                        if(sum > rank)
+                        {
+                            break;
+                        }
+                    }
+                    writer(x, y, b);
+                }
+            }
+            
+            //Remove the highest row of the window
+            for(int px=0; px<strip_padded_width; ++px)
+            {
+                column_histograms[px*bins + binAt(px, y-radius)]--;
+            }
+        }
+    }
+}
+
+/**
+ * Constant-time median filter for 8-bit images. All 256 values get their own
+ * bin, thus the result is exact.
+ *
+ * \param src         The source image band.
+ * \param dest        The destination image band (of the same size).
+ * \param window_size The (quadratic) size of the median window.
+ * \param bt          The border treatment mode.
+ */
+template <class S1, class S2>
+void histogramMedianFilter(const vigra::MultiArrayView<2, unsigned char, S1> & src,
+                           vigra::MultiArrayView<2, unsigned char, S2> dest,
+                           int window_size, vigra::BorderTreatmentMode bt)
+{
+    vigra::MultiArray<2, unsigned short> src_bins(src);
+    
+    histogramMedian(src_bins, 256, window_size, bt, 0,
+                    [&](int x, int y, unsigned int bin)
+                    {
+                        dest(x,y) = (unsigned char)bin;
+                    });
+}
+
+/**
+ * Constant-time median filter for float images. The values are quantized
+ * into a given number of bins, which cover the range [min_value, max_value].
+ * Each resulting pixel is set to the center value of its median bin, thus 
+ * the error is at most half a bin width. The range has to be the same for 
+ * all parts of an image, which are filtered independently, in order to get
+ * consistent results.
+ *
+ * \param src         The source image band.
+ * \param dest        The destination image band (of the same size).
+ * \param window_size The (quadratic) size of the median window.
+ * \param bt          The border treatment mode.
+ * \param min_value   The minimum of the quantization range.
+ * \param max_value   The maximum of the quantization range.
+ * \param bins        The number of bins, at most histogram_median_max_bins. Defaults to 256.
+ */
+template <class S1, class S2>
+void histogramMedianFilter(const vigra::MultiArrayView<2, float, S1> & src,
+                           vigra::MultiArrayView<2, float, S2> dest,
+                           int window_size, vigra::BorderTreatmentMode bt,
+                           float min_value, float max_value, unsigned int bins=256)
+{
+    bins = std::max(2u, std::min(bins, histogram_median_max_bins));
+    
+    const float bin_width = (max_value > min_value) ? (max_value - min_value)/(bins-1) : 1.0f;
+    
+    auto quantize = [&](float value) -> unsigned short
+    {
+        float bin = std::floor((value - min_value)/bin_width + 0.5f);
+        return (unsigned short)std::max(0.0f, std::min(float(bins-1), bin));
+    };
+    
+    vigra::MultiArray<2, unsigned short> src_bins(src.shape());
+    
+    for(int y=0; y<src.height(); ++y)
+    {
+        for(int x=0; x<src.width(); ++x)
+        {
+            src_bins(x,y) = quantize(src(x,y));
+        }
+    }
+    
+    histogramMedian(src_bins, bins, window_size, bt, quantize(0.0f),
+                    [&](int x, int y, unsigned int bin)
+                    {
+                        dest(x,y) = min_value + bin*bin_width;
+                    });
+}
+
+/**
+ * @}
+ */
+ 
+} //end of namespace graipe
+
+#endif //GRAIPE_IMAGEFILTER_HISTOGRAMMEDIAN_HXX
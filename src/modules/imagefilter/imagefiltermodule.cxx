@@ -40,6 +40,13 @@
 #include <vigra/shockfilter.hxx>
 #include <vigra/medianfilter.hxx>
 
+#include "imagefilter/histogrammedian.hxx"
+
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+
 namespace graipe {
 
 /**
@@ -101,8 +108,83 @@ class ImageFilter
         }
     
     protected:
-       /** Class member for the reatment modes **/
-       QStringList m_border_treatment_modes;
+        /** The view type, which is used for the (strided) row strips of a band **/
+        typedef vigra::MultiArrayView<2, float, vigra::StridedArrayTag> StripView;
+    
+        /**
+         * Runs a window-based filter in parallel over all bands of an image.
+         * Each band is decomposed into row strips, which are filtered
+         * independently. To get the same result as filtering the whole band,
+         * each strip is extended by a halo of window_height/2 rows, which are
+         * read, but not written back. At the borders of the band, the strip is
+         * not extended, thus the border treatment of the filter is applied there
+         * just as in the serial case. The only exception is BORDER_TREATMENT_WRAP,
+         * where the rows at the top border depend on the bottom rows and vice
+         * versa. In this case, the bands are filtered as a whole.
+         * Each strip is filtered into a buffer of the strip's size, whose
+         * inner rows are written to the band of the destination image.
+         *
+         * \param src           The source image.
+         * \param dest          The destination image, of same size and band count.
+         * \param window_height The height of the filter's window.
+         * \param bt            The border treatment mode of the filter.
+         * \param filter        The filter function. It gets a source view and a
+         *                      destination view of the same shape and must be safe
+         *                      to be called concurrently.
+         */
+        void parallelWindowFilter(const Image<float>* src, Image<float>* dest,
+                                  int window_height, vigra::BorderTreatmentMode bt,
+                                  const std::function<void(const StripView&, StripView)>& filter)
+        {
+            const int width  = src->width();
+            const int height = src->height();
+            
+            //A centered window reaches at most window_height/2 rows above and below:
+            const int halo = window_height/2;
+            
+            //Use strips, which are large compared to the halo, and give a few strips
+            //per thread to balance the load:
+            int strip_height = std::max(64, 8*halo);
+            strip_height = std::max(strip_height, height/(4*QThread::idealThreadCount()) + 1);
+            
+            int strip_count = (height + strip_height - 1)/strip_height;
+            
+            if(bt == vigra::BORDER_TREATMENT_WRAP || strip_count < 2)
+            {
+                strip_count  = 1;
+                strip_height = height;
+            }
+            
+            parallelBands(src->numBands()*strip_count, [&](unsigned int unit)
+            {
+                unsigned int band = unit / strip_count;
+                int strip = unit % strip_count;
+                
+                if(strip_count == 1)
+                {
+                    filter(src->band(band), dest->band(band));
+                    return;
+                }
+                
+                //The rows of this strip and of the strip including the halo
+                int y0 = strip*strip_height;
+                int y1 = std::min(height, y0 + strip_height);
+                int halo_y0 = std::max(0, y0 - halo);
+                int halo_y1 = std::min(height, y1 + halo);
+                
+                vigra::MultiArray<2,float> strip_result(vigra::Shape2(width, halo_y1 - halo_y0));
+                
+                filter(src->band(band).subarray(vigra::Shape2(0, halo_y0), vigra::Shape2(width, halo_y1)),
+                       strip_result);
+                
+                vigra::MultiArrayView<2,float> dest_band = dest->band(band);
+                dest_band.subarray(vigra::Shape2(0, y0), vigra::Shape2(width, y1))
+                    = strip_result.subarray(vigra::Shape2(0, y0 - halo_y0), vigra::Shape2(width, y1 - halo_y0));
+            });
+        }
+    
+        /** Class member for the reatment modes **/
+        QStringList m_border_treatment_modes;
 };
 
 
@@ -173,18 +255,16 @@ class FrostFilter
                     
                     new_image->setName(QString("Frost Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        frostFilter(current_image->band(m_phase),
-                                    new_image->band(m_phase),
-                                    vigra::Diff2D(param_windowSize->value(),param_windowSize->value()),
-                                    param_damping_k->value(),
-                                    vigra::BorderTreatmentMode(param_btmode->value()));
-                                    
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            frostFilter(src, dest,
+                                        vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                        param_damping_k->value(),
+                                        vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -290,18 +370,16 @@ class EnhancedFrostFilter
                                 
                     new_image->setName(QString("Enh. Frost Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        enhancedFrostFilter(current_image->band(m_phase),
-                                            new_image->band(m_phase),
-                                            vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                            param_damping_k->value(), param_enl->value(),
-                                            vigra::BorderTreatmentMode(param_btmode->value()));
-                        
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            enhancedFrostFilter(src, dest,
+                                                vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                                param_damping_k->value(), param_enl->value(),
+                                                vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -407,18 +485,16 @@ class GammaMAPFilter
                     
                     new_image->setName(QString("Gamma Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        gammaMAPFilter(current_image->band(m_phase),
-                                       new_image->band(m_phase),
-                                       vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                       param_enl->value(),
-                                       vigra::BorderTreatmentMode(param_btmode->value()));
-                                       
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            gammaMAPFilter(src, dest,
+                                           vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                           param_enl->value(),
+                                           vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -522,18 +598,16 @@ class KuanFilter
                     
                     new_image->setName(QString("Kuan Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        kuanFilter(current_image->band(m_phase),
-                                   new_image->band(m_phase),
-                                   vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                   param_enl->value(),
-                                   vigra::BorderTreatmentMode(param_btmode->value()));
-                        
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            kuanFilter(src, dest,
+                                       vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                       param_enl->value(),
+                                       vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -637,18 +711,16 @@ class LeeFilter
                     
                     new_image->setName(QString("Lee Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        leeFilter(current_image->band(m_phase),
-                                  new_image->band(m_phase),
-                                  vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                  param_enl->value(),
-                                  vigra::BorderTreatmentMode(param_btmode->value()));
-                        
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            leeFilter(src, dest,
+                                      vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                      param_enl->value(),
+                                      vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -757,18 +829,16 @@ class EnhancedLeeFilter
                     
                     new_image->setName(QString("Enh. Lee Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        enhancedLeeFilter(current_image->band(m_phase),
-                                          new_image->band(m_phase),
-                                          vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                          param_damping_k->value(), param_enl->value(),
-                                          vigra::BorderTreatmentMode(param_btmode->value()));
-                        
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    //Filter all bands in parallel, each one in row strips
+                    parallelWindowFilter(current_image, new_image,
+                                         param_windowSize->value(), vigra::BorderTreatmentMode(param_btmode->value()),
+                                         [&](const StripView& src, StripView dest)
+                        {
+                            enhancedLeeFilter(src, dest,
+                                              vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
+                                              param_damping_k->value(), param_enl->value(),
+                                              vigra::BorderTreatmentMode(param_btmode->value()));
+                        });
                     
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -821,9 +891,15 @@ class MedianFilter
         MedianFilter(Workspace * wsp)
         : ImageFilter(wsp)
         {
-            m_parameters->addParameter("image", new ModelParameter("Image",	"Image", NULL, false, wsp));
+            QStringList methods;
+            methods.append("Sorting \tof each window");
+            methods.append("Histogram \tin constant time per pixel");
+            
+            m_parameters->addParameter("image", new ModelParameter("Image",	"Image|ByteImage", NULL, false, wsp));
             m_parameters->addParameter("size", new IntParameter("Filter window size", 1, 9999, 11));
             m_parameters->addParameter("bt", new EnumParameter("Border treatment", m_border_treatment_modes, 2));
+            m_parameters->addParameter("method", new EnumParameter("Median computation", methods, 0));
+            m_parameters->addParameter("bins", new IntParameter("Histogram bins (float images)", 2, histogram_median_max_bins, 256));
             m_results.push_back(new Image<float>(wsp));
         }
     
@@ -857,29 +933,93 @@ class MedianFilter
                     ModelParameter	* param_image      = static_cast<ModelParameter*> ((*m_parameters)["image"]);
                     IntParameter	* param_windowSize = static_cast<IntParameter*>((*m_parameters)["size"]);
                     EnumParameter	* param_btmode     = static_cast<EnumParameter*> ((*m_parameters)["bt"]);
+                    EnumParameter	* param_method     = static_cast<EnumParameter*> ((*m_parameters)["method"]);
+                    IntParameter	* param_bins       = static_cast<IntParameter*>((*m_parameters)["bins"]);
                     
-                    Image<float>* current_image = static_cast<Image<float>*>(  param_image->value() );	
+                    int window_size = param_windowSize->value();
+                    vigra::BorderTreatmentMode bt = vigra::BorderTreatmentMode(param_btmode->value());
+                    bool use_histogram = (param_method->value() == 1);
                     
                     emit statusMessage(1.0, QString("starting computation"));
                     
-                    //create new image and do the transform
-                    Image<float>* new_image = new Image<float>(current_image->size(), current_image->numBands(), m_workspace);
-                    
-                    //copy metadata from current image (will be overwritten later)
-                    current_image->copyMetadata(*new_image);
-                    
-                    new_image->setName(QString("Median Filtered ") + current_image->name());
+                    Model* new_image = NULL;
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        medianFilter(current_image->band(m_phase),
-                                     new_image->band(m_phase),
-                                     vigra::Diff2D(param_windowSize->value(), param_windowSize->value()),
-                                     vigra::BorderTreatmentMode(param_btmode->value()));
-                                             
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
+                    if(param_image->value()->typeName() == "ByteImage")
+                    {
+                        Image<unsigned char>* current_image = static_cast<Image<unsigned char>*>(param_image->value());
+                        
+                        //create new image and do the transform
+                        Image<unsigned char>* new_byte_image = new Image<unsigned char>(current_image->size(), current_image->numBands(), m_workspace);
+                        new_image = new_byte_image;
+                        
+                        //copy metadata from current image (will be overwritten later)
+                        current_image->copyMetadata(*new_byte_image);
+                        
+                        new_image->setName(QString("Median Filtered ") + current_image->name());
+                        
+                        //Filter all bands in parallel
+                        parallelBands(current_image->numBands(), [&](unsigned int band)
+                        {
+                            if(use_histogram)
+                            {
+                                histogramMedianFilter(current_image->band(band), new_byte_image->band(band), window_size, bt);
+                            }
+                            else
+                            {
+                                medianFilter(current_image->band(band), new_byte_image->band(band),
+                                             vigra::Diff2D(window_size, window_size), bt);
+                            }
+                        });
+                    }
+                    else
+                    {
+                        Image<float>* current_image = static_cast<Image<float>*>(param_image->value());
+                        
+                        //create new image and do the transform
+                        Image<float>* new_float_image = new Image<float>(current_image->size(), current_image->numBands(), m_workspace);
+                        new_image = new_float_image;
+                        
+                        //copy metadata from current image (will be overwritten later)
+                        current_image->copyMetadata(*new_float_image);
+                        
+                        new_image->setName(QString("Median Filtered ") + current_image->name());
+                        
+                        //The quantization range has to be the same for all strips:
+                        float min_value = 0, max_value = 0;
+                        
+                        if(use_histogram)
+                        {
+                            for(unsigned int band=0; band!=current_image->numBands(); ++band)
+                            {
+                                float band_min, band_max;
+                                current_image->band(band).minmax(&band_min, &band_max);
+                                
+                                min_value = (band==0) ? band_min : std::min(min_value, band_min);
+                                max_value = (band==0) ? band_max : std::max(max_value, band_max);
+                            }
+                            
+                            //Zero padding needs zero to be inside the range
+                            if(bt == vigra::BORDER_TREATMENT_ZEROPAD)
+                            {
+                                min_value = std::min(min_value, 0.0f);
+                                max_value = std::max(max_value, 0.0f);
+                            }
+                        }
+                        
+                        //Filter all bands in parallel, each one in row strips
+                        parallelWindowFilter(current_image, new_float_image, window_size, bt,
+                                             [&](const StripView& src, StripView dest)
+                            {
+                                if(use_histogram)
+                                {
+                                    histogramMedianFilter(src, dest, window_size, bt,
+                                                          min_value, max_value, param_bins->value());
+                                }
+                                else
+                                {
+                                    medianFilter(src, dest, vigra::Diff2D(window_size, window_size), bt);
+                                }
+                            });
                     }
                     
                     QString descr("The following parameters were used for filtering:\n");
@@ -986,17 +1126,14 @@ class ShockFilter
                     
                     new_image->setName(QString("Shock Filtered ") + current_image->name());
                     
-                    m_phase_count = current_image->numBands();
-                    
-                    for( m_phase=0; m_phase < m_phase_count; m_phase++)
-                    {	
-                        shockFilter(current_image->band(m_phase),
-                                    new_image->band(m_phase),
+                    //Filter all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int band)
+                    {
+                        shockFilter(current_image->band(band),
+                                    new_image->band(band),
                                     param_iSigma->value(), param_oSigma->value(),
                                     param_upwind->value(), param_iterations->value());
-                        
-                        emit statusMessage(m_phase*99.0/m_phase_count, QString("filtering"));
-                    }
+                    });
 
                     QString descr("The following parameters were used for filtering:\n");
                     descr += m_parameters->valueText("ModelParameter");
@@ -0,0 +1,188 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "imagefilter/histogrammedian.hxx"
+
+#include <vigra/multi_array.hxx>
+#include <vigra/medianfilter.hxx>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/**
+ * @addtogroup graipe_imagefilters
+ * @{
+ *
+ * @file
+ * @brief Benchmark of the histogram median filter against VIGRA's median filter
+ *
+ * Usage: histogrammedian_benchmark [width height max_window_size]
+ *
+ * For each odd window size up to max_window_size, the runtime of VIGRA's
+ * sorting median filter and of the constant-time histogram median filter is
+ * measured on a random 8-bit and a random float image. The 8-bit results are
+ * compared to each other, and the histogram median is additionally run with
+ * a tiny memory budget, which forces many column strips. The program returns 
+ * a non-zero exit code if any of the results differ.
+ */
+
+using namespace graipe;
+
+/**
+ * Returns the runtime of a function in milliseconds.
+ *
+ * \param fn The function to be timed.
+ * \return The runtime of fn in ms.
+ */
+template <class FN>
+double timeMS(FN fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Compares two 8-bit images inside the area, where the window fits into the image.
+ *
+ * \param a           The first image.
+ * \param b           The second image.
+ * \param window_size The size of the median window.
+ * \return The number of differing pixels.
+ */
+int countDifferences(const vigra::MultiArray<2, unsigned char> & a,
+                     const vigra::MultiArray<2, unsigned char> & b,
+                     int window_size)
+{
+    int radius = window_size/2, differences = 0;
+    
+    for(int y=radius; y<a.height()-radius; ++y)
+    {
+        for(int x=radius; x<a.width()-radius; ++x)
+        {
+            if(a(x,y) != b(x,y))
+            {
+                ++differences;
+            }
+        }
+    }
+    return differences;
+}
+
+int main(int argc, char** argv)
+{
+    int width  = (argc > 1) ? std::atoi(argv[1]) : 1024;
+    int height = (argc > 2) ? std::atoi(argv[2]) : 1024;
+    int max_window_size = (argc > 3) ? std::atoi(argv[3]) : 31;
+    
+    const vigra::BorderTreatmentMode bt = vigra::BORDER_TREATMENT_REFLECT;
+    
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte_distribution(0, 255);
+    std::uniform_real_distribution<float> float_distribution(0.0f, 1000.0f);
+    
+    vigra::MultiArray<2, unsigned char> byte_image(vigra::Shape2(width, height));
+    vigra::MultiArray<2, float> float_image(vigra::Shape2(width, height));
+    
+    for(auto iter = byte_image.begin(); iter != byte_image.end(); ++iter)
+    {
+        *iter = byte_distribution(rng);
+    }
+    for(auto iter = float_image.begin(); iter != float_image.end(); ++iter)
+    {
+        *iter = float_distribution(rng);
+    }
+    
+    vigra::MultiArray<2, unsigned char> byte_vigra(byte_image.shape()), byte_histogram(byte_image.shape());
+    vigra::MultiArray<2, float> float_vigra(float_image.shape()), float_histogram(float_image.shape());
+    
+    int failures = 0;
+    
+    std::printf("Median filter on %dx%d images, times in ms\n", width, height);
+    std::printf("%6s %12s %12s %12s %12s\n", "window", "byte vigra", "byte hist.", "float vigra", "float hist.");
+    
+    for(int window_size=3; window_size<=max_window_size; window_size+=2)
+    {
+        double byte_vigra_ms = timeMS([&]{
+            vigra::medianFilter(byte_image, byte_vigra, vigra::Diff2D(window_size, window_size), bt);
+        });
+        double byte_histogram_ms = timeMS([&]{
+            histogramMedianFilter(byte_image, byte_histogram, window_size, bt);
+        });
+        double float_vigra_ms = timeMS([&]{
+            vigra::medianFilter(float_image, float_vigra, vigra::Diff2D(window_size, window_size), bt);
+        });
+        double float_histogram_ms = timeMS([&]{
+            histogramMedianFilter(float_image, float_histogram, window_size, bt, 0.0f, 1000.0f, 256);
+        });
+        
+        std::printf("%6d %12.1f %12.1f %12.1f %12.1f\n", window_size,
+                    byte_vigra_ms, byte_histogram_ms, float_vigra_ms, float_histogram_ms);
+        
+        int differences = countDifferences(byte_vigra, byte_histogram, window_size);
+        if(differences != 0)
+        {
+            std::printf("  ERROR: %d pixels differ from VIGRA's median\n", differences);
+            ++failures;
+        }
+        
+        //Force column strips of (at least) window_size columns
+        vigra::MultiArray<2, unsigned short> byte_bins(byte_image);
+        vigra::MultiArray<2, unsigned char> byte_strips(byte_image.shape());
+        
+        histogramMedian(byte_bins, 256, window_size, bt, 0,
+                        [&](int x, int y, unsigned int bin)
+                        {
+                            byte_strips(x,y) = (unsigned char)bin;
+                        },
+                        1);
+        
+        if(byte_strips != byte_histogram)
+        {
+            std::printf("  ERROR: column strips change the result\n");
+            ++failures;
+        }
+    }
+    
+    return (failures == 0) ? 0 : 1;
+}
+
+/**
+ * @}
+ */
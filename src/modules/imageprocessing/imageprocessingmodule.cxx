@@ -128,24 +128,26 @@ class AddImages
                         image->copyMetadata(*new_image);
                         new_image->setName(QString("addition of ") + param_images->toString());
                         
-                        //iterate
                         for(unsigned int i = 0; i < selected_images.size(); ++i)
                         {
-                            
                             image = static_cast<Image<float>*>( selected_images[i] );
                             
                             vigra_precondition(image->size() == new_image->size() && image->numBands() == new_image->numBands(), "images are of different size");
-                            
-                            for( unsigned int c=0; c < image->numBands(); c++)
+                        }
+                        
+                        //Process all bands in parallel and iterate over the images for each band
+                        parallelBands(new_image->numBands(), [&](unsigned int c)
+                        {
+                            for(unsigned int i = 0; i < selected_images.size(); ++i)
                             {
                                 using namespace vigra::functor;
-                        
-                                vigra::combineTwoImages(image->band(c),
+                                
+                                vigra::combineTwoImages(static_cast<Image<float>*>( selected_images[i] )->band(c),
                                                         new_image->band(c),
                                                         new_image->band(c),
                                                         Arg1()+Arg2());
                             }
-                        }
+                        });
                         
                         m_results.push_back(new_image);
                         
@@ -351,11 +353,12 @@ class RecursiveSmoothingFilter : public Algorithm
                     
                     float scale = param_scale->value();
                     
-                    for( unsigned int c=0; c < current_image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int c)
                     {
                         vigra::recursiveSmoothX(current_image->band(c), new_image->band(c), scale);// vigra::BorderTreatmentMode(param_btmode->value()));
                         vigra::recursiveSmoothY(new_image->band(c), new_image->band(c), scale);//, vigra::BorderTreatmentMode(param_btmode->value())));
-                    }
+                    });
                     QString descr("The following parameters were used for recursive smoothing:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
@@ -459,11 +462,12 @@ class GaussianSmoothingFilter : public Algorithm
                     vigra::Kernel1D<double> gauss;
                     gauss.initGaussian(scale);
                     
-                    for( unsigned int c=0; c < current_image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int c)
                     {
                         vigra::separableConvolveX(current_image->band(c), new_image->band(c), gauss);//, vigra::BorderTreatmentMode(param_btmode->value())) );
                         vigra::separableConvolveY(new_image->band(c), new_image->band(c), gauss);//, vigra::BorderTreatmentMode(param_btmode->value())));
-                    }
+                    });
                     QString descr("The following parameters were used for gaussian smoothing:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
@@ -579,12 +583,13 @@ class NormalizedGaussianSmoothingFilter : public Algorithm
                     vigra::Kernel2D<double> gauss2d;
                     gauss2d.initSeparable(gauss,gauss);
                     
-                    for( unsigned int c=0; c < current_image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int c)
                     {
                         vigra::normalizedConvolveImage(current_image->band(c),
                                                        mask,
                                                        new_image->band(c), gauss2d);
-                    }
+                    });
                     QString descr("The following parameters were used for normalized gaussian smoothing:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
@@ -690,7 +695,8 @@ class ApplyMaskToImage
                     
                     new_image->setName(QString("masked ") + image->name());
                     
-                    for( unsigned int c=0; c < image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(image->numBands(), [&](unsigned int c)
                     {
                         using namespace vigra::functor;
                         
@@ -698,7 +704,7 @@ class ApplyMaskToImage
                                                 mask,
                                                 new_image->band(c),
                                                 Arg1()*Arg2());
-                    }
+                    });
                     QString descr("The following parameters were used for masking:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
@@ -1479,7 +1485,8 @@ class ImageResizer : public Algorithm
                     
                     new_image->setName(QString("resized ") + current_image->name());
                     
-                    for( unsigned int c=0; c < current_image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int c)
                     {
                         switch (param_spline_degree->value())
                         {
@@ -1513,7 +1520,7 @@ class ImageResizer : public Algorithm
                                                                   new_image->band(c));
                                 break;
                         }
-                    }
+                    });
                     QString descr("The following parameters were used for resizing:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
@@ -1616,7 +1623,8 @@ class ImageInverter
                     
                     new_image->setName(QString("inverted ") + current_image->name());
                     
-                    for( unsigned int c=0; c < current_image->numBands(); c++)
+                    //Process all bands in parallel
+                    parallelBands(current_image->numBands(), [&](unsigned int c)
                     {
                         float offset = param_offset->value();
                         
@@ -1635,7 +1643,7 @@ class ImageInverter
                                               new_image->band(c),
                                               Param(offset)-Arg1());
                         
-                    }
+                    });
                     QString descr("The following parameters were used for inverting:\n");
                     descr += m_parameters->valueText("ModelParameter");
                     new_image->setDescription(descr);
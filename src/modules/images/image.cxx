@@ -53,7 +53,8 @@ Image<T>::Image(Workspace* wsp)
     m_timestamp(new DateTimeParameter("Timestamp:", QDateTime::currentDateTime())),
     m_scale(new DoubleParameter("Scale (1 px = X m):", 0, 1000000000, 1)),
     m_comment(new LongStringParameter("Comment:", "")),
-    m_units(new StringParameter("Units:", "m"))
+    m_units(new StringParameter("Units:", "m")),
+    m_revision(0)
 {
     m_name->setValue(QString("New ") + typeName());
     m_description->setValue(QString("This new ") + typeName() + " has been created on " + QDateTime::currentDateTime().toString());
@@ -68,7 +69,8 @@ Image<T>::Image(const Image<T> & img)
     m_timestamp(new DateTimeParameter("Timestamp:", img.timestamp())),
     m_scale(new DoubleParameter("Scale (1 px = X m):", 0, 1000000000, img.scale())),
     m_comment(new LongStringParameter("Comment:", img.comment())),
-    m_units(new StringParameter("Units:", "m"))
+    m_units(new StringParameter("Units:", "m")),
+    m_revision(0)
 {
     appendParameters();
 
@@ -93,7 +95,8 @@ Image<T>::Image(Size_Type size,
     m_timestamp(new DateTimeParameter("Timestamp:", QDateTime::currentDateTime())),
     m_scale(new DoubleParameter("Scale (1 px = X m):", 0, 1000000000, 1)),
     m_comment(new LongStringParameter("Comment:", "")),
-    m_units(new StringParameter("Units:", "m"))
+    m_units(new StringParameter("Units:", "m")),
+    m_revision(0)
 {
     appendParameters();
     setWidth((unsigned int)size[0]);
@@ -142,6 +145,10 @@ typename Image<T>::Size_Type Image<T>::size() const
 template<class T>
 const vigra::MultiArrayView<2,T> & Image<T>::band(unsigned int band_id) const
 {
+    if(isMapped(band_id))
+    {
+        return m_mappedbands[band_id];
+    }
     return m_imagebands[band_id];
 }
 
@@ -151,7 +158,19 @@ void Image<T>::setBand(unsigned int band_id, const vigra::MultiArrayView<2,T>& b
     if(locked())
         return;
     
+    if(isMapped(band_id))
+    {
+        if(m_mappedbands[band_id].shape() == band.shape())
+        {
+            //Copy into the (private) mapped memory
+            m_mappedbands[band_id] = band;
+            updateModel();
+            return;
+        }
+        unmapBands();
+    }
     m_imagebands[band_id] = band;
+    updateModel();
 }
 
 template <class T>
@@ -285,7 +304,7 @@ void Image<T>::serialize_content(QXmlStreamWriter& xmlWriter) const
 
         for(unsigned int c=0; c<m_imagebands.size(); ++c)
         {
-            QByteArray block((const char*)m_imagebands[c].data(),channel_size);
+            QByteArray block((const char*)band(c).data(),channel_size);
             
             xmlWriter.writeStartElement("Channel");
             xmlWriter.writeAttribute("ID", QString::number(c));
@@ -311,9 +330,19 @@ bool Image<T>::deserialize_content(QXmlStreamReader& xmlReader)
     
     qint64 channel_size = this->width()*this->height()*sizeof(T);
     
+    m_mappedbands.clear();
     m_imagebands.clear();
     m_imagebands.resize(numBands());
-        
+    
+    //For raw containers, the content is empty and the bands will be read or
+    //mapped afterwards using rawBlockData() or mapRawBlock().
+    if(xmlReader.attributes().value("Encoding") == "Raw")
+    {
+        //Skip until </Content>
+        xmlReader.skipCurrentElement();
+        return true;
+    }
+    
     //Prepare all bands:
     for(unsigned int c=0; c<m_imagebands.size(); ++c)
     {
@@ -396,9 +425,96 @@ bool Image<T>::deserialize_content(QXmlStreamReader& xmlReader)
     return true;
 }
 
+template<class T>
+unsigned int Image<T>::rawBlockCount() const
+{
+    return m_imagebands.size();
+}
+
+template<class T>
+qint64 Image<T>::rawBlockSize(unsigned int block_id) const
+{
+    return qint64(width())*height()*sizeof(T);
+}
+
+template<class T>
+const char* Image<T>::rawBlockData(unsigned int block_id) const
+{
+    if(block_id >= m_imagebands.size())
+        return NULL;
+    
+    return (const char*)band(block_id).data();
+}
+
+template<class T>
+char* Image<T>::rawBlockData(unsigned int block_id)
+{
+    if(locked() || block_id >= m_imagebands.size())
+        return NULL;
+    
+    if(isMapped(block_id))
+    {
+        return (char*)m_mappedbands[block_id].data();
+    }
+    
+    //Bands of raw containers are allocated on demand
+    if(m_imagebands[block_id].shape() != size())
+    {
+        m_imagebands[block_id].reshape(size());
+    }
+    return (char*)m_imagebands[block_id].data();
+}
+
+template<class T>
+bool Image<T>::mapRawBlock(unsigned int block_id, char* memory)
+{
+    if(locked() || block_id >= m_imagebands.size() || isMapped(block_id))
+        return false;
+    
+    if(m_mappedbands.size() != m_imagebands.size())
+    {
+        m_mappedbands.resize(m_imagebands.size());
+    }
+    
+    //Since the view is empty, the assignment only lets it point to the memory
+    m_mappedbands[block_id] = vigra::MultiArrayView<2,T>(size(), (T*)memory);
+    
+    //Release the own storage of this band
+    m_imagebands[block_id] = vigra::MultiArray<2,T>();
+    
+    return true;
+}
+
+template<class T>
+bool Image<T>::isMapped(unsigned int band_id) const
+{
+    return band_id < m_mappedbands.size() && m_mappedbands[band_id].hasData();
+}
+
+template<class T>
+unsigned int Image<T>::revision() const
+{
+    return m_revision;
+}
+
+template<class T>
+void Image<T>::unmapBands()
+{
+    for(unsigned int i=0; i<m_mappedbands.size(); ++i)
+    {
+        if(m_mappedbands[i].hasData())
+        {
+            m_imagebands[i] = m_mappedbands[i];
+        }
+    }
+    m_mappedbands.clear();
+}
+
 template <class T>
 void Image<T>::updateModel()
 {
+    ++m_revision;
+    
     //qDebug() << QString("Inside Image<T>::updateModel() - numBands=%1, size=(%2x%3) -locked=%4").arg(numBands()).arg(width()).arg(height()).arg(locked());
     
     //remove existing image bands
@@ -410,6 +526,11 @@ void Image<T>::updateModel()
         {
             m_imagebands.pop_back();
         }
+        
+        if(m_mappedbands.size() > numBands())
+        {
+            m_mappedbands.resize(numBands());
+        }
     }
     else if(width()!=0 && height()!=0)
     {
@@ -425,12 +546,21 @@ void Image<T>::updateModel()
                 //qDebug() << QString("Add a new image band of size: (%1x%2)").arg(width()).arg(height());
                 m_imagebands.push_back(band);
             }
+            
+            if(m_mappedbands.size() != 0)
+            {
+                m_mappedbands.resize(numBands());
+            }
         }
         //Dimensions have changed
         else if(   m_imagebands.size()!=0
-                && ((unsigned int)m_imagebands[0].width()!= width() || (unsigned int)m_imagebands[0].height()!= height()))
+                && ((unsigned int)band(0).width()!= width() || (unsigned int)band(0).height()!= height()))
         {
-            //qDebug() << QString("Dimensions have changed from (%1x%2) to (%3x%4)").arg(m_imagebands[0].width()).arg(m_imagebands[0].height()).arg(width()).arg(height());
+            //qDebug() << QString("Dimensions have changed from (%1x%2) to (%3x%4)").arg(band(0).width()).arg(band(0).height()).arg(width()).arg(height());
+            
+            //Mapped bands cannot be reshaped: use own storage from now on
+            m_mappedbands.clear();
+            
             for(vigra::MultiArray<2,T> & band: m_imagebands)
             {
                 band.reshape(vigra::Shape2(width(),height()));
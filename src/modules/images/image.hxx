@@ -60,6 +60,11 @@ namespace graipe {
  *
  * This class extends the RasteredModel class, the template argument is
  * defining the pixel type.
+ *
+ * The bands are usually owned by the image. If the image has been loaded from
+ * a raw container (see Impex), the bands may also be memory-mapped views on 
+ * the container file. Then, only the touched pages will be loaded from disk.
+ * Changes to mapped bands remain private to the image (copy-on-write).
  */
 template<class T>
 class GRAIPE_IMAGES_EXPORT Image
@@ -254,6 +259,65 @@ class GRAIPE_IMAGES_EXPORT Image
          * \param xmlReader The QXmlStreamReader, where we will read from.
          */
 		bool deserialize_content(QXmlStreamReader& xmlReader);
+    
+        /**
+         * Each band of the image is exposed as one raw data block for the binary
+         * raw container format.
+         *
+         * \return The number of bands of the image.
+         */
+        unsigned int rawBlockCount() const;
+    
+        /**
+         * Size of a band in bytes.
+         *
+         * \param block_id The id of the band.
+         * \return The size of the band in bytes.
+         */
+        qint64 rawBlockSize(unsigned int block_id) const;
+    
+        /**
+         * Constant/reading access to the memory of a band.
+         *
+         * \param block_id The id of the band.
+         * \return The pointer to the first byte of the band or NULL if out of bounds.
+         */
+        const char* rawBlockData(unsigned int block_id) const;
+    
+        /**
+         * Writing access to the memory of a band.
+         *
+         * \param block_id The id of the band.
+         * \return The pointer to the first byte of the band or NULL if out of bounds
+         *         or if the image is locked.
+         */
+        char* rawBlockData(unsigned int block_id);
+    
+        /**
+         * Use a memory-mapped band of a raw container as the storage of a band.
+         *
+         * \param block_id The id of the band.
+         * \param memory The mapped memory of the band.
+         * \return True, if the band is now using the mapped memory.
+         */
+        bool mapRawBlock(unsigned int block_id, char* memory);
+    
+        /**
+         * Checks, if a band of the image is a memory-mapped view.
+         *
+         * \param band_id The id of the band.
+         * \return True, if the band is memory-mapped.
+         */
+        bool isMapped(unsigned int band_id) const;
+    
+        /**
+         * Returns the content revision of the image. It is incremented by each
+         * call of updateModel(), but not by locking or unlocking the image.
+         * Caches of derived data may use it to detect changes of the bands.
+         *
+         * \return The content revision of the image.
+         */
+        unsigned int revision() const;
 	
     public slots:
         /**
@@ -268,9 +332,21 @@ class GRAIPE_IMAGES_EXPORT Image
          */
         void appendParameters();
     
+        /**
+         * Copies all memory-mapped bands into the image's own storage
+         * and removes the mapped views afterwards.
+         */
+        void unmapBands();
+    
         /** Storage of the image bands **/
 		std::vector<vigra::MultiArray<2,T> > m_imagebands;
     
+        /** 
+         * Memory-mapped views of the image bands. Either empty or of the same size
+         * as m_imagebands. Views without data are not mapped.
+         */
+		std::vector<vigra::MultiArrayView<2,T> > m_mappedbands;
+    
         /**
          * @{
          * Additional parameters
@@ -283,6 +359,9 @@ class GRAIPE_IMAGES_EXPORT Image
         /**
          * @}
          */
+    
+        /** The content revision, see revision() **/
+        unsigned int m_revision;
 };
 
 /**
@@ -127,6 +127,8 @@ ImageBandParameter<T>::ImageBandParameter(QString name, Parameter* parent, bool
         delete img;
         img=NULL;
         
+        QMutexLocker locker(&wsp->models_mutex);
+        
         for(Model* model :wsp->models )
         {
             if(model->typeName() ==typeName)
@@ -186,7 +186,8 @@ class OpticalFlowAlgorithm2Bands
                                         m_param_useGME->value(),
                                         mat_list[0],
                                         rotation_correlation_list[0],
-                                        translation_correlation_list[0]);
+                                        translation_correlation_list[0],
+                                        &m_gme);
                 }
                 else
                 {
@@ -199,7 +200,8 @@ class OpticalFlowAlgorithm2Bands
                                         m_param_useGME->value(),
                                         mat_list[0],
                                         rotation_correlation_list[0],
-                                        translation_correlation_list[0]);
+                                        translation_correlation_list[0],
+                                        &m_gme);
                 }
             }
             else if(m_param_pmode->value() == 0)
@@ -218,7 +220,8 @@ class OpticalFlowAlgorithm2Bands
                                                                  rotation_correlation_list,
                                                                  translation_correlation_list,
                                                                  m_param_highestLevel->value(), m_param_lowestLevel->value(),
-                                                                 m_param_hmode->value());
+                                                                 m_param_hmode->value(),
+                                                                 &m_gme);
                 }
                 else
                 {
@@ -233,7 +236,8 @@ class OpticalFlowAlgorithm2Bands
                                                                  rotation_correlation_list,
                                                                  translation_correlation_list,
                                                                  m_param_highestLevel->value(), m_param_lowestLevel->value(),
-                                                                 m_param_hmode->value());
+                                                                 m_param_hmode->value(),
+                                                                 &m_gme);
                     
                 }
                 
@@ -256,7 +260,8 @@ class OpticalFlowAlgorithm2Bands
                                                              rotation_correlation_list,
                                                              translation_correlation_list,
                                                              m_param_highestLevel->value(), m_param_lowestLevel->value(), m_param_hmode->value(),
-                                                             warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value());
+                                                             warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value(),
+                                                             &m_gme);
                 }
                 else 
                 {
@@ -272,7 +277,8 @@ class OpticalFlowAlgorithm2Bands
                                                              rotation_correlation_list,
                                                              translation_correlation_list,
                                                              m_param_highestLevel->value(), m_param_lowestLevel->value(), m_param_hmode->value(),
-                                                             warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value());
+                                                             warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value(),
+                                                             &m_gme);
                 }
                 
             }
@@ -380,6 +386,9 @@ class OpticalFlowAlgorithm2Bands
         /**
          * @}
          */
+    
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
   
 /**
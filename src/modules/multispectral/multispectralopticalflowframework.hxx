@@ -75,6 +75,8 @@ namespace graipe {
  * \param[out] mat If use_global is true, this contains the global motion estimation matrix (rot+trans).
  * \param[out] rotation_correlation If use_global is true, this contains the rotation correlation.
  * \param[out] translation_correlation If use_global is true, this contains the transflation correlation.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <	class T1, class T2, class OpticalFlowFunctor>
 int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
@@ -85,7 +87,8 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
                         OpticalFlowFunctor flowFunc,
                         bool use_global,
                         vigra::Matrix<double>& mat,
-                        double & rotation_correlation, double & translation_correlation)
+                        double & rotation_correlation, double & translation_correlation,
+                        GlobalMotionEstimator * gme = NULL)
 {	
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -97,9 +100,14 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src11, src21, mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src11, src21, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src11, src21, mat, rotation_correlation, translation_correlation);
+        }
         
         affineWarpImage(vigra::SplineImageView<3, T2>(src11), displaced_image11, mat);
         affineWarpImage(vigra::SplineImageView<3, T2>(src12), displaced_image12, mat);
@@ -140,6 +148,8 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
  * \param[out] mat If use_global is true, this contains the global motion estimation matrix (rot+trans).
  * \param[out] rotation_correlation If use_global is true, this contains the rotation correlation.
  * \param[out] translation_correlation If use_global is true, this contains the transflation correlation.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class T3, class OpticalFlowFunctor>
 int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
@@ -151,7 +161,8 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
                         OpticalFlowFunctor flowFunc,
                         bool use_global,
                         vigra::Matrix<double>& mat,
-                        double & rotation_correlation, double & translation_correlation)
+                        double & rotation_correlation, double & translation_correlation,
+                        GlobalMotionEstimator * gme = NULL)
 {	
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -164,9 +175,14 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src11, src21, mat,
-                                          rotation_correlation,
-                                          translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src11, src21, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src11, src21, mat, rotation_correlation, translation_correlation);
+        }
         
         affineWarpImage(vigra::SplineImageView<3, T2>(src11), displaced_image11, mat);
         affineWarpImage(vigra::SplineImageView<3, T2>(src12), displaced_image12, mat);
@@ -213,6 +229,8 @@ int calculateOFCE2Bands(const vigra::MultiArrayView<2, T1> & src11,
  * \param[in]  steps Step count.
  * \param[in]  break_level On wich level shall we finish/break the traversal.
  * \param[in]  hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
+ * \param[in]  gme The global motion estimator, which is shared by all levels.
+ *                 If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class MatrixType, class OpticalFlowFunctor>
 void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,T1> & src11,
@@ -227,7 +245,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
                                                   std::vector<double>& translation_correlation_list,
                                                   unsigned int steps,
                                                   unsigned int break_level,
-                                                  unsigned int hmode)
+                                                  unsigned int hmode,
+                                                  GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -277,7 +296,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
                             use_gme,
                             mat_list[s],
                             rotation_correlation_list[s],
-                            translation_correlation_list[s]);
+                            translation_correlation_list[s],
+                            gme);
 
         if(next_iter != step_list.end() )
 		{
@@ -325,6 +345,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
  * \param      steps Step count.
  * \param[in]  break_level On wich level shall we finish/break the traversal.
  * \param[in]  hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
+ * \param[in]  gme The global motion estimator, which is shared by all levels.
+ *                 If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor>
 void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,T1> & src11,
@@ -340,7 +362,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
                                                   std::vector<double>& translation_correlation_list,
                                                   unsigned int steps,
                                                   unsigned int break_level,
-                                                  unsigned int hmode)
+                                                  unsigned int hmode,
+                                                  GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -397,7 +420,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
                             use_gme,
                             mat_list[s],
                             rotation_correlation_list[s],
-                            translation_correlation_list[s]);
+                            translation_correlation_list[s],
+                            gme);
 		
         if(next_iter != step_list.end() )
 		{
@@ -454,6 +478,8 @@ void calculateOFCEHierarchicallyInitialiser2Bands(const vigra::MultiArrayView<2,
  * \param[in]  warp The functor, which is used for warping
  * \param[in]  warp_subsampling The subsampling, wich is used for warping
  * \param[in]  warp_sigma The sigma, which is used for smoothing the result before subsampling.
+ * \param[in]  gme The global motion estimator, which is shared by all levels.
+ *                 If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
 void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1> & src11,
@@ -473,7 +499,8 @@ void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1>
                                               unsigned int hmode,
                                               WarpingFunctor warp,
                                               unsigned int warp_subsampling,
-                                              float warp_sigma)
+                                              float warp_sigma,
+                                              GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -530,7 +557,8 @@ void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1>
                             use_gme,
                             mat_list[s],
                             rotation_correlation_list[s],
-                            translation_correlation_list[s]);
+                            translation_correlation_list[s],
+                            gme);
 		
 		if(next_iter != step_list.end() )
 		{
@@ -624,6 +652,8 @@ void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1>
  * \param[in]  warp The functor, which is used for warping
  * \param[in]  warp_subsampling The subsampling, wich is used for warping
  * \param[in]  warp_sigma The sigma, which is used for smoothing the result before subsampling.
+ * \param[in]  gme The global motion estimator, which is shared by all levels.
+ *                 If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
 void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1> & src11,
@@ -644,7 +674,8 @@ void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1>
                                               unsigned int hmode,
                                               WarpingFunctor warp,
                                               unsigned int warp_subsampling,
-                                              float warp_sigma)
+                                              float warp_sigma,
+                                              GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src11.shape() == src12.shape() ,"image sizes differ!");
     vigra_precondition(src12.shape() == src21.shape() ,"image sizes differ!");
@@ -707,7 +738,8 @@ void calculateOFCEHierarchicallyWarping2Bands(const vigra::MultiArrayView<2,T1>
                             use_gme,
                             mat_list[s],
                             rotation_correlation_list[s],
-                            translation_correlation_list[s]);
+                            translation_correlation_list[s],
+                            gme);
 		
 		if(next_iter != step_list.end() )
 		{
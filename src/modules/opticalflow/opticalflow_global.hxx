@@ -49,6 +49,12 @@
 //OFCE Spatiotemporal Gradients
 #include "opticalflowgradients.hxx"
 
+//Solvers for the Horn & Schunck-like approaches
+#include "opticalflowsolvers.hxx"
+
+//Parallel and vectorized execution
+#include "opticalflowparallel.hxx"
+
 
 
 
@@ -99,7 +105,8 @@ class OpticalFlowHSOriginalFunctor
 		OpticalFlowHSOriginalFunctor(double alpha=50, int iterations=1, double sigma=1.0)
 		:	m_alpha(alpha),
 			m_iterations(iterations),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
     
@@ -114,6 +121,39 @@ class OpticalFlowHSOriginalFunctor
 			m_level=level;
 		}
 		
+        /**
+         * Sets the solver backend, which is used to compute the flow.
+         * Defaults to the Jacobi iterations without early stopping.
+         *
+         * \param solver The solver backend.
+         */
+        void setSolver(const OpticalFlowHSSolver & solver)
+        {
+            m_solver = solver;
+        }
+    
+        /**
+         * Sets the execution (threads and instruction set) of the inner loops.
+         * Defaults to the sequential scalar execution.
+         *
+         * \param execution The execution settings.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
+    
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+        void setPrecision(int precision)
+        {
+            m_precision = precision;
+        }
+    
         /**
          * Returns the full name of the functor.
          *
@@ -134,6 +174,52 @@ class OpticalFlowHSOriginalFunctor
 			return "HS OFCE";
 		}
 	
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
 		/**
 		 * Here comes the implementatation, better known as the computation of optical flow
 		 * according to Norn & Schunck 81.
@@ -141,67 +227,85 @@ class OpticalFlowHSOriginalFunctor
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
             
-			vigra::MultiArray<2, FlowValueType> last_flow;
+            if(m_solver.solver() != OpticalFlowJacobiSolver)
+            {
+                //Update all inner pixels
+                vigra::MultiArray<2, vigra::UInt8> active(src1.shape());
+                active.subarray(vigra::Shape2(1,1), src1.shape()-vigra::Shape2(1,1)).init(1);
+                
+                solve<REAL>(src1, src2, active, flow);
+                return;
+            }
+            
+			vigra::MultiArray<2, FlowValueType> last_flow(flow.shape());
 			
-			double iter_change=0, mean_change=0, max_change=0;
+			double mean_change=0, max_change=0;
 			
 			for (int iteration=1;iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
 				last_flow = flow;
 				
-				for (int j=1; j<src1.height()-1; ++j)
-				{
-					for (int i=1; i<src1.width()-1; ++i)
+				//Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(1, src1.height()-1, [&](int first_row, int last_row, OpticalFlowChange & rows_change)
+                {
+                    for (int j=first_row; j<last_row; ++j)
 					{
+						for (int i=1; i<src1.width()-1; ++i)
+						{
 					
-						double	E_x = 0.25*(		src1(i+1,j  ) - src1(i,  j  )
-												+	src1(i+1,j+1) - src1(i,  j+1)
-												+	src2(i+1,j  ) - src2(i,  j  )
-												+	src2(i+1,j+1) - src2(i,  j+1)),
+							REAL	E_x = REAL(0.25)*(		src1(i+1,j  ) - src1(i,  j  )
+													+	src1(i+1,j+1) - src1(i,  j+1)
+													+	src2(i+1,j  ) - src2(i,  j  )
+													+	src2(i+1,j+1) - src2(i,  j+1)),
 								
-								E_y = 0.25*(		src1(i,  j+1) - src1(i,  j  )
-												+	src1(i+1,j+1) - src1(i+1,j  )
-												+	src2(i,  j+1) - src2(i,  j  )
-												+	src2(i+1,j+1) - src2(i+1,j  )),
+									E_y = REAL(0.25)*(		src1(i,  j+1) - src1(i,  j  )
+													+	src1(i+1,j+1) - src1(i+1,j  )
+													+	src2(i,  j+1) - src2(i,  j  )
+													+	src2(i+1,j+1) - src2(i+1,j  )),
 								
-								E_t = 0.25*(		src2(i,  j  ) - src1(i,  j  )
-												+	src2(i+1,j  ) - src1(i+1,j  )
-												+	src2(i,  j+1) - src1(i,  j+1)
-												+	src2(i+1,j+1) - src1(i+1,j+1)),
+									E_t = REAL(0.25)*(		src2(i,  j  ) - src1(i,  j  )
+													+	src2(i+1,j  ) - src1(i+1,j  )
+													+	src2(i,  j+1) - src1(i,  j+1)
+													+	src2(i+1,j+1) - src1(i+1,j+1)),
 											
-								u_mean =	(last_flow(i-1,j)[0]   + last_flow(i,j+1)[0]   +  last_flow(i+1,j)[0]   +  last_flow(i,j-1)[0]) /6.0
-										 +	(last_flow(i-1,j-1)[0] + last_flow(i-1,j+1)[0] +  last_flow(i+1,j+1)[0] +  last_flow(i-1,j-1)[0])/12.0,
+									u_mean =	(last_flow(i-1,j)[0]   + last_flow(i,j+1)[0]   +  last_flow(i+1,j)[0]   +  last_flow(i,j-1)[0]) /REAL(6)
+											 +	(last_flow(i-1,j-1)[0] + last_flow(i-1,j+1)[0] +  last_flow(i+1,j+1)[0] +  last_flow(i-1,j-1)[0])/REAL(12),
 											
-								v_mean =	(last_flow(i-1,j)[1]   + last_flow(i,j+1)[1]   +  last_flow(i+1,j)[1]   +  last_flow(i,j-1)[1]) /6.0
-										 +	(last_flow(i-1,j-1)[1] + last_flow(i-1,j+1)[1] +  last_flow(i+1,j+1)[1] +  last_flow(i-1,j-1)[1])/12.0,
+									v_mean =	(last_flow(i-1,j)[1]   + last_flow(i,j+1)[1]   +  last_flow(i+1,j)[1]   +  last_flow(i,j-1)[1]) /REAL(6)
+											 +	(last_flow(i-1,j-1)[1] + last_flow(i-1,j+1)[1] +  last_flow(i+1,j+1)[1] +  last_flow(i-1,j-1)[1])/REAL(12),
 
-								fix_part = (E_x*u_mean + E_y*v_mean + E_t)	/	(m_alpha*m_alpha + E_x*E_x + E_y*E_y);
+									fix_part = (E_x*u_mean + E_y*v_mean + E_t)	/	(REAL(m_alpha*m_alpha) + E_x*E_x + E_y*E_y);
 						
 						
-						flow(i,j)[0] = u_mean - fix_part*E_x;
-						flow(i,j)[1] = v_mean - fix_part*E_y;
+							flow(i,j)[0] = u_mean - fix_part*E_x;
+							flow(i,j)[1] = v_mean - fix_part*E_y;
 						
-						iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
-						mean_change += iter_change;
-						max_change = std::max(max_change, iter_change);
+							double iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
+							rows_change.sum += iter_change;
+							rows_change.max = std::max(rows_change.max, iter_change);
+						}
 					}
-				}
-				mean_change= mean_change / (src1.size());
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 		}
     
@@ -213,81 +317,160 @@ class OpticalFlowHSOriginalFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask THe mask, where pixel values are assumed to be valid.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        const vigra::MultiArrayView<2,T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     const vigra::MultiArrayView<2,T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {            
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
             
-            vigra::MultiArray<2, FlowValueType> last_flow;
+            if(m_solver.solver() != OpticalFlowJacobiSolver)
+            {
+                //Update all inner pixels, where the mask is set for the whole gradient cube
+                vigra::MultiArray<2, vigra::UInt8> active(src1.shape());
+                
+                for (int j=1; j<src1.height()-1; ++j)
+                {
+                    for (int i=1; i<src1.width()-1; ++i)
+                    {
+                        active(i,j) = (   mask(i,  j  ) !=0  && mask(i,  j+1) !=0
+                                       && mask(i+1,j  ) !=0  && mask(i+1,j+1) !=0);
+                    }
+                }
+                
+                solve<REAL>(src1, src2, active, flow);
+                return;
+            }
+            
+            vigra::MultiArray<2, FlowValueType> last_flow(flow.shape());
 			
-			double iter_change=0, mean_change=0, max_change=0;
+			double mean_change=0, max_change=0;
 			
 			for (int iteration=1;iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
                 last_flow = flow;
 				
-				for (int j=1; j<src1.height()-1; ++j)
-				{
-					for (int i=1; i<src1.width()-1; ++i)
+				//Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(1, src1.height()-1, [&](int first_row, int last_row, OpticalFlowChange & rows_change)
+                {
+                    for (int j=first_row; j<last_row; ++j)
 					{
+						for (int i=1; i<src1.width()-1; ++i)
+						{
 					
-						if(	  mask(i,  j  ) !=0  && mask(i,  j+1) !=0
-						   && mask(i+1,j  ) !=0  && mask(i+1,j+1) !=0)
-                        {
-                            double	E_x = 0.25*(		src1(i+1,j  ) - src1(i,  j  )
-                                                    +	src1(i+1,j+1) - src1(i,  j+1)
-                                                    +	src2(i+1,j  ) - src2(i,  j  )
-                                                    +	src2(i+1,j+1) - src2(i,  j+1)),
+							if(	  mask(i,  j  ) !=0  && mask(i,  j+1) !=0
+							   && mask(i+1,j  ) !=0  && mask(i+1,j+1) !=0)
+                            {
+                                REAL	E_x = REAL(0.25)*(		src1(i+1,j  ) - src1(i,  j  )
+                                                        +	src1(i+1,j+1) - src1(i,  j+1)
+                                                        +	src2(i+1,j  ) - src2(i,  j  )
+                                                        +	src2(i+1,j+1) - src2(i,  j+1)),
                                     
-                                    E_y = 0.25*(		src1(i,  j+1) - src1(i,  j  )
-                                                    +	src1(i+1,j+1) - src1(i+1,j  )
-                                                    +	src2(i,  j+1) - src2(i,  j  )
-                                                    +	src2(i+1,j+1) - src2(i+1,j  )),
+                                        E_y = REAL(0.25)*(		src1(i,  j+1) - src1(i,  j  )
+                                                        +	src1(i+1,j+1) - src1(i+1,j  )
+                                                        +	src2(i,  j+1) - src2(i,  j  )
+                                                        +	src2(i+1,j+1) - src2(i+1,j  )),
                                     
-                                    E_t = 0.25*(		src2(i,  j  ) - src1(i,  j  )
-                                                    +	src2(i+1,j  ) - src1(i+1,j  )
-                                                    +	src2(i,  j+1) - src1(i,  j+1)
-                                                    +	src2(i+1,j+1) - src1(i+1,j+1)),
+                                        E_t = REAL(0.25)*(		src2(i,  j  ) - src1(i,  j  )
+                                                        +	src2(i+1,j  ) - src1(i+1,j  )
+                                                        +	src2(i,  j+1) - src1(i,  j+1)
+                                                        +	src2(i+1,j+1) - src1(i+1,j+1)),
                                                 
-                                    u_mean =	(last_flow(i-1,j)[0]   + last_flow(i,j+1)[0]   +  last_flow(i+1,j)[0]   +  last_flow(i,j-1)[0]) /6.0
-                                             +	(last_flow(i-1,j-1)[0] + last_flow(i-1,j+1)[0] +  last_flow(i+1,j+1)[0] +  last_flow(i-1,j-1)[0])/12.0,
+                                        u_mean =	(last_flow(i-1,j)[0]   + last_flow(i,j+1)[0]   +  last_flow(i+1,j)[0]   +  last_flow(i,j-1)[0]) /REAL(6)
+                                                 +	(last_flow(i-1,j-1)[0] + last_flow(i-1,j+1)[0] +  last_flow(i+1,j+1)[0] +  last_flow(i-1,j-1)[0])/REAL(12),
                                                 
-                                    v_mean =	(last_flow(i-1,j)[1]   + last_flow(i,j+1)[1]   +  last_flow(i+1,j)[1]   +  last_flow(i,j-1)[1]) /6.0
-                                             +	(last_flow(i-1,j-1)[1] + last_flow(i-1,j+1)[1] +  last_flow(i+1,j+1)[1] +  last_flow(i-1,j-1)[1])/12.0,
+                                        v_mean =	(last_flow(i-1,j)[1]   + last_flow(i,j+1)[1]   +  last_flow(i+1,j)[1]   +  last_flow(i,j-1)[1]) /REAL(6)
+                                                 +	(last_flow(i-1,j-1)[1] + last_flow(i-1,j+1)[1] +  last_flow(i+1,j+1)[1] +  last_flow(i-1,j-1)[1])/REAL(12),
 
-                                    fix_part = (E_x*u_mean + E_y*v_mean + E_t)	/	(m_alpha*m_alpha + E_x*E_x + E_y*E_y);
+                                        fix_part = (E_x*u_mean + E_y*v_mean + E_t)	/	(REAL(m_alpha*m_alpha) + E_x*E_x + E_y*E_y);
                             
                             
-                            flow(i,j)[0] = u_mean - fix_part*E_x;
-                            flow(i,j)[1] = v_mean - fix_part*E_y;
+                                flow(i,j)[0] = u_mean - fix_part*E_x;
+                                flow(i,j)[1] = v_mean - fix_part*E_y;
                             
-                            iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
-                            mean_change += iter_change;
-                            max_change = std::max(max_change, iter_change);
+                                double iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
+                                rows_change.sum += iter_change;
+                                rows_change.max = std::max(rows_change.max, iter_change);
+                            }
                         }
                     }
-                }
-				mean_change= mean_change / (src1.size());
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 		}
 
     private:
+        /**
+         * Computes the gradients of Horn & Schunck 1981 once and solves the
+         * system of equations using the (non-Jacobi) solver backend.
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] active Non-zero for all pixels, which shall be updated.
+         * \param[in,out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the gradients.
+         */
+		template <class REAL, class T1, class T2>
+		void solve(const vigra::MultiArrayView<2,T1> & src1,
+                   const vigra::MultiArrayView<2,T2> & src2,
+                   const vigra::MultiArrayView<2,vigra::UInt8> & active,
+                   vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra::MultiArray<2,ValueType> J11(src1.shape()), J12(src1.shape()), J22(src1.shape()),
+                                           b1(src1.shape()), b2(src1.shape());
+            
+            for (int j=0; j<src1.height()-1; ++j)
+            {
+                for (int i=0; i<src1.width()-1; ++i)
+                {
+                    REAL	E_x = REAL(0.25)*(		src1(i+1,j  ) - src1(i,  j  )
+                                            +	src1(i+1,j+1) - src1(i,  j+1)
+                                            +	src2(i+1,j  ) - src2(i,  j  )
+                                            +	src2(i+1,j+1) - src2(i,  j+1)),
+                            
+                            E_y = REAL(0.25)*(		src1(i,  j+1) - src1(i,  j  )
+                                            +	src1(i+1,j+1) - src1(i+1,j  )
+                                            +	src2(i,  j+1) - src2(i,  j  )
+                                            +	src2(i+1,j+1) - src2(i+1,j  )),
+                            
+                            E_t = REAL(0.25)*(		src2(i,  j  ) - src1(i,  j  )
+                                            +	src2(i+1,j  ) - src1(i+1,j  )
+                                            +	src2(i,  j+1) - src1(i,  j+1)
+                                            +	src2(i+1,j+1) - src1(i+1,j+1));
+                    
+                    J11(i,j) = E_x*E_x;
+                    J12(i,j) = E_x*E_y;
+                    J22(i,j) = E_y*E_y;
+                    b1(i,j)  = -E_x*E_t;
+                    b2(i,j)  = -E_y*E_t;
+                }
+            }
+            
+            m_solver.solve(J11, J12, J22, b1, b2, active, m_alpha, m_iterations, flow);
+        }
+    
 		double	m_alpha;
 		int		m_iterations;
     //  double  m_sigma;
 		int		m_level;
+        OpticalFlowHSSolver m_solver;
+        OpticalFlowExecution m_execution;
+        int m_precision;
 };
 
 
@@ -318,7 +501,8 @@ class OpticalFlowHSFunctor
 		:	m_alpha(alpha),
 			m_iterations(iterations),
 			m_sigma(sigma),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
     
@@ -334,6 +518,43 @@ class OpticalFlowHSFunctor
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
 
+        /**
+         * Sets the solver backend. The red-black SOR and multigrid backends only
+         * support Horn's 8-neighborhood mean, but not the Gaussian smoothing of
+         * the flow. Thus, only the Jacobi iterations are supported here, but they
+         * may stop early.
+         *
+         * \param solver The solver backend.
+         */
+        void setSolver(const OpticalFlowHSSolver & solver)
+        {
+            vigra_precondition(solver.solver() == OpticalFlowJacobiSolver,
+                               "Gaussian Horn & Schunck: Only the Jacobi solver supports the Gaussian smoothness term.");
+            m_solver = solver;
+        }
+    
+        /**
+         * Sets the execution (threads and instruction set) of the inner loops.
+         * Defaults to the sequential scalar execution.
+         *
+         * \param execution The execution settings.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
+    
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+        void setPrecision(int precision)
+        {
+            m_precision = precision;
+        }
+    
         /**
          * Returns the full name of the functor.
          *
@@ -354,6 +575,52 @@ class OpticalFlowHSFunctor
 			return "GA HS OFCE";
 		}
 		
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
 		/**
 		 * Here comes the implementatation, better known as the computation of optical flow
 		 * according to Norn & Schunck but with better gradient estimation.
@@ -361,11 +628,13 @@ class OpticalFlowHSFunctor
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
@@ -379,37 +648,31 @@ class OpticalFlowHSFunctor
 			//spatiotemporal Gradients of first order: I_x, I_y and I_t
 			spatioTemporalGradient(src1, src2, gradX, gradY, gradT, m_sigma);
 			
-			double iter_change=0, mean_change=0, max_change=0;
+			double mean_change=0, max_change=0;
 			
 			for (int iteration=1;iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
 				vigra::gaussianSmoothing(flow, mean_flow,	m_sigma);
 				
-				for (int j=0; j<src1.height(); ++j)
-				{
-					for (int i=0; i<src1.width(); ++i)
-					{
-						double	fix_part	= (gradX(i,j)*mean_flow(i,j)[0]+ gradY(i,j)*mean_flow(i,j)[1]+ gradT(i,j))	/	(m_alpha*m_alpha + gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j)),
-								new_u		= mean_flow(i,j)[0] - fix_part*gradX(i,j),
-								new_v		= mean_flow(i,j)[1] - fix_part*gradY(i,j);
-						
-						iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
-										   +	pow(flow(i,j)[1] - new_v,2));
-						
-						mean_change	+= iter_change;
-						max_change = max(max_change, iter_change);
-                        
-						flow(i,j)[0] = new_u;
-                        flow(i,j)[1] = new_v;
-					}
-				}
-				mean_change = mean_change / src1.size();
+                //Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange & rows_change)
+                {
+                    for (int j=first_row; j<last_row; ++j)
+                    {
+                        m_execution.projectRow<REAL>(&gradX(0,j), &gradY(0,j), &gradT(0,j),
+                                                     &mean_flow(0,j)[0], &flow(0,j)[0], src1.width(),
+                                                     m_alpha*m_alpha, rows_change);
+                    }
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 		}
 		
@@ -421,12 +684,14 @@ class OpticalFlowHSFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask THe mask, where pixel values are assumed to be valid.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        const vigra::MultiArrayView<2,T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     const vigra::MultiArrayView<2,T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {            
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
@@ -441,40 +706,46 @@ class OpticalFlowHSFunctor
 			//spatiotemporal Gradients of first order: I_x, I_y and I_t
 			spatioTemporalGradientWithMask(src1, src2, mask, gradX, gradY, gradT, m_sigma);
 			
-			double iter_change=0, mean_change=0, max_change=0;
+			double mean_change=0, max_change=0;
 			
 			for (int iteration=1;iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
 				gaussianSmoothingWithMask(flow, mask, mean_flow,	m_sigma);
 				
-				for (int j=0; j<src1.height(); ++j)
-				{
-					for (int i=0; i<src1.width(); ++i)
-					{
-						if(mask(i,j) !=0)
+                //Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange & rows_change)
+                {
+                    for (int j=first_row; j<last_row; ++j)
+                    {
+                        for (int i=0; i<src1.width(); ++i)
                         {
-                            double	fix_part	= (gradX(i,j)*mean_flow(i,j)[0]+ gradY(i,j)*mean_flow(i,j)[1]+ gradT(i,j))	/	(m_alpha*m_alpha + gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j)),
-                                    new_u		= mean_flow(i,j)[0] -fix_part*gradX(i,j),
-                                    new_v		= mean_flow(i,j)[1] -fix_part*gradY(i,j);
-						
-                            iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
-										   +	pow(flow(i,j)[1] - new_v,2));
-						
-                            mean_change	+= iter_change;
-                            max_change = max(max_change, iter_change);
-						
-                            flow(i,j)[0] = new_u;
-                            flow(i,j)[1] = new_v;
-						}
-					}
-				}
-				mean_change = mean_change / src1.size();
+                            if(mask(i,j) !=0)
+                            {
+                                REAL	fix_part	= (gradX(i,j)*mean_flow(i,j)[0]+ gradY(i,j)*mean_flow(i,j)[1]+ gradT(i,j))	/	(REAL(m_alpha*m_alpha) + gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j)),
+                                        new_u		= mean_flow(i,j)[0] -fix_part*gradX(i,j),
+                                        new_v		= mean_flow(i,j)[1] -fix_part*gradY(i,j);
+                            
+                                double iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
+                                                          +	pow(flow(i,j)[1] - new_v,2));
+                            
+                                rows_change.sum += iter_change;
+                                rows_change.max = std::max(rows_change.max, iter_change);
+                            
+                                flow(i,j)[0] = new_u;
+                                flow(i,j)[1] = new_v;
+                            }
+                        }
+                    }
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 		}
     
@@ -483,6 +754,9 @@ class OpticalFlowHSFunctor
 		int		m_iterations;
 		double  m_sigma;
 		int		m_level;
+        OpticalFlowHSSolver m_solver;
+        OpticalFlowExecution m_execution;
+        int m_precision;
 };
 
 
@@ -516,7 +790,8 @@ class OpticalFlowNEFunctor
 		:	m_alpha(alpha),
 			m_iterations(iterations),
 			m_sigma(sigma),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
 		
@@ -532,6 +807,42 @@ class OpticalFlowNEFunctor
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
 		
+        /**
+         * Sets the solver backend. Since the Nagel & Enkelmann approach needs
+         * to recompute the derivatives of the flow at each iteration, only the
+         * Jacobi iterations are supported, but they may stop early.
+         *
+         * \param solver The solver backend.
+         */
+        void setSolver(const OpticalFlowHSSolver & solver)
+        {
+            vigra_precondition(solver.solver() == OpticalFlowJacobiSolver,
+                               "Nagel & Enkelmann: Only the Jacobi solver is supported.");
+            m_solver = solver;
+        }
+    
+        /**
+         * Sets the execution (threads and instruction set) of the inner loops.
+         * Defaults to the sequential scalar execution.
+         *
+         * \param execution The execution settings.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
+    
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+        void setPrecision(int precision)
+        {
+            m_precision = precision;
+        }
+    
         /**
          * Returns the full name of the functor.
          *
@@ -552,27 +863,73 @@ class OpticalFlowNEFunctor
 			return "NE OFCE";
 		}
 		
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
 		/**
          * Standard Optical flow calculation according to Nagel & Enkelmann
          *
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
             
             using namespace ::vigra;
-            using namespace ::vigra::linalg;
             
 			vigra::MultiArray<2,ValueType>  gradX(src1.shape()), gradY(src1.shape()), gradT(src1.shape()),
                                      gradXX(src1.shape()), gradXY(src1.shape()), gradYY(src1.shape()),
-                                     q_x(src1.shape()), q_y(src1.shape()),
                                      u_x(src1.shape()),	v_x(src1.shape()),
                                      u_y(src1.shape()),	v_y(src1.shape()),
                                      u_xy(src1.shape()), v_xy(src1.shape()),
@@ -580,8 +937,6 @@ class OpticalFlowNEFunctor
             
             vigra::MultiArray<2,FlowValueType> mean_flow(src1.shape());
             
-			double	delta  = 1; 						
-            
             temp = src1;
             temp += src2;
             temp /= 2;
@@ -592,46 +947,10 @@ class OpticalFlowNEFunctor
 			//spatiotemporal Gradients of first order: I_x, I_y and I_t
 			spatioTemporalGradient(src1, src2, gradX, gradY, gradT, m_sigma);
 					
-			//preparing q_x and q_y (is constant for all iterations)
-			for (int j=0; j<src1.height(); ++j)
-			{
-				for (int i=0; i<src1.width(); ++i)
-				{
-					vigra::Matrix<double>	W(2,2),	hessOfGauss(2,2), invHessOfGauss(2,2), nablaI_t(1,2), q_mat(1,2);
-					
-					//Calculate weight matrix W
-					W(0,0) = gradY(i,j)*gradY(i,j) + delta;
-					W(1,0) = -gradX(i,j)*gradY(i,j);
-					W(0,1) = -gradX(i,j)*gradY(i,j);
-					W(1,1) = gradX(i,j)*gradX(i,j) + delta;
-					
-					W = 1.0/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2.0*delta) * W;
-					
-					//Calculate q
-					invHessOfGauss(0,0) = gradYY(i,j);			
-					invHessOfGauss(1,0) = -gradXY(i,j);
-					invHessOfGauss(0,1) = -gradXY(i,j);
-					invHessOfGauss(1,1) = gradXX(i,j);
-					
-					hessOfGauss(0,0) = gradXX(i,j);	
-					hessOfGauss(1,0) = gradXY(i,j);	
-					hessOfGauss(0,1) = gradXY(i,j);
-					hessOfGauss(1,1) = gradYY(i,j);
-					
-					nablaI_t(0,0) = gradX(i,j);
-					nablaI_t(0,1) = gradY(i,j);
-					
-					q_mat	=	1.0/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2.0*delta)
-								*	(nablaI_t * (invHessOfGauss + 2.0*hessOfGauss*W));
-					
-					q_x(i,j) = q_mat(0,0);
-					q_y(i,j) = q_mat(0,1);
-				}
-			}
+			//preparing the per-pixel tensors (are constant for all iterations)
+			const Tensors<REAL> & tensors = computeTensors<REAL>(gradX, gradY, gradXX, gradXY, gradYY);
 			
-			double iter_change=0, mean_change=0,max_change=0;
-			
-			double	Xi_u, Xi_v, fix_part, new_u, new_v;
+			double mean_change=0, max_change=0;
 			
 			//prepare gaussian kernel for smoothing of vectorfields
 			vigra::Kernel1D<float> k; 
@@ -640,9 +959,6 @@ class OpticalFlowNEFunctor
 			//do iterations
 			for (int iteration=1; iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
 				//u,v-mean
 				vigra::gaussianSmoothing(flow, mean_flow, m_sigma);
 				
@@ -660,45 +976,66 @@ class OpticalFlowNEFunctor
 				vigra::separableConvolveX(flow.bindElementChannel(1), temp, k);
 				vigra::separableConvolveY(temp, v_xy, k);
 				
-                for (int j=0; j<src1.height(); ++j)
+                //Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange & rows_change)
                 {
-                    for (int i=0; i<src1.width(); ++i)
+                    //The vectorized kernels project the Xi's of a whole row at once
+                    bool vectorized = (m_execution.simd() != OpticalFlowSIMDScalar);
+                    std::vector<float> Xi(vectorized ? 2*src1.width() : 0);
+                    
+                    for (int j=first_row; j<last_row; ++j)
                     {
-						//Calculate Xi's
-						Xi_u =		mean_flow(i,j)[0] 
-								-	2.0*gradX(i,j)*gradY(i,j)*u_xy(i,j)/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2*delta)
-								-	(q_x(i,j)*u_x(i,j)+q_y(i,j)*u_y(i,j));
-						
-						Xi_v =		mean_flow(i,j)[1]
-								-	2.0*gradX(i,j)*gradY(i,j)*v_xy(i,j)/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2*delta)
-								-	(q_x(i,j)*v_x(i,j)+q_y(i,j)*v_y(i,j));
-						
-						//Assign new values
-						fix_part =  (gradX(i,j)*Xi_u +gradY(i,j)*Xi_v + gradT(i,j)) / (gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + m_alpha*m_alpha);
-						
-						new_u = Xi_u - gradX(i,j)*fix_part;
-						new_v = Xi_v - gradY(i,j)*fix_part;
-						
-						//qDebug() << "q: (" << q_x(i,j) << ", "<< q_y(i,j) << ")\n";
-						//qDebug() << "Xi: (" << Xi_u << ", "<< Xi_v << ")\n";
-						//qDebug() << "fix_part: (" << fix_part << ")\n";
-						//qDebug() << "new: (" << new_u << ", "<< new_v << ")\n";
-						
-						iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
-											+	pow(flow(i,j)[1] - new_v,2));
-						
-						mean_change += iter_change;
-						max_change = max(max_change, iter_change);
-						
-						flow(i,j)[0] = new_u;
-						flow(i,j)[1] = new_v;
-					}
-				}
-				
-				mean_change = mean_change / src1.size();
+                        for (int i=0; i<src1.width(); ++i)
+                        {
+                            //Calculate Xi's
+                            REAL Xi_u =		mean_flow(i,j)[0]
+                                            -	tensors.mixed(i,j)*u_xy(i,j)
+                                            -	(tensors.q_x(i,j)*u_x(i,j)+tensors.q_y(i,j)*u_y(i,j));
+                            
+                            REAL Xi_v =		mean_flow(i,j)[1]
+                                            -	tensors.mixed(i,j)*v_xy(i,j)
+                                            -	(tensors.q_x(i,j)*v_x(i,j)+tensors.q_y(i,j)*v_y(i,j));
+                            
+                            if(vectorized)
+                            {
+                                Xi[2*i]   = Xi_u;
+                                Xi[2*i+1] = Xi_v;
+                                continue;
+                            }
+                            
+                            //Assign new values
+                            REAL fix_part =  (gradX(i,j)*Xi_u +gradY(i,j)*Xi_v + gradT(i,j)) * tensors.projection(i,j);
+                            
+                            REAL new_u = Xi_u - gradX(i,j)*fix_part;
+                            REAL new_v = Xi_v - gradY(i,j)*fix_part;
+                            
+                            double iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
+                                                      +	pow(flow(i,j)[1] - new_v,2));
+                            
+                            rows_change.sum += iter_change;
+                            rows_change.max = std::max(rows_change.max, iter_change);
+                            
+                            flow(i,j)[0] = new_u;
+                            flow(i,j)[1] = new_v;
+                        }
+                        
+                        if(vectorized)
+                        {
+                            m_execution.projectRow<REAL>(&gradX(0,j), &gradY(0,j), &gradT(0,j),
+                                                         Xi.data(), &flow(0,j)[0], src1.width(),
+                                                         m_alpha*m_alpha, rows_change);
+                        }
+                    }
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 		}
 	
@@ -709,24 +1046,24 @@ class OpticalFlowNEFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask THe mask, where pixel values are assumed to be valid.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2,T1> & src1,
-                        const vigra::MultiArrayView<2,T2> & src2,
-                        const vigra::MultiArrayView<2,T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2,T1> & src1,
+                     const vigra::MultiArrayView<2,T2> & src2,
+                     const vigra::MultiArrayView<2,T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
             
             using namespace ::vigra;
-            using namespace ::vigra::linalg;
             
 			vigra::MultiArray<2,ValueType>  gradX(src1.shape()), gradY(src1.shape()), gradT(src1.shape()),
                                      gradXX(src1.shape()), gradXY(src1.shape()), gradYY(src1.shape()),
                                      mean_u(src1.shape()), mean_v(src1.shape()),
-                                     q_x(src1.shape()), q_y(src1.shape()),
                                      u_x(src1.shape()),	v_x(src1.shape()),
                                      u_y(src1.shape()),	v_y(src1.shape()),
                                      u_xy(src1.shape()), v_xy(src1.shape()),
@@ -734,8 +1071,6 @@ class OpticalFlowNEFunctor
             
             vigra::MultiArray<2,FlowValueType> mean_flow(src1.shape());
             
-			double	delta  = 1;
-            
             temp = src1;
             temp += src2;
             temp /= 2;
@@ -746,47 +1081,10 @@ class OpticalFlowNEFunctor
 			//spatiotemporal Gradients of first order: I_x, I_y and I_t
 			spatioTemporalGradientWithMask(src1, src2, mask, gradX, gradY, gradT, m_sigma);
 			
-			//preparing q_x and q_y (is constant for all iterations)
-            for (int j=0; j<src1.height(); ++j)
-            {
-                for (int i=0; i<src1.width(); ++i)
-                {
-                    
-					vigra::Matrix<double>	W(2,2),	hessOfGauss(2,2), invHessOfGauss(2,2), nablaI_t(1,2), q_mat(1,2);
-					
-					//Calculate weight matrix W
-					W(0,0) = gradY(i,j)*gradY(i,j) + delta;
-					W(1,0) = -gradX(i,j)*gradY(i,j);
-					W(0,1) = -gradX(i,j)*gradY(i,j);
-					W(1,1) = gradX(i,j)*gradX(i,j) + delta;
-					
-					W = 1.0/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2.0*delta) * W;
-					
-					//Calculate q
-					invHessOfGauss(0,0) = gradYY(i,j);			
-					invHessOfGauss(1,0) = -gradXY(i,j);
-					invHessOfGauss(0,1) = -gradXY(i,j);
-					invHessOfGauss(1,1) = gradXX(i,j);
-					
-					hessOfGauss(0,0) = gradXX(i,j);	
-					hessOfGauss(1,0) = gradXY(i,j);	
-					hessOfGauss(0,1) = gradXY(i,j);
-					hessOfGauss(1,1) = gradYY(i,j);
-					
-					nablaI_t(0,0) = gradX(i,j);
-					nablaI_t(0,1) = gradY(i,j);
-					
-					q_mat	=	1.0/	(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2.0*delta)
-									*	(nablaI_t * (invHessOfGauss + 2.0*hessOfGauss*W));
-					
-					q_x(i,j) = q_mat(0,0);
-					q_y(i,j) = q_mat(0,1);
-				}
-			}
-			
-			double iter_change=0, mean_change=0,max_change=0;
+			//preparing the per-pixel tensors (are constant for all iterations)
+			const Tensors<REAL> & tensors = computeTensors<REAL>(gradX, gradY, gradXX, gradXY, gradYY);
 			
-			double	Xi_u, Xi_v, fix_part, new_u, new_v;
+			double mean_change=0, max_change=0;
 			
 			//prepare gaussian kernel for smoothing of vectorfields
 			vigra::Kernel1D<float> k; 
@@ -795,9 +1093,6 @@ class OpticalFlowNEFunctor
 			//do iterations
 			for (int iteration=1; iteration<=m_iterations; ++iteration)
 			{
-				mean_change=0;
-				max_change=0;
-				
 				//u,v-mean
 				gaussianSmoothingWithMask(flow, mask, mean_flow, m_sigma);
 				
@@ -813,57 +1108,165 @@ class OpticalFlowNEFunctor
 				// v_xy
 				gaussianGradient2ndMixedTermWithMask(flow.bindElementChannel(1), mask, v_xy, m_sigma);
 				
-                for (int j=0; j<src1.height(); ++j)
+                //Update blocks of rows in parallel
+				OpticalFlowChange change = m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange & rows_change)
                 {
-                    for (int i=0; i<src1.width(); ++i)
+                    for (int j=first_row; j<last_row; ++j)
                     {
-						if(mask(i,j) !=0)
-						{
-                            //Calculate Xi's
-                            Xi_u =		mean_flow(i,j)[0] 
-                                    -	2.0*gradX(i,j)*gradY(i,j)*u_xy(i,j)/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2*delta)
-                                    -	(q_x(i,j)*u_x(i,j)+q_y(i,j)*u_y(i,j));
-                            
-                            Xi_v =		mean_flow(i,j)[1]
-                                    -	2.0*gradX(i,j)*gradY(i,j)*v_xy(i,j)/(gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + 2*delta)
-                                    -	(q_x(i,j)*v_x(i,j)+q_y(i,j)*v_y(i,j));
-                            
-                            //Assign new values
-                            fix_part =  (gradX(i,j)*Xi_u +gradY(i,j)*Xi_v + gradT(i,j)) / (gradX(i,j)*gradX(i,j) + gradY(i,j)*gradY(i,j) + m_alpha*m_alpha);
-                            
-                            new_u = Xi_u - gradX(i,j)*fix_part;
-                            new_v = Xi_v - gradY(i,j)*fix_part;
-                            
-                            //qDebug() << "q: (" << q_x(i,j) << ", "<< q_y(i,j) << ")\n";
-                            //qDebug() << "Xi: (" << Xi_u << ", "<< Xi_v << ")\n";
-                            //qDebug() << "fix_part: (" << fix_part << ")\n";
-                            //qDebug() << "new: (" << new_u << ", "<< new_v << ")\n";
-                            
-                            iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
-                                               +	pow(flow(i,j)[1] - new_v,2));
-                            
-                            mean_change += iter_change;
-                            max_change = std::max(max_change, iter_change);
-                            
-                            flow(i,j)[0] = new_u;
-                            flow(i,j)[1] = new_v;
+                        for (int i=0; i<src1.width(); ++i)
+                        {
+                            if(mask(i,j) !=0)
+                            {
+                                //Calculate Xi's
+                                REAL Xi_u =		mean_flow(i,j)[0]
+                                                -	tensors.mixed(i,j)*u_xy(i,j)
+                                                -	(tensors.q_x(i,j)*u_x(i,j)+tensors.q_y(i,j)*u_y(i,j));
+                                
+                                REAL Xi_v =		mean_flow(i,j)[1]
+                                                -	tensors.mixed(i,j)*v_xy(i,j)
+                                                -	(tensors.q_x(i,j)*v_x(i,j)+tensors.q_y(i,j)*v_y(i,j));
+                                
+                                //Assign new values
+                                REAL fix_part =  (gradX(i,j)*Xi_u +gradY(i,j)*Xi_v + gradT(i,j)) * tensors.projection(i,j);
+                                
+                                REAL new_u = Xi_u - gradX(i,j)*fix_part;
+                                REAL new_v = Xi_v - gradY(i,j)*fix_part;
+                                
+                                double iter_change = sqrt(		pow(flow(i,j)[0] - new_u,2)
+                                                          +	pow(flow(i,j)[1] - new_v,2));
+                                
+                                rows_change.sum += iter_change;
+                                rows_change.max = std::max(rows_change.max, iter_change);
+                                
+                                flow(i,j)[0] = new_u;
+                                flow(i,j)[1] = new_v;
+                            }
                         }
-					}
-				}
-				
-				mean_change = mean_change /src1.size();
+                    }
+                }, src1.width());
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
-				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
+				
+				if(m_solver.converged(mean_change, max_change))
+				{
+					break;
+				}
 			}
 			
 		}
 
    private:
+        /**
+         * The per-pixel tensors of the Nagel & Enkelmann approach, stored as a
+         * structure of arrays of the precision REAL.
+         */
+        template <class REAL>
+        struct Tensors
+        {
+            /** The components of the vector q **/
+            vigra::MultiArray<2,REAL> q_x, q_y;
+            /** The weight of the mixed flow derivatives: 2*I_x*I_y/(|nabla I|^2 + 2*delta) **/
+            vigra::MultiArray<2,REAL> mixed;
+            /** The normalization of the projection: 1/(|nabla I|^2 + alpha^2) **/
+            vigra::MultiArray<2,REAL> projection;
+        };
+    
+        /**
+         * Computes the per-pixel tensors of the Nagel & Enkelmann approach. They only
+         * depend on the image derivatives and are thus computed once for each level.
+         *
+         * \param gradX The first derivative of the image in x-direction.
+         * \param gradY The first derivative of the image in y-direction.
+         * \param gradXX The second derivative of the image in x-direction.
+         * \param gradXY The mixed second derivative of the image.
+         * \param gradYY The second derivative of the image in y-direction.
+         * \return The tensors of the precision REAL.
+         */
+        template <class REAL>
+        const Tensors<REAL> & computeTensors(const vigra::MultiArrayView<2,ValueType> & gradX,
+                                             const vigra::MultiArrayView<2,ValueType> & gradY,
+                                             const vigra::MultiArrayView<2,ValueType> & gradXX,
+                                             const vigra::MultiArrayView<2,ValueType> & gradXY,
+                                             const vigra::MultiArrayView<2,ValueType> & gradYY)
+        {
+            const REAL delta = 1;
+            
+            Tensors<REAL> & tensors = tensorStorage(REAL());
+            
+            //Only reallocate if the size has changed
+            if(tensors.q_x.shape() != gradX.shape())
+            {
+                tensors.q_x.reshape(gradX.shape());
+                tensors.q_y.reshape(gradX.shape());
+                tensors.mixed.reshape(gradX.shape());
+                tensors.projection.reshape(gradX.shape());
+            }
+            
+            m_execution.parallelRows(0, gradX.height(), [&](int first_row, int last_row, OpticalFlowChange &)
+            {
+                for (int j=first_row; j<last_row; ++j)
+                {
+                    for (int i=0; i<gradX.width(); ++i)
+                    {
+                        REAL	g_x = gradX(i,j), g_y = gradY(i,j),
+                                h_xx = gradXX(i,j), h_xy = gradXY(i,j), h_yy = gradYY(i,j),
+                                norm = REAL(1)/(g_x*g_x + g_y*g_y + REAL(2)*delta);
+                        
+                        //Weight matrix W (symmetric)
+                        REAL	w_xx =  norm*(g_y*g_y + delta),
+                                w_xy = -norm*g_x*g_y,
+                                w_yy =  norm*(g_x*g_x + delta);
+                        
+                        //M = adj(H) + 2*H*W, where H denotes the Hessian of the image
+                        REAL	m_xx =  h_yy + REAL(2)*(h_xx*w_xx + h_xy*w_xy),
+                                m_xy = -h_xy + REAL(2)*(h_xx*w_xy + h_xy*w_yy),
+                                m_yx = -h_xy + REAL(2)*(h_xy*w_xx + h_yy*w_xy),
+                                m_yy =  h_xx + REAL(2)*(h_xy*w_xy + h_yy*w_yy);
+                        
+                        //q = 1/(|nabla I|^2 + 2*delta) * nabla I^T * M
+                        tensors.q_x(i,j) = norm*(g_x*m_xx + g_y*m_yx);
+                        tensors.q_y(i,j) = norm*(g_x*m_xy + g_y*m_yy);
+                        
+                        tensors.mixed(i,j) = REAL(2)*g_x*g_y*norm;
+                        tensors.projection(i,j) = REAL(1)/(g_x*g_x + g_y*g_y + REAL(m_alpha*m_alpha));
+                    }
+                }
+            }, gradX.width());
+            
+            return tensors;
+        }
+    
+        /**
+         * Access to the tensors of double precision.
+         *
+         * \return The tensors of double precision.
+         */
+        Tensors<double> & tensorStorage(double)
+        {
+            return m_tensors;
+        }
+    
+        /**
+         * Access to the tensors of single precision.
+         *
+         * \return The tensors of single precision.
+         */
+        Tensors<float> & tensorStorage(float)
+        {
+            return m_float_tensors;
+        }
+    
 		double	m_alpha;
 		int		m_iterations;
 		double  m_sigma;
 		int		m_level;
+        OpticalFlowHSSolver m_solver;
+        OpticalFlowExecution m_execution;
+        int m_precision;
+        Tensors<double> m_tensors;
+        Tensors<float> m_float_tensors;
 };
 
 /**
@@ -42,6 +42,9 @@
 //OFCE Spatiotemporal Gradients
 #include "opticalflowgradients.hxx"
 
+//Parallel execution of the iterations
+#include "opticalflowparallel.hxx"
+
 
 namespace graipe {
 
@@ -94,6 +97,21 @@ class OpticalFlowCLGFunctor
 			m_level=level;
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
+    
+        /**
+         * Sets the execution (threads) of the iterations. For more than one thread,
+         * the red-black ordering of the SOR-scheme is used.
+         * Defaults to the sequential execution. The instruction set of the execution
+         * is not used: Each update depends on the updated left neighbor (lexicographic
+         * order) or only touches every second pixel of the interleaved flow (red-black
+         * order), thus the iterations always use the scalar code.
+         *
+         * \param execution The execution settings.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
 		
         /**
          * Returns the full name of the functor.
@@ -159,42 +177,37 @@ class OpticalFlowCLGFunctor
 			
 			int max_iter = m_iterations;
 			double	omega = m_omega,
-					iter_change=0,
 					mean_change=0,
 					max_change=0;
 			
+			//The right and lower neighbors are taken from the last iteration (lexicographic order)
+			//or from the current one (red-black order, used for more than one thread)
+			const vigra::MultiArrayView<2, FlowValueType> next_flow = (m_execution.threads() == 1) ? vigra::MultiArrayView<2, FlowValueType>(last_flow) : flow;
+			
 			for(int iteration=1; iteration<=max_iter; iteration++)
 			{
 				//save last results
 				last_flow = flow;
 				
-				mean_change=0;
-				max_change=0;
-				
-				for (int j=1;j<src1.height()-1; ++j)
-				{
-					for (int i=1;i<src1.width()-1; ++i)
+				OpticalFlowChange change = m_execution.sorSweep(src1.width(), src1.height(), [&](int i, int j) -> double
 					{
-						 //With SOR (successive over-relaxation)
-						 flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
+						//With SOR (successive over-relaxation)
+						flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
 										+	omega*(		(flow(i-1,j)[0] + flow(i,j-1)[0])
-													+	(last_flow(i+1,j)[0]+last_flow(i,j+1)[0])
+													+	(next_flow(i+1,j)[0]+next_flow(i,j+1)[0])
 													-	(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[1] + gradX(i,j)))
 										/	(4.0 + (1.0/m_alpha)*stxx(i,j));
 						
-						 flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
-									   +	omega*(		(flow(i-1,j)[1] + flow(i,j-1)[1])
-													+	(last_flow(i+1,j)[1]+last_flow(i,j+1)[1])
+						flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
+										+	omega*(		(flow(i-1,j)[1] + flow(i,j-1)[1])
+													+	(next_flow(i+1,j)[1]+next_flow(i,j+1)[1])
 													-	(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[0] + gradY(i,j)))
-									   /	(4.0 + (1.0/m_alpha)*styy(i,j));
+										/	(4.0 + (1.0/m_alpha)*styy(i,j));
 						
-						iter_change =  vigra::norm(last_flow(i,j) - flow(i,j));
-						mean_change += iter_change;
-										
-                        max_change = std::max(max_change, iter_change);
-					}
-				}
-				mean_change = mean_change / src1.size();
+						return vigra::norm(last_flow(i,j) - flow(i,j));
+					});
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
 				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
@@ -249,45 +262,40 @@ class OpticalFlowCLGFunctor
 			
 			int max_iter = m_iterations;
 			double	omega = m_omega,
-			iter_change=0,
-			mean_change=0,
-			max_change=0;
+					mean_change=0,
+					max_change=0;
+			
+			//The right and lower neighbors are taken from the last iteration (lexicographic order)
+			//or from the current one (red-black order, used for more than one thread)
+			const vigra::MultiArrayView<2, FlowValueType> next_flow = (m_execution.threads() == 1) ? vigra::MultiArrayView<2, FlowValueType>(last_flow) : flow;
 			
 			for(int iteration=1; iteration<=max_iter; iteration++)
 			{
 				//save last results
 				last_flow = flow;
 				
-				mean_change=0;
-				max_change=0;
-				
-				for (int j=1;j<src1.height()-1; ++j)
-				{
-					for (int i=1;i<src1.width()-1; ++i)
+				OpticalFlowChange change = m_execution.sorSweep(src1.width(), src1.height(), [&](int i, int j) -> double
 					{
-						if(	mask(i,j) !=0 )
-						{
-						 //With SOR (successive over-relaxation)
-						 flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
+						if(mask(i,j) == 0)
+							return 0.0;
+						
+						//With SOR (successive over-relaxation)
+						flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
 										+	omega*(		(flow(i-1,j)[0] + flow(i,j-1)[0])
-													+	(last_flow(i+1,j)[0]+last_flow(i,j+1)[0])
+													+	(next_flow(i+1,j)[0]+next_flow(i,j+1)[0])
 													-	(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[1] + gradX(i,j)))
 										/	(4.0 + (1.0/m_alpha)*stxx(i,j));
 						
-						 flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
-									   +	omega*(		(flow(i-1,j)[1] + flow(i,j-1)[1])
-													+	(last_flow(i+1,j)[1]+last_flow(i,j+1)[1])
+						flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
+										+	omega*(		(flow(i-1,j)[1] + flow(i,j-1)[1])
+													+	(next_flow(i+1,j)[1]+next_flow(i,j+1)[1])
 													-	(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[0] + gradY(i,j)))
-									   /	(4.0 + (1.0/m_alpha)*styy(i,j));
+										/	(4.0 + (1.0/m_alpha)*styy(i,j));
 						
-						iter_change =  vigra::norm(last_flow(i,j) - flow(i,j));
-						mean_change += iter_change;
-										
-                        max_change = std::max(max_change, iter_change);
-                        }
-                    }
-				}
-				mean_change = mean_change / src1.size();
+						return vigra::norm(last_flow(i,j) - flow(i,j));
+					});
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
 				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
@@ -301,6 +309,7 @@ class OpticalFlowCLGFunctor
 		double  m_omega;
 		int		m_iterations;
 		int		m_level;
+		OpticalFlowExecution m_execution;
 };
 
 
@@ -346,6 +355,21 @@ class OpticalFlowCLGNonlinearFunctor
 			m_level=level;
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
+    
+        /**
+         * Sets the execution (threads) of the iterations. For more than one thread,
+         * the red-black ordering of the SOR-scheme is used.
+         * Defaults to the sequential execution. The instruction set of the execution
+         * is not used: Each update depends on the updated left neighbor (lexicographic
+         * order) or only touches every second pixel of the interleaved flow (red-black
+         * order), thus the iterations always use the scalar code.
+         *
+         * \param execution The execution settings.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
 	
         /**
          * Returns the full name of the functor.
@@ -410,33 +434,31 @@ class OpticalFlowCLGNonlinearFunctor
 			
 			int max_iter = m_iterations;
 			double	omega = m_omega,
-					iter_change=0,
 					mean_change=0,
 					max_change=0;
 			
+			//The right and lower neighbors are taken from the last iteration (lexicographic order)
+			//or from the current one (red-black order, used for more than one thread)
+			const vigra::MultiArrayView<2, FlowValueType> next_flow = (m_execution.threads() == 1) ? vigra::MultiArrayView<2, FlowValueType>(last_flow) : flow;
+			
 			for(int iteration=0; iteration<max_iter; iteration++)
 			{
 				//save last results
 				last_flow = flow;
 				
-				mean_change=0;
-				max_change=0;
-				
-				for (int j=1;j<src1.height()-1; ++j)
-				{
-					for (int i=1;i<src1.width()-1; ++i)
+				OpticalFlowChange change = m_execution.sorSweep(src1.width(), src1.height(), [&](int i, int j) -> double
 					{
 						//Some abbrev. for convenience
 						double	p2i_minus_u = (pen(2,     flow(i-1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
 								p2j_minus_u = (pen(2,     flow(i,j-1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-								p2i_plus_u  = (pen(2,last_flow(i+1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-								p2j_plus_u  = (pen(2,last_flow(i,j+1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p2i_plus_u  = (pen(2,next_flow(i+1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p2j_plus_u  = (pen(2,next_flow(i,j+1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
 								p1_u = pen(1,last_flow(i,j)[0]),
 							
 								p2i_minus_v = (pen(2,     flow(i-1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
 								p2j_minus_v = (pen(2,     flow(i,j-1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-								p2i_plus_v  = (pen(2,last_flow(i+1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-								p2j_plus_v  = (pen(2,last_flow(i,j+1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p2i_plus_v  = (pen(2,next_flow(i+1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p2j_plus_v  = (pen(2,next_flow(i,j+1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
 								p1_v = pen(1,last_flow(i,j)[1]);
 						
 						//With SOR (successive over-relaxation)
@@ -446,9 +468,9 @@ class OpticalFlowCLGNonlinearFunctor
 											   + 	(p2j_minus_u * flow(i,j-1)[0])
 											   /*** SUM over N+ an penalize ***/
 											   +
-													(p2i_plus_u * last_flow(i+1,j)[0])
-											   +	(p2j_plus_u * last_flow(i,j+1)[0])
-			
+													(p2i_plus_u * next_flow(i+1,j)[0])
+											   +	(p2j_plus_u * next_flow(i,j+1)[0])
+						
 											   /*** Structure tensor term ***/
 											   -	p1_u*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[1] + gradX(i,j)))
 									  /	
@@ -464,9 +486,9 @@ class OpticalFlowCLGNonlinearFunctor
 											   + 	(p2j_minus_v * flow(i,j-1)[1])
 											   /*** SUM over N+ an penalize ***/
 											   +
-													(p2i_plus_v * last_flow(i+1,j)[1])
-											   +	(p2j_plus_v * last_flow(i,j+1)[1])
-			
+													(p2i_plus_v * next_flow(i+1,j)[1])
+											   +	(p2j_plus_v * next_flow(i,j+1)[1])
+						
 											   /*** Structure tensor term ***/
 											   -	p1_v*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[0] + gradY(i,j)))
 									  /	
@@ -476,12 +498,10 @@ class OpticalFlowCLGNonlinearFunctor
 									   +	(	p1_v
 											 *	(1.0/m_alpha)*styy(i,j)));
 						
-						iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
-						mean_change+= iter_change;
-						max_change  = max(max_change, iter_change);
-					}
-				}
-				mean_change = mean_change /src1.size();
+						return vigra::norm(last_flow(i,j) - flow(i,j));
+					});
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
 				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
@@ -534,81 +554,77 @@ class OpticalFlowCLGNonlinearFunctor
 			
 			int max_iter = m_iterations;
 			double	omega = m_omega,
-					iter_change=0,
 					mean_change=0,
 					max_change=0;
 			
+			//The right and lower neighbors are taken from the last iteration (lexicographic order)
+			//or from the current one (red-black order, used for more than one thread)
+			const vigra::MultiArrayView<2, FlowValueType> next_flow = (m_execution.threads() == 1) ? vigra::MultiArrayView<2, FlowValueType>(last_flow) : flow;
+			
 			for(int iteration=0; iteration<max_iter; iteration++)
 			{
 				//save last results
 				last_flow = flow;
 				
-				mean_change=0;
-				max_change=0;
-				
-				for (int j=1;j<src1.height()-1; ++j)
-				{
-					for (int i=1;i<src1.width()-1; ++i)
+				OpticalFlowChange change = m_execution.sorSweep(src1.width(), src1.height(), [&](int i, int j) -> double
 					{
-                        if(mask(i,j) != 0)
-                        {
-                            //Some abbrev. for convenience
-                            double	p2i_minus_u = (pen(2,     flow(i-1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-                                    p2j_minus_u = (pen(2,     flow(i,j-1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-                                    p2i_plus_u  = (pen(2,last_flow(i+1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-                                    p2j_plus_u  = (pen(2,last_flow(i,j+1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
-                                    p1_u = pen(1,last_flow(i,j)[0]),
-                                
-                                    p2i_minus_v = (pen(2,     flow(i-1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-                                    p2j_minus_v = (pen(2,     flow(i,j-1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-                                    p2i_plus_v  = (pen(2,last_flow(i+1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-                                    p2j_plus_v  = (pen(2,last_flow(i,j+1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
-                                    p1_v = pen(1,last_flow(i,j)[1]);
-                            
-                            //With SOR (successive over-relaxation)
-                            flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
-                                          +	omega*(	/*** SUM over N- an penalize ***/
-                                                        (p2i_minus_u * flow(i-1,j)[0])
-                                                   + 	(p2j_minus_u * flow(i,j-1)[0])
-                                                   /*** SUM over N+ an penalize ***/
-                                                   +
-                                                        (p2i_plus_u * last_flow(i+1,j)[0])
-                                                   +	(p2j_plus_u * last_flow(i,j+1)[0])
-                
-                                                   /*** Structure tensor term ***/
-                                                   -	p1_u*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[1] + gradX(i,j)))
-                                          /	
-                                          /*** SUM over all penalizer values for normalisation **/
-                                          (		p2i_minus_u + p2j_minus_u 
-                                           +	p2i_plus_u  + p2j_plus_u
-                                           +	(	p1_u
-                                                 *	(1.0/m_alpha)*stxx(i,j)));
-                            
-                            flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
-                                          +	omega*(	/*** SUM over N- an penalize ***/
-                                                        (p2i_minus_v * flow(i-1,j)[1])
-                                                   + 	(p2j_minus_v * flow(i,j-1)[1])
-                                                   /*** SUM over N+ an penalize ***/
-                                                   +
-                                                        (p2i_plus_v * last_flow(i+1,j)[1])
-                                                   +	(p2j_plus_v * last_flow(i,j+1)[1])
-                
-                                                   /*** Structure tensor term ***/
-                                                   -	p1_v*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[0] + gradY(i,j)))
-                                          /	
-                                          /*** SUM over all penalizer values for normalisation **/
-                                          (		p2i_minus_v + p2j_minus_v 
-                                           +	p2i_plus_v + p2j_plus_v
-                                           +	(	p1_v
-                                                 *	(1.0/m_alpha)*styy(i,j)));
-                            
-                            iter_change = vigra::norm(last_flow(i,j) - flow(i,j));
-                            mean_change+= iter_change;
-                            max_change  = max(max_change, iter_change);
-                        }
-                    }
-				}
-				mean_change = mean_change /src1.size();
+						if(mask(i,j) == 0)
+							return 0.0;
+						
+						//Some abbrev. for convenience
+						double	p2i_minus_u = (pen(2,     flow(i-1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p2j_minus_u = (pen(2,     flow(i,j-1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p2i_plus_u  = (pen(2,next_flow(i+1,j)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p2j_plus_u  = (pen(2,next_flow(i,j+1)[0]) + pen(2,last_flow(i,j)[0]))/2.0,
+								p1_u = pen(1,last_flow(i,j)[0]),
+							
+								p2i_minus_v = (pen(2,     flow(i-1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p2j_minus_v = (pen(2,     flow(i,j-1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p2i_plus_v  = (pen(2,next_flow(i+1,j)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p2j_plus_v  = (pen(2,next_flow(i,j+1)[1]) + pen(2,last_flow(i,j)[1]))/2.0,
+								p1_v = pen(1,last_flow(i,j)[1]);
+						
+						//With SOR (successive over-relaxation)
+						flow(i,j)[0] = (1.0-omega)*last_flow(i,j)[0]
+									  +	omega*(	/*** SUM over N- an penalize ***/
+													(p2i_minus_u * flow(i-1,j)[0])
+											   + 	(p2j_minus_u * flow(i,j-1)[0])
+											   /*** SUM over N+ an penalize ***/
+											   +
+													(p2i_plus_u * next_flow(i+1,j)[0])
+											   +	(p2j_plus_u * next_flow(i,j+1)[0])
+						
+											   /*** Structure tensor term ***/
+											   -	p1_u*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[1] + gradX(i,j)))
+									  /	
+									  /*** SUM over all penalizer values for normalisation **/
+									  (		p2i_minus_u + p2j_minus_u 
+									   +	p2i_plus_u  + p2j_plus_u
+									   +	(	p1_u
+											 *	(1.0/m_alpha)*stxx(i,j)));
+						
+						flow(i,j)[1] = (1.0-omega)*last_flow(i,j)[1]
+									  +	omega*(	/*** SUM over N- an penalize ***/
+													(p2i_minus_v * flow(i-1,j)[1])
+											   + 	(p2j_minus_v * flow(i,j-1)[1])
+											   /*** SUM over N+ an penalize ***/
+											   +
+													(p2i_plus_v * next_flow(i+1,j)[1])
+											   +	(p2j_plus_v * next_flow(i,j+1)[1])
+						
+											   /*** Structure tensor term ***/
+											   -	p1_v*(1.0/m_alpha)*(stxy(i,j)*last_flow(i,j)[0] + gradY(i,j)))
+									  /	
+									  /*** SUM over all penalizer values for normalisation **/
+									  (		p2i_minus_v + p2j_minus_v 
+									   +	p2i_plus_v + p2j_plus_v
+									   +	(	p1_v
+											 *	(1.0/m_alpha)*styy(i,j)));
+						
+						return vigra::norm(last_flow(i,j) - flow(i,j));
+					});
+				mean_change = change.sum / src1.size();
+				max_change = change.max;
 				//qDebug() << iteration << ":\t mean change this iteration: " << mean_change << "\n";
 				//qDebug() << iteration << ":\t max change this iteration: " << max_change << "\n\n";
 				//if(mean_change < 0.001/(m_alpha*m_alpha*m_alpha) || max_change < 0.001/(m_alpha*m_alpha)) break;
@@ -637,6 +653,7 @@ class OpticalFlowCLGNonlinearFunctor
 		double  m_omega;
 		int		m_iterations;
 		int		m_level;
+		OpticalFlowExecution m_execution;
 };
 
 /**
@@ -42,9 +42,18 @@
 //OFCE Spatiotemporal Gradients
 #include "opticalflowgradients.hxx"
 
+//Parallel execution
+#include "opticalflowparallel.hxx"
+
 //Image interpolation using splines
 #include <vigra/splineimageview.hxx>
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 
 namespace graipe {
 
@@ -55,8 +64,242 @@ namespace graipe {
  * @file
  * @brief Header file for the classical local Optical Flow algorithms.
  */
- 
- 
+
+/**
+ * This class defines the tiled execution of the local Optical Flow functors.
+ * The flow vector of each pixel only depends on the image data in a small
+ * neighborhood of the pixel and of its displaced position, and on its own
+ * initial flow. Thus, the images can be split into tiles, which are extended
+ * by a halo and processed independently (and in parallel) by the untiled functor.
+ * Only the temporaries of the tiles in progress need to be kept in memory.
+ *
+ * The halo covers the support of the functor, the largest initial displacement
+ * inside the tile and an allowance for the updates of the flow of the same size
+ * as the support. As long as the flow does not move further, the results are
+ * the same as for the untiled computation. Otherwise, the update of a pixel is
+ * stopped, like it is at the image borders.
+ *
+ * The default (tile size 0) is the untiled computation of the whole image.
+ */
+class OpticalFlowLocalTiling
+{
+    public:
+        /**
+         * Constructor of the tiling settings.
+         *
+         * \param execution The execution, which defines the count of threads
+         *                  used to process the tiles.
+         * \param tile_size The width and height of the tiles (without halo).
+         *                  If zero, the whole image is processed at once.
+         */
+        OpticalFlowLocalTiling(const OpticalFlowExecution & execution = OpticalFlowExecution(), int tile_size=0)
+        :   m_execution(execution),
+            m_tile_size(std::max(0, tile_size))
+        {
+        }
+
+        /**
+         * Is the tiled computation enabled?
+         *
+         * \return True, if the images are processed in tiles.
+         */
+        bool enabled() const
+        {
+            return m_tile_size > 0;
+        }
+
+        /**
+         * The size of the tiles.
+         *
+         * \return The width and height of the tiles (without halo).
+         */
+        int tileSize() const
+        {
+            return m_tile_size;
+        }
+
+        /**
+         * Computes the flow tile by tile using an (untiled) local Optical Flow functor.
+         *
+         * \param func The untiled functor. A copy of it is applied to each tile.
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in,out] flow The initial and resulting Optical Flow field.
+         * \param support The radius of the support of the functor in pixels.
+         */
+        template <class FUNCTOR, class T1, class T2, class FlowValueType>
+        void operator()(const FUNCTOR & func,
+                        const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow,
+                        int support) const
+        {
+            processTiles(flow, support, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArray<2, FlowValueType> & tile_flow)
+            {
+                FUNCTOR tile_func(func);
+                tile_func(src1.subarray(p, q), src2.subarray(p, q), tile_flow);
+            });
+        }
+
+        /**
+         * Computes the masked flow tile by tile using an (untiled) local Optical Flow functor.
+         *
+         * \param func The untiled functor. A copy of it is applied to each tile.
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[in,out] flow The initial and resulting Optical Flow field.
+         * \param support The radius of the support of the functor in pixels.
+         */
+        template <class FUNCTOR, class T1, class T2, class T3, class FlowValueType>
+        void operator()(const FUNCTOR & func,
+                        const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow,
+                        int support) const
+        {
+            processTiles(flow, support, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArray<2, FlowValueType> & tile_flow)
+            {
+                FUNCTOR tile_func(func);
+                tile_func(src1.subarray(p, q), src2.subarray(p, q), mask.subarray(p, q), tile_flow);
+            });
+        }
+
+    private:
+        /**
+         * Splits the flow field into tiles and calls a function for each
+         * (halo-extended) tile in parallel.
+         *
+         * Each tile only reads and writes the flow inside of its own bounds.
+         * The halo of the tile's flow is set to a displacement, which leaves the
+         * tile, thus the functors skip these pixels like pixels at the image border.
+         *
+         * \param[in,out] flow The initial and resulting Optical Flow field.
+         * \param support The radius of the support of the functor in pixels.
+         * \param tile_function The function, called as tile_function(p, q, tile_flow)
+         *                      to compute the flow of the extended tile [p,q).
+         */
+        template <class FlowValueType, class TILE_FUNCTION>
+        void processTiles(vigra::MultiArrayView<2, FlowValueType> flow, int support, TILE_FUNCTION tile_function) const
+        {
+            int width = flow.width(), height = flow.height(),
+                tiles_x = (width  + m_tile_size - 1)/m_tile_size,
+                tiles_y = (height + m_tile_size - 1)/m_tile_size;
+
+            std::vector<std::string> errors(tiles_x*tiles_y);
+
+            m_execution.parallelRows(0, tiles_x*tiles_y, [&](int first_tile, int last_tile, OpticalFlowChange &)
+            {
+                //Scratch memory of this thread
+                vigra::MultiArray<2, FlowValueType> tile_flow;
+
+                for (int t=first_tile; t<last_tile; ++t)
+                {
+                    //Exceptions must not leave the pooled threads
+                    try
+                    {
+                        vigra::Shape2 begin((t%tiles_x)*m_tile_size, (t/tiles_x)*m_tile_size),
+                                      end(std::min(width,  (int)begin[0] + m_tile_size),
+                                          std::min(height, (int)begin[1] + m_tile_size));
+
+                        double max_displacement = 0;
+
+                        for (int y=begin[1]; y<end[1]; ++y)
+                        {
+                            for (int x=begin[0]; x<end[0]; ++x)
+                            {
+                                max_displacement = std::max(max_displacement,
+                                                            (double)std::max(std::abs(flow(x,y)[0]), std::abs(flow(x,y)[1])));
+                            }
+                        }
+
+                        int halo = 2*support + (int)std::ceil(max_displacement);
+
+                        vigra::Shape2 p(std::max(0, (int)begin[0] - halo), std::max(0, (int)begin[1] - halo)),
+                                      q(std::min(width, (int)end[0] + halo),  std::min(height, (int)end[1] + halo));
+
+                        FlowValueType outside(0);
+                        outside[0] = q[0]-p[0];
+                        outside[1] = q[1]-p[1];
+
+                        tile_flow.reshape(q-p, outside);
+                        tile_flow.subarray(begin-p, end-p) = flow.subarray(begin, end);
+
+                        tile_function(p, q, tile_flow);
+
+                        flow.subarray(begin, end) = tile_flow.subarray(begin-p, end-p);
+                    }
+                    catch(std::exception& e)
+                    {
+                        errors[t] = e.what();
+                    }
+                    catch(...)
+                    {
+                        errors[t] = "Non-explainable error occured";
+                    }
+                }
+            });
+
+            for (const std::string & error : errors)
+            {
+                if(!error.empty())
+                {
+                    throw std::runtime_error(error);
+                }
+            }
+        }
+
+        /** The execution of the tiles **/
+        OpticalFlowExecution m_execution;
+        /** The size of the tiles **/
+        int m_tile_size;
+};
+
+/**
+ * Runs a filter on overlapping strips of rows in parallel. Each strip is
+ * extended by the radius of the filter in y-direction, thus the filtered
+ * rows are the same as for the whole image.
+ *
+ * \param execution The execution, which defines the count of threads.
+ * \param height The height of the images.
+ * \param radius The radius of the filter's support in y-direction.
+ * \param strip_function The function, called as strip_function(p, q, first, last).
+ *                       It needs to filter the rows [p, q) and store the
+ *                       result of the rows [first, last).
+ */
+inline void opticalFlowStrips(const OpticalFlowExecution & execution, int height, int radius,
+                              const std::function<void(int, int, int, int)>& strip_function)
+{
+    std::vector<std::string> errors(height);
+
+    execution.parallelRows(0, height, [&](int first, int last, OpticalFlowChange &)
+    {
+        //Exceptions must not leave the pooled threads
+        try
+        {
+            strip_function(std::max(0, first - radius), std::min(height, last + radius), first, last);
+        }
+        catch(std::exception& e)
+        {
+            errors[first] = e.what();
+        }
+        catch(...)
+        {
+            errors[first] = "Non-explainable error occured";
+        }
+    });
+
+    for (const std::string & error : errors)
+    {
+        if(!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+    }
+}
+
+
 /**
  * Optical Flow computation according to the Lucas & Kanade approach
  * These algorithms try to solve the aperture problem by postulating
@@ -101,7 +344,8 @@ class OpticalFlowLKFunctor
 			m_mask_size(mask_size),
 			m_threshold(threshold),
 			m_iterations(iterations),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
 
@@ -116,6 +360,27 @@ class OpticalFlowLKFunctor
 			m_level=level;
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
+
+        /**
+         * Sets the tiled (and parallel) execution of this functor.
+         *
+         * \param tiling The tiling settings. The default is the untiled computation.
+         */
+		void setTiling(const OpticalFlowLocalTiling & tiling)
+		{
+			m_tiling = tiling;
+		}
+
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+		void setPrecision(int precision)
+		{
+			m_precision = precision;
+		}
  
         /**
          * Returns the full name of the functor.
@@ -137,6 +402,75 @@ class OpticalFlowLKFunctor
 			return "LK OFCE";
 		}
 		
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowLKFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowLKFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, mask, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
 		/**
          * The optical flow calculation according to Lucas & Kanade 1982
 		 * computation of optical flow.
@@ -144,11 +478,13 @@ class OpticalFlowLKFunctor
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <	class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
-						const vigra::MultiArrayView<2, T2> & src2,
-						vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
@@ -169,8 +505,9 @@ class OpticalFlowLKFunctor
 			vigra::SplineImageView<1,ValueType> gradX2_s(gradX2), gradY2_s(gradY2), gradT2_s(gradT2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
-			double last_u, last_v, gx, gy, gt, sum_w;
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			double last_u, last_v;
+			REAL gx, gy, gt, sum_w;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
 			{
@@ -203,8 +540,8 @@ class OpticalFlowLKFunctor
 						{
 							for(unsigned int mi = i-m_mask_size/2; mi<i+m_mask_size/2;	++mi)
 							{
-								gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/2.0;
-								gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/2.0;
+								gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/REAL(2);
+								gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/REAL(2);
 								gt = (gradT2_s(mi+last_u,mj+last_v)-gradT1(mi,mj));
 								
 								A(0,0) += gx*gx; // (nabla I_x)^2
@@ -251,12 +588,14 @@ class OpticalFlowLKFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask The masked area under the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
-						const vigra::MultiArrayView<2, T2> & src2,
-						const vigra::MultiArrayView<2, T3> & mask,
-						vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     const vigra::MultiArrayView<2, T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
@@ -278,8 +617,9 @@ class OpticalFlowLKFunctor
 			vigra::SplineImageView<1,ValueType> gradX2_s(gradX2), gradY2_s(gradY2), gradT2_s(gradT2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
-			double last_u, last_v, gx, gy, gt, sum_we;
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			double last_u, last_v;
+			REAL gx, gy, gt, sum_we;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
 			{
@@ -314,8 +654,8 @@ class OpticalFlowLKFunctor
                             {
                                 for(unsigned int mi = i-m_mask_size/2; mi<i+m_mask_size/2;	++mi)
                                 {
-                                    gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/2.0;
-                                    gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/2.0;
+                                    gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/REAL(2);
+                                    gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/REAL(2);
                                     gt = (gradT2_s(mi+last_u,mj+last_v)-gradT1(mi,mj));
                                     
                                     A(0,0) += gx*gx; // (nabla I_x)^2
@@ -357,12 +697,26 @@ class OpticalFlowLKFunctor
 		}
 	
 	private:
+        /**
+         * The support of this functor, which is needed for the tiled computation.
+         *
+         * \return The radius of the gradient filters and the motion neighborhood in pixels.
+         */
+		int support() const
+		{
+			return int(3.5*m_sigma + 0.5) + m_mask_size/2 + 1;
+		}
+
 		double			m_sigma;
 		unsigned int	m_mask_size;
 		double			m_threshold;
 		unsigned int	m_iterations;
 		
 		unsigned int	m_level;
+		
+		OpticalFlowLocalTiling m_tiling;
+		
+		int m_precision;
 };
 
 
@@ -396,7 +750,8 @@ class OpticalFlowSTFunctor
 			m_mask_size(mask_size),
 			m_threshold(threshold),
 			m_iterations(iterations),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
     
@@ -411,6 +766,27 @@ class OpticalFlowSTFunctor
 			m_level=level;
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
+
+        /**
+         * Sets the tiled (and parallel) execution of this functor.
+         *
+         * \param tiling The tiling settings. The default is the untiled computation.
+         */
+		void setTiling(const OpticalFlowLocalTiling & tiling)
+		{
+			m_tiling = tiling;
+		}
+
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+		void setPrecision(int precision)
+		{
+			m_precision = precision;
+		}
  
         /**
          * Returns the full name of the functor.
@@ -432,17 +808,88 @@ class OpticalFlowSTFunctor
 			return "ST OFCE";
 		}
 		
-		/**
-         * The optical flow calculation according to Structure Tensor approach.
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
          *
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
          */
-		template <class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowSTFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
                         const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
                         vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowSTFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, mask, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
+		/**
+         * The optical flow calculation according to Structure Tensor approach.
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
+         */
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
@@ -463,9 +910,10 @@ class OpticalFlowSTFunctor
 			vigra::SplineImageView<1,ValueType> gradX2_s(gradX2), gradY2_s(gradY2), gradT2_s(gradT2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Gaussian<double> gauss(m_outer_sigma);
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
-			double last_u, last_v, gx, gy, gt, we, sum_we;
+			vigra::Gaussian<REAL> gauss(m_outer_sigma);
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			double last_u, last_v;
+			REAL gx, gy, gt, we, sum_we;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
 			{
@@ -501,8 +949,8 @@ class OpticalFlowSTFunctor
 						{
 							for(unsigned int mi = i-m_mask_size/2; mi<i+m_mask_size/2;	++mi)
 							{
-								gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/2.0;
-								gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/2.0;
+								gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/REAL(2);
+								gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/REAL(2);
 								gt = (gradT2_s(mi+last_u,mj+last_v)-gradT1(mi,mj));
 								
 								we =  gauss(sqrt((mi-i)*(mi-i)+(mj-j)*(mj-j)));
@@ -550,12 +998,14 @@ class OpticalFlowSTFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask The masked area under the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
-                        const vigra::MultiArrayView<2, T2> & src2,
-                        const vigra::MultiArrayView<2, T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     const vigra::MultiArrayView<2, T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
@@ -577,9 +1027,10 @@ class OpticalFlowSTFunctor
 			vigra::SplineImageView<1,ValueType> gradX2_s(gradX2), gradY2_s(gradY2), gradT2_s(gradT2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Gaussian<double> gauss(m_outer_sigma);
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
-			double last_u, last_v, gx, gy, gt, we, sum_we;
+			vigra::Gaussian<REAL> gauss(m_outer_sigma);
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			double last_u, last_v;
+			REAL gx, gy, gt, we, sum_we;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
 			{
@@ -617,8 +1068,8 @@ class OpticalFlowSTFunctor
                             {
                                 for(unsigned int mi = i-m_mask_size/2; mi<i+m_mask_size/2;	++mi)
                                 {
-                                    gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/2.0;
-                                    gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/2.0;
+                                    gx = (gradX1(mi,mj) + gradX2_s(mi+last_u,mj+last_v))/REAL(2);
+                                    gy = (gradY1(mi,mj) + gradY2_s(mi+last_u,mj+last_v))/REAL(2);
                                     gt = (gradT2_s(mi+last_u,mj+last_v)-gradT1(mi,mj));
                                     
                                     we =  gauss(sqrt((mi-i)*(mi-i)+(mj-j)*(mj-j)));
@@ -662,6 +1113,16 @@ class OpticalFlowSTFunctor
 	
 		
 	private:
+        /**
+         * The support of this functor, which is needed for the tiled computation.
+         *
+         * \return The radius of the gradient filters and the motion neighborhood in pixels.
+         */
+		int support() const
+		{
+			return int(3.5*m_sigma + 0.5) + m_mask_size/2 + 1;
+		}
+
 		double			m_sigma;
 		double			m_outer_sigma;
 		unsigned int	m_mask_size;
@@ -669,6 +1130,10 @@ class OpticalFlowSTFunctor
 		unsigned int	m_iterations;
 		
 		unsigned int	m_level;
+		
+		OpticalFlowLocalTiling m_tiling;
+		
+		int m_precision;
 };
 
 
@@ -698,7 +1163,8 @@ class OpticalFlowCCFunctor
 		:	m_sigma(sigma),
 			m_threshold(threshold),
 			m_iterations(iterations),
-			m_level(0.0)
+			m_level(0.0),
+			m_precision(OpticalFlowPrecisionDouble)
 		{
         }
     
@@ -713,6 +1179,27 @@ class OpticalFlowCCFunctor
 			m_level=level;
 			//we assume the same m_sigma for all levels, thus nothing is done here!
 		}
+
+        /**
+         * Sets the tiled (and parallel) execution of this functor.
+         *
+         * \param tiling The tiling settings. The default is the untiled computation.
+         */
+		void setTiling(const OpticalFlowLocalTiling & tiling)
+		{
+			m_tiling = tiling;
+		}
+
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+		void setPrecision(int precision)
+		{
+			m_precision = precision;
+		}
  
         /**
          * Returns the full name of the functor.
@@ -734,17 +1221,88 @@ class OpticalFlowCCFunctor
 			return "CC OFCE";
 		}
 		
-		/**
-         * Optical flow calculation according to the constant contrast assumption.
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
          *
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
          */
-		template <class T1, class T2>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
                         const vigra::MultiArrayView<2, T2> & src2,
                         vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowCCFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
+            vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
+            vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+
+            if(m_tiling.enabled())
+            {
+                OpticalFlowCCFunctor untiled(*this);
+                untiled.setTiling(OpticalFlowLocalTiling());
+                m_tiling(untiled, src1, src2, mask, flow, support());
+                return;
+            }
+
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
+		/**
+         * Optical flow calculation according to the constant contrast assumption.
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
+         */
+		template <class REAL, class T1, class T2>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
@@ -772,7 +1330,7 @@ class OpticalFlowCCFunctor
                                                 gradXX2_s(gradXX2), gradXY2_s(gradXY2), gradYY2_s(gradYY2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
 			double last_u, last_v;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
@@ -787,9 +1345,9 @@ class OpticalFlowCCFunctor
 						if(		i+last_u >= 0 && i+last_u < src1.width()
 							&&	j+last_v >= 0 && j+last_v < src1.height())
 						{
-							A(0,0) = (gradXX1(i,j) + gradXX2_s(i+last_u,j+last_v))/2.0;
-							A(1,0) = A(0,1) = (gradXY1(i,j) + gradXY2_s(i+last_u,j+last_v))/2.0;
-							A(1,1) = (gradYY1(i,j) + gradYY2_s(i+last_u,j+last_v))/2.0;
+							A(0,0) = (gradXX1(i,j) + gradXX2_s(i+last_u,j+last_v))/REAL(2);
+							A(1,0) = A(0,1) = (gradXY1(i,j) + gradXY2_s(i+last_u,j+last_v))/REAL(2);
+							A(1,1) = (gradYY1(i,j) + gradYY2_s(i+last_u,j+last_v))/REAL(2);
 							
 							b(0,0) = - (gradX2_s(i+last_u,j+last_v) - gradX1(i, j));
 							b(1,0) = - (gradY2_s(i+last_u,j+last_v) - gradY1(i, j));
@@ -797,7 +1355,7 @@ class OpticalFlowCCFunctor
 							//solve the linear system of equations
 							if(vigra::linearSolve( 	A, b, res) )
 							{
-								double detA = determinant(A);
+								REAL detA = determinant(A);
 								//threshold vectors using the determinant
 								if(detA> m_threshold)
 								{
@@ -819,12 +1377,14 @@ class OpticalFlowCCFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask The masked area under the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-		template <class T1, class T2, class T3>
-		void operator()(const vigra::MultiArrayView<2, T1> & src1,
-						const vigra::MultiArrayView<2, T2> & src2,
-						const vigra::MultiArrayView<2, T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+		template <class REAL, class T1, class T2, class T3>
+		void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     const vigra::MultiArrayView<2, T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
 		{
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
@@ -853,7 +1413,7 @@ class OpticalFlowCCFunctor
                                          gradXX2_s(gradXX2), gradXY2_s(gradXY2), gradYY2_s(gradYY2);
 			
 			//Matrix A, vecor b and eigenvectors resp. eigenvalues
-			vigra::Matrix<double> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
+			vigra::Matrix<REAL> A(2,2), b(2,1), res(2,1), ev(2,2), ew(2,1);
 			double last_u, last_v;
 			
 			for(unsigned int it=1; it<=m_iterations; ++it)
@@ -870,9 +1430,9 @@ class OpticalFlowCCFunctor
                             if(		i+last_u >= 0 && i+last_u < src1.width()
                                 &&	j+last_v >= 0 && j+last_v < src1.height())
                             {	
-                                A(0,0) = (gradXX1(i,j) + gradXX2_s(i+last_u,j+last_v))/2.0;
-                                A(1,0) = A(0,1) = (gradXY1(i,j) + gradXY2_s(i+last_u,j+last_v))/2.0;
-                                A(1,1) = (gradYY1(i,j) + gradYY2_s(i+last_u,j+last_v))/2.0;
+                                A(0,0) = (gradXX1(i,j) + gradXX2_s(i+last_u,j+last_v))/REAL(2);
+                                A(1,0) = A(0,1) = (gradXY1(i,j) + gradXY2_s(i+last_u,j+last_v))/REAL(2);
+                                A(1,1) = (gradYY1(i,j) + gradYY2_s(i+last_u,j+last_v))/REAL(2);
                                 
                                 b(0,0) = - (gradX2_s(i+last_u,j+last_v) - gradX1(i, j));
                                 b(1,0) = - (gradY2_s(i+last_u,j+last_v) - gradY1(i, j));
@@ -880,7 +1440,7 @@ class OpticalFlowCCFunctor
                                 //solve the linear system of equations
                                 if(vigra::linearSolve( 	A, b, res) )
                                 {
-                                    double detA = determinant(A);
+                                    REAL detA = determinant(A);
                                     //threshold vectors using the determinant
                                     if(detA> m_threshold)
                                     {
@@ -897,11 +1457,25 @@ class OpticalFlowCCFunctor
 		}
 	
 	private:
+        /**
+         * The support of this functor, which is needed for the tiled computation.
+         *
+         * \return The radius of the (second order) gradient filters in pixels.
+         */
+		int support() const
+		{
+			return 2*int(3.5*m_sigma + 0.5) + 1;
+		}
+
 		double			m_sigma;
 		double			m_threshold;
 		unsigned int	m_iterations;
 	
 		unsigned int	m_level;
+		
+		OpticalFlowLocalTiling m_tiling;
+		
+		int m_precision;
 };
 
 
@@ -916,6 +1490,52 @@ class OpticalFlowFBFunctor
         /** The flow vector type. 3 elements: u,v, weight **/
         typedef vigra::TinyVector<ValueType,3> FlowValueType;
     
+        /**
+         * Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, flow);
+            }
+        }
+
+        /**
+         * Masked Optical Flow computation using the precision set by setPrecision().
+         *
+         * \param[in] src1 First image of the series.
+         * \param[in] src2 Second image of the series.
+         * \param[in] mask The masked area under the series.
+         * \param[out] flow The resulting Optical Flow field.
+         */
+        template <class T1, class T2, class T3>
+        void operator()(const vigra::MultiArrayView<2, T1> & src1,
+                        const vigra::MultiArrayView<2, T2> & src2,
+                        const vigra::MultiArrayView<2, T3> & mask,
+                        vigra::MultiArrayView<2, FlowValueType> flow)
+        {
+            if(m_precision == OpticalFlowPrecisionFloat)
+            {
+                compute<float>(src1, src2, mask, flow);
+            }
+            else
+            {
+                compute<double>(src1, src2, mask, flow);
+            }
+        }
+
         /**
          * Constructor for the Structure Tensor Optical Flow approach.
          *
@@ -930,7 +1550,8 @@ class OpticalFlowFBFunctor
             m_mask_size(mask_size),	
             m_threshold(threshold),
             m_iterations(iterations),
-            m_level(0.0)
+            m_level(0.0),
+            m_precision(OpticalFlowPrecisionDouble)
         {
         }
     
@@ -945,6 +1566,29 @@ class OpticalFlowFBFunctor
             m_level=level;
             //we assume the same m_sigma for all levels, thus nothing is done here!
         }
+    
+        /**
+         * Sets the parallel execution of this functor. Since each iteration smoothes
+         * the flow matrix, the flow of a pixel depends on a growing neighborhood. Thus,
+         * the rows of each pass are processed in parallel instead of independent tiles.
+         *
+         * \param execution The execution settings. The default is the sequential execution.
+         */
+        void setExecution(const OpticalFlowExecution & execution)
+        {
+            m_execution = execution;
+        }
+
+        /**
+         * Sets the precision of the intermediate values, see OpticalFlowPrecisionMode.
+         * Defaults to double precision.
+         *
+         * \param precision The precision mode.
+         */
+        void setPrecision(int precision)
+        {
+            m_precision = precision;
+        }
  
         /**
          * Returns the full name of the functor.
@@ -972,11 +1616,13 @@ class OpticalFlowFBFunctor
          * \param[in] src1 First image of the series.
          * \param[in] src2 Second image of the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-        template <class T1, class T2>
-        void operator()(const vigra::MultiArrayView<2, T1> & src1,
-                        const vigra::MultiArrayView<2, T2> & src2,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+        template <class REAL, class T1, class T2>
+        void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == flow.shape(), "flow array sizes differ from image sizes!");
@@ -985,78 +1631,97 @@ class OpticalFlowFBFunctor
             vigra::MultiArray<2, vigra::TinyVector<float,5> > R0(src1.shape()), R1(src1.shape()), M(src1.shape());
             
             //2. Do polynomial expansion for both images
-            polynomialExpansion(src1, R0, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
-            polynomialExpansion(src2, R1, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            filterRows(src1.shape(), R0, m_mask_size/2, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+            {
+                polynomialExpansion(src1.subarray(p, q), dest, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            });
+            filterRows(src1.shape(), R1, m_mask_size/2, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+            {
+                polynomialExpansion(src2.subarray(p, q), dest, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            });
             
             //Create an iterpolated view on the second polynomial exp.
             vigra::SplineImageView<1, vigra::TinyVector<float,5> > R1_s(R1);
             
+            //The parallel smoothing cannot be done in-place
+            vigra::MultiArray<2, vigra::TinyVector<float,5> > M_smooth(m_execution.threads() == 1 ? vigra::Shape2(0,0) : src1.shape());
+            vigra::MultiArrayView<2, vigra::TinyVector<float,5> > Ms(m_execution.threads() == 1 ? M : M_smooth);
+            
             for(unsigned int i=1; i<=m_iterations; ++i)
             {
                 //A: Compute the current flow matrix M - according to both poly exps and the current flow
-                for(unsigned int y = 0; y < src1.height(); y++ )
+                m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange &)
                 {
-                    for(unsigned int x = 0; x < src1.width(); x++ )
+                    for(int y = first_row; y < last_row; y++ )
                     {
-                        float dx = flow(x,y)[0], dy = flow(x,y)[1];
-                        float fx = x + dx, fy = y + dy;
+                        for(unsigned int x = 0; x < src1.width(); x++ )
+                        {
+                            float dx = flow(x,y)[0], dy = flow(x,y)[1];
+                            float fx = x + dx, fy = y + dy;
                         
-                        float r2, r3, r4, r5, r6;
+                            float r2, r3, r4, r5, r6;
                         
-                        if( fx >=0 && fx < src1.width() && fy >=0 && fy < src1.height())
-                        {
-                            r2 = R1_s(fx,fy)[0];
-                            r3 = R1_s(fx,fy)[1];
-                            r4 = (R0(x,y)[2] + R1_s(fx,fy)[2])*0.5f;
-                            r5 = (R0(x,y)[3] + R1_s(fx,fy)[3])*0.5f;
-                            r6 = (R0(x,y)[4] + R1_s(fx,fy)[4])*0.25f;
-                        }
-                        else
-                        {
-                            r2 = r3 = 0.f;
-                            r4 = R0(x,y)[2];
-                            r5 = R0(x,y)[3];
-                            r6 = R0(x,y)[4]*0.5f;
-                        }
+                            if( fx >=0 && fx < src1.width() && fy >=0 && fy < src1.height())
+                            {
+                                r2 = R1_s(fx,fy)[0];
+                                r3 = R1_s(fx,fy)[1];
+                                r4 = (R0(x,y)[2] + R1_s(fx,fy)[2])*0.5f;
+                                r5 = (R0(x,y)[3] + R1_s(fx,fy)[3])*0.5f;
+                                r6 = (R0(x,y)[4] + R1_s(fx,fy)[4])*0.25f;
+                            }
+                            else
+                            {
+                                r2 = r3 = 0.f;
+                                r4 = R0(x,y)[2];
+                                r5 = R0(x,y)[3];
+                                r6 = R0(x,y)[4]*0.5f;
+                            }
                         
-                        r2 = (r2 - R0(x,y)[0])*0.5f;
-                        r3 = (r3 - R0(x,y)[1])*0.5f;
+                            r2 = (r2 - R0(x,y)[0])*0.5f;
+                            r3 = (r3 - R0(x,y)[1])*0.5f;
                         
-                        r2 += r4*dy + r6*dx;
-                        r3 += r6*dy + r5*dx;
+                            r2 += r4*dy + r6*dx;
+                            r3 += r6*dy + r5*dx;
                         
-                        M(x,y)[0] = r4*r4 + r6*r6; // G(1,1)
-                        M(x,y)[1] = (r4 + r5) *r6; // G(1,2)=G(2,1)
-                        M(x,y)[2] = r5*r5 + r6*r6; // G(2,2)
-                        M(x,y)[3] = r4*r2 + r6*r3; // h(1)
-                        M(x,y)[4] = r6*r2 + r5*r3; // h(2)
+                            M(x,y)[0] = r4*r4 + r6*r6; // G(1,1)
+                            M(x,y)[1] = (r4 + r5) *r6; // G(1,2)=G(2,1)
+                            M(x,y)[2] = r5*r5 + r6*r6; // G(2,2)
+                            M(x,y)[3] = r4*r2 + r6*r3; // h(1)
+                            M(x,y)[4] = r6*r2 + r5*r3; // h(2)
+                        }
                     }
-                }
+                }, src1.width());
                 
                 //B: Update the flow Matrix by smoothing and compute the flow
                 //gaussian Smooth Matrix:
-                vigra::gaussianSmoothing(M, M, m_sigma);
+                filterRows(src1.shape(), Ms, int(3.0*m_sigma + 0.5) + 1, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+                {
+                    vigra::gaussianSmoothing(M.subarray(p, q), dest, m_sigma);
+                });
                 
-                for(unsigned int y = 0; y < src1.height(); y++ )
+                m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange &)
                 {
-                    for(unsigned int x = 0; x < src1.width(); x++ )
+                    for(int y = first_row; y < last_row; y++ )
                     {
-                        double g11_ = M(x,y)[0];
-                        double g12_ = M(x,y)[1];
-                        double g22_ = M(x,y)[2];
-                        double h1_  = M(x,y)[3];
-                        double h2_  = M(x,y)[4];
+                        for(unsigned int x = 0; x < src1.width(); x++ )
+                        {
+                            REAL g11_ = Ms(x,y)[0];
+                            REAL g12_ = Ms(x,y)[1];
+                            REAL g22_ = Ms(x,y)[2];
+                            REAL h1_  = Ms(x,y)[3];
+                            REAL h2_  = Ms(x,y)[4];
                         
-                        double det = (g11_*g22_ - g12_*g12_);
+                            REAL det = (g11_*g22_ - g12_*g12_);
                         
-                        if(det != 0 && det >= m_threshold)
-                        {
-                            flow(x,y)[0] = float(g11_*h2_-g12_*h1_)/det;
-                            flow(x,y)[1] = float(g22_*h1_-g12_*h2_)/det;
-                            flow(x,y)[2] = det;
+                            if(det != 0 && det >= m_threshold)
+                            {
+                                flow(x,y)[0] = float(g11_*h2_-g12_*h1_)/det;
+                                flow(x,y)[1] = float(g22_*h1_-g12_*h2_)/det;
+                                flow(x,y)[2] = det;
+                            }
                         }
                     }
-                }
+                }, src1.width());
             }		
         }
     
@@ -1067,12 +1732,14 @@ class OpticalFlowFBFunctor
          * \param[in] src2 Second image of the series.
          * \param[in] mask The masked area under the series.
          * \param[out] flow The resulting Optical Flow field.
+         *
+         * The template parameter REAL defines the precision of the intermediate values.
          */
-        template <class T1, class T2, class T3>
-        void operator()(const vigra::MultiArrayView<2, T1> & src1,
-                        const vigra::MultiArrayView<2, T2> & src2,
-                        const vigra::MultiArrayView<2, T3> & mask,
-                        vigra::MultiArrayView<2, FlowValueType> flow)
+        template <class REAL, class T1, class T2, class T3>
+        void compute(const vigra::MultiArrayView<2, T1> & src1,
+                     const vigra::MultiArrayView<2, T2> & src2,
+                     const vigra::MultiArrayView<2, T3> & mask,
+                     vigra::MultiArrayView<2, FlowValueType> flow)
         {
             vigra_precondition(src1.shape() == src2.shape(), "image sizes differ!");
             vigra_precondition(src1.shape() == mask.shape(), "image and mask sizes differ!");
@@ -1082,87 +1749,136 @@ class OpticalFlowFBFunctor
             vigra::MultiArray<2, vigra::TinyVector<float,5> > R0(src1.shape()), R1(src1.shape()), M(src1.shape());
             
             //2. Do polynomial expansion for both images
-            polynomialExpansionWithMask(src1, mask, R0, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
-            polynomialExpansionWithMask(src2, mask, R1, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            filterRows(src1.shape(), R0, m_mask_size/2, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+            {
+                polynomialExpansionWithMask(src1.subarray(p, q), mask.subarray(p, q), dest, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            });
+            filterRows(src1.shape(), R1, m_mask_size/2, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+            {
+                polynomialExpansionWithMask(src2.subarray(p, q), mask.subarray(p, q), dest, /*poly_n*/ m_mask_size/2, /*poly_sigma*/ m_sigma);
+            });
             
             //Create an iterpolated view on the second polynomial exp.
             vigra::SplineImageView<1, vigra::TinyVector<float,5> > R1_s(R1);
             
+            //The parallel smoothing cannot be done in-place
+            vigra::MultiArray<2, vigra::TinyVector<float,5> > M_smooth(m_execution.threads() == 1 ? vigra::Shape2(0,0) : src1.shape());
+            vigra::MultiArrayView<2, vigra::TinyVector<float,5> > Ms(m_execution.threads() == 1 ? M : M_smooth);
+            
             for(unsigned int i=1; i<=m_iterations; ++i)
             {
                 //A: Compute the current flow matrix M - according to both poly exps and the current flow
-                for(unsigned int y = 0; y < src1.height(); y++ )
+                m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange &)
                 {
-                    for(unsigned int x = 0; x < src1.width(); x++ )
+                    for(int y = first_row; y < last_row; y++ )
                     {
-                        if (mask(x,y) != 0)
+                        for(unsigned int x = 0; x < src1.width(); x++ )
                         {
-                            float dx = flow(x,y)[0], dy = flow(x,y)[1];
-                            float fx = x + dx, fy = y + dy;
+                            if (mask(x,y) != 0)
+                            {
+                                float dx = flow(x,y)[0], dy = flow(x,y)[1];
+                                float fx = x + dx, fy = y + dy;
                             
-                            float r2, r3, r4, r5, r6;
+                                float r2, r3, r4, r5, r6;
                             
-                            if( fx >=0 && fx < src1.width() && fy >=0 && fy < src1.height())
-                            {
-                                r2 = R1_s(fx,fy)[0];
-                                r3 = R1_s(fx,fy)[1];
-                                r4 = (R0(x,y)[2] + R1_s(fx,fy)[2])*0.5f;
-                                r5 = (R0(x,y)[3] + R1_s(fx,fy)[3])*0.5f;
-                                r6 = (R0(x,y)[4] + R1_s(fx,fy)[4])*0.25f;
-                            }
-                            else
-                            {
-                                r2 = r3 = 0.f;
-                                r4 = R0(x,y)[2];
-                                r5 = R0(x,y)[3];
-                                r6 = R0(x,y)[4]*0.5f;
-                            }
+                                if( fx >=0 && fx < src1.width() && fy >=0 && fy < src1.height())
+                                {
+                                    r2 = R1_s(fx,fy)[0];
+                                    r3 = R1_s(fx,fy)[1];
+                                    r4 = (R0(x,y)[2] + R1_s(fx,fy)[2])*0.5f;
+                                    r5 = (R0(x,y)[3] + R1_s(fx,fy)[3])*0.5f;
+                                    r6 = (R0(x,y)[4] + R1_s(fx,fy)[4])*0.25f;
+                                }
+                                else
+                                {
+                                    r2 = r3 = 0.f;
+                                    r4 = R0(x,y)[2];
+                                    r5 = R0(x,y)[3];
+                                    r6 = R0(x,y)[4]*0.5f;
+                                }
                             
-                            r2 = (r2 - R0(x,y)[0])*0.5f;
-                            r3 = (r3 - R0(x,y)[1])*0.5f;
+                                r2 = (r2 - R0(x,y)[0])*0.5f;
+                                r3 = (r3 - R0(x,y)[1])*0.5f;
                             
-                            r2 += r4*dy + r6*dx;
-                            r3 += r6*dy + r5*dx;
+                                r2 += r4*dy + r6*dx;
+                                r3 += r6*dy + r5*dx;
                             
-                            M(x,y)[0] = r4*r4 + r6*r6; // G(1,1)
-                            M(x,y)[1] = (r4 + r5) *r6; // G(1,2)=G(2,1)
-                            M(x,y)[2] = r5*r5 + r6*r6; // G(2,2)
-                            M(x,y)[3] = r4*r2 + r6*r3; // h(1)
-                            M(x,y)[4] = r6*r2 + r5*r3; // h(2)
+                                M(x,y)[0] = r4*r4 + r6*r6; // G(1,1)
+                                M(x,y)[1] = (r4 + r5) *r6; // G(1,2)=G(2,1)
+                                M(x,y)[2] = r5*r5 + r6*r6; // G(2,2)
+                                M(x,y)[3] = r4*r2 + r6*r3; // h(1)
+                                M(x,y)[4] = r6*r2 + r5*r3; // h(2)
+                            }
                         }
                     }
-                }
+                }, src1.width());
                 
                 //B: Update the flow Matrix by smoothing and compute the flow
                 //gaussian Smooth Matrix:
-                gaussianSmoothingWithMask(M, mask, M, m_sigma);
+                filterRows(src1.shape(), Ms, int(3.0*m_sigma + 0.5) + 1, [&](const vigra::Shape2 & p, const vigra::Shape2 & q, vigra::MultiArrayView<2, vigra::TinyVector<float,5> > dest)
+                {
+                    gaussianSmoothingWithMask(M.subarray(p, q), mask.subarray(p, q), dest, m_sigma);
+                });
                 
-                for(unsigned int y = 0; y < src1.height(); y++ )
+                m_execution.parallelRows(0, src1.height(), [&](int first_row, int last_row, OpticalFlowChange &)
                 {
-                    for(unsigned int x = 0; x < src1.width(); x++ )
+                    for(int y = first_row; y < last_row; y++ )
                     {
-                        if(mask(x,y) != 0)
+                        for(unsigned int x = 0; x < src1.width(); x++ )
                         {
-                            double g11_ = M(x,y)[0];
-                            double g12_ = M(x,y)[1];
-                            double g22_ = M(x,y)[2];
-                            double h1_  = M(x,y)[3];
-                            double h2_  = M(x,y)[4];
-                        
-                            double det = (g11_*g22_ - g12_*g12_);
-                            if(det != 0 && det >= m_threshold)
+                            if(mask(x,y) != 0)
                             {
-                                flow(x,y)[0] = float(g11_*h2_-g12_*h1_)/det;
-                                flow(x,y)[1] = float(g22_*h1_-g12_*h2_)/det;
-                                flow(x,y)[2] = det;
+                                REAL g11_ = Ms(x,y)[0];
+                                REAL g12_ = Ms(x,y)[1];
+                                REAL g22_ = Ms(x,y)[2];
+                                REAL h1_  = Ms(x,y)[3];
+                                REAL h2_  = Ms(x,y)[4];
+                        
+                                REAL det = (g11_*g22_ - g12_*g12_);
+                                if(det != 0 && det >= m_threshold)
+                                {
+                                    flow(x,y)[0] = float(g11_*h2_-g12_*h1_)/det;
+                                    flow(x,y)[1] = float(g22_*h1_-g12_*h2_)/det;
+                                    flow(x,y)[2] = det;
+                                }
                             }
                         }
                     }
-                }
+                }, src1.width());
             }		
         }
         
     protected:
+        /**
+         * Applies a filter to the whole image or, if more than one thread is used,
+         * to overlapping strips of rows in parallel (see opticalFlowStrips()).
+         *
+         * \param shape The shape of the images.
+         * \param[out] dest The filtered image.
+         * \param radius The radius of the filter's support in y-direction.
+         * \param filter The filter, called as filter(p, q, strip_dest). It needs to
+         *               filter the region [p, q) of the images into strip_dest.
+         */
+        template <class T, class FILTER>
+        void filterRows(const vigra::Shape2 & shape, vigra::MultiArrayView<2, T> dest, int radius, FILTER filter) const
+        {
+            if(m_execution.threads() == 1)
+            {
+                filter(vigra::Shape2(0,0), shape, dest);
+                return;
+            }
+            
+            opticalFlowStrips(m_execution, shape[1], radius, [&](int p, int q, int first, int last)
+            {
+                vigra::MultiArray<2, T> strip(vigra::Shape2(shape[0], q-p));
+                
+                filter(vigra::Shape2(0,p), vigra::Shape2(shape[0],q), strip);
+                
+                dest.subarray(vigra::Shape2(0,first),   vigra::Shape2(shape[0],last)) 
+                    = strip.subarray(vigra::Shape2(0,first-p), vigra::Shape2(shape[0],last-p));
+            });
+        }
+        
         /**
          * Computes the Polynomial Expansion according to Farnebaeck.
          * Takes a single band image as input and computes a dest image, where each pixel is assigned to 
@@ -1393,6 +2109,10 @@ class OpticalFlowFBFunctor
         unsigned int	m_iterations;
         
         unsigned int	m_level;
+        
+        OpticalFlowExecution m_execution;
+        
+        int m_precision;
 };
 
 /**
@@ -36,6 +36,10 @@
 #ifndef GRAIPE_OPTICALFLOW_OPTICALFLOWALGORITHMS_HXX
 #define GRAIPE_OPTICALFLOW_OPTICALFLOWALGORITHMS_HXX
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
 #include "images/images.h"
 #include "vectorfields/vectorfields.h"
 #include "registration/registration.h"
@@ -43,6 +47,7 @@
 #include "opticalflow_local.hxx"
 #include "opticalflow_global.hxx"
 #include "opticalflow_hybrid.hxx"
+#include "opticalflowframework.hxx"
 
 //Experimental algorithms are not working right now.
 //TODO: If possible, fix them. If not, discard them.
@@ -75,6 +80,54 @@ QStringList hierarchical_modes()
 
 	return hierarchical_modes;
 }
+/**
+ * The solver backends of the Horn & Schunck-like Optical Flow algorithms.
+ * The order corresponds to graipe::OpticalFlowSolverType.
+ *
+ * \return A QStringList containing the available solvers.
+ */
+QStringList solver_modes()
+{
+	QStringList solver_modes;
+	solver_modes.append("Jacobi \tClassical iterations");
+	solver_modes.append("Red-black SOR \tSuccessive over-relaxation");
+	solver_modes.append("Multigrid \tV-cycles with red-black Gauss-Seidel smoothing");
+
+	return solver_modes;
+}
+
+/**
+ * The instruction sets of the inner loops of the global Optical Flow algorithms.
+ * The order corresponds to graipe::OpticalFlowSIMDMode.
+ *
+ * \return A QStringList containing the available instruction sets.
+ */
+QStringList simd_modes()
+{
+	QStringList simd_modes;
+	simd_modes.append("Auto \tBest available instruction set");
+	simd_modes.append("Scalar \tNo vectorization");
+	simd_modes.append("SSE2 \t4 pixels at once (single precision)");
+	simd_modes.append("AVX2 \t8 pixels at once (single precision)");
+
+	return simd_modes;
+}
+
+/**
+ * The precisions of the intermediate values of the Optical Flow algorithms.
+ * The order corresponds to graipe::OpticalFlowPrecisionMode.
+ *
+ * \return A QStringList containing the available precisions.
+ */
+QStringList precision_modes()
+{
+	QStringList precision_modes;
+	precision_modes.append("Double \tOriginal precision");
+	precision_modes.append("Float \tSingle precision intermediates");
+
+	return precision_modes;
+}
+
 /**
  * When hierarchical traversal strategies on the scale space are used, we need to
  * define the flow-progration strategy from one layer/octave to the next.
@@ -99,6 +152,23 @@ QStringList propagation_modes()
 	return propagation_modes;
 }
 
+/**
+ * If the flow is propagated by warping, the images may either be warped by a thin
+ * plate spline registration of the subsampled flow, or densely by the flow itself.
+ * The order of the dense modes corresponds to graipe::OpticalFlowWarpInterpolation.
+ *
+ * \return A QStringList containing the available warping modes.
+ */
+QStringList warping_modes()
+{
+	QStringList warping_modes;
+	warping_modes.append("Thin plate splines \tFirst image, subsampled by the propagation strategy");
+	warping_modes.append("Dense bilinear \tSecond image, backwards by each flow vector");
+	warping_modes.append("Dense bicubic \tSecond image, backwards by each flow vector");
+
+	return warping_modes;
+}
+
 /**
  * This class defines the most general common part of all Optical Flow estimation 
  * algorithms by means of a specialization of graipe::Algorithm
@@ -111,9 +181,20 @@ class OpticalFlowAlgorithm
          * The default constructor. Does not introduce the commonly used parameters, since
          * we want to have control over ther orderung of them. See the following two member 
          * functions for further details.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series instead of
+         *              an image pair.
          */
-        OpticalFlowAlgorithm(Workspace* wsp)
-        : Algorithm(wsp)
+        OpticalFlowAlgorithm(Workspace* wsp, bool batch=false)
+        : Algorithm(wsp),
+          m_batch(batch),
+          m_param_imageBand1(NULL),
+          m_param_imageBand2(NULL),
+          m_param_images(NULL),
+          m_param_band(NULL),
+          m_param_pairThreads(NULL),
+          m_param_seriesWarmStart(NULL)
         {
         }
     
@@ -133,14 +214,27 @@ class OpticalFlowAlgorithm
          */
         virtual void addImageAndMaskParameters()
         {
-            m_param_imageBand1		= new ImageBandParameter<float>("Reference Image", NULL, false, m_workspace);
-            m_param_imageBand2		= new ImageBandParameter<float>("Second Image",	NULL, false, m_workspace);
-            
             m_param_useMask			= new BoolParameter("use image band for masking flow");
             m_param_mask			= new ImageBandParameter<float>("Mask Image", m_param_useMask, false, m_workspace);
             
-            m_parameters->addParameter("band1", m_param_imageBand1 );
-            m_parameters->addParameter("band2", m_param_imageBand2 );
+            if(m_batch)
+            {
+                m_param_images		= new MultiModelParameter("Image series (ordered by timestamp)", "Image", NULL, false, m_workspace);
+                m_param_band		= new IntParameter("Band of each image", 0, 1000, 0);
+                m_param_pairThreads	= new IntParameter("Concurrent image pairs (0 = all cores)", 0, 256, 0);
+                
+                m_parameters->addParameter("images", m_param_images );
+                m_parameters->addParameter("band", m_param_band );
+                m_parameters->addParameter("pair_threads", m_param_pairThreads );
+            }
+            else
+            {
+                m_param_imageBand1	= new ImageBandParameter<float>("Reference Image", NULL, false, m_workspace);
+                m_param_imageBand2	= new ImageBandParameter<float>("Second Image",	NULL, false, m_workspace);
+                
+                m_parameters->addParameter("band1", m_param_imageBand1 );
+                m_parameters->addParameter("band2", m_param_imageBand2 );
+            }
             
             
             m_parameters->addParameter("use_mask?", m_param_useMask );
@@ -159,6 +253,7 @@ class OpticalFlowAlgorithm
             m_param_highestLevel	= new IntParameter("highest pyramid level", 0, 10, 3, m_param_useHierarchy);
             m_param_hmode			= new EnumParameter("scale processing", hierarchical_modes(), 0, m_param_useHierarchy);
             m_param_pmode			= new EnumParameter("propagation strategy", propagation_modes(), 0, m_param_useHierarchy);
+            m_param_warpMode		= new EnumParameter("warping method (if the propagation strategy warps)", warping_modes(), 0, m_param_useHierarchy);
             m_param_warp_sigma  	= new FloatParameter("apply gaussian smoothing before each warping using sigma: (0.0 = none)", 0.0, 50.0, 1.0, m_param_useHierarchy);
             
             
@@ -171,139 +266,339 @@ class OpticalFlowAlgorithm
             m_parameters->addParameter("hiL", m_param_highestLevel );
             m_parameters->addParameter("hmode", m_param_hmode );
             m_parameters->addParameter("pmode", m_param_pmode );
+            m_parameters->addParameter("warp_mode", m_param_warpMode );
             m_parameters->addParameter("warp_sigma", m_param_warp_sigma );
             m_parameters->addParameter("save-intermI", m_param_saveIntermediateImages );
             m_parameters->addParameter("save-intermVF", m_param_saveIntermediateFlow );
-        }	
-        
+            
+            m_param_initialFlow     = new MultiModelParameter("Initial flow field (e.g. of the previous image pair, none: zero flow)", "DenseVectorfield2D|DenseWeightedVectorfield2D", NULL, false, m_workspace);
+            m_param_predictFlow     = new BoolParameter("predict initial flow by advection along itself");
+            m_param_initialLevel    = new IntParameter("highest pyramid level if initialized", 0, 10, 1, m_param_useHierarchy);
+            
+            m_parameters->addParameter("initial_flow", m_param_initialFlow );
+            m_parameters->addParameter("predict_flow?", m_param_predictFlow );
+            m_parameters->addParameter("initL", m_param_initialLevel );
+            
+            if(m_batch)
+            {
+                m_param_seriesWarmStart = new BoolParameter("initialize each pair by the flow of the previous pair (sequential)");
+                m_parameters->addParameter("series_warm_start?", m_param_seriesWarmStart );
+            }
+        }
+    
         /**
-         * This templated (by the flow functor) function defines the prototype for all
-         * flow processor calls according to the chosen parameters.
+         * Provides the selected initial flow field for a warm start.
          *
-         * \param func The Optical Flow Functor, which will carry out each step's 
-         *             flow estimation.
+         * \param[out] flow The (u,v) components of the first selected flow field.
+         * \return True, if an initial flow field has been selected.
          */
-        template<class OpticalFlowFunctor>
-        void computeFlow(OpticalFlowFunctor func)
+        template<class FlowValueType>
+        bool initialFlow(vigra::MultiArray<2,FlowValueType> & flow)
         {
-            typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+            std::vector<Model*> models = m_param_initialFlow->value();
             
-            vigra_assert(FlowValueType().size() > 1, "flow functor needs to return a vectorfield of at least (u,v) components");
+            if(models.empty())
+            {
+                return false;
+            }
             
+            const DenseVectorfield2D* vf = static_cast<const DenseVectorfield2D*>(models[0]);
             
-            vigra::MultiArrayView<2,float> imageband1 = m_param_imageBand1->value();
-            vigra::MultiArrayView<2,float> imageband2 = m_param_imageBand2->value();
+            flow.reshape(vf->u().shape());
+            flow.bindElementChannel(0) = vf->u();
+            flow.bindElementChannel(1) = vf->v();
+            
+            return true;
+        }	
+        
+        /**
+         * Provides the Gaussian pyramid of one image band for the hierarchical methods.
+         * Pyramids of unchanged image bands are shared by means of the workspace's
+         * graipe::ImagePyramidCache, so that subsequent runs on the same bands do not
+         * need to repeat the reductions.
+         *
+         * \param image The image, which contains the band.
+         * \param band_id The index of the band in the image.
+         * \param band The band itself.
+         * \param highest_level The highest (smallest) level of the pyramid.
+         * \return The shared pyramid of the band.
+         */
+        ImagePyramidCache::PyramidPointer cachedImagePyramid(const Image<float>* image, unsigned int band_id, const vigra::MultiArrayView<2,float> & band,
+                                                             unsigned int highest_level)
+        {
+            return ImagePyramidCache::cache(m_workspace)->pyramid(image, band_id, band, highest_level);
+        }
+    
+        /**
+         * Provides the Gaussian pyramids of both image bands and (if used) the mask band
+         * for the hierarchical methods. Missing pyramids are built in parallel.
+         * Unused pyramids are empty.
+         *
+         * \param[in] highest_level The highest (smallest) level of the pyramids.
+         * \param[out] pyramids The pyramids of the first, second and mask band.
+         */
+        void imagePyramids(unsigned int highest_level, std::vector<ImagePyramidCache::PyramidPointer> & pyramids)
+        {
+            std::vector<ImageBandParameter<float> *> bands;
+            bands.push_back(m_param_imageBand1);
+            bands.push_back(m_param_imageBand2);
             
-            //Mask
-            vigra::MultiArrayView<2,float> mask = m_param_mask->value();
             if(m_param_useMask->value())
-                vigra_assert( mask.size() == imageband1.size(), "mask and image sizes differ!");
+            {
+                bands.push_back(m_param_mask);
+            }
+            
+            pyramids.assign(3, std::make_shared<const ImagePyramid<float> >());
             
+            OpticalFlowExecution((int)bands.size()).parallelRows(0, (int)bands.size(), [&](int first, int last, OpticalFlowChange &)
+            {
+                for (int i=first; i<last; ++i)
+                {
+                    pyramids[i] = cachedImagePyramid(bands[i]->image(), bands[i]->bandId(), bands[i]->value(), highest_level);
+                }
+            });
+        }
+    
+        /**
+         * The results of one flow estimation by means of the framework: The flow fields,
+         * global motion matrices and correlations of each level (finest level first) and 
+         * the (first or second) warped images of the warping-based hierarchical methods.
+         */
+        template<class FlowValueType>
+        struct FlowResult
+        {
             std::vector<vigra::MultiArray<2,float> > img_list;
+            std::vector<vigra::MultiArray<2,float> > img2_list;
             std::vector<vigra::MultiArray<2,FlowValueType> > flow_list;
             std::vector<vigra::Matrix<double> > mat_list;
             std::vector<double> rotation_correlation_list;
             std::vector<double> translation_correlation_list;
+        };
+    
+        /**
+         * Estimates the flow between two image bands according to the chosen framework
+         * parameters. The pyramids are only used by the hierarchical methods and have to
+         * reach (at least) the level given by graipe::hierarchicalSteps in this case.
+         *
+         * \param func The Optical Flow Functor, which will carry out each step's 
+         *             flow estimation.
+         * \param imageband1 The first image band.
+         * \param imageband2 The second image band.
+         * \param mask The mask band (only used if masking is enabled).
+         * \param pyramid1 The pyramid of the first image band.
+         * \param pyramid2 The pyramid of the second image band.
+         * \param mask_pyramid The pyramid of the mask band (only used if masking is enabled).
+         * \param initial_flow If not NULL, the flow is initialised by this flow field. In the
+         *                     hierarchical case, the highest level is then lowered.
+         * \param gme The global motion estimator, which keeps its plans for further calls.
+         * \param[out] result The flow fields and global motions of all levels.
+         */
+        template<class OpticalFlowFunctor>
+        void estimateFlow(OpticalFlowFunctor func,
+                          const vigra::MultiArrayView<2,float> & imageband1,
+                          const vigra::MultiArrayView<2,float> & imageband2,
+                          const vigra::MultiArrayView<2,float> & mask,
+                          const ImagePyramid<float> & pyramid1,
+                          const ImagePyramid<float> & pyramid2,
+                          const ImagePyramid<float> & mask_pyramid,
+                          const vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> * initial_flow,
+                          GlobalMotionEstimator & gme,
+                          FlowResult<typename OpticalFlowFunctor::FlowValueType> & result)
+        {
+            typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+            
+            if(m_param_useMask->value())
+                vigra_assert( mask.size() == imageband1.size(), "mask and image sizes differ!");
             
-            flow_list.push_back(vigra::MultiArray<2,FlowValueType>(imageband1.shape()));
-            mat_list.push_back(vigra::Matrix<double>(3,3));
-            rotation_correlation_list.push_back(0);
-            translation_correlation_list.push_back(0);
+            result.flow_list.push_back(vigra::MultiArray<2,FlowValueType>(imageband1.shape()));
+            result.mat_list.push_back(vigra::Matrix<double>(3,3));
+            result.rotation_correlation_list.push_back(0);
+            result.translation_correlation_list.push_back(0);
             
             if ( !m_param_useHierarchy->value())
             {
+                if(initial_flow != NULL)
+                {
+                    initialiseFlow(initial_flow->bindElementChannel(0), initial_flow->bindElementChannel(1),
+                                   result.flow_list[0], m_param_predictFlow->value());
+                }
+                
                 if (m_param_useMask->value()) 
                 {
                     calculateOFCE(imageband1,
                                   imageband2,
                                   mask,
-                                  flow_list[0],
+                                  result.flow_list[0],
                                   func,
                                   m_param_useGME->value(),
-                                  mat_list[0],
-                                  rotation_correlation_list[0],
-                                  translation_correlation_list[0]);
+                                  result.mat_list[0],
+                                  result.rotation_correlation_list[0],
+                                  result.translation_correlation_list[0],
+                                  &gme);
                 }
                 else
                 {
                     calculateOFCE(imageband1,
                                   imageband2,
-                                  flow_list[0],
+                                  result.flow_list[0],
                                   func,
                                   m_param_useGME->value(),
-                                  mat_list[0],
-                                  rotation_correlation_list[0],
-                                  translation_correlation_list[0]);
+                                  result.mat_list[0],
+                                  result.rotation_correlation_list[0],
+                                  result.translation_correlation_list[0],
+                                  &gme);
                 }
             }
             
-            else if(m_param_pmode->value() == 0)
+            else
             {
+                unsigned int steps = hierarchicalSteps(imageband1.shape(), m_param_highestLevel->value());
                 
-                if (m_param_useMask->value()) 
+                if(initial_flow != NULL)
                 {
-                    calculateOFCEHierarchicallyInitialiser(imageband1,
-                                                           imageband2,
-                                                           mask,
-                                                           flow_list,
-                                                           func,
-                                                           m_param_useGME->value(),
-                                                           mat_list,
-                                                           rotation_correlation_list,
-                                                           translation_correlation_list,
-                                                           m_param_highestLevel->value(), m_param_lowestLevel->value(),
-                                                           m_param_hmode->value());
+                    //A good initial flow makes the coarse levels dispensable
+                    steps = std::min(steps, (unsigned int)std::max(m_param_initialLevel->value(), m_param_lowestLevel->value()));
+                    
+                    for (unsigned int level=1; level<=steps; ++level)
+                    {
+                        result.flow_list.push_back(vigra::MultiArray<2,FlowValueType>(pyramid1[level].shape()));
+                    }
+                    initialiseFlow(initial_flow->bindElementChannel(0), initial_flow->bindElementChannel(1),
+                                   result.flow_list[steps], m_param_predictFlow->value());
                 }
-                else
+                
+                if(m_param_pmode->value() == 0)
                 {
-                    calculateOFCEHierarchicallyInitialiser(imageband1,
-                                                           imageband2,
-                                                           flow_list,
-                                                           func,
-                                                           m_param_useGME->value(),
-                                                           mat_list,
-                                                           rotation_correlation_list,
-                                                           translation_correlation_list,
-                                                           m_param_highestLevel->value(), m_param_lowestLevel->value(),
-                                                           m_param_hmode->value());
+                    if (m_param_useMask->value()) 
+                    {
+                        calculateOFCEHierarchicallyInitialiser(pyramid1,
+                                                               pyramid2,
+                                                               mask_pyramid,
+                                                               result.flow_list,
+                                                               func,
+                                                               m_param_useGME->value(),
+                                                               result.mat_list,
+                                                               result.rotation_correlation_list,
+                                                               result.translation_correlation_list,
+                                                               steps, m_param_lowestLevel->value(),
+                                                               m_param_hmode->value(),
+                                                               &gme);
+                    }
+                    else
+                    {
+                        calculateOFCEHierarchicallyInitialiser(pyramid1,
+                                                               pyramid2,
+                                                               result.flow_list,
+                                                               func,
+                                                               m_param_useGME->value(),
+                                                               result.mat_list,
+                                                               result.rotation_correlation_list,
+                                                               result.translation_correlation_list,
+                                                               steps, m_param_lowestLevel->value(),
+                                                               m_param_hmode->value(),
+                                                               &gme);
                     
-                }
+                    }
                 
-            }
-            else
-            {
-                WarpTPSFunctor warp_func;
-                if (m_param_useMask->value()) 
+                }
+                else if(m_param_warpMode->value() == 0)
                 {
-                    calculateOFCEHierarchicallyWarping(imageband1,
-                                                       imageband2,
-                                                       mask,
-                                                       img_list,
-                                                       flow_list,
-                                                       func,
-                                                       m_param_useGME->value(),
-                                                       mat_list,
-                                                       rotation_correlation_list,
-                                                       translation_correlation_list,
-                                                       m_param_highestLevel->value(), m_param_lowestLevel->value(), m_param_hmode->value(),
-                                                       warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value());
+                    WarpTPSFunctor warp_func;
+                    estimateFlowWarping(func, warp_func, 5*m_param_pmode->value(),
+                                        pyramid1, pyramid2, mask_pyramid,
+                                        steps, gme, result);
                 }
-                else 
+                else
                 {
-                    calculateOFCEHierarchicallyWarping(imageband1,
-                                                       imageband2,
-                                                       img_list,
-                                                       flow_list,
-                                                       func,
-                                                       m_param_useGME->value(),
-                                                       mat_list,
-                                                       rotation_correlation_list,
-                                                       translation_correlation_list,
-                                                       m_param_highestLevel->value(), m_param_lowestLevel->value(), m_param_hmode->value(),
-                                                       warp_func, 5*m_param_pmode->value(), m_param_warp_sigma->value());
+                    //The pixels are warped independently, thus all cores may be used
+                    OpticalFlowDenseWarpFunctor warp_func(m_param_warpMode->value()-1, OpticalFlowExecution(0, OpticalFlowSIMDAuto));
+                    estimateFlowWarping(func, warp_func, 1,
+                                        pyramid1, pyramid2, mask_pyramid,
+                                        steps, gme, result);
                 }
-                
-            }	
+            }
+        }
+    
+        /**
+         * Estimates the flow by means of the hierarchical warping approach according to
+         * the chosen framework parameters (see estimateFlow).
+         *
+         * \param func The Optical Flow Functor, which will carry out each step's 
+         *             flow estimation.
+         * \param warp_func The functor, which is used for warping.
+         * \param warp_subsampling The subsampling of the flow for point-based warping functors.
+         * \param pyramid1 The pyramid of the first image band.
+         * \param pyramid2 The pyramid of the second image band.
+         * \param mask_pyramid The pyramid of the mask band (only used if masking is enabled).
+         * \param steps The count of hierarchical steps.
+         * \param gme The global motion estimator, which keeps its plans for further calls.
+         * \param[out] result The flow fields, global motions and warped images of all levels.
+         */
+        template<class OpticalFlowFunctor, class WarpingFunctor>
+        void estimateFlowWarping(OpticalFlowFunctor func,
+                                 WarpingFunctor warp_func,
+                                 unsigned int warp_subsampling,
+                                 const ImagePyramid<float> & pyramid1,
+                                 const ImagePyramid<float> & pyramid2,
+                                 const ImagePyramid<float> & mask_pyramid,
+                                 unsigned int steps,
+                                 GlobalMotionEstimator & gme,
+                                 FlowResult<typename OpticalFlowFunctor::FlowValueType> & result)
+        {
+            if (m_param_useMask->value()) 
+            {
+                calculateOFCEHierarchicallyWarping(pyramid1,
+                                                   pyramid2,
+                                                   mask_pyramid,
+                                                   result.img_list,
+                                                   result.flow_list,
+                                                   func,
+                                                   m_param_useGME->value(),
+                                                   result.mat_list,
+                                                   result.rotation_correlation_list,
+                                                   result.translation_correlation_list,
+                                                   steps, m_param_lowestLevel->value(), m_param_hmode->value(),
+                                                   warp_func, warp_subsampling, m_param_warp_sigma->value(),
+                                                   &gme, &result.img2_list);
+            }
+            else 
+            {
+                calculateOFCEHierarchicallyWarping(pyramid1,
+                                                   pyramid2,
+                                                   result.img_list,
+                                                   result.flow_list,
+                                                   func,
+                                                   m_param_useGME->value(),
+                                                   result.mat_list,
+                                                   result.rotation_correlation_list,
+                                                   result.translation_correlation_list,
+                                                   steps, m_param_lowestLevel->value(), m_param_hmode->value(),
+                                                   warp_func, warp_subsampling, m_param_warp_sigma->value(),
+                                                   &gme, &result.img2_list);
+            }
+        }
+    
+        /**
+         * Creates the result models of one flow estimation: The flow field (and on demand
+         * the flow fields of all levels and the warped images) are appended to the results.
+         *
+         * \param result The flow fields and global motions of all levels.
+         * \param image1 The first image.
+         * \param name1 The name of the first image band.
+         * \param image2 The second image.
+         * \param name2 The name of the second image band.
+         */
+        template<class OpticalFlowFunctor>
+        void addResults(const FlowResult<typename OpticalFlowFunctor::FlowValueType> & result,
+                        const Image<float>* image1, const QString & name1,
+                        const Image<float>* image2, const QString & name2)
+        {
+            typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+            
+            const std::vector<vigra::MultiArray<2,float> > & img_list = result.img_list;
+            const std::vector<vigra::MultiArray<2,float> > & img2_list = result.img2_list;
+            const std::vector<vigra::MultiArray<2,FlowValueType> > & flow_list = result.flow_list;
+            const std::vector<vigra::Matrix<double> > & mat_list = result.mat_list;
             
             for (unsigned int i=0; i< flow_list.size(); ++i)
             {
@@ -327,11 +622,11 @@ class OpticalFlowAlgorithm
                     
                     if( i != 0)
                     {
-                        new_vectorfield->setName(QString("%1 (L%2) of %3 and %4").arg(functor_sname).arg(i).arg(m_param_imageBand1->toString()).arg(m_param_imageBand2->toString()));
+                        new_vectorfield->setName(QString("%1 (L%2) of %3 and %4").arg(functor_sname).arg(i).arg(name1).arg(name2));
                     }
                     else
                     {
-                        new_vectorfield->setName(QString("%1 of %2 and %3").arg(functor_sname).arg(m_param_imageBand1->toString()).arg(m_param_imageBand2->toString()));
+                        new_vectorfield->setName(QString("%1 of %2 and %3").arg(functor_sname).arg(name1).arg(name2));
                     }
                     new_vectorfield->setGlobalMotion(QTransform(mat_list[i](0,0), mat_list[i](1,0), mat_list[i](2,0),
                                                                 mat_list[i](0,1), mat_list[i](1,1), mat_list[i](2,1),
@@ -341,11 +636,11 @@ class OpticalFlowAlgorithm
                     qDebug() << "Inverted GME for VF:" << new_vectorfield->globalMotion().inverted();
                     
                     //Get time diff
-                    unsigned int seconds = (unsigned int)m_param_imageBand1->image()->timestamp().secsTo(m_param_imageBand2->image()->timestamp());
+                    unsigned int seconds = (unsigned int)image1->timestamp().secsTo(image2->timestamp());
                     
                     if(seconds != 0)
                     {
-                        new_vectorfield->setScale(m_param_imageBand1->image()->scale()*100.0/seconds * (m_param_imageBand1->image()->width()/flow_list[0].width()));
+                        new_vectorfield->setScale(image1->scale()*100.0/seconds * (image1->width()/flow_list[0].width()));
                     }
                     
                     QString descr = QString("The following parameters were used to calculate the %1\n").arg(functor_name);
@@ -354,19 +649,31 @@ class OpticalFlowAlgorithm
                     {
                         descr += QString("Level %1 of %2\n").arg(i).arg(flow_list.size());
                     }
-                    descr += m_parameters->valueText("ImageBandParameter<float>");
+                    descr += m_parameters->valueText("ImageBandParameter<float>, MultiModelParameter");
                     new_vectorfield->setDescription(descr);
                     m_results.push_back(new_vectorfield);
                 }
                 //Also save warped images on demand
-                if(m_param_pmode->value() !=0 && i!=0 && m_param_saveIntermediateImages->value()) 
+                if(m_param_pmode->value() !=0 && m_param_warpMode->value() != 0 && i!=0 && m_param_saveIntermediateImages->value()) 
+                {
+                    Image<float>* new_image = new Image<float>(img2_list[i].shape(), 1, m_workspace);
+                    new_image->setBand(0,img2_list[i]);
+                    
+                    image2->copyMetadata(*new_image);
+                    
+                    new_image->setName(QString("Warped Image (L%1) of %2").arg(i).arg(name2));
+                    new_image->setDescription(QString(  "The following parameters were used to calculate the warping:\n"
+                                                        "%1").arg(OpticalFlowDenseWarpFunctor(m_param_warpMode->value()-1).name()));
+                    m_results.push_back(new_image);
+                }
+                else if(m_param_pmode->value() !=0 && i!=0 && m_param_saveIntermediateImages->value()) 
                 {
                     Image<float>* new_image = new Image<float>(img_list[i].shape(), 1, m_workspace);
                     new_image->setBand(0,img_list[i]);
                     
-                    m_param_imageBand1->image()->copyMetadata(*new_image);
+                    image1->copyMetadata(*new_image);
                     
-                    new_image->setName(QString("Warped Image (L%1) of %2").arg(i).arg(m_param_imageBand1->toString()));
+                    new_image->setName(QString("Warped Image (L%1) of %2").arg(i).arg(name1));
                     new_image->setDescription(QString(  "The following parameters were used to calculate the warping:\n"
                                                         "TPS Functor\n"
                                                         "Subsampled each %1 pixel").arg(5*m_param_pmode->value()));
@@ -374,8 +681,234 @@ class OpticalFlowAlgorithm
                 }
             }
         }
+    
+        /**
+         * This templated (by the flow functor) function defines the prototype for all
+         * flow processor calls according to the chosen parameters. In batch mode, the
+         * flow is computed for the whole image series, see computeBatchFlow().
+         * If the algorithm is canceled, the parallel loops of the functors throw an
+         * exception (see graipe::OpticalFlowCancellation).
+         *
+         * \param func The Optical Flow Functor, which will carry out each step's 
+         *             flow estimation.
+         */
+        template<class OpticalFlowFunctor>
+        void computeFlow(OpticalFlowFunctor func)
+        {
+            typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+            
+            vigra_assert(FlowValueType().size() > 1, "flow functor needs to return a vectorfield of at least (u,v) components");
+            
+            OpticalFlowCancellation cancellation([this]{ return isCanceled(); });
+            
+            if(m_batch)
+            {
+                computeBatchFlow(func);
+                return;
+            }
+            
+            vigra::MultiArrayView<2,float> imageband1 = m_param_imageBand1->value();
+            vigra::MultiArrayView<2,float> imageband2 = m_param_imageBand2->value();
+            vigra::MultiArrayView<2,float> mask = m_param_mask->value();
+            
+            std::vector<ImagePyramidCache::PyramidPointer> pyramids(3, std::make_shared<const ImagePyramid<float> >());
+            
+            if(m_param_useHierarchy->value())
+            {
+                imagePyramids(hierarchicalSteps(imageband1.shape(), m_param_highestLevel->value()), pyramids);
+            }
+            
+            vigra::MultiArray<2,FlowValueType> initial_flow;
+            bool initialise = initialFlow(initial_flow);
+            
+            FlowResult<FlowValueType> result;
+            
+            estimateFlow(func,
+                         imageband1, imageband2, mask,
+                         *pyramids[0], *pyramids[1], *pyramids[2],
+                         initialise ? &initial_flow : NULL,
+                         m_gme,
+                         result);
+            
+            addResults<OpticalFlowFunctor>(result,
+                                           m_param_imageBand1->image(), m_param_imageBand1->toString(),
+                                           m_param_imageBand2->image(), m_param_imageBand2->toString());
+        }
+    
+        /**
+         * Computes the flow between each pair of consecutive images of the image series
+         * (ordered by their timestamps). The pairs are processed in windows of concurrent
+         * pairs, each by its own copy of the functor. Each pair gets an equal share of the
+         * threads (see graipe::OpticalFlowThreadLimit). If each pair shall be initialised
+         * by the flow of its predecessor, the pairs are processed one after the other.
+         * The pyramids of each image are only built (or taken from the workspace's cache)
+         * once and then shared by both pairs, which contain the image. Only the pyramids
+         * of the current window are kept. The results of each window are added in the 
+         * order of the series as soon as the window is finished.
+         *
+         * \param func The Optical Flow Functor, which will carry out each step's 
+         *             flow estimation.
+         */
+        template<class OpticalFlowFunctor>
+        void computeBatchFlow(OpticalFlowFunctor func)
+        {
+            typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+            
+            std::vector<Model*> models = m_param_images->value();
+            std::vector<Image<float>*> images;
+            
+            for(Model* model : models)
+            {
+                images.push_back(static_cast<Image<float>*>(model));
+            }
+            
+            std::stable_sort(images.begin(), images.end(), [](const Image<float>* a, const Image<float>* b)
+            {
+                return a->timestamp() < b->timestamp();
+            });
+            
+            vigra_precondition(images.size() > 1, "at least two images are needed for a series");
+            
+            unsigned int band_id = m_param_band->value();
+            
+            for(const Image<float>* image : images)
+            {
+                vigra_precondition(band_id < image->numBands(), "band index exceeds the number of bands of an image");
+                vigra_precondition(image->band(band_id).shape() == images[0]->band(band_id).shape(), "image sizes differ!");
+            }
+            
+            vigra::MultiArrayView<2,float> mask = m_param_mask->value();
+            
+            int frames = (int)images.size();
+            int pairs  = frames - 1;
+            
+            //The initial flow of the first pair (if selected), and (for warm starts) of the next pair
+            vigra::MultiArray<2,FlowValueType> initial_flow;
+            bool initialise = initialFlow(initial_flow);
+            bool warm_start = m_param_seriesWarmStart->value();
+            
+            //Split the threads between the concurrent pairs
+            int pair_threads = m_param_pairThreads->value() > 0 ? m_param_pairThreads->value() : QThread::idealThreadCount();
+            pair_threads = warm_start ? 1 : std::max(1, std::min(pair_threads, pairs));
+            
+            int inner_threads = std::max(1, QThread::idealThreadCount()/pair_threads);
+            
+            //The pyramids of the current window (unused pyramids are empty)
+            unsigned int steps = hierarchicalSteps(images[0]->band(band_id).shape(), m_param_highestLevel->value());
+            bool use_pyramids = m_param_useHierarchy->value();
+            
+            ImagePyramidCache::PyramidPointer empty_pyramid = std::make_shared<const ImagePyramid<float> >();
+            ImagePyramidCache::PyramidPointer mask_pyramid = empty_pyramid;
+            std::vector<ImagePyramidCache::PyramidPointer> pyramids(frames);
+            
+            if(use_pyramids && m_param_useMask->value())
+            {
+                mask_pyramid = cachedImagePyramid(m_param_mask->image(), m_param_mask->bandId(), mask, steps);
+            }
+            
+            //One estimator for each concurrent pair: The plans are measured once and reused
+            std::vector<std::unique_ptr<GlobalMotionEstimator> > gmes;
+            
+            for (int p=0; p<pair_threads; ++p)
+            {
+                gmes.push_back(std::unique_ptr<GlobalMotionEstimator>(new GlobalMotionEstimator(FFTW_MEASURE)));
+            }
+            
+            for (int first_pair=0; first_pair<pairs; first_pair+=pair_threads)
+            {
+                int last_pair = std::min(pairs, first_pair + pair_threads);
+                
+                //Pyramids of the frames [first_pair, last_pair], the first one may be kept from the last window
+                if(use_pyramids)
+                {
+                    OpticalFlowExecution(last_pair - first_pair + 1).parallelRows(first_pair, last_pair+1, [&](int first, int last, OpticalFlowChange &)
+                    {
+                        for (int i=first; i<last; ++i)
+                        {
+                            if(!pyramids[i])
+                            {
+                                pyramids[i] = cachedImagePyramid(images[i], band_id, images[i]->band(band_id), steps);
+                            }
+                        }
+                    });
+                }
+                
+                //Estimate the flow of all pairs of this window concurrently
+                std::vector<FlowResult<FlowValueType> > results(last_pair - first_pair);
+                std::vector<std::string> errors(last_pair - first_pair);
+                
+                OpticalFlowExecution(last_pair - first_pair).parallelRows(first_pair, last_pair, [&](int first, int last, OpticalFlowChange &)
+                {
+                    OpticalFlowThreadLimit limit(inner_threads);
+                    
+                    for (int i=first; i<last; ++i)
+                    {
+                        const vigra::MultiArray<2,FlowValueType> * pair_initial_flow = NULL;
+                        
+                        if((i == 0 && initialise) || (i != 0 && warm_start && initial_flow.size() != 0))
+                        {
+                            pair_initial_flow = &initial_flow;
+                        }
+                        
+                        //Exceptions must not leave the pooled threads
+                        try
+                        {
+                            OpticalFlowFunctor pair_func(func);
+                            
+                            estimateFlow(pair_func,
+                                         images[i]->band(band_id), images[i+1]->band(band_id), mask,
+                                         use_pyramids ? *pyramids[i]   : *empty_pyramid,
+                                         use_pyramids ? *pyramids[i+1] : *empty_pyramid,
+                                         *mask_pyramid,
+                                         pair_initial_flow,
+                                         *gmes[i - first_pair],
+                                         results[i - first_pair]);
+                        }
+                        catch(std::exception& e)
+                        {
+                            errors[i - first_pair] = e.what();
+                        }
+                        catch(...)
+                        {
+                            errors[i - first_pair] = "Non-explainable error occured";
+                        }
+                    }
+                });
+                
+                for (const std::string & error : errors)
+                {
+                    if(!error.empty())
+                    {
+                        throw std::runtime_error(error);
+                    }
+                }
+                
+                for (int i=first_pair; i<last_pair; ++i)
+                {
+                    addResults<OpticalFlowFunctor>(results[i - first_pair],
+                                                   images[i],   QString("%1 (band %2)").arg(images[i]->name()).arg(band_id),
+                                                   images[i+1], QString("%1 (band %2)").arg(images[i+1]->name()).arg(band_id));
+                    
+                    //Release the pyramid of the first image, it is not needed anymore
+                    pyramids[i].reset();
+                }
+                
+                if(warm_start)
+                {
+                    initial_flow.swap(results.back().flow_list[0]);
+                }
+                
+                emit statusMessage(1.0 + 98.0*last_pair/pairs, QString("computed the flow of %1 of %2 pairs").arg(last_pair).arg(pairs));
+            }
+        }
             
     protected:
+        /** Compute the flow of an image series instead of an image pair? **/
+        bool m_batch;
+    
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
+    
         /**
          * @{
          *  
@@ -384,6 +917,11 @@ class OpticalFlowAlgorithm
         ImageBandParameter<float> * m_param_imageBand1;
         ImageBandParameter<float> * m_param_imageBand2;
         
+        MultiModelParameter * m_param_images;
+        IntParameter * m_param_band;
+        IntParameter * m_param_pairThreads;
+        BoolParameter * m_param_seriesWarmStart;
+        
         BoolParameter *  m_param_useMask;
         ImageBandParameter<float> * m_param_mask;
         
@@ -395,11 +933,16 @@ class OpticalFlowAlgorithm
         
         EnumParameter		* m_param_hmode;
         EnumParameter		* m_param_pmode;
+        EnumParameter		* m_param_warpMode;
         
         FloatParameter *   m_param_warp_sigma;
         
         BoolParameter	* m_param_saveIntermediateImages;
         BoolParameter	* m_param_saveIntermediateFlow;
+        
+        MultiModelParameter * m_param_initialFlow;
+        BoolParameter	* m_param_predictFlow;
+        IntParameter *   m_param_initialLevel;
         /**
          * @}
          */
@@ -420,19 +963,34 @@ class OpticalFlowHSEstimator
 	public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-		OpticalFlowHSEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+		OpticalFlowHSEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
 		{
 			addImageAndMaskParameters();
 			
 			m_param_sigma = new FloatParameter("sigma of gauss. gradient", 0, 30, 1);
 			m_param_alpha = new FloatParameter("Weight alpha", 0, 99999, 1);
 			m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 100);
+			m_param_solver = new EnumParameter("Solver", solver_modes(), 0);
+			m_param_omega = new FloatParameter("SOR relaxation factor omega", 0.01, 1.99, 1.9);
+			m_param_epsilon = new FloatParameter("Stop if max. change is below (0 = never)", 0, 10, 0);
+			m_param_threads = new IntParameter("Threads (0 = all cores)", 0, 256, 1);
+			m_param_simd = new EnumParameter("Instruction set", simd_modes(), OpticalFlowSIMDScalar);
+			m_param_precision = new EnumParameter("Precision", precision_modes(), OpticalFlowPrecisionDouble);
 			
 			m_parameters->addParameter("sigma", m_param_sigma );
 			m_parameters->addParameter("alpha", m_param_alpha );
 			m_parameters->addParameter("iterations", m_param_iterations );
+			m_parameters->addParameter("solver", m_param_solver );
+			m_parameters->addParameter("omega", m_param_omega );
+			m_parameters->addParameter("epsilon", m_param_epsilon );
+			m_parameters->addParameter("threads", m_param_threads );
+			m_parameters->addParameter("simd", m_param_simd );
+			m_parameters->addParameter("precision", m_param_precision );
 		
 			addFrameworkProcessingParameters();
 		}
@@ -469,6 +1027,13 @@ class OpticalFlowHSEstimator
                                              m_param_iterations->value(),
                                              m_param_sigma->value());
                     
+                    func.setSolver(OpticalFlowHSSolver(m_param_solver->value(),
+                                                       m_param_omega->value(),
+                                                       m_param_epsilon->value()));
+                    func.setExecution(OpticalFlowExecution(m_param_threads->value(),
+                                                           m_param_simd->value()));
+                    func.setPrecision(m_param_precision->value());
+                    
                     emit statusMessage(1.0, QString("started computation"));
                     
                     computeFlow(func);
@@ -497,6 +1062,12 @@ class OpticalFlowHSEstimator
         FloatParameter * m_param_sigma;
         FloatParameter * m_param_alpha;
         IntParameter* m_param_iterations;
+        EnumParameter * m_param_solver;
+        FloatParameter * m_param_omega;
+        FloatParameter * m_param_epsilon;
+        IntParameter * m_param_threads;
+        EnumParameter * m_param_simd;
+        EnumParameter * m_param_precision;
         /**
          * @}
          */
@@ -549,9 +1120,12 @@ class OpticalFlowBruhnEstimator
     public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-        OpticalFlowBruhnEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+        OpticalFlowBruhnEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
         {
             addImageAndMaskParameters();
             
@@ -560,6 +1134,7 @@ class OpticalFlowBruhnEstimator
             m_param_alpha = new FloatParameter("Weight alpha", 0, 100, 1);
             m_param_omega = new FloatParameter("Weight omega", 0, 100, 1);
             m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 100);
+            m_param_threads = new IntParameter("Threads (0 = all cores, red-black order if > 1)", 0, 256, 1);
             
             
             m_parameters->addParameter("sigma1", m_param_inner_sigma );
@@ -567,6 +1142,7 @@ class OpticalFlowBruhnEstimator
             m_parameters->addParameter("alpha", m_param_alpha );
             m_parameters->addParameter("omega", m_param_omega );
             m_parameters->addParameter("iterations", m_param_iterations );
+            m_parameters->addParameter("threads", m_param_threads );
             
             addFrameworkProcessingParameters();
         }
@@ -604,6 +1180,8 @@ class OpticalFlowBruhnEstimator
                                              m_param_omega->value(),
                                              m_param_iterations->value());
                     
+                    func.setExecution(OpticalFlowExecution(m_param_threads->value()));
+                    
                     emit statusMessage(1.0, QString("started computation"));
                     
                     computeFlow(func);
@@ -634,6 +1212,7 @@ class OpticalFlowBruhnEstimator
         FloatParameter * m_param_alpha;
         FloatParameter * m_param_omega;	
         IntParameter* m_param_iterations;
+        IntParameter * m_param_threads;
         /**
          * @}
          */
@@ -642,23 +1221,23 @@ class OpticalFlowBruhnEstimator
 /**
  * Type identifier of this algorihm.
  *
- * \return Always: "createOpticalFlowCLGEstimator"
+ * \return Always: "OpticalFlowCLGEstimator"
  */
 template<>
 QString OpticalFlowBruhnEstimator<OpticalFlowCLGFunctor>::typeName() const
 {
-    return "createOpticalFlowCLGEstimator";
+    return "OpticalFlowCLGEstimator";
 }
 
 /**
  * Type identifier of this algorihm.
  *
- * \return Always: "OpticalFlowCLGNonlinearFunctor"
+ * \return Always: "OpticalFlowCLGNonlinearEstimator"
  */
 template<>
 QString OpticalFlowBruhnEstimator<OpticalFlowCLGNonlinearFunctor>::typeName() const
 {
-    return "OpticalFlowCLGNonlinearFunctor";
+    return "OpticalFlowCLGNonlinearEstimator";
 }
 
 
@@ -672,9 +1251,12 @@ class OpticalFlowLKEstimator
     public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-        OpticalFlowLKEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+        OpticalFlowLKEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
         {
             addImageAndMaskParameters();
             
@@ -682,11 +1264,17 @@ class OpticalFlowLKEstimator
             m_param_mask_size = new IntParameter("Mask size", 3, 1000, 31);
             m_param_threshold = new FloatParameter("Threshold (lower ew)", 0, 100000, 0);
             m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 1);
+            m_param_threads = new IntParameter("Threads for the tiles (0 = all cores)", 0, 256, 1);
+            m_param_tileSize = new IntParameter("Tile size (0 = whole image)", 0, 4096, 0);
+            m_param_precision = new EnumParameter("Precision", precision_modes(), OpticalFlowPrecisionDouble);
             
             m_parameters->addParameter("sigma", m_param_sigma );
             m_parameters->addParameter("mask_size", m_param_mask_size );
             m_parameters->addParameter("T", m_param_threshold );
             m_parameters->addParameter("iterations", m_param_iterations );
+            m_parameters->addParameter("threads", m_param_threads );
+            m_parameters->addParameter("tile_size", m_param_tileSize );
+            m_parameters->addParameter("precision", m_param_precision );
             
             addFrameworkProcessingParameters();
         }
@@ -724,6 +1312,9 @@ class OpticalFlowLKEstimator
                                               m_param_threshold->value(),
                                               m_param_iterations->value()); 		
                     
+                    func.setTiling(OpticalFlowLocalTiling(OpticalFlowExecution(m_param_threads->value()),
+                                                          m_param_tileSize->value()));
+                    func.setPrecision(m_param_precision->value());
                     
                     emit statusMessage(1.0, QString("started computation"));
                     
@@ -754,6 +1345,9 @@ class OpticalFlowLKEstimator
         IntParameter * m_param_mask_size;
         FloatParameter * m_param_threshold;	
         IntParameter* m_param_iterations;
+        IntParameter * m_param_threads;
+        IntParameter * m_param_tileSize;
+        EnumParameter * m_param_precision;
         /**
          * @}
          */
@@ -772,9 +1366,12 @@ class OpticalFlowFBEstimator
     public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-        OpticalFlowFBEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+        OpticalFlowFBEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
         {
             addImageAndMaskParameters();
             
@@ -782,11 +1379,15 @@ class OpticalFlowFBEstimator
             m_param_mask_size = new IntParameter("Mask size", 3, 1000, 31);
             m_param_threshold = new FloatParameter("threshold (det >= t)", 0, 1000000000, 0);
             m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 1);
+            m_param_threads = new IntParameter("Threads (0 = all cores)", 0, 256, 1);
+            m_param_precision = new EnumParameter("Precision", precision_modes(), OpticalFlowPrecisionDouble);
             
             m_parameters->addParameter("sigma", m_param_sigma );
             m_parameters->addParameter("mask_size", m_param_mask_size );
             m_parameters->addParameter("T", m_param_threshold );
             m_parameters->addParameter("iterations", m_param_iterations );
+            m_parameters->addParameter("threads", m_param_threads );
+            m_parameters->addParameter("precision", m_param_precision );
             
             addFrameworkProcessingParameters();
         }
@@ -824,6 +1425,9 @@ class OpticalFlowFBEstimator
                                               m_param_threshold->value(),
                                               m_param_iterations->value()); 		
                     
+                    func.setExecution(OpticalFlowExecution(m_param_threads->value()));
+                    func.setPrecision(m_param_precision->value());
+                    
                     emit statusMessage(1.0, QString("started computation"));
                     
                     computeFlow(func);
@@ -853,6 +1457,8 @@ class OpticalFlowFBEstimator
         IntParameter * m_param_mask_size;
         FloatParameter * m_param_threshold;
         IntParameter* m_param_iterations;
+        IntParameter * m_param_threads;
+        EnumParameter * m_param_precision;
         /**
          * @}
          */
@@ -873,9 +1479,12 @@ class OpticalFlowTensorEstimator
     public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-        OpticalFlowTensorEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+        OpticalFlowTensorEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
         {
             addImageAndMaskParameters();
             
@@ -884,6 +1493,9 @@ class OpticalFlowTensorEstimator
             m_param_mask_size = new IntParameter("mask size", 1, 1000, 31);
             m_param_threshold = new FloatParameter("Threshold (lower ew)", 0, 1000000000, 0);
             m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 1);
+            m_param_threads = new IntParameter("Threads for the tiles (0 = all cores)", 0, 256, 1);
+            m_param_tileSize = new IntParameter("Tile size (0 = whole image)", 0, 4096, 0);
+            m_param_precision = new EnumParameter("Precision", precision_modes(), OpticalFlowPrecisionDouble);
             
             
             m_parameters->addParameter("sigma1", m_param_inner_sigma );
@@ -891,6 +1503,9 @@ class OpticalFlowTensorEstimator
             m_parameters->addParameter("mask_size", m_param_mask_size );
             m_parameters->addParameter("T", m_param_threshold );
             m_parameters->addParameter("iterations", m_param_iterations );
+            m_parameters->addParameter("threads", m_param_threads );
+            m_parameters->addParameter("tile_size", m_param_tileSize );
+            m_parameters->addParameter("precision", m_param_precision );
             
             addFrameworkProcessingParameters();
         }
@@ -928,6 +1543,10 @@ class OpticalFlowTensorEstimator
                                              m_param_threshold->value(),
                                              m_param_iterations->value());
                     
+                    func.setTiling(OpticalFlowLocalTiling(OpticalFlowExecution(m_param_threads->value()),
+                                                          m_param_tileSize->value()));
+                    func.setPrecision(m_param_precision->value());
+                    
                     emit statusMessage(1.0, QString("started computation"));
                     
                     computeFlow(func);
@@ -958,6 +1577,9 @@ class OpticalFlowTensorEstimator
         IntParameter* m_param_mask_size;
         FloatParameter * m_param_threshold;	
         IntParameter* m_param_iterations;
+        IntParameter * m_param_threads;
+        IntParameter * m_param_tileSize;
+        EnumParameter * m_param_precision;
         /**
          * @}
          */
@@ -985,19 +1607,28 @@ class OpticalFlowCCEstimator
     public:
         /**
          * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         * \param batch If true, the flow is computed for a whole image series.
          */
-        OpticalFlowCCEstimator(Workspace* wsp)
-        : OpticalFlowAlgorithm(wsp)
+        OpticalFlowCCEstimator(Workspace* wsp, bool batch=false)
+        : OpticalFlowAlgorithm(wsp, batch)
         {
             addImageAndMaskParameters();
             
             m_param_sigma = new FloatParameter("sigma of gauss. gradient", 0, 30, 1);
             m_param_threshold = new FloatParameter("Threshold (lower ew)", 0, 100000, 0);
             m_param_iterations = new IntParameter("No. of iterations", 1, 1000, 1);
+            m_param_threads = new IntParameter("Threads for the tiles (0 = all cores)", 0, 256, 1);
+            m_param_tileSize = new IntParameter("Tile size (0 = whole image)", 0, 4096, 0);
+            m_param_precision = new EnumParameter("Precision", precision_modes(), OpticalFlowPrecisionDouble);
             
             m_parameters->addParameter("sigma", m_param_sigma );
             m_parameters->addParameter("T", m_param_threshold );
             m_parameters->addParameter("iterations", m_param_iterations );
+            m_parameters->addParameter("threads", m_param_threads );
+            m_parameters->addParameter("tile_size", m_param_tileSize );
+            m_parameters->addParameter("precision", m_param_precision );
             
             addFrameworkProcessingParameters();
         }
@@ -1033,6 +1664,10 @@ class OpticalFlowCCEstimator
                                               m_param_threshold->value(),
                                               m_param_iterations->value());
                     
+                    func.setTiling(OpticalFlowLocalTiling(OpticalFlowExecution(m_param_threads->value()),
+                                                          m_param_tileSize->value()));
+                    func.setPrecision(m_param_precision->value());
+                    
                     emit statusMessage(1.0, QString("started computation"));
                     
                     computeFlow(func);
@@ -1061,11 +1696,46 @@ class OpticalFlowCCEstimator
         FloatParameter * m_param_sigma;
         FloatParameter * m_param_threshold;	
         IntParameter* m_param_iterations;
+        IntParameter * m_param_threads;
+        IntParameter * m_param_tileSize;
+        EnumParameter * m_param_precision;
         /**
          * @}
          */
 };
 
+
+/**
+ * This templated class turns any of the Optical Flow estimators above into a batch
+ * estimator, which computes the flow between each pair of consecutive images of an
+ * image series instead of the flow of only one image pair.
+ */
+template<class ESTIMATOR>
+class OpticalFlowBatchEstimator
+:   public ESTIMATOR
+{
+    public:
+        /**
+         * Default constructor. Adds all neccessary parameters for this algorithm to run.
+         *
+         * \param wsp The workspace of this algorithm.
+         */
+        OpticalFlowBatchEstimator(Workspace* wsp)
+        : ESTIMATOR(wsp, true)
+        {
+        }
+    
+        /**
+         * Type identifier of this algorihm.
+         *
+         * \return The type name of the estimator followed by "Batch".
+         */
+        QString typeName() const
+        {
+            return ESTIMATOR::typeName() + "Batch";
+        }
+};
+
 //Experimental algorithms are not working right now.
 //TODO: If possible, fix them. If not, discard them.
 /*
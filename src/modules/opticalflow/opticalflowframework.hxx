@@ -50,6 +50,12 @@
 #include <vigra/stdconvolution.hxx>
 #include <vigra/affine_registration_fft.hxx>
 
+//Gaussian image pyramids
+#include "opticalflowpyramid.hxx"
+
+//Dense warping by means of flow fields
+#include "opticalflowwarping.hxx"
+
 namespace graipe {
 
 /**
@@ -82,7 +88,123 @@ void correctOFCEWithGlobalDisplacement(vigra::MultiArrayView<2,vigra::TinyVector
     }
 }
 
+/**
+ * Removes the global displacement from a flow field. This is the inverse of
+ * correctOFCEWithGlobalDisplacement and yields the residual flow of an initial
+ * flow with respect to the globally displaced first image.
+ *
+ * \param[in,out] flow The flow field.
+ * \param[in] mat The global motion (I1->I2), which will be removed from the flow field.
+ */
+template <	class T, int N>
+void removeGlobalDisplacementFromOFCE(vigra::MultiArrayView<2,vigra::TinyVector<T,N> > flow,
+                                      const vigra::Matrix<double>& mat)
+{
+    vigra_assert( N >= 2, "flow field must contain (u,v)-components at least" );
+    
+    for(unsigned int y=0; y != flow.height(); ++y)
+    {
+        for(unsigned int x=0; x != flow.width(); ++x)
+        {
+            flow(x,y)[0] -= x*mat(0,0) + y*mat(0,1) + mat(0,2) - x;
+            flow(x,y)[1] -= x*mat(1,0) + y*mat(1,1) + mat(1,2) - y;
+        }
+    }
+}
+
+/**
+ * Checks, if a flow field serves as an initial flow, i.e. if any of its (u,v)
+ * components is non-zero. Zero flow fields are the default of the computations.
+ *
+ * \param[in] flow The flow field.
+ * \return True, if the flow field contains any motion.
+ */
+template <	class T, int N>
+bool isInitialOFCE(const vigra::MultiArrayView<2,vigra::TinyVector<T,N> > & flow)
+{
+    for(unsigned int y=0; y != flow.height(); ++y)
+    {
+        for(unsigned int x=0; x != flow.width(); ++x)
+        {
+            if(flow(x,y)[0] != 0 || flow(x,y)[1] != 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Inverts the global motion of an image pair, which is given as a rotation and
+ * translation from I2->I1 (as estimated), to the motion I1->I2.
+ *
+ * \param[in] mat The global motion (I2->I1).
+ * \return The global motion (I1->I2).
+ */
+inline vigra::Matrix<double> invertGlobalMotion(const vigra::Matrix<double>& mat)
+{
+    vigra::Matrix<double> imat = vigra::identityMatrix<double>(3);
+    imat(0,0) = mat(0,0); imat(0,1) = mat(1,0);
+    imat(1,0) = mat(0,1); imat(1,1) = mat(1,1);
+    imat(0,2) = - (imat(0,0)*mat(0,2) + imat(1,0)*mat(1,2));
+    imat(1,2) = - (imat(0,1)*mat(0,2) + imat(1,1)*mat(1,2));
+    return imat;
+}
+
+
+
 
+/**
+ * Initialises the Optical Flow computation by means of a given flow field (u,v), e.g.
+ * the result of the previous image pair of a series (warm start). The given flow is 
+ * resampled to the size of the flow field, and the vector lengths are rescaled
+ * accordingly. If a prediction is requested, the flow is additionally transported 
+ * along itself by one time step (semi-Lagrangian advection), which assumes that 
+ * the moving structures keep their velocities.
+ *
+ * \param[in] u The x-components of the given flow field.
+ * \param[in] v The y-components of the given flow field.
+ * \param[out] flow The initialised flow field. Further components are set to zero.
+ * \param[in] predict If true, the given flow will be advected by one time step.
+ */
+template <class T, class S1, class S2, class FlowValueType>
+void initialiseFlow(const vigra::MultiArrayView<2,T,S1> & u,
+                    const vigra::MultiArrayView<2,T,S2> & v,
+                    vigra::MultiArrayView<2,FlowValueType> flow,
+                    bool predict)
+{
+    vigra_precondition(u.shape() == v.shape() ,"flow component sizes differ!");
+    
+    vigra::MultiArray<2,T> u_res(flow.shape()), v_res(flow.shape());
+    
+    vigra::resizeImageLinearInterpolation(u, u_res);
+    vigra::resizeImageLinearInterpolation(v, v_res);
+    
+    u_res *= T(double(flow.width())/u.width());
+    v_res *= T(double(flow.height())/u.height());
+    
+    vigra::SplineImageView<1,T> u_spline(u_res), v_spline(v_res);
+    
+    for(int y=0; y != flow.height(); ++y)
+    {
+        for(int x=0; x != flow.width(); ++x)
+        {
+            double src_x = x, src_y = y;
+            
+            //Where did the structure come from, which is at (x,y) after one step?
+            if(predict && u_spline.isInside(x - u_res(x,y), y - v_res(x,y)))
+            {
+                src_x = x - u_res(x,y);
+                src_y = y - v_res(x,y);
+            }
+            
+            flow(x,y) = FlowValueType();
+            flow(x,y)[0] = u_spline(src_x, src_y);
+            flow(x,y)[1] = v_spline(src_x, src_y);
+        }
+    }
+}
 
 
 /**
@@ -92,12 +214,15 @@ void correctOFCEWithGlobalDisplacement(vigra::MultiArrayView<2,vigra::TinyVector
  *
  * \param[in] src1 First image of the series.
  * \param[in] src2 Second image of the series.
- * \param[out] flow The resulting Optical Flow field.
+ * \param[in,out] flow The resulting Optical Flow field. If it is not zero, it serves
+ *                     as the initial flow (including the global displacement).
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_global If true, the global motion estimation be used prior.
  * \param[out] mat If use_global is true, this contains the global motion estimation matrix (rot+trans).
  * \param[out] rotation_correlation If use_global is true, this contains the rotation correlation.
  * \param[out] translation_correlation If use_global is true, this contains the transflation correlation.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class OpticalFlowFunctor>
 void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
@@ -106,7 +231,8 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
 				   OpticalFlowFunctor flow_func,
                    bool use_global,
                    vigra::Matrix<double>& mat,
-                   double & rotation_correlation, double & translation_correlation)
+                   double & rotation_correlation, double & translation_correlation,
+                   GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
     vigra_precondition(src1.shape() == flow.shape() ,"image and flow array sizes differ!");
@@ -115,13 +241,31 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
 	vigra::MultiArray<2,T1> src1_t(src1.shape());
     
     mat = vigra::identityMatrix<double>(3);
+    vigra::Matrix<double> imat = mat;
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         
         //mat is an affine transfrom from I2->I1, thus affineWarping is possible without inversion
         affineWarpImage(vigra::SplineImageView<3, T1>(src1), src1_t, mat);
+        
+        //Mat is from I2->I1 invert for I1->I2
+        imat = invertGlobalMotion(mat);
+        
+        //An initial flow (e.g. of a warm start or a coarser level) already contains
+        //the global displacement, which is added back after the computation
+        if(isInitialOFCE(flow))
+        {
+            removeGlobalDisplacementFromOFCE(flow, imat);
+        }
     }
 	else
     {
@@ -135,13 +279,6 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
 	//3. step: "add" the global displacement back to the result
 	if(use_global)
 	{
-        //Mat is from I2->I1 invert for I1->I2
-        vigra::Matrix<double> imat = vigra::identityMatrix<double>(3);
-        imat(0,0) = mat(0,0); imat(0,1) = mat(1,0);
-        imat(1,0) = mat(0,1); imat(1,1) = mat(1,1);
-        imat(0,2) = - (imat(0,0)*mat(0,2) + imat(1,0)*mat(1,2));
-        imat(1,2) = - (imat(0,1)*mat(0,2) + imat(1,1)*mat(1,2));
-        
         mat = imat;
         correctOFCEWithGlobalDisplacement(flow, mat);
 	}
@@ -158,12 +295,15 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
  * \param[in] src1 First image of the series.
  * \param[in] src2 Second image of the series.
  * \param[in] mask THe mask, where pixel values are assumed to be valid.
- * \param[out] flow The resulting Optical Flow field.
+ * \param[in,out] flow The resulting Optical Flow field. If it is not zero, it serves
+ *                     as the initial flow (including the global displacement).
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_global If true, the global motion estimation be used prior.
  * \param[out] mat If use_global is true, this contains the global motion estimation matrix (rot+trans).
  * \param[out] rotation_correlation If use_global is true, this contains the rotation correlation.
  * \param[out] translation_correlation If use_global is true, this contains the transflation correlation.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
  */
 template <class T1, class T2, class T3, class OpticalFlowFunctor>
 void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
@@ -173,7 +313,8 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
                   OpticalFlowFunctor flow_func,
                   bool use_global,
                   vigra::Matrix<double>& mat,
-                  double & rotation_correlation, double & translation_correlation)
+                  double & rotation_correlation, double & translation_correlation,
+                  GlobalMotionEstimator * gme = NULL)
 {
     vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
     vigra_precondition(src1.shape() == mask.shape() ,"image and mask sizes differ!");
@@ -183,13 +324,31 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
 	vigra::MultiArray<2,T1> src1_t(src1.shape());
     
     mat = vigra::identityMatrix<double>(3);
+    vigra::Matrix<double> imat = mat;
     
     if(use_global)
     {
-        estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        if(gme != NULL)
+        {
+            gme->estimate(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
+        else
+        {
+            vigra::estimateGlobalRotationTranslation(src1, src2, mat, rotation_correlation, translation_correlation);
+        }
         
         //mat is an affine transfrom from I2->I1, thus affineWarping is possible without inversion
         affineWarpImage(vigra::SplineImageView<3, T1>(src1), src1_t, mat);
+        
+        //Mat is from I2->I1 invert for I1->I2
+        imat = invertGlobalMotion(mat);
+        
+        //An initial flow (e.g. of a warm start or a coarser level) already contains
+        //the global displacement, which is added back after the computation
+        if(isInitialOFCE(flow))
+        {
+            removeGlobalDisplacementFromOFCE(flow, imat);
+        }
     }
 	else
     {
@@ -203,13 +362,6 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
 	//3. step: "add" the global displacement back to the result
 	if(use_global)
 	{
-        //Mat is from I2->I1 invert for I1->I2
-        vigra::Matrix<double> imat = vigra::identityMatrix<double>(3);
-        imat(0,0) = mat(0,0); imat(0,1) = mat(1,0);
-        imat(1,0) = mat(0,1); imat(1,1) = mat(1,1);
-        imat(0,2) = - (imat(0,0)*mat(0,2) + imat(1,0)*mat(1,2));
-        imat(1,2) = - (imat(0,1)*mat(0,2) + imat(1,1)*mat(1,2));
-        
         mat = imat;
         correctOFCEWithGlobalDisplacement(flow, mat);
 	}
@@ -220,37 +372,16 @@ void calculateOFCE(const vigra::MultiArrayView<2,T1> & src1,
  */ 
 
 /**
- * Helper-function to get (via Gaussian reduction) from one image to next pyramid level's image
- * Next means smaller image.
- * \param[in] in The input image
- * \param[out] out The reduced image.
+ * Helper function to limit the step count of the hierarchical processing, such
+ * that the smallest level is at least 8 pixels wide and high.
+ *
+ * \param shape The shape of the images at level 0.
+ * \param steps The requested step count.
+ * \return The (possibly reduced) step count.
  */
-template <class T>
-void reduceToNextLevel(const vigra::MultiArrayView<2,T> & in, vigra::MultiArray<2,T> & out)
-{    
-    // image size at current level
-    unsigned int width  = (unsigned int)in.width(),
-                 height = (unsigned int)in.height();
-    
-    // image size at next smaller level
-    unsigned int newwidth  = (width + 1) / 2,
-                 newheight = (height + 1) / 2;
-    
-    // resize result image to appropriate size
-    out.reshape(vigra::Shape2(newwidth, newheight));
-    
-    // define a Gaussian kernel (size 5x1)
-    vigra::Kernel1D<double> filter;
-    filter.initExplicitly(-2, 2) = 0.05, 0.25, 0.4, 0.25, 0.05;
-    
-    vigra::MultiArray<2,T> temp(in.shape()), temp2(in.shape());
-    
-    // smooth (band limit) input image
-    vigra::separableConvolveX(in,   temp, filter);
-    vigra::separableConvolveY(temp, temp2, filter);
-                       
-    // downsample smoothed image
-    vigra::resizeImageNoInterpolation(temp2, out);
+inline unsigned int hierarchicalSteps(const vigra::Shape2 & shape, unsigned int steps)
+{
+    return std::min((double)steps, log((double)std::min(shape[0], shape[1]))/log(2.0)-3);
 }
 
 /**
@@ -316,8 +447,8 @@ std::list<unsigned int> buildStepList(unsigned int steps, unsigned int break_lev
  *     at level (n+1)
  * For each (a) the functor is called without a mask, but if selected with global motion estimation.
  *
- * \param[in] src1 First image of the series.
- * \param[in] src2 Second image of the series.
+ * \param[in] src1_pyramid The pyramid of the first image of the series.
+ * \param[in] src2_pyramid The pyramid of the second image of the series.
  * \param[out] flow_list The resulting Optical Flow fields during the steps.
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_gme If true, the global motion estimation be used prior to each computation.
@@ -327,10 +458,17 @@ std::list<unsigned int> buildStepList(unsigned int steps, unsigned int break_lev
  * \param[in] steps Step count.
  * \param[in] break_level On wich level shall we finish/break the traversal.
  * \param[in] hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
+ *
+ * The pyramids need to contain at least the given step count of levels (after
+ * the limitation by hierarchicalSteps). They may be reused by subsequent calls.
+ * If flow_list already contains the flow fields of some levels, these are used 
+ * as initial flows (e.g. at the highest level for a warm start, see initialiseFlow).
  */
 template <	class T1, class T2, class MatrixType, class OpticalFlowFunctor>
-void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> & src1, 
-                                            const vigra::MultiArrayView<2,T2> & src2, 
+void calculateOFCEHierarchicallyInitialiser(const ImagePyramid<T1> & src1_pyramid, 
+                                            const ImagePyramid<T2> & src2_pyramid, 
                                             std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> > & flow_list,
                                             OpticalFlowFunctor flow_func,
                                             bool use_gme,
@@ -339,31 +477,23 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
                                             std::vector<double>& translation_correlation_list,
                                             unsigned int steps,  
                                             unsigned int break_level, 
-                                            unsigned int hmode)
+                                            unsigned int hmode,
+                                            GlobalMotionEstimator * gme = NULL)
 {
-    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    vigra_precondition(src1_pyramid[0].shape() == src2_pyramid[0].shape() ,"image sizes differ!");
     
-	steps = std::min((double)steps, log((double)std::min(src1.width(), src1.height()))/log(2.0)-3);
+	steps = hierarchicalSteps(src1_pyramid[0].shape(), steps);
+	vigra_precondition(src1_pyramid.highestLevel() >= steps && src2_pyramid.highestLevel() >= steps, "image pyramids have too few levels!");
 	std::list<unsigned int> step_list = buildStepList(steps, break_level, hmode);
 	
-    //create gaussian pyramid hierarchy bottom->up
-	std::vector<vigra::MultiArray<2,T1> >	img_list(steps+1);
-    std::vector<vigra::MultiArray<2,T2> >	img2_list(steps+1);
-	
-	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
-	
-	img_list[0]  = src1;
-	img2_list[0] = src2;
-		
-	for (unsigned int level=1; level<=steps; ++level)
+	//flow fields, which are already given, serve as initial flows of their levels
+	for (unsigned int level=flow_list.size(); level<=steps; ++level)
 	{
-		reduceToNextLevel(img_list[level-1], img_list[level]);
-		reduceToNextLevel(img2_list[level-1], img2_list[level]);
-		
-		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(img_list[level].shape()));
-		mat_list.push_back(MatrixType(3,3));
-		
+		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(src1_pyramid[level].shape()));
 	}
+	mat_list.resize(steps+1, MatrixType(3,3));
+	rotation_correlation_list.resize(steps+1, 0.0);
+	translation_correlation_list.resize(steps+1, 0.0);
 	
 	//work on that hierarchy	
 	for (std::list<unsigned int>::iterator iter = step_list.begin(); iter != step_list.end(); ++iter)
@@ -376,13 +506,14 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
 		
 		flow_func.setLevel(s);
 		
-		calculateOFCE(img_list[s], img2_list[s],
+		calculateOFCE(src1_pyramid[s], src2_pyramid[s],
                       flow_list[s],
 					  flow_func, 
 					  use_gme,
                       mat_list[s],
                       rotation_correlation_list[s],
-                      translation_correlation_list[s]);
+                      translation_correlation_list[s],
+                      gme);
 		
 		if(next_iter != step_list.end() )
 		{
@@ -407,6 +538,49 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
 	}
 }
 
+/**
+ * Convenience overload of the first hierarchical approach, which builds
+ * the pyramids of both images (in parallel) before.
+ * See the overload for pyramids for a description of the parameters.
+ */
+template <	class T1, class T2, class MatrixType, class OpticalFlowFunctor>
+void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> & src1, 
+                                            const vigra::MultiArrayView<2,T2> & src2, 
+                                            std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> > & flow_list,
+                                            OpticalFlowFunctor flow_func,
+                                            bool use_gme,
+                                            std::vector<MatrixType>& mat_list,
+                                            std::vector<double>& rotation_correlation_list,
+                                            std::vector<double>& translation_correlation_list,
+                                            unsigned int steps,  
+                                            unsigned int break_level, 
+                                            unsigned int hmode)
+{
+    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    
+	steps = hierarchicalSteps(src1.shape(), steps);
+	
+	//create gaussian pyramid hierarchy bottom->up
+	ImagePyramid<T1> src1_pyramid;
+	ImagePyramid<T2> src2_pyramid;
+	
+	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
+	
+	buildImagePyramids(src1, src1_pyramid, src2, src2_pyramid, steps);
+	
+	calculateOFCEHierarchicallyInitialiser(src1_pyramid,
+	                                       src2_pyramid,
+	                                       flow_list,
+	                                       flow_func,
+	                                       use_gme,
+	                                       mat_list,
+	                                       rotation_correlation_list,
+	                                       translation_correlation_list,
+	                                       steps,
+	                                       break_level,
+	                                       hmode);
+}
+
 
 /**
  * The second hierarchical Optical Flow estimation approach:
@@ -415,9 +589,9 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
  *    at level (n+1)
  * For each (a) the functor is called with a mask and if selected with global motion estimation.
  *
- * \param[in] src1 First image of the series.
- * \param[in] src2 Second image of the series.
- * \param[in] mask THe mask, where pixel values are assumed to be valid.
+ * \param[in] src1_pyramid The pyramid of the first image of the series.
+ * \param[in] src2_pyramid The pyramid of the second image of the series.
+ * \param[in] mask_pyramid The pyramid of the mask, where pixel values are assumed to be valid.
  * \param[out] flow_list The resulting Optical Flow fields during the steps.
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_gme If true, the global motion estimation be used prior to each computation.
@@ -427,11 +601,18 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
  * \param steps Step count.
  * \param[in] break_level On wich level shall we finish/break the traversal.
  * \param[in] hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
+ *
+ * The pyramids need to contain at least the given step count of levels (after
+ * the limitation by hierarchicalSteps). They may be reused by subsequent calls.
+ * If flow_list already contains the flow fields of some levels, these are used 
+ * as initial flows (e.g. at the highest level for a warm start, see initialiseFlow).
  */
 template <	class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor>
-void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> & src1,
-											const vigra::MultiArrayView<2,T2> & src2,
-											const vigra::MultiArrayView<2,T3> & mask,
+void calculateOFCEHierarchicallyInitialiser(const ImagePyramid<T1> & src1_pyramid,
+											const ImagePyramid<T2> & src2_pyramid,
+											const ImagePyramid<T3> & mask_pyramid,
                                             std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> > & flow_list,
 											OpticalFlowFunctor flow_func,
 											bool use_gme,
@@ -440,35 +621,24 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
                                             std::vector<double>& translation_correlation_list,
 											unsigned int steps,
 											unsigned int break_level,
-											unsigned int hmode)
+											unsigned int hmode,
+											GlobalMotionEstimator * gme = NULL)
 {
-    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
-    vigra_precondition(src1.shape() == mask.shape() ,"image and mask sizes differ!");
+    vigra_precondition(src1_pyramid[0].shape() == src2_pyramid[0].shape() ,"image sizes differ!");
+    vigra_precondition(src1_pyramid[0].shape() == mask_pyramid[0].shape() ,"image and mask sizes differ!");
     
-	steps = std::min((double)steps, log((double)std::min(src1.width(),src1.height()))/log(2.0)-3);
+	steps = hierarchicalSteps(src1_pyramid[0].shape(), steps);
+	vigra_precondition(src1_pyramid.highestLevel() >= steps && src2_pyramid.highestLevel() >= steps && mask_pyramid.highestLevel() >= steps, "image pyramids have too few levels!");
 	std::list<unsigned int> step_list = buildStepList(steps, break_level, hmode);
     
-	//create gaussian pyramid hierarchy bottom->up
-	std::vector<vigra::MultiArray<2,T1> >	img_list(steps+1);
-    std::vector<vigra::MultiArray<2,T2> >	img2_list(steps+1);
-	std::vector<vigra::MultiArray<2,T3> >	mask_list(steps+1);
-	
-	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
-	
-	img_list[0]  = src1;;
-	img2_list[0] = src2;
-	mask_list[0] = mask;
-	
-	for (unsigned int level=1; level<=steps; ++level)
+	//flow fields, which are already given, serve as initial flows of their levels
+	for (unsigned int level=flow_list.size(); level<=steps; ++level)
 	{
-		reduceToNextLevel(img_list[level-1], img_list[level]);
-		reduceToNextLevel(img2_list[level-1], img2_list[level]);
-		reduceToNextLevel(mask_list[level-1], mask_list[level]);
-		
-		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(img_list[level].shape()));
-		mat_list.push_back(MatrixType(3,3));
-		
+		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(src1_pyramid[level].shape()));
 	}
+	mat_list.resize(steps+1, MatrixType(3,3));
+	rotation_correlation_list.resize(steps+1, 0.0);
+	translation_correlation_list.resize(steps+1, 0.0);
 	
 	//work on that hierarchy	
 	for (std::list<unsigned int>::iterator iter = step_list.begin(); iter != step_list.end(); ++iter)
@@ -481,15 +651,16 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
 		
 		flow_func.setLevel(s);
 		
-		calculateOFCE(img_list[s],
-					  img2_list[s],
-					  mask_list[s],
+		calculateOFCE(src1_pyramid[s],
+					  src2_pyramid[s],
+					  mask_pyramid[s],
 					  flow_list[s],
 					  flow_func,
 					  use_gme,
                       mat_list[s],
                       rotation_correlation_list[s],
-                      translation_correlation_list[s]);
+                      translation_correlation_list[s],
+                      gme);
 		
 		if(next_iter != step_list.end() )
 		{
@@ -514,6 +685,110 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
 	}
 }
 
+/**
+ * Convenience overload of the second hierarchical approach, which builds
+ * the pyramids of both images and the mask (in parallel) before.
+ * See the overload for pyramids for a description of the parameters.
+ */
+template <	class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor>
+void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> & src1,
+											const vigra::MultiArrayView<2,T2> & src2,
+											const vigra::MultiArrayView<2,T3> & mask,
+                                            std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> > & flow_list,
+											OpticalFlowFunctor flow_func,
+											bool use_gme,
+                                            std::vector<MatrixType>& mat_list,
+                                            std::vector<double>& rotation_correlation_list,
+                                            std::vector<double>& translation_correlation_list,
+											unsigned int steps,
+											unsigned int break_level,
+											unsigned int hmode)
+{
+    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    vigra_precondition(src1.shape() == mask.shape() ,"image and mask sizes differ!");
+    
+	steps = hierarchicalSteps(src1.shape(), steps);
+	
+	//create gaussian pyramid hierarchy bottom->up
+	ImagePyramid<T1> src1_pyramid;
+	ImagePyramid<T2> src2_pyramid;
+	ImagePyramid<T3> mask_pyramid;
+	
+	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
+	
+	buildImagePyramids(src1, src1_pyramid, src2, src2_pyramid, mask, mask_pyramid, steps);
+	
+	calculateOFCEHierarchicallyInitialiser(src1_pyramid,
+	                                       src2_pyramid,
+	                                       mask_pyramid,
+	                                       flow_list,
+	                                       flow_func,
+	                                       use_gme,
+	                                       mat_list,
+	                                       rotation_correlation_list,
+	                                       translation_correlation_list,
+	                                       steps,
+	                                       break_level,
+	                                       hmode);
+}
+
+
+
+
+/**
+ * Warps the images of one level of the hierarchical approaches according to the
+ * (propagated) flow by means of a point-based registration functor, like the 
+ * WarpTPSFunctor: The flow field is subsampled to point correspondences and the 
+ * first image is warped to match the second image.
+ *
+ * \param[in,out] img1 The first image, which will be warped.
+ * \param[in,out] img2 The second image, which remains unchanged.
+ * \param[in] flow The flow field.
+ * \param[in] warp The registration functor.
+ * \param[in] warp_subsampling The subsampling of the flow field.
+ */
+template <class T1, class T2, class FlowValueType, class WarpingFunctor>
+void warpOFCELevel(vigra::MultiArray<2,T1> & img1,
+                   vigra::MultiArray<2,T2> & img2,
+                   const vigra::MultiArrayView<2,FlowValueType> & flow,
+                   WarpingFunctor warp,
+                   unsigned int warp_subsampling)
+{
+    //Prepare point list for warping
+    std::vector<Vectorfield2D::PointType> src_points, dest_points;
+    for(unsigned int y=0; y<(unsigned int)(flow.height()); y+=warp_subsampling)
+    {
+        for(unsigned int x=0; x<(unsigned int)(flow.width()); x+=warp_subsampling)
+        {
+            src_points.push_back(Vectorfield2D::PointType(x,y));
+            dest_points.push_back(Vectorfield2D::PointType(x+flow(x,y)[0], y+flow(x,y)[1]));
+        } 
+    }
+    //Call the warping functor
+    warp(img1, img1, src_points.begin(), src_points.end(), dest_points.begin());
+}
+
+/**
+ * Warps the images of one level of the hierarchical approaches according to the
+ * (propagated) flow by means of the dense warping functor: The second image is
+ * warped backwards, such that it matches the first image. No subsampling is needed.
+ *
+ * \param[in,out] img1 The first image, which remains unchanged.
+ * \param[in,out] img2 The second image, which will be warped.
+ * \param[in] flow The flow field.
+ * \param[in] warp The dense warping functor.
+ * \param[in] warp_subsampling Ignored.
+ */
+template <class T1, class T2, class FlowValueType>
+void warpOFCELevel(vigra::MultiArray<2,T1> & img1,
+                   vigra::MultiArray<2,T2> & img2,
+                   const vigra::MultiArrayView<2,FlowValueType> & flow,
+                   OpticalFlowDenseWarpFunctor warp,
+                   unsigned int warp_subsampling)
+{
+    warp(img2, img2, flow);
+}
+
 
 
 
@@ -521,7 +796,7 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
  * The third hierarchical Optical Flow estimation approach:
  *  
  *  a) Detect flow at level n
- *  b) use that (probably scaled) flow to warp the img_list image of next level.
+ *  b) use that (probably scaled) flow to warp the img_list (or img2_list) image of next level.
  *  c) save the flow at this level
  *  d) proceed with zero assumption flow at next level (n+1)
  *  e) ...
@@ -529,9 +804,9 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
  *
  * For each (a) the functor is called without a mask, but if selected with global motion estimation.
  *
- * \param[in] src1 First image of the series.
- * \param[in] src2 Second image of the series.
- * \param[out] img_list The resulting warped images during the steps.
+ * \param[in] src1_pyramid The pyramid of the first image of the series.
+ * \param[in] src2_pyramid The pyramid of the second image of the series.
+ * \param[out] img_list The resulting (warped) first images during the steps.
  * \param[out] flow_list The resulting Optical Flow fields during the steps.
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_gme If true, the global motion estimation be used prior to each computation.
@@ -541,13 +816,22 @@ void calculateOFCEHierarchicallyInitialiser(const vigra::MultiArrayView<2,T1> &
  * \param[in] steps Step count.
  * \param[in] break_level On wich level shall we finish/break the traversal.
  * \param[in] hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
- * \param[in] warp The functor, which is used for warping
+ * \param[in] warp The functor, which is used for warping. Point-based registration functors
+ *                 warp the first images, the OpticalFlowDenseWarpFunctor the second images.
  * \param[in] warp_subsampling The subsampling, wich is used for warping
  * \param[in] warp_sigma The sigma, which is used for smoothing the result before subsampling.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
+ * \param[out] img2_list The resulting (warped) second images during the steps (optional).
+ *
+ * The pyramids need to contain at least the given step count of levels (after
+ * the limitation by hierarchicalSteps). They may be reused by subsequent calls.
+ * If flow_list already contains the flow fields of some levels, these are used 
+ * as initial flows (e.g. at the highest level for a warm start, see initialiseFlow).
  */
 template <class T1, class T2, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
-void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1, 
-										const vigra::MultiArrayView<2,T2> & src2, 
+void calculateOFCEHierarchicallyWarping(const ImagePyramid<T1> & src1_pyramid, 
+										const ImagePyramid<T2> & src2_pyramid, 
 										std::vector<vigra::MultiArray<2, T1> >& img_list,
                                         std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> >& flow_list,
 										OpticalFlowFunctor flow_func,
@@ -560,35 +844,38 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 										unsigned int hmode,
 										WarpingFunctor warp,
 										unsigned int warp_subsampling,
-										float warp_sigma)
+										float warp_sigma,
+										GlobalMotionEstimator * gme = NULL,
+										std::vector<vigra::MultiArray<2, T2> > * img2_list = NULL)
 {
-    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    std::vector<vigra::MultiArray<2, T2> > local_img2_list;
+    if(img2_list == NULL)
+    {
+        img2_list = &local_img2_list;
+    }
+    
+    vigra_precondition(src1_pyramid[0].shape() == src2_pyramid[0].shape() ,"image sizes differ!");
     
     using namespace ::vigra::multi_math;
     
-	steps = std::min((double)steps, log((double)std::min(src1.width(), src1.height()))/log(2.0)-3);
+	steps = hierarchicalSteps(src1_pyramid[0].shape(), steps);
+	vigra_precondition(src1_pyramid.highestLevel() >= steps && src2_pyramid.highestLevel() >= steps, "image pyramids have too few levels!");
 	std::list<unsigned int> step_list = buildStepList(steps, break_level, hmode);
 	
-    //create gaussian pyramid hierarchy bottom->up
-	img_list.resize(steps+1);
-    std::vector<vigra::MultiArray<2,T2> >	img2_list(steps+1);
-    
-	vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> flow_res(src1.shape()), temp_res(src1.shape());
-	
-	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
+	//the images of the first (or second) pyramid will be warped
+	img_list.assign(src1_pyramid.levels().begin(), src1_pyramid.levels().begin()+steps+1);
+	img2_list->assign(src2_pyramid.levels().begin(), src2_pyramid.levels().begin()+steps+1);
 	
-	img_list[0]  = src1;
-	img2_list[0] = src2;
+	vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> flow_res(src1_pyramid[0].shape()), temp_res(src1_pyramid[0].shape());
 	
-	for (unsigned int level=1; level<=steps; ++level)
+	//flow fields, which are already given, serve as initial flows of their levels
+	for (unsigned int level=flow_list.size(); level<=steps; ++level)
 	{
-		reduceToNextLevel(img_list[level-1], img_list[level]);
-		reduceToNextLevel(img2_list[level-1], img2_list[level]);
-		
-		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(img_list[level].shape()));
-		mat_list.push_back(MatrixType(3,3));
-		
+		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(src1_pyramid[level].shape()));
 	}
+	mat_list.resize(steps+1, MatrixType(3,3));
+	rotation_correlation_list.resize(steps+1, 0.0);
+	translation_correlation_list.resize(steps+1, 0.0);
 	
 	//work on that hierarchy	
 	for (std::list<unsigned int>::iterator iter = step_list.begin(); iter != step_list.end(); ++iter)
@@ -601,13 +888,14 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 		
 		flow_func.setLevel(s);
 		
-		calculateOFCE(img_list[s], img2_list[s],
+		calculateOFCE(img_list[s], (*img2_list)[s],
                       flow_list[s],
 					  flow_func, 
 					  use_gme,
                       mat_list[s],
                       rotation_correlation_list[s],
-                      translation_correlation_list[s]);
+                      translation_correlation_list[s],
+                      gme);
         
 		if(next_iter != step_list.end() )
 		{
@@ -635,18 +923,8 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 				vigra::gaussianSmoothing(flow_list[next_s], flow_list[next_s], warp_sigma);
 			}
 			
-			//Prepare point list for warping
-			std::vector<Vectorfield2D::PointType> src_points, dest_points;
-			for(unsigned int y=0; y<(unsigned int)(flow_list[next_s].height()); y+=warp_subsampling)
-			{
-				for(unsigned int x=0; x<(unsigned int)(flow_list[next_s].width()); x+=warp_subsampling)
-				{
-					src_points.push_back(Vectorfield2D::PointType(x,y));
-					dest_points.push_back(Vectorfield2D::PointType(x+flow_list[next_s](x,y)[0], y+flow_list[next_s](x,y)[1]));
-				} 
-			}
-			//Call the warping functor
-			warp(img_list[next_s], img_list[next_s], src_points.begin(), src_points.end(), dest_points.begin());
+			//Warp the images of the next level
+			warpOFCELevel(img_list[next_s], (*img2_list)[next_s], flow_list[next_s], warp, warp_subsampling);
 			
 			//Delete (already corrected) motion estimate
 			flow_list[next_s] = typename OpticalFlowFunctor::FlowValueType();
@@ -666,10 +944,61 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 	flow_list[0] = flow_res;
 }
 
+/**
+ * Convenience overload of the third hierarchical approach, which builds
+ * the pyramids of both images (in parallel) before.
+ * See the overload for pyramids for a description of the parameters.
+ */
+template <class T1, class T2, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
+void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1, 
+										const vigra::MultiArrayView<2,T2> & src2, 
+										std::vector<vigra::MultiArray<2, T1> >& img_list,
+                                        std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> >& flow_list,
+										OpticalFlowFunctor flow_func,
+										bool use_gme, 
+                                        std::vector<MatrixType>& mat_list,
+                                        std::vector<double>& rotation_correlation_list,
+                                        std::vector<double>& translation_correlation_list,
+										unsigned int steps,  
+										unsigned int break_level, 
+										unsigned int hmode,
+										WarpingFunctor warp,
+										unsigned int warp_subsampling,
+										float warp_sigma)
+{
+    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    
+	steps = hierarchicalSteps(src1.shape(), steps);
+	
+	//create gaussian pyramid hierarchy bottom->up
+	ImagePyramid<T1> src1_pyramid;
+	ImagePyramid<T2> src2_pyramid;
+	
+	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
+	
+	buildImagePyramids(src1, src1_pyramid, src2, src2_pyramid, steps);
+	
+	calculateOFCEHierarchicallyWarping(src1_pyramid,
+	                                   src2_pyramid,
+	                                   img_list,
+	                                   flow_list,
+	                                   flow_func,
+	                                   use_gme,
+	                                   mat_list,
+	                                   rotation_correlation_list,
+	                                   translation_correlation_list,
+	                                   steps,
+	                                   break_level,
+	                                   hmode,
+	                                   warp,
+	                                   warp_subsampling,
+	                                   warp_sigma);
+}
+
 /**
  * The fourth hierarchical Optical Flow estimation approach:
  *  a) Detect flow at level n
- *  b) use that (probably scaled) flow to warp the img_list image of next level.
+ *  b) use that (probably scaled) flow to warp the img_list (or img2_list) image of next level.
  *  c) save the flow at this level
  *  d) proceed with zero assumption flow at next level (n+1)
  *  e) ...
@@ -677,10 +1006,10 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
  *
  * For each (a) the functor is called with a mask and if selected with global motion estimation.
  *
- * \param[in] src1 First image of the series.
- * \param[in] src2 Second image of the series.
- * \param[in] mask THe mask, where pixel values are assumed to be valid.
- * \param[out] img_list The resulting warped images during the steps.
+ * \param[in] src1_pyramid The pyramid of the first image of the series.
+ * \param[in] src2_pyramid The pyramid of the second image of the series.
+ * \param[in] mask_pyramid The pyramid of the mask, where pixel values are assumed to be valid.
+ * \param[out] img_list The resulting (warped) first images during the steps.
  * \param[out] flow_list The resulting Optical Flow fields during the steps.
  * \param[in] flow_func The used functor to compute the Optical Flow.
  * \param[in] use_gme If true, the global motion estimation be used prior to each computation.
@@ -690,14 +1019,23 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
  * \param steps Step count.
  * \param[in] break_level On wich level shall we finish/break the traversal.
  * \param[in] hmode The hierarchical traversal mode: (0: V, 1: Single W, 2: Full W)
- * \param[in] warp The functor, which is used for warping
+ * \param[in] warp The functor, which is used for warping. Point-based registration functors
+ *                 warp the first images, the OpticalFlowDenseWarpFunctor the second images.
  * \param[in] warp_subsampling The subsampling, wich is used for warping
  * \param[in] warp_sigma The sigma, which is used for smoothing the result before subsampling.
+ * \param[in] gme The global motion estimator, which may be reused by subsequent calls.
+ *                If NULL, vigra::estimateGlobalRotationTranslation is used.
+ * \param[out] img2_list The resulting (warped) second images during the steps (optional).
+ *
+ * The pyramids need to contain at least the given step count of levels (after
+ * the limitation by hierarchicalSteps). They may be reused by subsequent calls.
+ * If flow_list already contains the flow fields of some levels, these are used 
+ * as initial flows (e.g. at the highest level for a warm start, see initialiseFlow).
  */
 template <class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
-void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1,
-										const vigra::MultiArrayView<2,T2> & src2,
-										const vigra::MultiArrayView<2,T3> & mask,
+void calculateOFCEHierarchicallyWarping(const ImagePyramid<T1> & src1_pyramid,
+										const ImagePyramid<T2> & src2_pyramid,
+										const ImagePyramid<T3> & mask_pyramid,
 										std::vector<vigra::MultiArray<2,T1> >& img_list,
                                         std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> >& flow_list,
 										OpticalFlowFunctor flow_func,
@@ -710,39 +1048,39 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
                                         unsigned int hmode,
                                         WarpingFunctor warp,
                                         unsigned int warp_subsampling,
-                                        float warp_sigma)
+                                        float warp_sigma,
+                                        GlobalMotionEstimator * gme = NULL,
+                                        std::vector<vigra::MultiArray<2,T2> > * img2_list = NULL)
 {
-    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
-    vigra_precondition(src1.shape() == mask.shape() ,"image and mask sizes differ!");
+    std::vector<vigra::MultiArray<2,T2> > local_img2_list;
+    if(img2_list == NULL)
+    {
+        img2_list = &local_img2_list;
+    }
+    
+    vigra_precondition(src1_pyramid[0].shape() == src2_pyramid[0].shape() ,"image sizes differ!");
+    vigra_precondition(src1_pyramid[0].shape() == mask_pyramid[0].shape() ,"image and mask sizes differ!");
     
     using namespace ::vigra::multi_math;
     
-	steps = std::min((double)steps, log((double)std::min(src1.width(), src1.height()))/log(2.0)-3);
+	steps = hierarchicalSteps(src1_pyramid[0].shape(), steps);
+	vigra_precondition(src1_pyramid.highestLevel() >= steps && src2_pyramid.highestLevel() >= steps && mask_pyramid.highestLevel() >= steps, "image pyramids have too few levels!");
 	std::list<unsigned int> step_list = buildStepList(steps, break_level, hmode);
 	
-    //create gaussian pyramid hierarchy bottom->up
-	img_list.resize(steps+1);
-	std::vector<vigra::MultiArray<2,T2> >	img2_list(steps+1);
-	std::vector<vigra::MultiArray<2,T3> >	mask_list(steps+1);
+	//the images of the first (or second) pyramid will be warped
+	img_list.assign(src1_pyramid.levels().begin(), src1_pyramid.levels().begin()+steps+1);
+	img2_list->assign(src2_pyramid.levels().begin(), src2_pyramid.levels().begin()+steps+1);
 	
-	vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> flow_res(src1.shape()), temp_res(src1.shape());
+	vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> flow_res(src1_pyramid[0].shape()), temp_res(src1_pyramid[0].shape());
 	
-	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
-	
-	img_list[0] = src1;
-	img2_list[0] = src2;
-	mask_list[0] = mask;
-	
-	for (unsigned int level=1; level<=steps; ++level)
+	//flow fields, which are already given, serve as initial flows of their levels
+	for (unsigned int level=flow_list.size(); level<=steps; ++level)
 	{
-		reduceToNextLevel(img_list[level-1], img_list[level]);
-		reduceToNextLevel(img2_list[level-1], img2_list[level]);
-		reduceToNextLevel(mask_list[level-1], mask_list[level]);
-		
-		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(img_list[level].shape()));
-		mat_list.push_back(MatrixType(3,3));
-		
+		flow_list.push_back(vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType>(src1_pyramid[level].shape()));
 	}
+	mat_list.resize(steps+1, MatrixType(3,3));
+	rotation_correlation_list.resize(steps+1, 0.0);
+	translation_correlation_list.resize(steps+1, 0.0);
 	
 	//work on that hierarchy	
 	for (std::list<unsigned int>::iterator iter = step_list.begin(); iter != step_list.end(); ++iter)
@@ -756,14 +1094,15 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 		flow_func.setLevel(s);
 		
 		calculateOFCE(img_list[s],
-					  img2_list[s],
-					  mask_list[s],
+					  (*img2_list)[s],
+					  mask_pyramid[s],
 					  flow_list[s],
 					  flow_func,
 					  use_gme,
                       mat_list[s],
                       rotation_correlation_list[s],
-                      translation_correlation_list[s]);
+                      translation_correlation_list[s],
+                      gme);
         
 		if(next_iter != step_list.end() )
 		{
@@ -793,18 +1132,8 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 				vigra::gaussianSmoothing(flow_list[next_s], flow_list[next_s], warp_sigma);
 			}
 			
-			//Prepare point list for warping
-			std::vector<Vectorfield2D::PointType> src_points, dest_points;
-			for(unsigned int y=0; y<(unsigned int)(flow_list[next_s].height()); y+=warp_subsampling)
-			{
-				for(unsigned int x=0; x<(unsigned int)(flow_list[next_s].width()); x+=warp_subsampling)
-				{
-					src_points.push_back(Vectorfield2D::PointType(x,y));
-					dest_points.push_back(Vectorfield2D::PointType(x+flow_list[next_s](x,y)[0], y+flow_list[next_s](x,y)[1]));
-				} 
-			}
-			//Call the warping functor
-			warp(img_list[next_s], img_list[next_s], src_points.begin(), src_points.end(), dest_points.begin());
+			//Warp the images of the next level
+			warpOFCELevel(img_list[next_s], (*img2_list)[next_s], flow_list[next_s], warp, warp_subsampling);
 			
 			//Delete (already corrected) motion estimate
 			flow_list[next_s] = typename OpticalFlowFunctor::FlowValueType();
@@ -824,6 +1153,61 @@ void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1
 	flow_list[0] = flow_res;
 }
 
+/**
+ * Convenience overload of the fourth hierarchical approach, which builds
+ * the pyramids of both images and the mask (in parallel) before.
+ * See the overload for pyramids for a description of the parameters.
+ */
+template <class T1, class T2, class T3, class MatrixType, class OpticalFlowFunctor, class WarpingFunctor>
+void calculateOFCEHierarchicallyWarping(const vigra::MultiArrayView<2,T1> & src1,
+										const vigra::MultiArrayView<2,T2> & src2,
+										const vigra::MultiArrayView<2,T3> & mask,
+										std::vector<vigra::MultiArray<2,T1> >& img_list,
+                                        std::vector<vigra::MultiArray<2,typename OpticalFlowFunctor::FlowValueType> >& flow_list,
+										OpticalFlowFunctor flow_func,
+										bool use_gme,
+                                        std::vector<MatrixType>& mat_list,
+                                        std::vector<double>& rotation_correlation_list,
+                                        std::vector<double>& translation_correlation_list,
+                                        unsigned int steps,
+                                        unsigned int break_level,
+                                        unsigned int hmode,
+                                        WarpingFunctor warp,
+                                        unsigned int warp_subsampling,
+                                        float warp_sigma)
+{
+    vigra_precondition(src1.shape() == src2.shape() ,"image sizes differ!");
+    vigra_precondition(src1.shape() == mask.shape() ,"image and mask sizes differ!");
+    
+	steps = hierarchicalSteps(src1.shape(), steps);
+	
+	//create gaussian pyramid hierarchy bottom->up
+	ImagePyramid<T1> src1_pyramid;
+	ImagePyramid<T2> src2_pyramid;
+	ImagePyramid<T3> mask_pyramid;
+	
+	qDebug() << "Building gaussian pyramid for both images with " << steps << " levels";
+	
+	buildImagePyramids(src1, src1_pyramid, src2, src2_pyramid, mask, mask_pyramid, steps);
+	
+	calculateOFCEHierarchicallyWarping(src1_pyramid,
+	                                   src2_pyramid,
+	                                   mask_pyramid,
+	                                   img_list,
+	                                   flow_list,
+	                                   flow_func,
+	                                   use_gme,
+	                                   mat_list,
+	                                   rotation_correlation_list,
+	                                   translation_correlation_list,
+	                                   steps,
+	                                   break_level,
+	                                   hmode,
+	                                   warp,
+	                                   warp_subsampling,
+	                                   warp_sigma);
+}
+
 /**
  * @}
  */
@@ -146,6 +146,105 @@ Algorithm* createOpticalFlowCCEstimator(Workspace* wsp)
 	return new OpticalFlowCCEstimator(wsp);
 }
 
+/** 
+ * Creates one instance of the original Horn & Schunck Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowHSOriginalFunctor> >.
+ */
+Algorithm* createOpticalFlowHSOriginalBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowHSOriginalFunctor> >(wsp);
+}
+
+/** 
+ * Creates one instance of the Gaussian version of the Horn & Schunck Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowHSFunctor> >.
+ */
+Algorithm* createOpticalFlowHSBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowHSFunctor> >(wsp);
+}
+
+/** 
+ * Creates one instance of the Nagel & Enkelmann Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowNEFunctor> >.
+ */
+Algorithm* createOpticalFlowNEBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowHSEstimator<OpticalFlowNEFunctor> >(wsp);
+}
+
+/** 
+ * Creates one instance of the Lucas-Kanade Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowLKEstimator>.
+ */
+Algorithm* createOpticalFlowLKBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowLKEstimator>(wsp);
+}
+
+/** 
+ * Creates one instance of the Structure Tensor Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowTensorEstimator<OpticalFlowSTFunctor> >.
+ */
+Algorithm* createOpticalFlowSTBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowTensorEstimator<OpticalFlowSTFunctor> >(wsp);
+}
+
+/** 
+ * Creates one instance of the Verri's constant constrast Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowCCEstimator>.
+ */
+Algorithm* createOpticalFlowCCBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowCCEstimator>(wsp);
+}
+
+/** 
+ * Creates one instance of the Farnebaeck Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowFBEstimator>.
+ */
+Algorithm* createOpticalFlowFBBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowFBEstimator>(wsp);
+}
+
+/** 
+ * Creates one instance of the Combined Local Global Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowBruhnEstimator<OpticalFlowCLGFunctor> >.
+ */
+Algorithm* createOpticalFlowCLGBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowBruhnEstimator<OpticalFlowCLGFunctor> >(wsp);
+}
+
+/** 
+ * Creates one instance of the Non-linear version of the Combined Local Global Optical Flow
+ * algorithm defined above for image series.
+ *
+ * \return A new instance of the OpticalFlowBatchEstimator<OpticalFlowBruhnEstimator<OpticalFlowCLGNonlinearFunctor> >.
+ */
+Algorithm* createOpticalFlowCLGNonlinearBatchEstimator(Workspace* wsp)
+{
+	return new OpticalFlowBatchEstimator<OpticalFlowBruhnEstimator<OpticalFlowCLGNonlinearFunctor> >(wsp);
+}
+
 /**
  * Experimental algorithms are not working right now.
  * 
@@ -274,6 +373,54 @@ class OpticalFlowModule
 			alg_item.algorithm_fptr = &createOpticalFlowCLGNonlinearEstimator;
 			alg_factory.push_back(alg_item);
 			
+			//Batch mode of all methods above for image series
+            alg_item.topic_name = "Optical flow estimation (image series)";
+			
+			alg_item.algorithm_name = "Horn-Schunk method (original)";
+            alg_item.algorithm_type = "OpticalFlowHSOriginalEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowHSOriginalBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Horn-Schunk method (gaussian kernels)";
+            alg_item.algorithm_type = "OpticalFlowHSEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowHSBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Nagel-Enkelmann method";
+            alg_item.algorithm_type = "OpticalFlowNEEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowNEBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Lucas kanade method";
+            alg_item.algorithm_type = "OpticalFlowLKEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowLKBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Structure tensor method";
+            alg_item.algorithm_type = "OpticalFlowSTEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowSTBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Verri's constant contrast method";
+            alg_item.algorithm_type = "OpticalFlowCCEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowCCBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Farnebaeck method";
+            alg_item.algorithm_type = "OpticalFlowFBEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowFBBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Combined Local Global method (linear)";
+            alg_item.algorithm_type = "OpticalFlowCLGEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowCLGBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
+			alg_item.algorithm_name = "Combined Local Global method (nonlinear)";
+            alg_item.algorithm_type = "OpticalFlowCLGNonlinearEstimatorBatch";
+			alg_item.algorithm_fptr = &createOpticalFlowCLGNonlinearBatchEstimator;
+			alg_factory.push_back(alg_item);
+			
 			//Experimental algorithms are not working right now.
             //TODO: If possible, fix them. If not, discard them.
             /*
@@ -0,0 +1,869 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_OPTICALFLOW_OPTICALFLOWPARALLEL_HXX
+#define GRAIPE_OPTICALFLOW_OPTICALFLOWPARALLEL_HXX
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define GRAIPE_OPTICALFLOW_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+//Allow the compilation of SSE2/AVX2 kernels without global compiler flags
+#if defined(GRAIPE_OPTICALFLOW_X86) && defined(__GNUC__)
+    #define GRAIPE_OPTICALFLOW_TARGET_SSE2 __attribute__((target("sse2")))
+    #define GRAIPE_OPTICALFLOW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define GRAIPE_OPTICALFLOW_TARGET_SSE2
+    #define GRAIPE_OPTICALFLOW_TARGET_AVX2
+#endif
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Header file for the parallel and vectorized execution of the global Optical Flow algorithms.
+ */
+
+/**
+ * The instruction sets for the vectorized kernels.
+ */
+enum OpticalFlowSIMDMode
+{
+    /** Use the best available instruction set **/
+    OpticalFlowSIMDAuto   = 0,
+    /** No vectorization: Double precision, as the original loops **/
+    OpticalFlowSIMDScalar = 1,
+    /** SSE2: 4 pixels at once in single precision **/
+    OpticalFlowSIMDSSE2   = 2,
+    /** AVX2: 8 pixels at once in single precision **/
+    OpticalFlowSIMDAVX2   = 3
+};
+
+/**
+ * The precision of the intermediate values (derivatives, accumulators and
+ * per-pixel tensors) of the Optical Flow functors. The flow fields themselves
+ * are always stored in single precision.
+ */
+enum OpticalFlowPrecisionMode
+{
+    /** Double precision, as the original implementations **/
+    OpticalFlowPrecisionDouble = 0,
+    /** Single precision: Half the memory traffic and twice the vector width **/
+    OpticalFlowPrecisionFloat  = 1
+};
+
+/**
+ * The changes of the flow during one iteration (or a part of it).
+ */
+struct OpticalFlowChange
+{
+    /** Sum of the changes of all pixels **/
+    double sum;
+    /** The maximal change of a pixel **/
+    double max;
+};
+
+/**
+ * Checks if the CPU supports an instruction set.
+ *
+ * \param mode The instruction set, see OpticalFlowSIMDMode.
+ * \return True, if the kernels of the given mode can be used.
+ */
+inline bool opticalFlowSIMDAvailable(int mode)
+{
+    switch(mode)
+    {
+        case OpticalFlowSIMDAuto:
+        case OpticalFlowSIMDScalar:
+            return true;
+#if defined(GRAIPE_OPTICALFLOW_X86)
+    #if defined(__GNUC__)
+        case OpticalFlowSIMDSSE2:
+            return __builtin_cpu_supports("sse2");
+        case OpticalFlowSIMDAVX2:
+            return __builtin_cpu_supports("avx2");
+    #elif defined(_MSC_VER)
+        case OpticalFlowSIMDSSE2:
+        {
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1<<26)) != 0;
+        }
+        case OpticalFlowSIMDAVX2:
+        {
+            int info[4];
+            __cpuid(info, 1);
+            //AVX and OS support for saving the YMM registers
+            if((info[2] & (1<<27)) == 0 || (info[2] & (1<<28)) == 0 || (_xgetbv(0) & 6) != 6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1<<5)) != 0;
+        }
+    #endif
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * The scalar kernel of the Horn & Schunck-like update of one row:
+ * Each flow vector is computed from a mean (or predicted) flow vector f_m by
+ * projecting it onto the constraint line of the optical flow equation:
+ *
+ *     f = f_m - nabla(I) * (nabla(I)*f_m + I_t) / (alpha^2 + |nabla(I)|^2)
+ *
+ * \param[in] gx The gradients in x-direction.
+ * \param[in] gy The gradients in y-direction.
+ * \param[in] gt The gradients in temporal direction.
+ * \param[in] mean The mean flow vectors (interleaved u,v).
+ * \param[in,out] flow The flow vectors (interleaved u,v), which will be updated.
+ * \param[in] count The count of pixels.
+ * \param[in] alpha2 The squared smoothness weight alpha.
+ * \param[in,out] change The changes of the flow will be added here.
+ *
+ * The template parameter REAL defines the precision of the computations.
+ */
+template <class REAL>
+inline void opticalFlowProjectRowScalar(const float* gx, const float* gy, const float* gt,
+                                        const float* mean, float* flow, int count,
+                                        double alpha2, OpticalFlowChange & change)
+{
+    for(int i=0; i<count; ++i)
+    {
+        REAL	fix_part	= (gx[i]*mean[2*i] + gy[i]*mean[2*i+1] + gt[i])	/	(REAL(alpha2) + gx[i]*gx[i] + gy[i]*gy[i]),
+                new_u		= mean[2*i]   - fix_part*gx[i],
+                new_v		= mean[2*i+1] - fix_part*gy[i];
+        
+        REAL    du = flow[2*i]   - new_u,
+                dv = flow[2*i+1] - new_v;
+        
+        //Only the sum of the changes is accumulated in double precision
+        double iter_change = std::sqrt(du*du + dv*dv);
+        
+        change.sum += iter_change;
+        change.max = std::max(change.max, iter_change);
+        
+        flow[2*i]   = new_u;
+        flow[2*i+1] = new_v;
+    }
+}
+
+#if defined(GRAIPE_OPTICALFLOW_X86)
+
+/**
+ * The SSE2 kernel of the Horn & Schunck-like update of one row.
+ * See opticalFlowProjectRowScalar() for a description of the parameters.
+ */
+GRAIPE_OPTICALFLOW_TARGET_SSE2
+inline void opticalFlowProjectRowSSE2(const float* gx, const float* gy, const float* gt,
+                                      const float* mean, float* flow, int count,
+                                      double alpha2, OpticalFlowChange & change)
+{
+    const __m128 a2 = _mm_set1_ps((float)alpha2);
+    float changes[4];
+    
+    int i=0;
+    for(; i+4<=count; i+=4)
+    {
+        __m128  x  = _mm_loadu_ps(gx+i),
+                y  = _mm_loadu_ps(gy+i),
+                t  = _mm_loadu_ps(gt+i),
+                m0 = _mm_loadu_ps(mean+2*i),
+                m1 = _mm_loadu_ps(mean+2*i+4),
+                f0 = _mm_loadu_ps(flow+2*i),
+                f1 = _mm_loadu_ps(flow+2*i+4);
+        
+        //Deinterleave u and v
+        __m128  mu = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(2,0,2,0)),
+                mv = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(3,1,3,1)),
+                fu = _mm_shuffle_ps(f0, f1, _MM_SHUFFLE(2,0,2,0)),
+                fv = _mm_shuffle_ps(f0, f1, _MM_SHUFFLE(3,1,3,1));
+        
+        __m128  num = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mu), _mm_mul_ps(y, mv)), t),
+                den = _mm_add_ps(_mm_add_ps(a2, _mm_mul_ps(x, x)), _mm_mul_ps(y, y)),
+                fix = _mm_div_ps(num, den),
+                nu  = _mm_sub_ps(mu, _mm_mul_ps(fix, x)),
+                nv  = _mm_sub_ps(mv, _mm_mul_ps(fix, y)),
+                du  = _mm_sub_ps(fu, nu),
+                dv  = _mm_sub_ps(fv, nv);
+        
+        _mm_storeu_ps(changes, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(du, du), _mm_mul_ps(dv, dv))));
+        
+        for(int c=0; c!=4; ++c)
+        {
+            change.sum += changes[c];
+            change.max = std::max(change.max, (double)changes[c]);
+        }
+        
+        //Interleave u and v
+        _mm_storeu_ps(flow+2*i,   _mm_unpacklo_ps(nu, nv));
+        _mm_storeu_ps(flow+2*i+4, _mm_unpackhi_ps(nu, nv));
+    }
+    
+    opticalFlowProjectRowScalar<double>(gx+i, gy+i, gt+i, mean+2*i, flow+2*i, count-i, alpha2, change);
+}
+
+/**
+ * The AVX2 kernel of the Horn & Schunck-like update of one row.
+ * See opticalFlowProjectRowScalar() for a description of the parameters.
+ */
+GRAIPE_OPTICALFLOW_TARGET_AVX2
+inline void opticalFlowProjectRowAVX2(const float* gx, const float* gy, const float* gt,
+                                      const float* mean, float* flow, int count,
+                                      double alpha2, OpticalFlowChange & change)
+{
+    const __m256 a2 = _mm256_set1_ps((float)alpha2);
+    float changes[8];
+    
+    int i=0;
+    for(; i+8<=count; i+=8)
+    {
+        __m256  x  = _mm256_loadu_ps(gx+i),
+                y  = _mm256_loadu_ps(gy+i),
+                t  = _mm256_loadu_ps(gt+i),
+                m0 = _mm256_loadu_ps(mean+2*i),
+                m1 = _mm256_loadu_ps(mean+2*i+8),
+                f0 = _mm256_loadu_ps(flow+2*i),
+                f1 = _mm256_loadu_ps(flow+2*i+8);
+        
+        //Deinterleave u and v: The shuffles work per 128-bit lane, thus
+        //the 64-bit blocks need to be reordered afterwards
+        __m256  mu = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(2,0,2,0))), _MM_SHUFFLE(3,1,2,0))),
+                mv = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(3,1,3,1))), _MM_SHUFFLE(3,1,2,0))),
+                fu = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(f0, f1, _MM_SHUFFLE(2,0,2,0))), _MM_SHUFFLE(3,1,2,0))),
+                fv = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(f0, f1, _MM_SHUFFLE(3,1,3,1))), _MM_SHUFFLE(3,1,2,0)));
+        
+        __m256  num = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, mu), _mm256_mul_ps(y, mv)), t),
+                den = _mm256_add_ps(_mm256_add_ps(a2, _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)),
+                fix = _mm256_div_ps(num, den),
+                nu  = _mm256_sub_ps(mu, _mm256_mul_ps(fix, x)),
+                nv  = _mm256_sub_ps(mv, _mm256_mul_ps(fix, y)),
+                du  = _mm256_sub_ps(fu, nu),
+                dv  = _mm256_sub_ps(fv, nv);
+        
+        _mm256_storeu_ps(changes, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(du, du), _mm256_mul_ps(dv, dv))));
+        
+        for(int c=0; c!=8; ++c)
+        {
+            change.sum += changes[c];
+            change.max = std::max(change.max, (double)changes[c]);
+        }
+        
+        //Interleave u and v and restore the order of the 128-bit lanes
+        __m256  lo = _mm256_unpacklo_ps(nu, nv),
+                hi = _mm256_unpackhi_ps(nu, nv);
+        
+        _mm256_storeu_ps(flow+2*i,   _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(flow+2*i+8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    
+    opticalFlowProjectRowScalar<double>(gx+i, gy+i, gt+i, mean+2*i, flow+2*i, count-i, alpha2, change);
+}
+
+#endif //GRAIPE_OPTICALFLOW_X86
+
+/**
+ * The minimal count of pixels, for which the rows are processed in parallel by
+ * OpticalFlowExecution::parallelRows(). Below, the overhead of the threads
+ * exceeds the gain.
+ */
+const int opticalflow_min_parallel_pixels = 32768;
+
+/**
+ * The thread pool, which is shared by all parallel loops of the Optical Flow
+ * algorithms. It is not the global instance, since the calling thread may be
+ * a thread of the global pool itself.
+ *
+ * \return The Optical Flow thread pool.
+ */
+inline QThreadPool& opticalFlowThreadPool()
+{
+    static QThreadPool pool;
+    return pool;
+}
+
+/**
+ * Limits the count of threads, which are used by the parallel loops of the
+ * calling thread (see OpticalFlowExecution::parallelRows()), as long as the limit
+ * exists. This allows to share a thread budget between concurrent computations,
+ * e.g. the image pairs of a series, without changing their execution settings.
+ * The limit only reduces the count of helper threads, but not the decomposition
+ * of the loops, thus the results do not depend on it. Nested limits may only
+ * lower the limit.
+ */
+class OpticalFlowThreadLimit
+{
+    public:
+        /**
+         * Constructor. Sets the limit of the calling thread.
+         *
+         * \param threads The maximal count of threads. Zero or less means no limit.
+         */
+        explicit OpticalFlowThreadLimit(int threads)
+        :   m_previous(current())
+        {
+            if(threads > 0 && (m_previous == 0 || threads < m_previous))
+            {
+                current() = threads;
+            }
+        }
+    
+        /**
+         * Destructor. Restores the previous limit of the calling thread.
+         */
+        ~OpticalFlowThreadLimit()
+        {
+            current() = m_previous;
+        }
+    
+        /**
+         * The current limit of the calling thread.
+         *
+         * \return The maximal count of threads or zero, if there is no limit.
+         */
+        static int & current()
+        {
+            static thread_local int limit = 0;
+            return limit;
+        }
+    
+    private:
+        Q_DISABLE_COPY(OpticalFlowThreadLimit)
+    
+        /** The previous limit **/
+        int m_previous;
+};
+
+/**
+ * Allows to cancel the parallel loops of the calling thread (see 
+ * OpticalFlowExecution::parallelRows()), as long as the cancellation exists.
+ * Each loop checks the cancellation before it starts and before each block of
+ * rows. Once it has been requested, the remaining blocks are skipped and the
+ * loop throws an exception from the calling thread. Thus, an algorithm may
+ * be canceled during the (possibly long) iterations of its functors. The helper
+ * threads of a loop check the cancellation of the calling thread.
+ */
+class OpticalFlowCancellation
+{
+    public:
+        /**
+         * Constructor. Sets the cancellation of the calling thread.
+         *
+         * \param is_canceled The function, which checks, if the cancellation
+         *                    has been requested, e.g. Algorithm::isCanceled().
+         */
+        explicit OpticalFlowCancellation(const std::function<bool()> & is_canceled)
+        :   m_is_canceled(is_canceled),
+            m_parent(current()),
+            m_previous(current())
+        {
+            current() = this;
+        }
+    
+        /**
+         * Constructor. Sets the cancellation of another thread (e.g. the caller
+         * of a parallel loop) for the calling thread.
+         *
+         * \param parent The cancellation of the other thread. May be NULL.
+         */
+        explicit OpticalFlowCancellation(const OpticalFlowCancellation * parent)
+        :   m_parent(parent),
+            m_previous(current())
+        {
+            current() = this;
+        }
+    
+        /**
+         * Destructor. Restores the previous cancellation of the calling thread.
+         */
+        ~OpticalFlowCancellation()
+        {
+            current() = m_previous;
+        }
+    
+        /**
+         * Checks if the cancellation has been requested.
+         *
+         * eturn True, if this or an enclosing cancellation has been requested.
+         */
+        bool requested() const
+        {
+            return (m_is_canceled && m_is_canceled()) || (m_parent != NULL && m_parent->requested());
+        }
+    
+        /**
+         * Throws an exception, if the cancellation has been requested.
+         *
+         * \param cancellation The cancellation. Defaults to the one of the calling thread.
+         */
+        static void check(const OpticalFlowCancellation * cancellation = current())
+        {
+            if(cancellation != NULL && cancellation->requested())
+            {
+                throw std::runtime_error("The computation has been canceled.");
+            }
+        }
+    
+        /**
+         * The current cancellation of the calling thread.
+         *
+         * eturn The cancellation or NULL, if there is none.
+         */
+        static const OpticalFlowCancellation* & current()
+        {
+            static thread_local const OpticalFlowCancellation* cancellation = NULL;
+            return cancellation;
+        }
+    
+    private:
+        Q_DISABLE_COPY(OpticalFlowCancellation)
+    
+        /** The function, which checks the cancellation. May be empty **/
+        std::function<bool()> m_is_canceled;
+        /** The enclosing cancellation, which is checked, too **/
+        const OpticalFlowCancellation* m_parent;
+        /** The previous cancellation of the calling thread **/
+        const OpticalFlowCancellation* m_previous;
+};
+
+/**
+ * A parallel loop over blocks of rows for OpticalFlowExecution::parallelRows().
+ * The blocks are fetched by an atomic counter, both by the calling thread and by
+ * the helper runnables. Thus, the loop finishes even if no thread of the pool is
+ * free, e.g. for nested loops. The job is shared with the helpers, since these 
+ * may start after the calling thread has finished all blocks.
+ */
+class OpticalFlowRowsJob
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param rows_function The function, which processes the rows.
+         * \param first_row The first row.
+         * \param last_row The row after the last row.
+         * \param block_size The count of rows of each block.
+         */
+        OpticalFlowRowsJob(const std::function<void(int, int, OpticalFlowChange&)>& rows_function,
+                           int first_row, int last_row, int block_size)
+        :   m_rows_function(rows_function),
+            m_first_row(first_row),
+            m_last_row(last_row),
+            m_block_size(block_size),
+            m_block_count((last_row - first_row + block_size - 1)/block_size),
+            m_changes(m_block_count, OpticalFlowChange{0, 0}),
+            m_finished_blocks(0),
+            m_thread_limit(OpticalFlowThreadLimit::current()),
+            m_cancellation(OpticalFlowCancellation::current())
+        {
+        }
+    
+        /**
+         * Processes blocks of rows until all blocks have been fetched.
+         * Exceptions of the rows function are stored and rethrown by wait().
+         * After an exception or a cancellation, the remaining blocks are skipped.
+         */
+        void work()
+        {
+            //Nested loops of the helpers obey the limit and the cancellation of the calling thread
+            OpticalFlowThreadLimit limit(m_thread_limit);
+            OpticalFlowCancellation cancellation(m_cancellation);
+            
+            for(int b = m_next_block.fetchAndAddOrdered(1); b < m_block_count; b = m_next_block.fetchAndAddOrdered(1))
+            {
+                try
+                {
+                    if(!m_failed.loadAcquire())
+                    {
+                        OpticalFlowCancellation::check(m_cancellation);
+                        m_rows_function(m_first_row + b*m_block_size,
+                                        std::min(m_last_row, m_first_row + (b+1)*m_block_size),
+                                        m_changes[b]);
+                    }
+                }
+                catch(...)
+                {
+                    QMutexLocker locker(&m_mutex);
+                    if(!m_error)
+                    {
+                        m_error = std::current_exception();
+                    }
+                    m_failed.storeRelease(1);
+                }
+                
+                QMutexLocker locker(&m_mutex);
+                if(++m_finished_blocks == m_block_count)
+                {
+                    m_done.wakeAll();
+                }
+            }
+        }
+    
+        /**
+         * Waits until all blocks have been processed and sums up their changes
+         * in the order of the blocks.
+         *
+         * \return The changes of all rows.
+         */
+        OpticalFlowChange wait()
+        {
+            {
+                QMutexLocker locker(&m_mutex);
+                while(m_finished_blocks != m_block_count)
+                {
+                    m_done.wait(&m_mutex);
+                }
+            }
+            
+            if(m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+            
+            OpticalFlowChange change = {0, 0};
+            for(const OpticalFlowChange& c : m_changes)
+            {
+                change.sum += c.sum;
+                change.max = std::max(change.max, c.max);
+            }
+            return change;
+        }
+    
+        /**
+         * The count of blocks.
+         *
+         * \return The count of blocks.
+         */
+        int blockCount() const
+        {
+            return m_block_count;
+        }
+    
+    private:
+        /** The function, which processes the rows. Only called until wait() returns **/
+        const std::function<void(int, int, OpticalFlowChange&)>& m_rows_function;
+        /** The range of rows and their decomposition into blocks **/
+        int m_first_row, m_last_row, m_block_size, m_block_count;
+        /** The changes of each block **/
+        std::vector<OpticalFlowChange> m_changes;
+        /** The next block to be processed **/
+        QAtomicInt m_next_block;
+        /** Guards the count of finished blocks and the error **/
+        QMutex m_mutex;
+        /** Signalled, when all blocks are finished **/
+        QWaitCondition m_done;
+        /** The count of finished blocks **/
+        int m_finished_blocks;
+        /** The first exception thrown by the rows function **/
+        std::exception_ptr m_error;
+        /** Set, if the rows function has thrown an exception **/
+        QAtomicInt m_failed;
+        /** The thread limit of the calling thread **/
+        int m_thread_limit;        /** The cancellation of the calling thread **/
+        const OpticalFlowCancellation* m_cancellation;
+};
+
+/**
+ * Runnable, which helps processing an OpticalFlowRowsJob.
+ */
+class OpticalFlowRowsRunnable
+:   public QRunnable
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param job The job to work on.
+         */
+        OpticalFlowRowsRunnable(const std::shared_ptr<OpticalFlowRowsJob>& job)
+        :   m_job(job)
+        {
+        }
+    
+        /**
+         * Processes blocks of the job.
+         */
+        void run() override
+        {
+            m_job->work();
+        }
+    
+    private:
+        /** The job **/
+        std::shared_ptr<OpticalFlowRowsJob> m_job;
+};
+
+/**
+ * This class defines how the inner loops of the global Optical Flow functors
+ * are executed: By means of a given number of threads, which process blocks
+ * of rows in parallel, and by means of a given instruction set for the
+ * vectorized kernels. The default is the sequential scalar execution.
+ */
+class OpticalFlowExecution
+{
+    public:
+        /**
+         * Constructor of the execution settings.
+         *
+         * \param threads The count of threads. If zero, one thread per core is used.
+         * \param simd    The instruction set, see OpticalFlowSIMDMode. If the
+         *                CPU does not support it, the scalar kernel is used.
+         */
+        OpticalFlowExecution(int threads=1, int simd=OpticalFlowSIMDScalar)
+        :   m_threads(threads>0 ? threads : QThread::idealThreadCount()),
+            m_simd(simd)
+        {
+            if(m_simd == OpticalFlowSIMDAuto)
+            {
+                m_simd = opticalFlowSIMDAvailable(OpticalFlowSIMDAVX2) ? OpticalFlowSIMDAVX2
+                       : opticalFlowSIMDAvailable(OpticalFlowSIMDSSE2) ? OpticalFlowSIMDSSE2
+                       : OpticalFlowSIMDScalar;
+            }
+            else if(!opticalFlowSIMDAvailable(m_simd))
+            {
+                m_simd = OpticalFlowSIMDScalar;
+            }
+        }
+    
+        /**
+         * The count of threads.
+         *
+         * \return The count of threads used for the parallel loops.
+         */
+        int threads() const
+        {
+            return m_threads;
+        }
+    
+        /**
+         * The instruction set of the vectorized kernels.
+         *
+         * \return The (available) instruction set, see OpticalFlowSIMDMode.
+         */
+        int simd() const
+        {
+            return m_simd;
+        }
+    
+        /**
+         * Runs a function for blocks of rows in parallel and sums up their changes.
+         * The blocks are fixed for a given row range and thread count, and their
+         * changes are summed up in order, thus the results are reproducible.
+         * The blocks are processed by the calling thread and by the shared
+         * opticalFlowThreadPool(), at most by as many threads as allowed by the
+         * OpticalFlowThreadLimit of the calling thread. If the rows contain less than 
+         * opticalflow_min_parallel_pixels pixels, they are processed serially.
+         * If the OpticalFlowCancellation of the calling thread has been requested,
+         * the remaining blocks are skipped and an exception is thrown.
+         *
+         * \param first_row The first row.
+         * \param last_row The row after the last row.
+         * \param rows_function The function, which processes a block [first, last) of rows
+         *                      and adds its changes to the given OpticalFlowChange.
+         * \param row_pixels The count of pixels of each row. Zero for coarse work
+         *                   items (e.g. images), which are always processed in parallel.
+         * \return The changes of all rows.
+         */
+        OpticalFlowChange parallelRows(int first_row, int last_row,
+                                       const std::function<void(int, int, OpticalFlowChange&)>& rows_function,
+                                       int row_pixels = 0) const
+        {
+            OpticalFlowCancellation::check();
+            
+            OpticalFlowChange change = {0, 0};
+            
+            if(    m_threads == 1 || last_row - first_row < 2
+               || (row_pixels > 0 && double(last_row - first_row)*row_pixels < opticalflow_min_parallel_pixels))
+            {
+                rows_function(first_row, last_row, change);
+                return change;
+            }
+            
+            //A few blocks per thread to balance the load
+            int block_count = std::min(last_row - first_row, 4*m_threads);
+            int block_size  = (last_row - first_row + block_count - 1)/block_count;
+            
+            std::shared_ptr<OpticalFlowRowsJob> job = std::make_shared<OpticalFlowRowsJob>(rows_function, first_row, last_row, block_size);
+            
+            //The thread limit only reduces the count of helpers
+            int threads = std::min(m_threads, job->blockCount());
+            
+            if(OpticalFlowThreadLimit::current() > 0)
+            {
+                threads = std::min(threads, OpticalFlowThreadLimit::current());
+            }
+            
+            for(int t=1; t < threads; ++t)
+            {
+                opticalFlowThreadPool().start(new OpticalFlowRowsRunnable(job));
+            }
+            job->work();
+            
+            return job->wait();
+        }
+    
+        /**
+         * Performs the Horn & Schunck-like update of one row (see 
+         * opticalFlowProjectRowScalar()) using the selected kernel.
+         * The template parameter REAL defines the precision of the scalar kernel.
+         *
+         * \param[in] gx The gradients in x-direction.
+         * \param[in] gy The gradients in y-direction.
+         * \param[in] gt The gradients in temporal direction.
+         * \param[in] mean The mean flow vectors (interleaved u,v).
+         * \param[in,out] flow The flow vectors (interleaved u,v), which will be updated.
+         * \param[in] count The count of pixels.
+         * \param[in] alpha2 The squared smoothness weight alpha.
+         * \param[in,out] change The changes of the flow will be added here.
+         */
+        template <class REAL = double>
+        void projectRow(const float* gx, const float* gy, const float* gt,
+                        const float* mean, float* flow, int count,
+                        double alpha2, OpticalFlowChange & change) const
+        {
+            switch(m_simd)
+            {
+#if defined(GRAIPE_OPTICALFLOW_X86)
+                case OpticalFlowSIMDAVX2:
+                    opticalFlowProjectRowAVX2(gx, gy, gt, mean, flow, count, alpha2, change);
+                    break;
+                case OpticalFlowSIMDSSE2:
+                    opticalFlowProjectRowSSE2(gx, gy, gt, mean, flow, count, alpha2, change);
+                    break;
+#endif
+                default:
+                    opticalFlowProjectRowScalar<REAL>(gx, gy, gt, mean, flow, count, alpha2, change);
+            }
+        }
+    
+        /**
+         * Performs one sweep of a successive over-relaxation (or Gauss-Seidel)
+         * scheme with a 4-neighborhood over all inner pixels.
+         * For one thread, the pixels are processed in lexicographic order.
+         * Otherwise, the red-black ordering is used: Since the pixels of one color
+         * only depend on pixels of the other color, the rows can be processed in
+         * parallel for each color. Please note, that this may lead to (slightly)
+         * different results.
+         *
+         * \param width The width of the flow field.
+         * \param height The height of the flow field.
+         * \param pixel_function The update function, called as pixel_function(i, j).
+         *                       It updates the flow at (i,j) and returns its change.
+         *                       For more than one thread, the right and lower neighbors
+         *                       have to be taken from the current flow instead of the
+         *                       last iteration.
+         * \return The changes of all pixels.
+         */
+        template <class PIXEL_FUNCTION>
+        OpticalFlowChange sorSweep(int width, int height, PIXEL_FUNCTION pixel_function) const
+        {
+            OpticalFlowChange change = {0, 0};
+            
+            if(m_threads == 1)
+            {
+                OpticalFlowCancellation::check();
+                
+                for (int j=1; j<height-1; ++j)
+                {
+                    for (int i=1; i<width-1; ++i)
+                    {
+                        double iter_change = pixel_function(i, j);
+                        change.sum += iter_change;
+                        change.max = std::max(change.max, iter_change);
+                    }
+                }
+                return change;
+            }
+            
+            for(int color=0; color!=2; ++color)
+            {
+                OpticalFlowChange color_change = parallelRows(1, height-1, [&](int first_row, int last_row, OpticalFlowChange & rows_change)
+                {
+                    for (int j=first_row; j<last_row; ++j)
+                    {
+                        for (int i=1+(j+1+color)%2; i<width-1; i+=2)
+                        {
+                            double iter_change = pixel_function(i, j);
+                            rows_change.sum += iter_change;
+                            rows_change.max = std::max(rows_change.max, iter_change);
+                        }
+                    }
+                }, width);
+                change.sum += color_change.sum;
+                change.max = std::max(change.max, color_change.max);
+            }
+            return change;
+        }
+    
+    private:
+        /** The count of threads **/
+        int m_threads;
+        /** The instruction set **/
+        int m_simd;
+};
+
+/**
+ * @}
+ */
+    
+} //end of namespace graipe
+
+#endif //GRAIPE_OPTICALFLOW_OPTICALFLOWPARALLEL_HXX
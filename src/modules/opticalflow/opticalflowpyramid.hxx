@@ -0,0 +1,496 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_OPTICALFLOW_OPTICALFLOWPYRAMID_HXX
+#define GRAIPE_OPTICALFLOW_OPTICALFLOWPYRAMID_HXX
+
+#include "core/core.h"
+#include "images/images.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QSet>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <vector>
+
+//image representation
+#include <vigra/stdimage.hxx>
+#include <vigra/multi_array.hxx>
+
+//separable filters and resizing
+#include <vigra/convolution.hxx>
+#include <vigra/stdconvolution.hxx>
+#include <vigra/resizeimage.hxx>
+
+//Parallel execution
+#include "opticalflowparallel.hxx"
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Header file for the Gaussian image pyramids of the Optical Flow framework.
+ */
+
+/**
+ * Helper-function to get (via Gaussian reduction) from one image to next pyramid level's image
+ * Next means smaller image.
+ * \param[in] in The input image
+ * \param[out] out The reduced image.
+ */
+template <class T>
+void reduceToNextLevel(const vigra::MultiArrayView<2,T> & in, vigra::MultiArray<2,T> & out)
+{    
+    // image size at current level
+    unsigned int width  = (unsigned int)in.width(),
+                 height = (unsigned int)in.height();
+    
+    // image size at next smaller level
+    unsigned int newwidth  = (width + 1) / 2,
+                 newheight = (height + 1) / 2;
+    
+    // resize result image to appropriate size
+    out.reshape(vigra::Shape2(newwidth, newheight));
+    
+    // define a Gaussian kernel (size 5x1)
+    vigra::Kernel1D<double> filter;
+    filter.initExplicitly(-2, 2) = 0.05, 0.25, 0.4, 0.25, 0.05;
+    
+    vigra::MultiArray<2,T> temp(in.shape()), temp2(in.shape());
+    
+    // smooth (band limit) input image
+    vigra::separableConvolveX(in,   temp, filter);
+    vigra::separableConvolveY(temp, temp2, filter);
+                       
+    // downsample smoothed image
+    vigra::resizeImageNoInterpolation(temp2, out);
+}
+
+/**
+ * A Gaussian image pyramid. Level 0 holds the image itself, each further level
+ * is reduced by a factor of two using graipe::reduceToNextLevel. The pyramid
+ * may be built once and then be reused by several Optical Flow computations.
+ */
+template <class T>
+class ImagePyramid
+{
+    public:
+        /**
+         * Default constructor. Creates an empty pyramid.
+         */
+        ImagePyramid()
+        {
+        }
+    
+        /**
+         * Constructor, which builds the pyramid of an image.
+         *
+         * \param image The image at level 0.
+         * \param highest_level The highest (smallest) level of the pyramid.
+         */
+        ImagePyramid(const vigra::MultiArrayView<2,T> & image, unsigned int highest_level)
+        {
+            build(image, highest_level);
+        }
+    
+        /**
+         * (Re-)builds the pyramid of an image.
+         *
+         * \param image The image at level 0.
+         * \param highest_level The highest (smallest) level of the pyramid.
+         */
+        void build(const vigra::MultiArrayView<2,T> & image, unsigned int highest_level)
+        {
+            m_levels.resize(1);
+            m_levels[0] = image;
+            
+            extend(highest_level);
+        }
+    
+        /**
+         * Adds further levels to a non-empty pyramid. Existing levels are kept.
+         *
+         * \param highest_level The new highest (smallest) level of the pyramid.
+         */
+        void extend(unsigned int highest_level)
+        {
+            vigra_precondition(!empty(), "ImagePyramid::extend(): the pyramid is empty!");
+            
+            for (unsigned int level=m_levels.size(); level<=highest_level; ++level)
+            {
+                m_levels.push_back(vigra::MultiArray<2,T>());
+                reduceToNextLevel(m_levels[level-1], m_levels[level]);
+            }
+        }
+    
+        /**
+         * Returns if the pyramid has not been built yet.
+         *
+         * \return True, if the pyramid contains no levels.
+         */
+        bool empty() const
+        {
+            return m_levels.empty();
+        }
+    
+        /**
+         * Returns the highest (smallest) level of a non-empty pyramid.
+         *
+         * \return The highest level.
+         */
+        unsigned int highestLevel() const
+        {
+            return m_levels.size()-1;
+        }
+    
+        /**
+         * Const access to one level of the pyramid.
+         *
+         * \param level The level, 0 is the original image.
+         * \return The image at that level.
+         */
+        const vigra::MultiArray<2,T> & operator[](unsigned int level) const
+        {
+            return m_levels[level];
+        }
+    
+        /**
+         * Const access to all levels of the pyramid.
+         *
+         * \return The images of all levels, starting at level 0.
+         */
+        const std::vector<vigra::MultiArray<2,T> > & levels() const
+        {
+            return m_levels;
+        }
+    
+    private:
+        /** The images of the levels **/
+        std::vector<vigra::MultiArray<2,T> > m_levels;
+};
+
+/**
+ * Builds the pyramids of two images of the same size in parallel.
+ *
+ * \param[in] image1 The first image.
+ * \param[out] pyramid1 The pyramid of the first image.
+ * \param[in] image2 The second image.
+ * \param[out] pyramid2 The pyramid of the second image.
+ * \param[in] highest_level The highest (smallest) level of the pyramids.
+ */
+template <class T1, class T2>
+void buildImagePyramids(const vigra::MultiArrayView<2,T1> & image1, ImagePyramid<T1> & pyramid1,
+                        const vigra::MultiArrayView<2,T2> & image2, ImagePyramid<T2> & pyramid2,
+                        unsigned int highest_level)
+{
+    OpticalFlowExecution(2).parallelRows(0, 2, [&](int first, int last, OpticalFlowChange &)
+    {
+        for (int i=first; i<last; ++i)
+        {
+            if (i == 0)
+                pyramid1.build(image1, highest_level);
+            else
+                pyramid2.build(image2, highest_level);
+        }
+    });
+}
+
+/**
+ * Builds the pyramids of three images (e.g. two images and a mask) of the same
+ * size in parallel.
+ *
+ * \param[in] image1 The first image.
+ * \param[out] pyramid1 The pyramid of the first image.
+ * \param[in] image2 The second image.
+ * \param[out] pyramid2 The pyramid of the second image.
+ * \param[in] image3 The third image.
+ * \param[out] pyramid3 The pyramid of the third image.
+ * \param[in] highest_level The highest (smallest) level of the pyramids.
+ */
+template <class T1, class T2, class T3>
+void buildImagePyramids(const vigra::MultiArrayView<2,T1> & image1, ImagePyramid<T1> & pyramid1,
+                        const vigra::MultiArrayView<2,T2> & image2, ImagePyramid<T2> & pyramid2,
+                        const vigra::MultiArrayView<2,T3> & image3, ImagePyramid<T3> & pyramid3,
+                        unsigned int highest_level)
+{
+    OpticalFlowExecution(3).parallelRows(0, 3, [&](int first, int last, OpticalFlowChange &)
+    {
+        for (int i=first; i<last; ++i)
+        {
+            if (i == 0)
+                pyramid1.build(image1, highest_level);
+            else if (i == 1)
+                pyramid2.build(image2, highest_level);
+            else
+                pyramid3.build(image3, highest_level);
+        }
+    });
+}
+
+/**
+ * A cache for the pyramids of image bands, which belongs to a workspace (see
+ * ImagePyramidCache::cache()). Since a pyramid only depends on the image band
+ * itself, subsequent Optical Flow computations on the same bands (e.g. parameter
+ * sweeps over alpha or the iterations) can reuse it. The pyramids are shared and
+ * constant, thus they are never copied by the cache. A pyramid is rebuilt, if the
+ * content revision of its image (see Image::revision()) has changed since it was
+ * built. Model::modelChanged() is not observed, because locking and unlocking the
+ * image emit it, too, which would discard the pyramids after each run. All pyramids
+ * of an image are removed, when it is deleted. The cache keeps the most recently 
+ * used pyramids.
+ */
+class ImagePyramidCache
+:   public QObject
+{
+    public:
+        /** The type of the shared (constant) pyramids **/
+        typedef std::shared_ptr<const ImagePyramid<float> > PyramidPointer;
+    
+        /**
+         * Returns the pyramid cache of a workspace. It is created on demand and
+         * deleted together with the workspace.
+         *
+         * \param wsp The workspace.
+         * \return The pyramid cache of the workspace.
+         */
+        static ImagePyramidCache* cache(Workspace* wsp)
+        {
+            QMutexLocker locker(&wsp->caches_mutex);
+            
+            QObject* & cache = wsp->caches["graipe::ImagePyramidCache"];
+            
+            if (cache == NULL)
+            {
+                cache = new ImagePyramidCache;
+            }
+            return static_cast<ImagePyramidCache*>(cache);
+        }
+    
+        /**
+         * Returns the pyramid of an image band, which reaches (at least) the given
+         * level. If the cached pyramid of the band has less levels, it is extended.
+         * Missing pyramids are built and inserted into the cache.
+         *
+         * \param image The image model, which contains the band.
+         * \param band_id The index of the band in the image.
+         * \param band The band itself.
+         * \param highest_level The highest (smallest) level of the pyramid.
+         * \return The shared pyramid of the band.
+         */
+        PyramidPointer pyramid(const Image<float>* image, unsigned int band_id, const vigra::MultiArrayView<2,float> & band,
+                               unsigned int highest_level)
+        {
+            PyramidPointer cached;
+            unsigned int revision;
+            
+            {
+                QMutexLocker locker(&m_mutex);
+                
+                revision = m_revision;
+                
+                for (std::list<Entry>::iterator iter = m_entries.begin(); iter != m_entries.end(); ++iter)
+                {
+                    if (iter->image == image && iter->band_id == band_id)
+                    {
+                        //The image has changed or the band is replaced: rebuild
+                        if (   iter->image_revision != image->revision()
+                            || iter->shape != band.shape() || iter->data != band.data())
+                        {
+                            m_entries.erase(iter);
+                            break;
+                        }
+                        
+                        //Most recently used first
+                        m_entries.splice(m_entries.begin(), m_entries, iter);
+                        cached = iter->pyramid;
+                        break;
+                    }
+                }
+            }
+            
+            if (cached && cached->highestLevel() >= highest_level)
+            {
+                return cached;
+            }
+            
+            //Build or extend the pyramid without holding the lock
+            std::shared_ptr<ImagePyramid<float> > pyramid;
+            
+            if (cached)
+            {
+                pyramid = std::make_shared<ImagePyramid<float> >(*cached);
+                pyramid->extend(highest_level);
+            }
+            else
+            {
+                pyramid = std::make_shared<ImagePyramid<float> >(band, highest_level);
+            }
+            
+            insert(image, image->revision(), band_id, band, pyramid, revision);
+            return pyramid;
+        }
+    
+        /**
+         * Removes all pyramids of an image from the cache.
+         * This is done automatically, when the image is deleted.
+         *
+         * \param image The image model.
+         */
+        void invalidate(const Model* image)
+        {
+            QMutexLocker locker(&m_mutex);
+            
+            ++m_revision;
+            
+            m_entries.remove_if([image](const Entry & entry)
+                                {
+                                    return entry.image == image;
+                                });
+        }
+    
+        /**
+         * The maximal count of cached pyramids.
+         *
+         * \return Always 8.
+         */
+        static unsigned int capacity()
+        {
+            return 8;
+        }
+    
+    private:
+        /**
+         * Default constructor. Use cache() to get the cache of a workspace.
+         */
+        ImagePyramidCache()
+        :   m_revision(0)
+        {
+        }
+    
+        /**
+         * Inserts (or replaces) a pyramid in the cache. If the cache is full, the
+         * least recently used pyramid is removed. Nothing is inserted, if any image
+         * has been invalidated since the given revision, because the pyramid may be
+         * outdated.
+         * 
+         * \param image The image model, which contains the band.
+         * \param image_revision The content revision of the image, when the pyramid was built.
+         * \param band_id The index of the band in the image.
+         * \param band The band itself.
+         * \param pyramid The pyramid of the band.
+         * \param revision The revision of the cache before the pyramid was built.
+         */
+        void insert(const Model* image, unsigned int image_revision,
+                    unsigned int band_id, const vigra::MultiArrayView<2,float> & band,
+                    const PyramidPointer & pyramid, unsigned int revision)
+        {
+            QMutexLocker locker(&m_mutex);
+            
+            if (revision != m_revision)
+            {
+                return;
+            }
+            
+            m_entries.remove_if([image, band_id](const Entry & entry)
+                                {
+                                    return entry.image == image && entry.band_id == band_id;
+                                });
+            
+            Entry entry = {image, image_revision, band_id, band.shape(), band.data(), pyramid};
+            m_entries.push_front(entry);
+            
+            while (m_entries.size() > capacity())
+            {
+                m_entries.pop_back();
+            }
+            
+            //Remove the pyramids as soon as the image is deleted
+            if (!m_images.contains(image))
+            {
+                m_images.insert(image);
+                
+                connect(image, &QObject::destroyed, this, [this, image]()
+                        {
+                            invalidate(image);
+                            
+                            QMutexLocker locker(&m_mutex);
+                            m_images.remove(image);
+                        }, Qt::DirectConnection);
+            }
+        }
+    
+        /**
+         * An entry of the cache.
+         */
+        struct Entry
+        {
+            /** The image model **/
+            const Model* image;
+            /** The content revision of the image model **/
+            unsigned int image_revision;
+            /** The index of the band **/
+            unsigned int band_id;
+            /** The shape of the band **/
+            vigra::Shape2 shape;
+            /** The data of the band, to detect replaced bands **/
+            const float* data;
+            /** The pyramid of the band **/
+            PyramidPointer pyramid;
+        };
+    
+        /** The cached pyramids, the most recently used first **/
+        std::list<Entry> m_entries;
+        /** The images, whose deletion is observed **/
+        QSet<const Model*> m_images;
+        /** Incremented at each invalidation **/
+        unsigned int m_revision;
+        /** The mutex to protect the cache **/
+        QMutex m_mutex;
+};
+
+/**
+ * @}
+ */
+    
+} //end of namespace graipe
+
+#endif //GRAIPE_OPTICALFLOW_OPTICALFLOWPYRAMID_HXX
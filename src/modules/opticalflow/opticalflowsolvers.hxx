@@ -0,0 +1,469 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_OPTICALFLOW_OPTICALFLOWSOLVERS_HXX
+#define GRAIPE_OPTICALFLOW_OPTICALFLOWSOLVERS_HXX
+
+//debug output
+#include <QtDebug>
+
+#include <vigra/multi_array.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Header file for the iterative solvers of the Horn & Schunck-like Optical Flow algorithms.
+ */
+
+/**
+ * The available solver backends for the Horn & Schunck-like functors.
+ */
+enum OpticalFlowSolverType
+{
+    /** Plain Jacobi iterations (the functor's original scheme) **/
+    OpticalFlowJacobiSolver = 0,
+    /** Red-black successive over-relaxation **/
+    OpticalFlowRedBlackSORSolver = 1,
+    /** Multigrid V-cycles with red-black Gauss-Seidel smoothing **/
+    OpticalFlowMultigridSolver = 2
+};
+
+/**
+ * This class solves the linear system of equations of the Horn & Schunck approach,
+ * which reads for each pixel p:
+ *
+ *     a*(u_p - M(u)_p) + J11_p*u_p + J12_p*v_p = b1_p
+ *     a*(v_p - M(v)_p) + J12_p*u_p + J22_p*v_p = b2_p
+ *
+ * where a = alpha^2, J = nabla(I)*nabla(I)^T, b = -nabla(I)*I_t and M is
+ * the weighted mean of the 8-neighborhood as proposed in Horn & Schunck 1981
+ * (1/6 for the direct and 1/12 for the diagonal neighbors). At the image
+ * borders, the neighbors are repeated. Only pixels marked as active are updated.
+ *
+ * Each (Jacobi-like) step of the original algorithm solves the 2x2 system of a
+ * pixel with the means taken from the last iteration. The red-black SOR solver
+ * uses the already updated means instead and over-relaxes the result by omega.
+ * The multigrid solver uses the red-black Gauss-Seidel step as a smoother and
+ * corrects the flow by means of the error computed at coarser grids (V-cycle).
+ *
+ * All solvers may stop early, if the maximal change of an iteration (or V-cycle)
+ * falls below a given epsilon.
+ */
+class OpticalFlowHSSolver
+{
+    public:
+        /** The single value type of a flow field **/
+        typedef float ValueType;
+        /** The flow vector type. 2 elements: u,v **/
+        typedef vigra::TinyVector<ValueType,2> FlowValueType;
+    
+        /**
+         * Constructor of the solver.
+         *
+         * \param solver  The solver type, see OpticalFlowSolverType.
+         * \param omega   The relaxation factor for the SOR solver (0 < omega < 2).
+         * \param epsilon The iterations will be stopped, if the maximal change of
+         *                the flow falls below epsilon. If zero, all iterations are performed.
+         */
+        OpticalFlowHSSolver(int solver=OpticalFlowJacobiSolver, double omega=1.9, double epsilon=0.0)
+        :   m_solver(solver),
+            m_omega(omega),
+            m_epsilon(epsilon)
+        {
+        }
+    
+        /**
+         * The solver type.
+         *
+         * \return The solver type, see OpticalFlowSolverType.
+         */
+        int solver() const
+        {
+            return m_solver;
+        }
+    
+        /**
+         * Checks if the changes of one iteration indicate convergence.
+         *
+         * \param mean_change The mean change of the flow in the last iteration.
+         * \param max_change  The maximal change of the flow in the last iteration.
+         * \return True, if epsilon is set and the max. change has fallen below it.
+         */
+        bool converged(double mean_change, double max_change) const
+        {
+            return m_epsilon > 0 && max_change < m_epsilon && mean_change < m_epsilon;
+        }
+    
+        /**
+         * Solves the system of equations using the selected solver (except for Jacobi,
+         * which is performed by the functors themselves).
+         *
+         * \param[in] J11 The first component of the motion tensor.
+         * \param[in] J12 The mixed component of the motion tensor.
+         * \param[in] J22 The second component of the motion tensor.
+         * \param[in] b1 The right hand side for u.
+         * \param[in] b2 The right hand side for v.
+         * \param[in] active Non-zero for all pixels, which shall be updated.
+         * \param[in] alpha The smoothness weight alpha.
+         * \param[in] iterations The max. count of iterations (SOR) or V-cycles (multigrid).
+         * \param[in,out] flow The flow, initialized with the starting values.
+         * \return The count of performed iterations.
+         */
+        int solve(const vigra::MultiArrayView<2,ValueType> & J11,
+                  const vigra::MultiArrayView<2,ValueType> & J12,
+                  const vigra::MultiArrayView<2,ValueType> & J22,
+                  const vigra::MultiArrayView<2,ValueType> & b1,
+                  const vigra::MultiArrayView<2,ValueType> & b2,
+                  const vigra::MultiArrayView<2,vigra::UInt8> & active,
+                  double alpha, int iterations,
+                  vigra::MultiArrayView<2,FlowValueType> flow) const
+        {
+            //Set up the finest level
+            std::vector<Level> levels(1);
+            
+            levels[0].a = alpha*alpha;
+            levels[0].J11 = J11; levels[0].J12 = J12; levels[0].J22 = J22;
+            levels[0].b1  = b1;  levels[0].b2  = b2;
+            levels[0].active = active;
+            levels[0].x = flow;
+            
+            if(m_solver == OpticalFlowMultigridSolver)
+            {
+                //Coarsen the system until it gets too small
+                while(levels.back().x.width() >= 8 && levels.back().x.height() >= 8)
+                {
+                    levels.push_back(Level());
+                    restrictSystem(levels[levels.size()-2], levels.back());
+                }
+            }
+            
+            vigra::MultiArray<2,FlowValueType> last_flow(flow.shape());
+            
+            int iteration=1;
+            
+            for(; iteration<=iterations; ++iteration)
+            {
+                double mean_change=0, max_change=0;
+                
+                if(m_solver == OpticalFlowMultigridSolver)
+                {
+                    last_flow = levels[0].x;
+                    
+                    vCycle(levels, 0);
+                    
+                    for(int j=0; j<flow.height(); ++j)
+                    {
+                        for(int i=0; i<flow.width(); ++i)
+                        {
+                            double iter_change = vigra::norm(last_flow(i,j) - levels[0].x(i,j));
+                            mean_change += iter_change;
+                            max_change = std::max(max_change, iter_change);
+                        }
+                    }
+                }
+                else
+                {
+                    redBlackSweep(levels[0], m_omega, mean_change, max_change);
+                }
+                
+                mean_change = mean_change / flow.size();
+                
+                if(converged(mean_change, max_change))
+                {
+                    break;
+                }
+            }
+            
+            flow = levels[0].x;
+            
+            return std::min(iteration, iterations);
+        }
+    
+    private:
+        /**
+         * The system of equations at one level of the multigrid hierarchy.
+         */
+        struct Level
+        {
+            /** The smoothness weight, a = alpha^2 at the finest level **/
+            double a;
+            /** The motion tensor and the right hand side **/
+            vigra::MultiArray<2,ValueType> J11, J12, J22, b1, b2;
+            /** The pixels, which are updated **/
+            vigra::MultiArray<2,vigra::UInt8> active;
+            /** The current solution **/
+            vigra::MultiArray<2,FlowValueType> x;
+        };
+    
+        /**
+         * Computes the weighted mean M(x) of the 8-neighborhood.
+         *
+         * \param x The flow.
+         * \param i The x-coordinate.
+         * \param j The y-coordinate.
+         * \return The weighted mean.
+         */
+        static FlowValueType neighborMean(const vigra::MultiArray<2,FlowValueType> & x, int i, int j)
+        {
+            const int im = std::max(i-1, 0), ip = std::min(i+1, (int)x.width()-1),
+                      jm = std::max(j-1, 0), jp = std::min(j+1, (int)x.height()-1);
+            
+            return  (x(im,j)  + x(ip,j)  + x(i,jm)  + x(i,jp)) /6.0f
+                  + (x(im,jm) + x(ip,jm) + x(im,jp) + x(ip,jp))/12.0f;
+        }
+    
+        /**
+         * Performs one red-black Gauss-Seidel/SOR sweep on a level.
+         *
+         * \param[in,out] L The level.
+         * \param[in] omega The relaxation factor.
+         * \param[in,out] mean_change The sum of all changes will be added here.
+         * \param[in,out] max_change The max. change will be updated.
+         */
+        static void redBlackSweep(Level & L, double omega, double & mean_change, double & max_change)
+        {
+            const double a = L.a;
+            
+            for(int color=0; color!=2; ++color)
+            {
+                for(int j=0; j<L.x.height(); ++j)
+                {
+                    for(int i=(j+color)%2; i<L.x.width(); i+=2)
+                    {
+                        if(L.active(i,j) == 0)
+                        {
+                            continue;
+                        }
+                        
+                        FlowValueType mean = neighborMean(L.x, i, j);
+                        
+                        double  a11 = a + L.J11(i,j),
+                                a12 = L.J12(i,j),
+                                a22 = a + L.J22(i,j),
+                                r1  = L.b1(i,j) + a*mean[0],
+                                r2  = L.b2(i,j) + a*mean[1],
+                                det = a11*a22 - a12*a12;
+                        
+                        if(det == 0)
+                        {
+                            continue;
+                        }
+                        
+                        FlowValueType & x = L.x(i,j);
+                        
+                        double  new_u = (1.0-omega)*x[0] + omega*(a22*r1 - a12*r2)/det,
+                                new_v = (1.0-omega)*x[1] + omega*(a11*r2 - a12*r1)/det;
+                        
+                        double iter_change = sqrt((x[0]-new_u)*(x[0]-new_u) + (x[1]-new_v)*(x[1]-new_v));
+                        mean_change += iter_change;
+                        max_change = std::max(max_change, iter_change);
+                        
+                        x[0] = new_u;
+                        x[1] = new_v;
+                    }
+                }
+            }
+        }
+    
+        /**
+         * Restricts the motion tensor and the activity of a fine level to a coarse
+         * level by averaging 2x2 pixels. Since the grid spacing doubles, the
+         * smoothness weight is divided by four.
+         *
+         * \param[in] fine The fine level.
+         * \param[out] coarse The coarse level.
+         */
+        static void restrictSystem(const Level & fine, Level & coarse)
+        {
+            vigra::Shape2 shape((fine.x.width()+1)/2, (fine.x.height()+1)/2);
+            
+            coarse.a = fine.a/4.0;
+            coarse.J11.reshape(shape); coarse.J12.reshape(shape); coarse.J22.reshape(shape);
+            coarse.b1.reshape(shape);  coarse.b2.reshape(shape);
+            coarse.active.reshape(shape);
+            coarse.x.reshape(shape);
+            
+            for(int j=0; j<shape[1]; ++j)
+            {
+                for(int i=0; i<shape[0]; ++i)
+                {
+                    double j11=0, j12=0, j22=0;
+                    int count=0;
+                    
+                    for(int fj=2*j; fj<std::min(2*j+2, (int)fine.x.height()); ++fj)
+                    {
+                        for(int fi=2*i; fi<std::min(2*i+2, (int)fine.x.width()); ++fi)
+                        {
+                            j11 += fine.J11(fi,fj); j12 += fine.J12(fi,fj); j22 += fine.J22(fi,fj);
+                            count++;
+                            
+                            if(fine.active(fi,fj))
+                            {
+                                coarse.active(i,j) = 1;
+                            }
+                        }
+                    }
+                    coarse.J11(i,j) = j11/count; coarse.J12(i,j) = j12/count; coarse.J22(i,j) = j22/count;
+                }
+            }
+        }
+    
+        /**
+         * Restricts the residual of a fine level to the right hand side of the
+         * coarse level.
+         *
+         * \param[in] fine The fine level.
+         * \param[out] coarse The coarse level.
+         */
+        static void restrictResidual(const Level & fine, Level & coarse)
+        {
+            const double a = fine.a;
+            
+            coarse.b1.init(0); coarse.b2.init(0);
+            vigra::MultiArray<2,int> count(coarse.b1.shape());
+            
+            for(int j=0; j<fine.x.height(); ++j)
+            {
+                for(int i=0; i<fine.x.width(); ++i)
+                {
+                    count(i/2,j/2)++;
+                    
+                    if(fine.active(i,j) == 0)
+                    {
+                        continue;
+                    }
+                    
+                    FlowValueType mean = neighborMean(fine.x, i, j);
+                    const FlowValueType & x = fine.x(i,j);
+                    
+                    coarse.b1(i/2,j/2) += fine.b1(i,j) + a*mean[0] - (a + fine.J11(i,j))*x[0] - fine.J12(i,j)*x[1];
+                    coarse.b2(i/2,j/2) += fine.b2(i,j) + a*mean[1] - fine.J12(i,j)*x[0] - (a + fine.J22(i,j))*x[1];
+                }
+            }
+            
+            coarse.b1 /= count;
+            coarse.b2 /= count;
+        }
+    
+        /**
+         * Adds the bilinearly interpolated error of a coarse level to the solution
+         * of the fine level.
+         *
+         * \param[in] coarse The coarse level.
+         * \param[in,out] fine The fine level.
+         */
+        static void prolongateError(const Level & coarse, Level & fine)
+        {
+            const int cw = coarse.x.width(), ch = coarse.x.height();
+            
+            for(int j=0; j<fine.x.height(); ++j)
+            {
+                int cj = j/2,
+                    nj = std::max(0, std::min(ch-1, (j%2) ? cj+1 : cj-1));
+                
+                for(int i=0; i<fine.x.width(); ++i)
+                {
+                    if(fine.active(i,j) == 0)
+                    {
+                        continue;
+                    }
+                    
+                    int ci = i/2,
+                        ni = std::max(0, std::min(cw-1, (i%2) ? ci+1 : ci-1));
+                    
+                    fine.x(i,j) +=   coarse.x(ci,cj)*(9.0f/16.0f) + coarse.x(ni,cj)*(3.0f/16.0f)
+                                   + coarse.x(ci,nj)*(3.0f/16.0f) + coarse.x(ni,nj)*(1.0f/16.0f);
+                }
+            }
+        }
+    
+        /**
+         * Performs one V-cycle starting at a given level.
+         *
+         * \param levels The multigrid hierarchy.
+         * \param l The index of the current level.
+         */
+        static void vCycle(std::vector<Level> & levels, unsigned int l)
+        {
+            double mean_change=0, max_change=0;
+            
+            if(l+1 == levels.size())
+            {
+                //Coarsest level: Just smooth a few times
+                for(int s=0; s!=20; ++s)
+                {
+                    redBlackSweep(levels[l], 1.0, mean_change, max_change);
+                }
+                return;
+            }
+            
+            //Pre-smoothing
+            redBlackSweep(levels[l], 1.0, mean_change, max_change);
+            redBlackSweep(levels[l], 1.0, mean_change, max_change);
+            
+            //Coarse grid correction
+            restrictResidual(levels[l], levels[l+1]);
+            levels[l+1].x.init(FlowValueType(0.0));
+            vCycle(levels, l+1);
+            prolongateError(levels[l+1], levels[l]);
+            
+            //Post-smoothing
+            redBlackSweep(levels[l], 1.0, mean_change, max_change);
+            redBlackSweep(levels[l], 1.0, mean_change, max_change);
+        }
+    
+        /** The solver type **/
+        int m_solver;
+        /** The relaxation factor for SOR **/
+        double m_omega;
+        /** The threshold for early stopping **/
+        double m_epsilon;
+};
+
+/**
+ * @}
+ */
+    
+} //end of namespace graipe
+
+#endif //GRAIPE_OPTICALFLOW_OPTICALFLOWSOLVERS_HXX
@@ -0,0 +1,336 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_OPTICALFLOW_OPTICALFLOWWARPING_HXX
+#define GRAIPE_OPTICALFLOW_OPTICALFLOWWARPING_HXX
+
+#include <QString>
+
+#include <algorithm>
+#include <vector>
+
+//image representation
+#include <vigra/multi_array.hxx>
+#include <vigra/numerictraits.hxx>
+
+//Parallel and vectorized execution
+#include "opticalflowparallel.hxx"
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Header file for the dense (backward) warping of images by means of a flow field.
+ */
+
+/**
+ * The interpolation methods of the dense warping.
+ */
+enum OpticalFlowWarpInterpolation
+{
+    /** Bilinear interpolation of the 2x2 neighborhood **/
+    OpticalFlowWarpBilinear = 0,
+    /** Bicubic (Keys, a=-0.5) interpolation of the 4x4 neighborhood **/
+    OpticalFlowWarpBicubic  = 1
+};
+
+/**
+ * The scalar kernel of the bilinear backward warping of one row:
+ *
+ *     dest(i) = img(x + i + u(i), y + v(i))
+ *
+ * Positions outside the image are clamped to the image borders.
+ *
+ * \param[in] img The (contiguous) image, which will be sampled.
+ * \param[in] width The width of the image.
+ * \param[in] height The height of the image.
+ * \param[in] x The column of the first pixel.
+ * \param[in] y The row, which will be warped.
+ * \param[in] u The x-components of the flow of the row.
+ * \param[in] v The y-components of the flow of the row.
+ * \param[out] dest The warped row.
+ * \param[in] count The count of pixels.
+ */
+inline void opticalFlowWarpRowBilinearScalar(const float* img, int width, int height, int x, int y,
+                                             const float* u, const float* v, float* dest, int count)
+{
+    for(int i=0; i<count; ++i)
+    {
+        float	px = std::min(std::max(float(x + i) + u[i], 0.0f), float(width-1)),
+                py = std::min(std::max(float(y) + v[i], 0.0f), float(height-1));
+        
+        int		x0 = int(px), x1 = std::min(x0+1, width-1),
+                y0 = int(py), y1 = std::min(y0+1, height-1);
+        
+        float	fx = px - float(x0),
+                fy = py - float(y0);
+        
+        dest[i] =   (1.0f-fy)*((1.0f-fx)*img[y0*width+x0] + fx*img[y0*width+x1])
+                  +       fy *((1.0f-fx)*img[y1*width+x0] + fx*img[y1*width+x1]);
+    }
+}
+
+/**
+ * The weights of the cubic convolution kernel (Keys, a=-0.5) for the four
+ * neighbors at the offsets -1, 0, 1 and 2 of a sampling position.
+ *
+ * \param[in] f The fractional part of the sampling position.
+ * \param[out] w The four weights.
+ */
+inline void opticalFlowCubicWeights(float f, float* w)
+{
+    float f2 = f*f, f3 = f2*f;
+    
+    w[0] = -0.5f*f3 +      f2 - 0.5f*f;
+    w[1] =  1.5f*f3 - 2.5f*f2 + 1.0f;
+    w[2] = -1.5f*f3 + 2.0f*f2 + 0.5f*f;
+    w[3] =  0.5f*f3 - 0.5f*f2;
+}
+
+/**
+ * The scalar kernel of the bicubic backward warping of one row.
+ * See opticalFlowWarpRowBilinearScalar() for a description of the parameters.
+ */
+inline void opticalFlowWarpRowBicubicScalar(const float* img, int width, int height, int x, int y,
+                                            const float* u, const float* v, float* dest, int count)
+{
+    for(int i=0; i<count; ++i)
+    {
+        float	px = std::min(std::max(float(x + i) + u[i], 0.0f), float(width-1)),
+                py = std::min(std::max(float(y) + v[i], 0.0f), float(height-1));
+        
+        int		x0 = int(px),
+                y0 = int(py);
+        
+        float wx[4], wy[4];
+        opticalFlowCubicWeights(px - float(x0), wx);
+        opticalFlowCubicWeights(py - float(y0), wy);
+        
+        float res = 0;
+        
+        for(int n=0; n!=4; ++n)
+        {
+            const float* row = img + std::min(std::max(y0+n-1, 0), height-1)*width;
+            
+            float row_res = 0;
+            for(int m=0; m!=4; ++m)
+            {
+                row_res += wx[m]*row[std::min(std::max(x0+m-1, 0), width-1)];
+            }
+            res += wy[n]*row_res;
+        }
+        dest[i] = res;
+    }
+}
+
+#if defined(GRAIPE_OPTICALFLOW_X86)
+
+/**
+ * The AVX2 kernel of the bilinear backward warping of one row. It gathers the
+ * neighbors of eight pixels at once and computes the same results as the scalar
+ * kernel. See opticalFlowWarpRowBilinearScalar() for a description of the parameters.
+ */
+GRAIPE_OPTICALFLOW_TARGET_AVX2
+inline void opticalFlowWarpRowBilinearAVX2(const float* img, int width, int height, int x, int y,
+                                           const float* u, const float* v, float* dest, int count)
+{
+    const __m256    zero    = _mm256_setzero_ps(),
+                    one     = _mm256_set1_ps(1.0f),
+                    max_x   = _mm256_set1_ps(float(width-1)),
+                    max_y   = _mm256_set1_ps(float(height-1)),
+                    row     = _mm256_set1_ps(float(y)),
+                    offsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    
+    const __m256i   last_x  = _mm256_set1_epi32(width-1),
+                    last_y  = _mm256_set1_epi32(height-1),
+                    stride  = _mm256_set1_epi32(width),
+                    one_i   = _mm256_set1_epi32(1);
+    
+    int i=0;
+    for(; i+8<=count; i+=8)
+    {
+        __m256  px = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(float(x + i)), offsets), _mm256_loadu_ps(u+i)),
+                py = _mm256_add_ps(row, _mm256_loadu_ps(v+i));
+        
+        px = _mm256_min_ps(_mm256_max_ps(px, zero), max_x);
+        py = _mm256_min_ps(_mm256_max_ps(py, zero), max_y);
+        
+        //The positions are not negative, thus truncation equals flooring
+        __m256i x0 = _mm256_cvttps_epi32(px),
+                y0 = _mm256_cvttps_epi32(py),
+                x1 = _mm256_min_epi32(_mm256_add_epi32(x0, one_i), last_x),
+                y1 = _mm256_min_epi32(_mm256_add_epi32(y0, one_i), last_y),
+                r0 = _mm256_mullo_epi32(y0, stride),
+                r1 = _mm256_mullo_epi32(y1, stride);
+        
+        __m256  fx  = _mm256_sub_ps(px, _mm256_cvtepi32_ps(x0)),
+                fy  = _mm256_sub_ps(py, _mm256_cvtepi32_ps(y0)),
+                gx  = _mm256_sub_ps(one, fx),
+                gy  = _mm256_sub_ps(one, fy),
+                p00 = _mm256_i32gather_ps(img, _mm256_add_epi32(r0, x0), 4),
+                p01 = _mm256_i32gather_ps(img, _mm256_add_epi32(r0, x1), 4),
+                p10 = _mm256_i32gather_ps(img, _mm256_add_epi32(r1, x0), 4),
+                p11 = _mm256_i32gather_ps(img, _mm256_add_epi32(r1, x1), 4);
+        
+        __m256  top    = _mm256_add_ps(_mm256_mul_ps(gx, p00), _mm256_mul_ps(fx, p01)),
+                bottom = _mm256_add_ps(_mm256_mul_ps(gx, p10), _mm256_mul_ps(fx, p11));
+        
+        _mm256_storeu_ps(dest+i, _mm256_add_ps(_mm256_mul_ps(gy, top), _mm256_mul_ps(fy, bottom)));
+    }
+    
+    opticalFlowWarpRowBilinearScalar(img, width, height, x+i, y, u+i, v+i, dest+i, count-i);
+}
+
+#endif //GRAIPE_OPTICALFLOW_X86
+
+/**
+ * This class represents the dense backward warping functor. In contrast to the
+ * point-based registration functors (like the WarpTPSFunctor), it does not need
+ * to fit a transformation to subsampled point correspondences. Each pixel is 
+ * directly sampled at its position moved by the flow vector:
+ *
+ *     dest(x,y) = src(x + u(x,y), y + v(x,y))
+ *
+ * The rows are warped in parallel. The bilinear warping uses the AVX2 kernel if
+ * it has been selected and is available; the bicubic warping is always scalar.
+ */
+class OpticalFlowDenseWarpFunctor
+{
+    public:
+        /**
+         * Constructor of the dense warping functor.
+         *
+         * \param interpolation The interpolation method, see OpticalFlowWarpInterpolation.
+         * \param execution The execution settings (threads and instruction set).
+         */
+        OpticalFlowDenseWarpFunctor(int interpolation = OpticalFlowWarpBilinear,
+                                    const OpticalFlowExecution & execution = OpticalFlowExecution())
+        :   m_interpolation(interpolation),
+            m_execution(execution)
+        {
+        }
+    
+        /**
+         * The functor call. It warps the source image backwards by means of the flow field,
+         * such that it matches the image, the flow starts from. The source and destination
+         * may be the same image.
+         *
+         * \param[in] src The image, which will be warped.
+         * \param[out] dest The warped image.
+         * \param[in] flow The flow field (u,v,...).
+         */
+        template <class T1, class T2, class FlowValueType>
+        void operator()(const vigra::MultiArrayView<2, T1> & src, vigra::MultiArrayView<2, T2> dest,
+                        const vigra::MultiArrayView<2, FlowValueType> & flow) const
+        {
+            vigra_precondition(src.shape() == dest.shape(), "image sizes differ!");
+            vigra_precondition(src.shape() == flow.shape(), "flow array sizes differ from image sizes!");
+            
+            //Contiguous single precision copy for the kernels, which also allows in-place warping
+            vigra::MultiArray<2,float> source(src);
+            
+            const int width = src.width(), height = src.height();
+            
+            m_execution.parallelRows(0, height, [&](int first_row, int last_row, OpticalFlowChange &)
+            {
+                std::vector<float> u(width), v(width), warped(width);
+                
+                for(int y=first_row; y<last_row; ++y)
+                {
+                    for(int x=0; x<width; ++x)
+                    {
+                        u[x] = flow(x,y)[0];
+                        v[x] = flow(x,y)[1];
+                    }
+                    
+                    warpRow(source.data(), width, height, y, u.data(), v.data(), warped.data());
+                    
+                    for(int x=0; x<width; ++x)
+                    {
+                        dest(x,y) = vigra::NumericTraits<T2>::fromRealPromote(warped[x]);
+                    }
+                }
+            }, width);
+        }
+    
+        /**
+         * The name of this functor.
+         *
+         * \return "Dense bilinear warping" or "Dense bicubic warping".
+         */
+        QString name() const
+        {
+            return (m_interpolation == OpticalFlowWarpBicubic) ? "Dense bicubic warping" : "Dense bilinear warping";
+        }
+    
+    private:
+        /**
+         * Warps one row using the selected interpolation and kernel.
+         * See opticalFlowWarpRowBilinearScalar() for a description of the parameters.
+         */
+        void warpRow(const float* img, int width, int height, int y,
+                     const float* u, const float* v, float* dest) const
+        {
+            if(m_interpolation == OpticalFlowWarpBicubic)
+            {
+                opticalFlowWarpRowBicubicScalar(img, width, height, 0, y, u, v, dest, width);
+                return;
+            }
+#if defined(GRAIPE_OPTICALFLOW_X86)
+            if(m_execution.simd() == OpticalFlowSIMDAVX2)
+            {
+                opticalFlowWarpRowBilinearAVX2(img, width, height, 0, y, u, v, dest, width);
+                return;
+            }
+#endif
+            opticalFlowWarpRowBilinearScalar(img, width, height, 0, y, u, v, dest, width);
+        }
+    
+        /** The interpolation method **/
+        int m_interpolation;
+        /** The execution (threads and instruction set) **/
+        OpticalFlowExecution m_execution;
+};
+
+/**
+ * @}
+ */
+    
+} //end of namespace graipe
+
+#endif //GRAIPE_OPTICALFLOW_OPTICALFLOWWARPING_HXX
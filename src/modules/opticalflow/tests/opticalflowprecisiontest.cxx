@@ -0,0 +1,301 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "opticalflow/opticalflow_local.hxx"
+#include "opticalflow/opticalflow_global.hxx"
+
+#include <vigra/multi_array.hxx>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Accuracy regression test of the single precision Optical Flow path
+ *
+ * Usage: opticalflowprecisiontest [width height]
+ *
+ * A smooth random texture is sampled once directly and once moved by a 
+ * synthetic flow (a subpixel translation and a small rotation around the image
+ * center), thus no interpolation errors are introduced. Each functor is run with
+ * double and with single precision intermediate values (see compute<REAL>()).
+ * For both paths, the mean endpoint error against the true flow and the runtime
+ * are reported, together with the mean endpoint difference between both paths.
+ * The program returns a non-zero exit code if the single precision path is
+ * less accurate than the double path by more than the tolerance.
+ */
+
+using namespace graipe;
+
+/**
+ * A smooth random texture, which is the sum of gaussian blobs.
+ */
+class Texture
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param width  The width of the area, which is covered by the blobs.
+         * \param height The height of the area, which is covered by the blobs.
+         */
+        Texture(int width, int height)
+        {
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            
+            int blobs = width*height/25;
+            
+            for(int i=0; i<blobs; ++i)
+            {
+                m_x.push_back((unit(rng)*1.5 - 0.25)*width);
+                m_y.push_back((unit(rng)*1.5 - 0.25)*height);
+                m_sigma.push_back(2.0 + 3.0*unit(rng));
+                m_amplitude.push_back(100.0*(2.0*unit(rng) - 1.0));
+            }
+        }
+    
+        /**
+         * Returns the texture's value at a (subpixel) position.
+         *
+         * \param x The x-coordinate.
+         * \param y The y-coordinate.
+         * \return The value at (x,y).
+         */
+        double operator()(double x, double y) const
+        {
+            double value = 128;
+            
+            for(unsigned int i=0; i<m_x.size(); ++i)
+            {
+                double dx = x - m_x[i], dy = y - m_y[i];
+                double d2 = dx*dx + dy*dy;
+                
+                if(d2 < 25*m_sigma[i]*m_sigma[i])
+                {
+                    value += m_amplitude[i]*std::exp(-d2/(2*m_sigma[i]*m_sigma[i]));
+                }
+            }
+            return value;
+        }
+    
+    private:
+        /** The blobs **/
+        std::vector<double> m_x, m_y, m_sigma, m_amplitude;
+};
+
+/**
+ * A synthetic image pair together with its true flow.
+ */
+struct SyntheticFlow
+{
+    /** The name of the motion **/
+    std::string name;
+    /** The first and second image **/
+    vigra::MultiArray<2, float> image1, image2;
+    /** The true flow (u,v) at each pixel of the first image **/
+    vigra::MultiArray<2, vigra::TinyVector<float,2> > flow;
+};
+
+/**
+ * Creates an image pair, where the second image is the first one rotated around
+ * its center and translated afterwards.
+ *
+ * \param texture The texture of the first image.
+ * \param name    The name of the motion.
+ * \param width   The width of the images.
+ * \param height  The height of the images.
+ * \param angle   The rotation angle in degrees.
+ * \param tx      The translation in x-direction.
+ * \param ty      The translation in y-direction.
+ * \return The image pair and its true flow.
+ */
+SyntheticFlow syntheticFlow(const Texture & texture, const std::string & name,
+                            int width, int height,
+                            double angle, double tx, double ty)
+{
+    SyntheticFlow result;
+    result.name = name;
+    result.image1.reshape(vigra::Shape2(width, height));
+    result.image2.reshape(vigra::Shape2(width, height));
+    result.flow.reshape(vigra::Shape2(width, height));
+    
+    double phi = angle*M_PI/180.0, c = std::cos(phi), s = std::sin(phi);
+    double cx = (width-1)/2.0, cy = (height-1)/2.0;
+    
+    for(int y=0; y<height; ++y)
+    {
+        for(int x=0; x<width; ++x)
+        {
+            result.image1(x,y) = texture(x,y);
+            
+            //Forward motion of the first image's pixel
+            double dx = x - cx, dy = y - cy;
+            result.flow(x,y)[0] = c*dx - s*dy + cx + tx - x;
+            result.flow(x,y)[1] = s*dx + c*dy + cy + ty - y;
+            
+            //Backward motion: Where does the second image's pixel come from?
+            dx = x - tx - cx;
+            dy = y - ty - cy;
+            result.image2(x,y) = texture( c*dx + s*dy + cx,
+                                         -s*dx + c*dy + cy);
+        }
+    }
+    return result;
+}
+
+/**
+ * Returns the mean endpoint error of a flow inside the image without a border,
+ * where the functors have no (or unreliable) results.
+ *
+ * \param flow      The estimated flow.
+ * \param reference The reference flow.
+ * \param border    The width of the ignored border.
+ * \return The mean endpoint error.
+ */
+template <class F1, class F2>
+double meanEndpointError(const vigra::MultiArray<2, F1> & flow,
+                         const vigra::MultiArray<2, F2> & reference,
+                         int border)
+{
+    double sum = 0;
+    int count = 0;
+    
+    for(int y=border; y<flow.height()-border; ++y)
+    {
+        for(int x=border; x<flow.width()-border; ++x)
+        {
+            double du = flow(x,y)[0] - reference(x,y)[0],
+                   dv = flow(x,y)[1] - reference(x,y)[1];
+            
+            sum += std::sqrt(du*du + dv*dv);
+            ++count;
+        }
+    }
+    return (count != 0) ? sum/count : 0.0;
+}
+
+/**
+ * Runs a functor with double and with single precision on all synthetic flows,
+ * prints the errors and runtimes and checks the accuracy of the single precision path.
+ *
+ * \param name      The name of the functor.
+ * \param func      The functor.
+ * \param flows     The synthetic flows.
+ * \param tolerance The maximal (mean endpoint) deviation of the single precision path.
+ * \return The number of failed checks.
+ */
+template <class OpticalFlowFunctor>
+int testPrecision(const std::string & name, OpticalFlowFunctor func,
+                  const std::vector<SyntheticFlow> & flows, double tolerance)
+{
+    typedef typename OpticalFlowFunctor::FlowValueType FlowValueType;
+    
+    const int border = 16;
+    int failures = 0;
+    
+    for(const SyntheticFlow & synthetic : flows)
+    {
+        vigra::MultiArray<2, FlowValueType> double_flow(synthetic.image1.shape()),
+                                            float_flow(synthetic.image1.shape());
+        
+        auto start = std::chrono::steady_clock::now();
+        func.template compute<double>(synthetic.image1, synthetic.image2, double_flow);
+        auto middle = std::chrono::steady_clock::now();
+        func.template compute<float>(synthetic.image1, synthetic.image2, float_flow);
+        auto end = std::chrono::steady_clock::now();
+        
+        double double_error = meanEndpointError(double_flow, synthetic.flow, border),
+               float_error  = meanEndpointError(float_flow,  synthetic.flow, border),
+               difference   = meanEndpointError(float_flow,  double_flow,    border);
+        
+        double double_ms = std::chrono::duration<double, std::milli>(middle - start).count(),
+               float_ms  = std::chrono::duration<double, std::milli>(end - middle).count();
+        
+        std::printf("%-6s %-12s | %10.5f %10.5f %10.2e | %9.1f %9.1f %7.2f\n",
+                    name.c_str(), synthetic.name.c_str(),
+                    double_error, float_error, difference,
+                    double_ms, float_ms, double_ms/float_ms);
+        
+        if(float_error > double_error + tolerance || difference > tolerance)
+        {
+            std::printf("  ERROR: the single precision path deviates by more than %g pixels\n", tolerance);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    int width  = (argc > 1) ? std::atoi(argv[1]) : 128;
+    int height = (argc > 2) ? std::atoi(argv[2]) : 128;
+    
+    const double tolerance = 0.01;
+    
+    Texture texture(width, height);
+    
+    std::vector<SyntheticFlow> flows;
+    flows.push_back(syntheticFlow(texture, "translation", width, height, 0.0, 0.6, -0.4));
+    flows.push_back(syntheticFlow(texture, "rotation", width, height, 1.0, 0.0, 0.0));
+    
+    int failures = 0;
+    
+    std::printf("Optical Flow on %dx%d images, mean endpoint errors in pixels, times in ms\n", width, height);
+    std::printf("%-6s %-12s | %10s %10s %10s | %9s %9s %7s\n",
+                "func.", "motion", "double", "float", "|f-d|", "double", "float", "speedup");
+    
+    failures += testPrecision("HS",   OpticalFlowHSOriginalFunctor(10.0, 200), flows, tolerance);
+    failures += testPrecision("GAHS", OpticalFlowHSFunctor(10.0, 200, 1.0),     flows, tolerance);
+    failures += testPrecision("NE",   OpticalFlowNEFunctor(10.0, 200, 1.0),     flows, tolerance);
+    failures += testPrecision("LK",   OpticalFlowLKFunctor(1.0, 11, 0.0, 10),   flows, tolerance);
+    failures += testPrecision("ST",   OpticalFlowSTFunctor(1.0, 3.0, 11, 0.0, 10), flows, tolerance);
+    failures += testPrecision("CC",   OpticalFlowCCFunctor(1.0, 0.0, 10),       flows, tolerance);
+    failures += testPrecision("FB",   OpticalFlowFBFunctor(1.0, 11, 0.0, 10),   flows, tolerance);
+    
+    return (failures == 0) ? 0 : 1;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,124 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "opticalflow/opticalflowpyramid.hxx"
+#include "images/images.h"
+
+#include <cstdio>
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Regression test of the image pyramid cache
+ *
+ * Usage: opticalflowpyramidcachetest
+ *
+ * The pyramid of an image band is requested twice with the image being locked
+ * and unlocked in between, as the algorithms do for each run. The second request
+ * has to return the cached pyramid. After a band has been changed, a new pyramid
+ * has to be built. The program returns a non-zero exit code if any check fails.
+ */
+
+using namespace graipe;
+
+/**
+ * Prints an error message if a check fails.
+ *
+ * \param condition The result of the check.
+ * \param message The message, which is printed if the check fails.
+ * \return 0 if the check succeeded, else 1.
+ */
+int check(bool condition, const char* message)
+{
+    if(!condition)
+    {
+        std::printf("ERROR: %s\n", message);
+        return 1;
+    }
+    return 0;
+}
+
+int main()
+{
+    Workspace wsp;
+    Image<float>* image = new Image<float>(Image<float>::Size_Type(64, 64), 2, &wsp);
+    
+    vigra::MultiArray<2, float> band(image->band(0).shape());
+    for(int y=0; y<band.height(); ++y)
+    {
+        for(int x=0; x<band.width(); ++x)
+        {
+            band(x,y) = x*y % 17;
+        }
+    }
+    image->setBand(0, band);
+    
+    ImagePyramidCache* cache = ImagePyramidCache::cache(&wsp);
+    int failures = 0;
+    
+    //First run: builds the pyramid
+    unsigned int unlock_code = image->lockForRead();
+    ImagePyramidCache::PyramidPointer first = cache->pyramid(image, 0, image->band(0), 3);
+    image->unlock(unlock_code);
+    
+    //Second run on the same image: reuses the pyramid
+    unlock_code = image->lockForRead();
+    ImagePyramidCache::PyramidPointer second = cache->pyramid(image, 0, image->band(0), 3);
+    image->unlock(unlock_code);
+    
+    failures += check(first == second, "the second run does not reuse the cached pyramid");
+    
+    //Another band of the same image has its own pyramid
+    ImagePyramidCache::PyramidPointer other = cache->pyramid(image, 1, image->band(1), 3);
+    failures += check(other != first, "two bands share one pyramid");
+    
+    //Changing the image rebuilds the pyramid
+    band(0,0) = 100;
+    image->setBand(0, band);
+    
+    ImagePyramidCache::PyramidPointer changed = cache->pyramid(image, 0, image->band(0), 3);
+    failures += check(changed != first, "the pyramid of a changed image is reused");
+    failures += check(cache->pyramid(image, 0, image->band(0), 3) == changed, "the rebuilt pyramid is not cached");
+    
+    delete image;
+    
+    return (failures == 0) ? 0 : 1;
+}
+
+/**
+ * @}
+ */
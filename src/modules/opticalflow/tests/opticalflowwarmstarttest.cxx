@@ -0,0 +1,220 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "opticalflow/opticalflowframework.hxx"
+#include "opticalflow/opticalflow_global.hxx"
+
+#include <vigra/multi_array.hxx>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/**
+ * @addtogroup graipe_opticalflow
+ * @{
+ *
+ * @file
+ * @brief Regression test of warm starts together with the global motion estimation
+ *
+ * Usage: opticalflowwarmstarttest [width height]
+ *
+ * A smooth random texture is sampled once directly and once translated. The
+ * flow is computed with the global motion estimation, once without and once
+ * with the true flow as the initial flow (like a warm start by the previous
+ * pair of a series). Since the initial flow already contains the global motion,
+ * both results need to match the true flow. The program returns a non-zero
+ * exit code if the mean endpoint error of any run exceeds the tolerance.
+ */
+
+using namespace graipe;
+
+/**
+ * A smooth random texture, which is the sum of gaussian blobs.
+ */
+class Texture
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param width  The width of the area, which is covered by the blobs.
+         * \param height The height of the area, which is covered by the blobs.
+         */
+        Texture(int width, int height)
+        {
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            
+            int blobs = width*height/25;
+            
+            for(int i=0; i<blobs; ++i)
+            {
+                m_x.push_back((unit(rng)*1.5 - 0.25)*width);
+                m_y.push_back((unit(rng)*1.5 - 0.25)*height);
+                m_sigma.push_back(2.0 + 3.0*unit(rng));
+                m_amplitude.push_back(100.0*(2.0*unit(rng) - 1.0));
+            }
+        }
+    
+        /**
+         * Returns the texture's value at a (subpixel) position.
+         *
+         * \param x The x-coordinate.
+         * \param y The y-coordinate.
+         * \return The value at (x,y).
+         */
+        double operator()(double x, double y) const
+        {
+            double value = 128;
+            
+            for(unsigned int i=0; i<m_x.size(); ++i)
+            {
+                double dx = x - m_x[i], dy = y - m_y[i];
+                double d2 = dx*dx + dy*dy;
+                
+                if(d2 < 25*m_sigma[i]*m_sigma[i])
+                {
+                    value += m_amplitude[i]*std::exp(-d2/(2*m_sigma[i]*m_sigma[i]));
+                }
+            }
+            return value;
+        }
+    
+    private:
+        /** The blobs **/
+        std::vector<double> m_x, m_y, m_sigma, m_amplitude;
+};
+
+/**
+ * Returns the mean endpoint error of a flow against a constant translation
+ * inside the image without a border, where the functors have no (or unreliable)
+ * results.
+ *
+ * \param flow   The estimated flow.
+ * \param tx     The translation in x-direction.
+ * \param ty     The translation in y-direction.
+ * \param border The width of the ignored border.
+ * \return The mean endpoint error.
+ */
+template <class FlowValueType>
+double meanEndpointError(const vigra::MultiArray<2, FlowValueType> & flow,
+                         double tx, double ty, int border)
+{
+    double sum = 0;
+    int count = 0;
+    
+    for(int y=border; y<flow.height()-border; ++y)
+    {
+        for(int x=border; x<flow.width()-border; ++x)
+        {
+            double du = flow(x,y)[0] - tx,
+                   dv = flow(x,y)[1] - ty;
+            
+            sum += std::sqrt(du*du + dv*dv);
+            ++count;
+        }
+    }
+    return (count != 0) ? sum/count : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    typedef OpticalFlowHSFunctor::FlowValueType FlowValueType;
+    
+    int width  = (argc > 1) ? std::atoi(argv[1]) : 128;
+    int height = (argc > 2) ? std::atoi(argv[2]) : 128;
+    
+    const double tx = 4.0, ty = -3.0;
+    const double tolerance = 0.25;
+    const int border = 16;
+    
+    Texture texture(width, height);
+    
+    vigra::MultiArray<2, float> image1(vigra::Shape2(width, height)),
+                                image2(vigra::Shape2(width, height));
+    
+    for(int y=0; y<height; ++y)
+    {
+        for(int x=0; x<width; ++x)
+        {
+            image1(x,y) = texture(x,y);
+            image2(x,y) = texture(x - tx, y - ty);
+        }
+    }
+    
+    int failures = 0;
+    
+    for(int warm_start=0; warm_start!=2; ++warm_start)
+    {
+        vigra::MultiArray<2, FlowValueType> flow(image1.shape());
+        
+        if(warm_start)
+        {
+            for(FlowValueType & value : flow)
+            {
+                value[0] = tx;
+                value[1] = ty;
+            }
+        }
+        
+        vigra::Matrix<double> mat(3,3);
+        double rotation_correlation = 0, translation_correlation = 0;
+        
+        calculateOFCE(image1, image2, flow,
+                      OpticalFlowHSFunctor(10.0, 200, 1.0),
+                      true,
+                      mat, rotation_correlation, translation_correlation);
+        
+        double error = meanEndpointError(flow, tx, ty, border);
+        
+        std::printf("%-10s | global motion (%7.3f, %7.3f) | mean endpoint error %10.5f\n",
+                    warm_start ? "warm start" : "cold start", mat(0,2), mat(1,2), error);
+        
+        if(error > tolerance)
+        {
+            std::printf("  ERROR: the flow deviates by more than %g pixels\n", tolerance);
+            ++failures;
+        }
+    }
+    
+    return (failures == 0) ? 0 : 1;
+}
+
+/**
+ * @}
+ */
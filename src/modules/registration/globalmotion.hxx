@@ -0,0 +1,639 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef GRAIPE_REGISTRATION_GLOBALMOTION_HXX
+#define GRAIPE_REGISTRATION_GLOBALMOTION_HXX
+
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <fftw3.h>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <vigra/mathutil.hxx>
+#include <vigra/multi_array.hxx>
+#include <vigra/matrix.hxx>
+
+namespace graipe {
+
+/**
+ * @addtogroup graipe_registration
+ * @{
+ *
+ * @file
+ * @brief Header file for the FFT-based global motion estimation
+ */
+
+/**
+ * This class estimates the global motion (rotation and translation) between two
+ * images by means of the Fourier transform. The rotation is derived from the
+ * circular correlation of the log-magnitude spectra in polar coordinates, which do
+ * not depend on the translation. The translation is then derived by means of the
+ * phase correlation of the first image (rotated) and the second image. Since the
+ * magnitude spectra are point-symmetric, both possible rotations (phi and phi+180)
+ * are tested and the one, which yields the higher translation correlation, is used.
+ *
+ * In contrast to vigra::estimateGlobalRotationTranslation, the FFTW plans and the
+ * (aligned) buffers are created only once for each image shape and reused for all
+ * further estimations of this shape, e.g. for all image pairs of a series or for
+ * levels, which are visited more than once by the hierarchical methods.
+ *
+ * An estimator must not be used by more than one thread at the same time, but many
+ * estimators may be used concurrently. The planning is serialized, and the plans of
+ * already seen sizes are created fast by means of the FFTW wisdom.
+ */
+class GlobalMotionEstimator
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param planner_flags The FFTW planner flags. FFTW_MEASURE takes longer to
+         *                      create the plans but yields faster transforms, which 
+         *                      pays off if many images of the same size are processed.
+         */
+        explicit GlobalMotionEstimator(unsigned int planner_flags = FFTW_ESTIMATE)
+        :   m_planner_flags(planner_flags)
+        {
+        }
+    
+        /**
+         * Destructor. Destroys all plans and frees all buffers.
+         */
+        ~GlobalMotionEstimator()
+        {
+            QMutexLocker locker(&plannerMutex());
+            
+            for(std::map<std::pair<int,int>, Engine*>::iterator iter=m_engines.begin(); iter!=m_engines.end(); ++iter)
+            {
+                delete iter->second;
+            }
+        }
+    
+        /**
+         * Estimates the global rotation and translation between two images. The resulting 
+         * matrix maps the coordinates of the second image to the coordinates of the first
+         * image, thus the first image may be aligned to the second by means of an affine
+         * warping without an inversion: in2(x) ~ in1(mat*x).
+         *
+         * \param[in] in1 The first image.
+         * \param[in] in2 The second image.
+         * \param[out] mat The affine transformation (3x3) from the second to the first image.
+         * \param[out] rotation_correlation The correlation of the polar magnitude spectra.
+         * \param[out] translation_correlation The correlation of the aligned images.
+         */
+        template <class T1, class S1, class T2, class S2>
+        void estimate(const vigra::MultiArrayView<2,T1,S1> & in1,
+                      const vigra::MultiArrayView<2,T2,S2> & in2,
+                      vigra::Matrix<double> & mat,
+                      double & rotation_correlation,
+                      double & translation_correlation)
+        {
+            vigra_precondition(in1.shape() == in2.shape(), "image sizes differ!");
+            
+            mat = vigra::identityMatrix<double>(3);
+            rotation_correlation = translation_correlation = 0;
+            
+            if(in1.width() < 8 || in1.height() < 8)
+            {
+                return;
+            }
+            
+            Engine & engine = this->engine(in1.width(), in1.height());
+            
+            //1. Rotation, up to +/- 180 degrees
+            engine.polarSpectrum(in1, engine.polar1);
+            engine.polarSpectrum(in2, engine.polar2);
+            double angle = engine.rotation(rotation_correlation);
+            
+            //2. Translation for both possible rotations
+            engine.copy(in1, engine.image1);
+            engine.copy(in2, engine.image2);
+            engine.windowed(engine.image2, engine.real);
+            fftw_execute_dft_r2c(engine.forward, engine.real, engine.spectrum2);
+            
+            for(int candidate=0; candidate!=2; ++candidate)
+            {
+                vigra::Matrix<double> rotation = engine.rotationMatrix(angle + candidate*180.0);
+                
+                double correlation = 0;
+                vigra::Matrix<double> candidate_mat = engine.translation(rotation, correlation);
+                
+                if(candidate==0 || correlation > translation_correlation)
+                {
+                    mat = candidate_mat;
+                    translation_correlation = correlation;
+                }
+            }
+        }
+    
+    private:
+        /**
+         * The plans and buffers for one image shape.
+         */
+        struct Engine
+        {
+            /**
+             * Constructor. Allocates all buffers and creates all plans for the given size.
+             * Needs to be called with a locked planner mutex.
+             *
+             * \param w The width of the images.
+             * \param h The height of the images.
+             * \param flags The FFTW planner flags.
+             */
+            Engine(int w, int h, unsigned int flags)
+            :   width(w), height(h),
+                cwidth(w/2+1),
+                angles(360),
+                radii(std::max(8, std::min(w,h)/4)),
+                window_x(w), window_y(h),
+                valid(w*h)
+            {
+                real      = fftw_alloc_real(width*height);
+                image1    = fftw_alloc_real(width*height);
+                image2    = fftw_alloc_real(width*height);
+                spectrum1 = fftw_alloc_complex(cwidth*height);
+                spectrum2 = fftw_alloc_complex(cwidth*height);
+                magnitude = fftw_alloc_real(cwidth*height);
+                
+                polar1    = fftw_alloc_real(angles*radii);
+                polar2    = fftw_alloc_real(angles*radii);
+                polar_spectrum1 = fftw_alloc_complex((angles/2+1)*radii);
+                polar_spectrum2 = fftw_alloc_complex((angles/2+1)*radii);
+                angle_spectrum  = fftw_alloc_complex(angles/2+1);
+                angle_correlation = fftw_alloc_real(angles);
+                
+                //FFTW_MEASURE overwrites the buffers, they are filled afterwards
+                forward  = fftw_plan_dft_r2c_2d(height, width, real, spectrum1, flags);
+                backward = fftw_plan_dft_c2r_2d(height, width, spectrum1, real, flags);
+                
+                int n = angles;
+                polar_forward  = fftw_plan_many_dft_r2c(1, &n, radii,
+                                                        polar1, NULL, 1, angles,
+                                                        polar_spectrum1, NULL, 1, angles/2+1,
+                                                        flags);
+                angle_backward = fftw_plan_dft_c2r_1d(angles, angle_spectrum, angle_correlation, flags);
+                
+                //Hann window to suppress the spectral leakage of the image borders
+                for(int x=0; x<width; ++x)
+                {
+                    window_x[x] = 0.5 - 0.5*cos(2.0*M_PI*x/(width-1));
+                }
+                for(int y=0; y<height; ++y)
+                {
+                    window_y[y] = 0.5 - 0.5*cos(2.0*M_PI*y/(height-1));
+                }
+            }
+            
+            /**
+             * Destructor. Needs to be called with a locked planner mutex.
+             */
+            ~Engine()
+            {
+                fftw_destroy_plan(forward);
+                fftw_destroy_plan(backward);
+                fftw_destroy_plan(polar_forward);
+                fftw_destroy_plan(angle_backward);
+                
+                fftw_free(real);
+                fftw_free(image1);
+                fftw_free(image2);
+                fftw_free(spectrum1);
+                fftw_free(spectrum2);
+                fftw_free(magnitude);
+                fftw_free(polar1);
+                fftw_free(polar2);
+                fftw_free(polar_spectrum1);
+                fftw_free(polar_spectrum2);
+                fftw_free(angle_spectrum);
+                fftw_free(angle_correlation);
+            }
+            
+            /**
+             * Copies an image into a (row-major) buffer.
+             *
+             * \param in The image.
+             * \param[out] out The buffer.
+             */
+            template <class T, class S>
+            void copy(const vigra::MultiArrayView<2,T,S> & in, double * out) const
+            {
+                for(int y=0; y<height; ++y)
+                {
+                    for(int x=0; x<width; ++x)
+                    {
+                        out[y*width+x] = in(x,y);
+                    }
+                }
+            }
+            
+            /**
+             * Multiplies a (row-major) image buffer by the Hann window after subtracting
+             * its mean, which suppresses the spectral leakage of the image borders.
+             *
+             * \param in The image buffer.
+             * \param[out] out The windowed image buffer.
+             */
+            void windowed(const double * in, double * out) const
+            {
+                double mean = 0;
+                for(int i=0; i<width*height; ++i)
+                {
+                    mean += in[i];
+                }
+                mean /= width*height;
+                
+                for(int y=0; y<height; ++y)
+                {
+                    for(int x=0; x<width; ++x)
+                    {
+                        out[y*width+x] = (in[y*width+x] - mean)*window_x[x]*window_y[y];
+                    }
+                }
+            }
+            
+            /**
+             * Samples the (windowed) log-magnitude spectrum of an image in polar coordinates.
+             * The angles cover [0, 180) degrees and the radii cover the frequencies between
+             * 0.05 and 0.45 cycles per pixel (without DC and corners). Each row of the result
+             * contains all angles of one radius. The result is zero-mean.
+             *
+             * \param in The image.
+             * \param[out] polar The polar spectrum.
+             */
+            template <class T, class S>
+            void polarSpectrum(const vigra::MultiArrayView<2,T,S> & in, double * polar)
+            {
+                copy(in, image2);
+                windowed(image2, real);
+                
+                fftw_execute_dft_r2c(forward, real, spectrum1);
+                
+                for(int i=0; i<cwidth*height; ++i)
+                {
+                    magnitude[i] = log(1.0 + sqrt(spectrum1[i][0]*spectrum1[i][0] + spectrum1[i][1]*spectrum1[i][1]));
+                }
+                
+                double polar_mean = 0;
+                
+                for(int r=0; r<radii; ++r)
+                {
+                    double rho = 0.05 + 0.4*r/(radii-1);
+                    
+                    for(int a=0; a<angles; ++a)
+                    {
+                        double theta = M_PI*a/angles;
+                        
+                        //Frequency indices, the magnitude is point-symmetric
+                        double kx = rho*width*cos(theta),
+                               ky = rho*height*sin(theta);
+                        if(kx < 0)
+                        {
+                            kx = -kx;
+                            ky = -ky;
+                        }
+                        
+                        int x0 = (int)kx;
+                        int y0 = (int)floor(ky);
+                        double dx = kx - x0,
+                               dy = ky - y0;
+                        
+                        int y1 = ((y0+1)%height + height)%height;
+                        y0 = (y0%height + height)%height;
+                        
+                        double value =    (1-dx)*(1-dy)*magnitude[y0*cwidth+x0]   + dx*(1-dy)*magnitude[y0*cwidth+x0+1]
+                                        + (1-dx)*dy    *magnitude[y1*cwidth+x0]   + dx*dy    *magnitude[y1*cwidth+x0+1];
+                        
+                        polar[r*angles+a] = value;
+                        polar_mean += value;
+                    }
+                }
+                
+                polar_mean /= angles*radii;
+                
+                for(int i=0; i<angles*radii; ++i)
+                {
+                    polar[i] -= polar_mean;
+                }
+            }
+            
+            /**
+             * Finds the rotation between both polar spectra by means of their circular
+             * correlation along the angles (summed over all radii).
+             *
+             * \param[out] correlation The normalized correlation at the best angle.
+             * \return The rotation angle in degrees [0, 180).
+             */
+            double rotation(double & correlation)
+            {
+                fftw_execute_dft_r2c(polar_forward, polar1, polar_spectrum1);
+                fftw_execute_dft_r2c(polar_forward, polar2, polar_spectrum2);
+                
+                int cangles = angles/2+1;
+                
+                for(int a=0; a<cangles; ++a)
+                {
+                    angle_spectrum[a][0] = angle_spectrum[a][1] = 0;
+                    
+                    for(int r=0; r<radii; ++r)
+                    {
+                        const fftw_complex & p1 = polar_spectrum1[r*cangles+a];
+                        const fftw_complex & p2 = polar_spectrum2[r*cangles+a];
+                        
+                        //p1 * conj(p2)
+                        angle_spectrum[a][0] += p1[0]*p2[0] + p1[1]*p2[1];
+                        angle_spectrum[a][1] += p1[1]*p2[0] - p1[0]*p2[1];
+                    }
+                }
+                
+                fftw_execute(angle_backward);
+                
+                int best = (int)(std::max_element(angle_correlation, angle_correlation+angles) - angle_correlation);
+                
+                double norm1 = 0, norm2 = 0;
+                for(int i=0; i<angles*radii; ++i)
+                {
+                    norm1 += polar1[i]*polar1[i];
+                    norm2 += polar2[i]*polar2[i];
+                }
+                
+                correlation = (norm1*norm2 > 0) ? angle_correlation[best]/angles/sqrt(norm1*norm2) : 0;
+                
+                double offset = peakOffset(angle_correlation[(best+angles-1)%angles],
+                                           angle_correlation[best],
+                                           angle_correlation[(best+1)%angles]);
+                
+                return (best + offset)*180.0/angles;
+            }
+            
+            /**
+             * Creates the rotation matrix around the image center.
+             *
+             * \param degrees The angle of the rotation.
+             * \return The affine 3x3 matrix of the rotation.
+             */
+            vigra::Matrix<double> rotationMatrix(double degrees) const
+            {
+                double c = cos(degrees*M_PI/180.0),
+                       s = sin(degrees*M_PI/180.0),
+                       cx = (width-1)/2.0,
+                       cy = (height-1)/2.0;
+                
+                vigra::Matrix<double> mat = vigra::identityMatrix<double>(3);
+                mat(0,0) = c;   mat(0,1) = -s;  mat(0,2) = cx - c*cx + s*cy;
+                mat(1,0) = s;   mat(1,1) = c;   mat(1,2) = cy - s*cx - c*cy;
+                return mat;
+            }
+            
+            /**
+             * Finds the translation between the rotated first image and the second image
+             * by means of phase correlation. The spectrum of the second image has to be
+             * stored in spectrum2 before.
+             *
+             * \param rotation The rotation of the first image.
+             * \param[out] correlation The correlation coefficient of the aligned images.
+             * \return The complete transformation from the second to the first image.
+             */
+            vigra::Matrix<double> translation(const vigra::Matrix<double> & rotation, double & correlation)
+            {
+                //Rotate the first image (bilinear), fill the outside by the mean
+                double mean = 0;
+                for(int i=0; i<width*height; ++i)
+                {
+                    mean += image1[i];
+                }
+                mean /= width*height;
+                
+                for(int y=0; y<height; ++y)
+                {
+                    for(int x=0; x<width; ++x)
+                    {
+                        double sx = rotation(0,0)*x + rotation(0,1)*y + rotation(0,2),
+                               sy = rotation(1,0)*x + rotation(1,1)*y + rotation(1,2);
+                        
+                        int x0 = (int)floor(sx),
+                            y0 = (int)floor(sy);
+                        
+                        if(x0 >= 0 && y0 >= 0 && x0+1 < width && y0+1 < height)
+                        {
+                            double dx = sx - x0,
+                                   dy = sy - y0;
+                            real[y*width+x] =   (1-dx)*(1-dy)*image1[y0*width+x0]     + dx*(1-dy)*image1[y0*width+x0+1]
+                                              + (1-dx)*dy    *image1[(y0+1)*width+x0] + dx*dy    *image1[(y0+1)*width+x0+1];
+                            valid[y*width+x] = 1;
+                        }
+                        else
+                        {
+                            real[y*width+x] = mean;
+                            valid[y*width+x] = 0;
+                        }
+                    }
+                }
+                
+                std::vector<double> rotated(real, real+width*height);
+                
+                //Normalized cross power spectrum: F_rotated * conj(F_2) / |...|
+                windowed(&rotated[0], real);
+                fftw_execute_dft_r2c(forward, real, spectrum1);
+                
+                for(int i=0; i<cwidth*height; ++i)
+                {
+                    double re = spectrum1[i][0]*spectrum2[i][0] + spectrum1[i][1]*spectrum2[i][1],
+                           im = spectrum1[i][1]*spectrum2[i][0] - spectrum1[i][0]*spectrum2[i][1],
+                           length = sqrt(re*re + im*im);
+                    
+                    spectrum1[i][0] = (length > 1.0e-12) ? re/length : 0;
+                    spectrum1[i][1] = (length > 1.0e-12) ? im/length : 0;
+                }
+                
+                fftw_execute_dft_c2r(backward, spectrum1, real);
+                
+                int best = (int)(std::max_element(real, real+width*height) - real);
+                int bx = best % width,
+                    by = best / width;
+                
+                double sx = bx + peakOffset(real[by*width+(bx+width-1)%width], real[best], real[by*width+(bx+1)%width]),
+                       sy = by + peakOffset(real[((by+height-1)%height)*width+bx], real[best], real[((by+1)%height)*width+bx]);
+                
+                //Wrap around: shifts larger than half of the image are negative
+                if(sx > width/2)  sx -= width;
+                if(sy > height/2) sy -= height;
+                
+                //second(x) ~ rotated(x+s)
+                correlation = alignedCorrelation(rotated, vigra::round(sx), vigra::round(sy));
+                
+                vigra::Matrix<double> mat = rotation;
+                mat(0,2) = rotation(0,0)*sx + rotation(0,1)*sy + rotation(0,2);
+                mat(1,2) = rotation(1,0)*sx + rotation(1,1)*sy + rotation(1,2);
+                return mat;
+            }
+            
+            /**
+             * Computes the correlation coefficient of the second image and the shifted,
+             * rotated first image, where the latter is valid.
+             *
+             * \param rotated The rotated first image.
+             * \param sx The shift in x-direction.
+             * \param sy The shift in y-direction.
+             * \return The correlation coefficient.
+             */
+            double alignedCorrelation(const std::vector<double> & rotated, int sx, int sy)
+            {
+                double n = 0, s1 = 0, s2 = 0, s11 = 0, s22 = 0, s12 = 0;
+                
+                for(int y=std::max(0,-sy); y<std::min(height, height-sy); ++y)
+                {
+                    for(int x=std::max(0,-sx); x<std::min(width, width-sx); ++x)
+                    {
+                        int i = (y+sy)*width + x+sx;
+                        
+                        if(valid[i])
+                        {
+                            double v1 = rotated[i],
+                                   v2 = image2[y*width+x];
+                            n   += 1;
+                            s1  += v1;      s2  += v2;
+                            s11 += v1*v1;   s22 += v2*v2;
+                            s12 += v1*v2;
+                        }
+                    }
+                }
+                
+                if(n < 2)
+                {
+                    return 0;
+                }
+                
+                double var1 = s11 - s1*s1/n,
+                       var2 = s22 - s2*s2/n;
+                
+                return (var1*var2 > 0) ? (s12 - s1*s2/n)/sqrt(var1*var2) : 0;
+            }
+            
+            /**
+             * Subpixel position of a peak by means of a parabola fit.
+             *
+             * \param left The value left of the peak.
+             * \param center The value at the peak.
+             * \param right The value right of the peak.
+             * \return The offset of the peak in [-0.5, 0.5].
+             */
+            static double peakOffset(double left, double center, double right)
+            {
+                double denominator = left - 2*center + right;
+                
+                if(denominator >= 0)
+                {
+                    return 0;
+                }
+                return std::max(-0.5, std::min(0.5, 0.5*(left - right)/denominator));
+            }
+            
+            /** The size of the images **/
+            int width, height, cwidth;
+            /** The size of the polar spectra **/
+            int angles, radii;
+            /** The separable Hann window **/
+            std::vector<double> window_x, window_y;
+            /** Where the rotated first image is defined **/
+            std::vector<unsigned char> valid;
+            
+            /** The buffers of the images and spectra **/
+            double * real, * image1, * image2, * magnitude;
+            fftw_complex * spectrum1, * spectrum2;
+            
+            /** The buffers of the polar spectra **/
+            double * polar1, * polar2, * angle_correlation;
+            fftw_complex * polar_spectrum1, * polar_spectrum2, * angle_spectrum;
+            
+            /** The plans **/
+            fftw_plan forward, backward, polar_forward, angle_backward;
+        };
+    
+        /**
+         * Returns the plans and buffers for the given image size. They are created
+         * on the first use of each size.
+         *
+         * \param width The width of the images.
+         * \param height The height of the images.
+         * \return The plans and buffers.
+         */
+        Engine & engine(int width, int height)
+        {
+            std::pair<int,int> key(width, height);
+            
+            std::map<std::pair<int,int>, Engine*>::iterator iter = m_engines.find(key);
+            
+            if(iter == m_engines.end())
+            {
+                QMutexLocker locker(&plannerMutex());
+                iter = m_engines.insert(std::make_pair(key, new Engine(width, height, m_planner_flags))).first;
+            }
+            return *iter->second;
+        }
+    
+        /**
+         * The FFTW planner is not thread-safe, so the creation and destruction of all
+         * plans is serialized by means of this mutex.
+         *
+         * \return The mutex.
+         */
+        static QMutex & plannerMutex()
+        {
+            static QMutex mutex;
+            return mutex;
+        }
+    
+        /** No copies, since the plans are owned **/
+        GlobalMotionEstimator(const GlobalMotionEstimator &);
+        GlobalMotionEstimator & operator=(const GlobalMotionEstimator &);
+    
+        /** The FFTW planner flags **/
+        unsigned int m_planner_flags;
+        /** The plans and buffers for each image size **/
+        std::map<std::pair<int,int>, Engine*> m_engines;
+};
+
+/**
+ * @}
+ */
+
+} //end of namespace graipe
+
+#endif //GRAIPE_REGISTRATION_GLOBALMOTION_HXX
@@ -21,6 +21,7 @@
 #include "registration/piecewiseaffine_registration.hxx"
 #include "registration/delaunay.hxx"
 #include "registration/warpingfunctors.hxx"
+#include "registration/globalmotion.hxx"
 
 /**
  * @}
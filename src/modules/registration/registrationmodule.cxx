@@ -38,6 +38,7 @@
 #include "core/core.h"
 
 #include "registration/warpingfunctors.hxx"
+#include "registration/globalmotion.hxx"
 
 #include <vigra/affine_registration_fft.hxx>
 
@@ -117,11 +118,11 @@ class GlobalMotionCorrector
                     QElapsedTimer timer;
                     timer.start();
                     
-                    estimateGlobalRotationTranslation(imageband1,
-                                                      imageband2,
-                                                      mat,
-                                                      rotation_correlation,
-                                                      translation_correlation);
+                    m_gme.estimate(imageband1,
+                                   imageband2,
+                                   mat,
+                                   rotation_correlation,
+                                   translation_correlation);
                     
                     Image<float>* displaced_image = new Image<float>(imageband2.shape(), m_param_imageBand1->image()->numBands(), m_workspace);
                     
@@ -185,6 +186,9 @@ class GlobalMotionCorrector
         /**
          * @}
          */
+    
+        /** The global motion estimator, which keeps its plans for further runs **/
+        GlobalMotionEstimator m_gme;
 };
 
 /** 
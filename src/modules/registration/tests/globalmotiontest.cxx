@@ -0,0 +1,248 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2008-2017 by Benjamin Seppke                 */
+/*       Cognitive Systems Group, University of Hamburg, Germany        */
+/*                                                                      */
+/*    This file is part of the GrAphical Image Processing Enviroment.   */
+/*    The GRAIPE Website may be found at:                               */
+/*        https://github.com/bseppke/graipe                             */
+/*    Please direct questions, bug reports, and contributions to        */
+/*    the GitHub page and use the methods provided there.               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include "registration/globalmotion.hxx"
+
+#include <vigra/multi_array.hxx>
+#include <vigra/affine_registration_fft.hxx>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/**
+ * @addtogroup graipe_registration
+ * @{
+ *
+ * @file
+ * @brief Regression test of the global motion estimator against VIGRA
+ *
+ * Usage: globalmotiontest [width height]
+ *
+ * A smooth random texture is sampled once directly and once rotated and 
+ * translated, thus no interpolation errors are introduced. For each synthetic
+ * motion, the matrices of graipe::GlobalMotionEstimator and of
+ * vigra::estimateGlobalRotationTranslation are compared with the true motion
+ * and with each other. The runtimes of both are reported, too. The program
+ * returns a non-zero exit code if any of the estimates is off.
+ */
+
+using namespace graipe;
+
+/**
+ * A smooth random texture, which is the sum of gaussian blobs.
+ */
+class Texture
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * \param width  The width of the area, which is covered by the blobs.
+         * \param height The height of the area, which is covered by the blobs.
+         */
+        Texture(int width, int height)
+        {
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            
+            int blobs = width*height/25;
+            
+            for(int i=0; i<blobs; ++i)
+            {
+                m_x.push_back((unit(rng)*2.0 - 0.5)*width);
+                m_y.push_back((unit(rng)*2.0 - 0.5)*height);
+                m_sigma.push_back(1.5 + 3.0*unit(rng));
+                m_amplitude.push_back(2.0*unit(rng) - 1.0);
+            }
+        }
+    
+        /**
+         * Returns the texture's value at a (subpixel) position.
+         *
+         * \param x The x-coordinate.
+         * \param y The y-coordinate.
+         * \return The value at (x,y).
+         */
+        double operator()(double x, double y) const
+        {
+            double value = 0;
+            
+            for(unsigned int i=0; i<m_x.size(); ++i)
+            {
+                double dx = x - m_x[i], dy = y - m_y[i];
+                double d2 = dx*dx + dy*dy;
+                
+                if(d2 < 25*m_sigma[i]*m_sigma[i])
+                {
+                    value += m_amplitude[i]*std::exp(-d2/(2*m_sigma[i]*m_sigma[i]));
+                }
+            }
+            return value;
+        }
+    
+    private:
+        /** The blobs **/
+        std::vector<double> m_x, m_y, m_sigma, m_amplitude;
+};
+
+/**
+ * Compares two global motion matrices.
+ *
+ * \param a The first matrix.
+ * \param b The second matrix.
+ * \param[out] angle_error The difference of the rotation angles in degrees.
+ * \param[out] translation_error The largest displacement of the image corners in pixels.
+ * \param width  The width of the image.
+ * \param height The height of the image.
+ */
+void compareMotions(const vigra::Matrix<double> & a, const vigra::Matrix<double> & b,
+                    double & angle_error, double & translation_error,
+                    int width, int height)
+{
+    angle_error = (std::atan2(a(1,0), a(0,0)) - std::atan2(b(1,0), b(0,0)))*180.0/M_PI;
+    angle_error = std::fabs(std::remainder(angle_error, 360.0));
+    
+    translation_error = 0;
+    
+    for(int corner=0; corner<4; ++corner)
+    {
+        double x = (corner & 1) ? width-1 : 0,
+               y = (corner & 2) ? height-1 : 0;
+        
+        double dx = (a(0,0) - b(0,0))*x + (a(0,1) - b(0,1))*y + a(0,2) - b(0,2),
+               dy = (a(1,0) - b(1,0))*x + (a(1,1) - b(1,1))*y + a(1,2) - b(1,2);
+        
+        translation_error = std::max(translation_error, std::sqrt(dx*dx + dy*dy));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int width  = (argc > 1) ? std::atoi(argv[1]) : 128;
+    int height = (argc > 2) ? std::atoi(argv[2]) : 128;
+    
+    //Rotation (degrees) and translation of the synthetic motions
+    const double motions[][3] = { {  0.0,  3.0, -2.0},
+                                  { 10.0,  2.0,  1.0},
+                                  {-15.0, -1.0,  4.0},
+                                  { 30.0,  0.0,  0.0},
+                                  {  0.0, -6.5,  2.5} };
+    
+    const double max_angle_error = 1.0;
+    const double max_corner_error = 2.0;
+    
+    Texture texture(width, height);
+    
+    vigra::MultiArray<2, float> image1(vigra::Shape2(width, height)),
+                                image2(vigra::Shape2(width, height));
+    
+    double cx = (width-1)/2.0, cy = (height-1)/2.0;
+    
+    for(int y=0; y<height; ++y)
+    {
+        for(int x=0; x<width; ++x)
+        {
+            image1(x,y) = texture(x,y);
+        }
+    }
+    
+    GlobalMotionEstimator gme;
+    int failures = 0;
+    
+    std::printf("Global motion on %dx%d images, errors in degrees / pixels, times in ms\n", width, height);
+    std::printf("%7s %6s %6s | %9s %9s %9s | %9s %9s %9s\n",
+                "angle", "tx", "ty", "gme angle", "gme px", "gme ms", "vigra ang", "vigra px", "vigra ms");
+    
+    for(const double * motion : motions)
+    {
+        //The true motion around the image center: image2(x) = image1(mat*x)
+        double phi = motion[0]*M_PI/180.0;
+        
+        vigra::Matrix<double> true_mat = vigra::identityMatrix<double>(3);
+        true_mat(0,0) = std::cos(phi); true_mat(0,1) = -std::sin(phi);
+        true_mat(1,0) = std::sin(phi); true_mat(1,1) =  std::cos(phi);
+        true_mat(0,2) = cx - true_mat(0,0)*cx - true_mat(0,1)*cy + motion[1];
+        true_mat(1,2) = cy - true_mat(1,0)*cx - true_mat(1,1)*cy + motion[2];
+        
+        for(int y=0; y<height; ++y)
+        {
+            for(int x=0; x<width; ++x)
+            {
+                image2(x,y) = texture(true_mat(0,0)*x + true_mat(0,1)*y + true_mat(0,2),
+                                      true_mat(1,0)*x + true_mat(1,1)*y + true_mat(1,2));
+            }
+        }
+        
+        vigra::Matrix<double> gme_mat, vigra_mat;
+        double rotation_correlation, translation_correlation;
+        
+        auto start = std::chrono::steady_clock::now();
+        gme.estimate(image1, image2, gme_mat, rotation_correlation, translation_correlation);
+        auto middle = std::chrono::steady_clock::now();
+        vigra::estimateGlobalRotationTranslation(image1, image2, vigra_mat, rotation_correlation, translation_correlation);
+        auto end = std::chrono::steady_clock::now();
+        
+        double gme_angle, gme_corner, vigra_angle, vigra_corner, angle_difference, corner_difference;
+        compareMotions(gme_mat, true_mat, gme_angle, gme_corner, width, height);
+        compareMotions(vigra_mat, true_mat, vigra_angle, vigra_corner, width, height);
+        compareMotions(gme_mat, vigra_mat, angle_difference, corner_difference, width, height);
+        
+        std::printf("%7.1f %6.1f %6.1f | %9.3f %9.3f %9.1f | %9.3f %9.3f %9.1f\n",
+                    motion[0], motion[1], motion[2],
+                    gme_angle, gme_corner, std::chrono::duration<double, std::milli>(middle - start).count(),
+                    vigra_angle, vigra_corner, std::chrono::duration<double, std::milli>(end - middle).count());
+        
+        if(gme_angle > max_angle_error || gme_corner > max_corner_error)
+        {
+            std::printf("  ERROR: the estimator misses the true motion\n");
+            ++failures;
+        }
+        if(angle_difference > max_angle_error || corner_difference > max_corner_error)
+        {
+            std::printf("  ERROR: the estimator differs from VIGRA (%.3f degrees, %.3f pixels)\n", angle_difference, corner_difference);
+            ++failures;
+        }
+    }
+    
+    return (failures == 0) ? 0 : 1;
+}
+
+/**
+ * @}
+ */
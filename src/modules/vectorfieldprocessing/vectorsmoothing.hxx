@@ -37,6 +37,7 @@
 #define GRAIPE_VECTORFIELDPROCESSING_VECTORSMOOTHING_HXX
 
 #include <vector>
+#include <algorithm>
 
 #include <vigra/stdimage.hxx>
 #include <vigra/multi_array.hxx>
@@ -79,20 +80,33 @@ SparseWeightedVectorfield2D* smoothVectorfield(SparseWeightedMultiVectorfield2D
     
     //Prepare adjacency matrix
 	std::vector<std::vector<int> > adjacency(feature_count);
+	std::vector<unsigned int> neighbors;
+	
+	const SpatialIndex2D& index = vectorfield->spatialIndex();
+	
     for (int i=0; i< feature_count; ++i)
 	{
 		result_vectorfield->addVector(vectorfield->origin(i), vectorfield->direction(i), vectorfield->weight(i));
 		work_vectorfield->addVector(vectorfield->origin(i), vectorfield->direction(i), vectorfield->weight(i));
 		
-		for (int j=0; j<=i; ++j)
+		if(vectorfield->weight(i)>min_weight)								// corr > thresh
 		{
-            if(    (QPointFX(vectorfield->origin(i)-vectorfield->origin(j)).squaredLength()	< max_geo_distance*max_geo_distance)	// distance small enough
-				&& (vectorfield->weight(i)>min_weight))							// corr > thresh
-			{									// corr != NaN	
-				adjacency[i].push_back(j); //j is neighboured to i and thus
-				adjacency[j].push_back(i); //i is neighboured to j!
-            }
-        }
+			index.radiusSearch(vectorfield->origin(i), max_geo_distance, neighbors);
+			
+			//Keep the neighbour order of the former full scan
+			std::sort(neighbors.begin(), neighbors.end());
+			
+			for (unsigned int n=0; n<neighbors.size() && int(neighbors[n])<=i; ++n)
+			{
+				int j = neighbors[n];
+				
+				if(QPointFX(vectorfield->origin(i)-vectorfield->origin(j)).squaredLength()	< max_geo_distance*max_geo_distance)	// distance small enough
+				{
+					adjacency[i].push_back(j); //j is neighboured to i and thus
+					adjacency[j].push_back(i); //i is neighboured to j!
+				}
+			}
+		}
     }
 	
 	//Initialize the resulting vectorfield by using either all alternatives
@@ -231,18 +245,31 @@ SparseWeightedVectorfield2D * relaxVectorfield(SparseWeightedMultiVectorfield2D
 
 	//Prepare adjacency matrix
 	std::vector<std::vector<int> > adjacency(feature_count);
+	std::vector<unsigned int> neighbors;
+	
+	const SpatialIndex2D& index = vectorfield->spatialIndex();
+	
 	for (int i=0; i< feature_count; ++i)
 	{
 		result_vectorfield->addVector(vectorfield->origin(i), vectorfield->direction(i), vectorfield->weight(i));
 		work_vectorfield->addVector(vectorfield->origin(i), vectorfield->direction(i), vectorfield->weight(i));
 		
-		for (int j=0; j<=i; ++j)
+		if(vectorfield->weight(i)>min_weight)								// corr > thresh
 		{
-			if(    (QPointFX(vectorfield->origin(i)-vectorfield->origin(j)).squaredLength()	< max_geo_distance*max_geo_distance)	// distance small enough
-			   && (vectorfield->weight(i)>min_weight))							// corr > thresh
-			{									// corr != NaN	
-				adjacency[i].push_back(j); //j is neighboured to i and thus
-				adjacency[j].push_back(i); //i is neighboured to j!
+			index.radiusSearch(vectorfield->origin(i), max_geo_distance, neighbors);
+			
+			//Keep the neighbour order of the former full scan
+			std::sort(neighbors.begin(), neighbors.end());
+			
+			for (unsigned int n=0; n<neighbors.size() && int(neighbors[n])<=i; ++n)
+			{
+				int j = neighbors[n];
+				
+				if(QPointFX(vectorfield->origin(i)-vectorfield->origin(j)).squaredLength()	< max_geo_distance*max_geo_distance)	// distance small enough
+				{
+					adjacency[i].push_back(j); //j is neighboured to i and thus
+					adjacency[j].push_back(i); //i is neighboured to j!
+				}
 			}
 		}
 	}
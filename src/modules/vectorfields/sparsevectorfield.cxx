@@ -47,12 +47,14 @@ namespace graipe {
  */
 
 SparseVectorfield2D::SparseVectorfield2D(Workspace* wsp)
-:	Vectorfield2D(wsp)
+:	Vectorfield2D(wsp),
+    m_spatial_index_valid(false)
 {
 }
 
 SparseVectorfield2D::SparseVectorfield2D(const SparseVectorfield2D & vf)
-:	Vectorfield2D(vf)
+:	Vectorfield2D(vf),
+    m_spatial_index_valid(false)
 {
 	for( unsigned int i=0; i < vf.size(); ++i)
 	{
@@ -248,6 +250,28 @@ bool SparseVectorfield2D::deserialize_content(QXmlStreamReader& xmlReader)
     return true;
 }
 
+const SpatialIndex2D& SparseVectorfield2D::spatialIndex() const
+{
+    QMutexLocker locker(&m_spatial_index_mutex);
+    
+    //Items may also be appended by the CSV and XML readers without a model update
+    if(!m_spatial_index_valid || m_spatial_index.size() != m_origins.size())
+    {
+        m_spatial_index.build(m_origins.begin(), m_origins.end());
+        m_spatial_index_valid = true;
+    }
+    return m_spatial_index;
+}
+
+void SparseVectorfield2D::updateModel()
+{
+    {
+        QMutexLocker locker(&m_spatial_index_mutex);
+        m_spatial_index_valid = false;
+    }
+    Vectorfield2D::updateModel();
+}
+
 
 
 
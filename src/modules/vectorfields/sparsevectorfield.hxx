@@ -212,12 +212,35 @@ class GRAIPE_VECTORFIELDS_EXPORT SparseVectorfield2D
          * \return True, if the content could be deserialized and the model is not locked.
          */
 		virtual bool deserialize_content(QXmlStreamReader& xmlReader);
+    
+        /**
+         * Spatial index over the origins of all vectors, which may be used for
+         * radius and nearest neighbour queries. The index is built on first use and
+         * invalidated whenever the vectorfield changes.
+         *
+         * \return A KD-tree over the origins of all vectors.
+         */
+        const SpatialIndex2D& spatialIndex() const;
+    
+    protected slots:
+        /**
+         * This slot is called, whenever the vectorfield is changed.
+         * It invalidates the spatial index before informing others.
+         */
+        void updateModel();
 		
 	protected:
         /** Data container for the origins **/
         std::vector<PointType> m_origins;
         /** Data container for the directions **/
 		std::vector<PointType> m_directions;
+    
+        /** The lazily built spatial index of the origins **/
+        mutable SpatialIndex2D m_spatial_index;
+        /** Is the spatial index up to date? **/
+        mutable bool m_spatial_index_valid;
+        /** Guards the lazy construction of the spatial index **/
+        mutable QMutex m_spatial_index_mutex;
 };
 
 /**